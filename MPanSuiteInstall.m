@@ -8,7 +8,12 @@ function [] = MPanSuiteInstall
 % MEX compiler command
 % --------------------
 
-mexcompiler = 'mex -ldl -outdir ./mex_so';
+mexcompiler = 'mex -R2018a -ldl -lpthread -outdir ./mex_so';
+
+% Sources shared by all the gateways
+% ----------------------------------
+
+mexshared = ' ./mex_so/pansession.c ./mex_so/pancounter.c ./mex_so/panconsole.c ./mex_so/panmemreg.c';
 
 % Test mex and compile panet.c panget.c pansimc.c
 % -----------------------------------------------
@@ -18,11 +23,26 @@ mex_ok = check_mex(mexcompiler);
 if ~mex_ok
   return
 else
-    eval([mexcompiler ' ./mex_so/pannet.c']);
-    eval([mexcompiler ' ./mex_so/panget.c']);
-    eval([mexcompiler ' ./mex_so/pansimc.c']);
-    eval([mexcompiler ' ./mex_so/panredraw.c']);
-    eval([mexcompiler ' ./mex_so/panclearwav.c']);
+    eval([mexcompiler ' ./mex_so/pannet.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/panget.c ./mex_so/pantranspose.c ./mex_so/panquant.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/pansimc.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/pansimc_async.c ./mex_so/panworker.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/panredraw.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/panclearwav.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/panslice.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/panrawread.c ./mex_so/panrawcol.c ./mex_so/panquant.c ./mex_so/pancounter.c -lz']);
+    eval([mexcompiler ' ./mex_so/panrawconv.c ./mex_so/panrawcol.c ./mex_so/pancounter.c -lz']);
+    eval([mexcompiler ' ./mex_so/pandownsample.c ./mex_so/pandecim.c ./mex_so/panrawcol.c' mexshared ' -lz']);
+    eval([mexcompiler ' ./mex_so/panmemwav.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/pansweep.c ./mex_so/panworker.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/panbatch.c' mexshared]);
+    eval([mexcompiler ' ./mex_so/panstats.c ./mex_so/pancounter.c']);
+    eval([mexcompiler ' ./mex_so/panlog.c ./mex_so/panconsole.c']);
+    eval([mexcompiler ' ./mex_so/panprofile.c ./mex_so/panprof.c ./mex_so/pancounter.c']);
+    % The headless runner is a plain executable, built without mex.
+    if system('cc -O2 -fvisibility=hidden -rdynamic -o ./mex_so/panrun ./mex_so/panrun.c ./mex_so/panrawcol.c ./mex_so/pancounter.c -ldl -lz')
+        warning('MPanSuiteWarning: the panrun headless runner could not be built.');
+    end
 end
 fprintf('\n\nMEX files were successfully created.\n');
 
@@ -92,6 +112,7 @@ mkdir(fullfile(where,'MPanSuite/src/MPanTran'));
 mkdir(fullfile(where,'MPanSuite/src/MPanShooting'));
 mkdir(fullfile(where,'MPanSuite/src/MPanDc'));
 mkdir(fullfile(where,'MPanSuite/src/MPanEnvelope'));
+mkdir(fullfile(where,'MPanSuite/src/MPanSweep'));
 
 % MPansuite files list creation
 %------------------------------
@@ -100,15 +121,66 @@ mex_so_files = {
     fullfile('mex_so','panget.c')
     fullfile('mex_so','pannet.c')
     fullfile('mex_so','pansimc.c')
+    fullfile('mex_so','pansimc_async.c')
     fullfile('mex_so','panredraw.c')
     fullfile('mex_so','panclearwav.c')
+    fullfile('mex_so','panslice.c')
+    fullfile('mex_so','panrawread.c')
+    fullfile('mex_so','panrawconv.c')
+    fullfile('mex_so','pandownsample.c')
+    fullfile('mex_so','panmemwav.c')
+    fullfile('mex_so','pansweep.c')
+    fullfile('mex_so','panbatch.c')
+    fullfile('mex_so','panstats.c')
+    fullfile('mex_so','panlog.c')
+    fullfile('mex_so','panprofile.c')
+    fullfile('mex_so','panrun.c')
+    fullfile('mex_so','pansession.c')
+    fullfile('mex_so','pansession.h')
+    fullfile('mex_so','pancounter.c')
+    fullfile('mex_so','pancounter.h')
+    fullfile('mex_so','panconsole.c')
+    fullfile('mex_so','panconsole.h')
+    fullfile('mex_so','panworker.c')
+    fullfile('mex_so','panworker.h')
+    fullfile('mex_so','pantranspose.c')
+    fullfile('mex_so','pantranspose.h')
+    fullfile('mex_so','panquant.c')
+    fullfile('mex_so','panquant.h')
+    fullfile('mex_so','panrawcol.c')
+    fullfile('mex_so','panrawcol.h')
+    fullfile('mex_so','pandecim.c')
+    fullfile('mex_so','pandecim.h')
+    fullfile('mex_so','panmemreg.c')
+    fullfile('mex_so','panmemreg.h')
+    fullfile('mex_so','panmacro.c')
+    fullfile('mex_so','panmacro.h')
+    fullfile('mex_so','panmacrofwd.c')
+    fullfile('mex_so','panprof.c')
+    fullfile('mex_so','panprof.h')
     fullfile('mex_so','panget.mexa64')
     fullfile('mex_so','pannet.mexa64')
     fullfile('mex_so','pansimc.mexa64')
+    fullfile('mex_so','pansimc_async.mexa64')
     fullfile('mex_so','panredraw.mexa64')
     fullfile('mex_so','panclearwav.mexa64')
+    fullfile('mex_so','panslice.mexa64')
+    fullfile('mex_so','panrawread.mexa64')
+    fullfile('mex_so','panrawconv.mexa64')
+    fullfile('mex_so','pandownsample.mexa64')
+    fullfile('mex_so','panmemwav.mexa64')
+    fullfile('mex_so','pansweep.mexa64')
+    fullfile('mex_so','panbatch.mexa64')
+    fullfile('mex_so','panstats.mexa64')
+    fullfile('mex_so','panlog.mexa64')
+    fullfile('mex_so','panprofile.mexa64')
 };
 
+% The headless runner is installed only if it could be built.
+if exist(fullfile('mex_so','panrun'),'file')
+    mex_so_files = [mex_so_files; {fullfile('mex_so','panrun')}];
+end
+
 src_shared_files = {
     fullfile('src/MPanShared','MPanLoadNet.m')
     fullfile('src/MPanShared','MPanOptions.m')
@@ -117,6 +189,18 @@ src_shared_files = {
     fullfile('src/MPanShared','MPanVarGetRawFile.m')
     fullfile('src/MPanShared','MPanVarInRawFile.m')
     fullfile('src/MPanShared','MPanStrCommandComplete.m')
+    fullfile('src/MPanShared','MPanGetMemVars.m')
+    fullfile('src/MPanShared','MPanWaveform.m')
+    fullfile('src/MPanShared','MPanRawIndex.m')
+    fullfile('src/MPanShared','MPanRawConvert.m')
+    fullfile('src/MPanShared','MPanVarDecimateRawFile.m')
+    fullfile('src/MPanShared','MPanFuture.m')
+    fullfile('src/MPanShared','MPanSolutionCache.m')
+    fullfile('src/MPanShared','MPanStats.m')
+    fullfile('src/MPanShared','MPanMemWaveforms.m')
+    fullfile('src/MPanShared','MPanBuildMacro.m')
+    fullfile('src/MPanShared','MPanProfile.m')
+    fullfile('src/MPanShared','MPanSession.m')
 };
 
 src_tran_files = {
@@ -139,8 +223,15 @@ src_envelope_files = {
     fullfile('src/MPanEnvelope','MPanEnvelope.m')
 };
 
+src_sweep_files = {
+    fullfile('src/MPanSweep','MPanSweep.m')
+    fullfile('src/MPanSweep','MPanBatch.m')
+    fullfile('src/MPanSweep','MPanSweepArgs.m')
+};
+
 stb_files = [mex_so_files; src_shared_files; src_tran_files; ...
-    src_alter_files; src_shooting_files; src_dc_files; src_envelope_files];
+    src_alter_files; src_shooting_files; src_dc_files; src_envelope_files; ...
+    src_sweep_files];
 
 % Now copying the MPanSuite files
 %--------------------------------
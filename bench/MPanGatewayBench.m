@@ -0,0 +1,176 @@
+function R = MPanGatewayBench(varargin)
+% MPanGatewayBench measures the cost of the MEX gateways (pannet, pansimc,
+% panredraw, panget and panclearwav) against the stand-in panMat.so of
+% bench/panmat_stub.c, so that no PAN license is needed. It can be run
+% headless, e.g. matlab -batch "MPanGatewayBench".
+%
+% Usage: R = MPanGatewayBench()
+%        R = MPanGatewayBench(varargin)
+%
+% Build the stand-in library and the gateways first, from the repository
+% root:
+%    gcc -O2 -shared -fPIC -o bench/panMat.so bench/panmat_stub.c -lm
+%    MPanSuiteInstall (only the compilation step is needed)
+%
+% R = MPanGatewayBench() returns a struct array, one element per measure,
+% with fields
+%    gateway     the gateway that is timed
+%    type        'real', 'complex' or 'string' for panget, '' otherwise
+%    rows, cols  the size of the waveform read by panget
+%    calls       the number of timed calls
+%    median_us   the median latency of one call [us]
+%    min_us      the smallest latency of one call [us]
+%    mbps        the copy throughput of panget [MB/s], i.e. the bytes of
+%                the output divided by the median latency
+%    ratio       median_us divided by the one of the baseline (NaN if no
+%                baseline is given)
+% and prints it as a table.
+%
+% R = MPanGatewayBench(varargin) works as above. varargin must be a
+% sequence of pairs as 'NAME1',VALUE1,... where
+%    'repeat'     is the number of calls timed for every measure (200)
+%    'rows'       the numbers of samples of the waveforms ([1e3 1e5 1e6])
+%    'cols'       the numbers of columns of the waveforms ([1 8])
+%    'types'      a cell array among 'real', 'complex', 'string'. String
+%                 waveforms of more than 1e5 cells are skipped
+%    'baseline'   the R of a previous run: a warning lists the measures
+%                 whose median latency grew more than 'tolerance'
+%    'tolerance'  the allowed relative growth of the latency (0.2)
+%
+% PAN_MAT_SHL_PATH is restored when the benchmark ends, but the stand-in
+% library stays loaded: load the netlist again with MPanLoadNet.
+%
+% See also
+%    MPanStats, MPanRawBench
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+OPTIONS = struct('repeat',200,'rows',[1e3 1e5 1e6],'cols',[1 8], ...
+    'types',{{'real','complex','string'}},'baseline',[],'tolerance',0.2);
+if rem(nargin,2) ~= 0
+    error('MPanSuiteError: an even number of inputs is expected.')
+end
+for k = 1:2:nargin
+    if ~isfield(OPTIONS,varargin{k})
+        error('MPanSuiteError: unknown option %s.', varargin{k});
+    end
+    OPTIONS.(varargin{k}) = varargin{k+1};
+end
+
+HERE = fileparts(mfilename('fullpath'));
+if exist(fullfile(HERE,'panMat.so'),'file') ~= 2
+    error(['MPanSuiteError: build the stand-in library first: gcc -O2 ' ...
+        '-shared -fPIC -o bench/panMat.so bench/panmat_stub.c -lm']);
+end
+
+OLD_PATH = getenv('PAN_MAT_SHL_PATH');
+setenv('PAN_MAT_SHL_PATH', HERE);
+CLEANUP = onCleanup(@() setenv('PAN_MAT_SHL_PATH', OLD_PATH));
+
+NETLIST = [tempname '.pan'];
+fclose(fopen(NETLIST,'w'));
+CLEANUP_NETLIST = onCleanup(@() delete(NETLIST));
+
+R = struct('gateway',{},'type',{},'rows',{},'cols',{},'calls',{}, ...
+    'median_us',{},'min_us',{},'mbps',{},'ratio',{});
+
+% Loading the library: few calls, each one is a dlclose/dlopen.
+N = min(OPTIONS.repeat, 20);
+R(end+1) = MPanGatewayBenchRow('pannet', '', 0, 0, ...
+    MPanGatewayBenchTime(@() pannet(NETLIST), N), 0);
+
+R(end+1) = MPanGatewayBenchRow('pansimc', '', 0, 0, ...
+    MPanGatewayBenchTime(@() pansimc('bench nop'), OPTIONS.repeat), 0);
+R(end+1) = MPanGatewayBenchRow('panredraw', '', 0, 0, ...
+    MPanGatewayBenchTime(@() panredraw('on'), OPTIONS.repeat), 0);
+
+for t = 1:numel(OPTIONS.types)
+    TYPE = OPTIONS.types{t};
+    for c = OPTIONS.cols(:).'
+        for r = OPTIONS.rows(:).'
+            if strcmp(TYPE,'string') && r * c > 1e5
+                % One mxArray per string: kept to a sensible size.
+                continue
+            end
+            pansimc(sprintf('w wave rows=%d cols=%d type=%s shape=sine', r, c, TYPE));
+            Y = panget('w');
+            if iscell(Y)
+                BYTES = sum(cellfun(@numel, Y(:))) * 2;
+            else
+                BYTES = numel(Y) * (8 + 8*~isreal(Y));
+            end
+            clear Y
+            % Large copies are timed fewer times.
+            N = max(3, min(OPTIONS.repeat, round(2e8 / max(BYTES,1))));
+            R(end+1) = MPanGatewayBenchRow('panget', TYPE, r, c, ...
+                MPanGatewayBenchTime(@() panget('w'), N, 1), BYTES); %#ok<AGROW>
+        end
+    end
+end
+
+T = zeros(1,OPTIONS.repeat);
+for k = 1:OPTIONS.repeat
+    pansimc('d wave rows=1 cols=1');
+    t0 = tic;
+    panclearwav('d');
+    T(k) = toc(t0);
+end
+R(end+1) = MPanGatewayBenchRow('panclearwav', '', 1, 1, T, 0);
+pansimc('w wave rows=0 cols=1');
+
+if ~isempty(OPTIONS.baseline)
+    B = OPTIONS.baseline;
+    SLOWER = {};
+    for k = 1:numel(R)
+        h = find(strcmp({B.gateway},R(k).gateway) & strcmp({B.type},R(k).type) & ...
+            [B.rows] == R(k).rows & [B.cols] == R(k).cols, 1);
+        if ~isempty(h)
+            R(k).ratio = R(k).median_us / B(h).median_us;
+            if R(k).ratio > 1 + OPTIONS.tolerance
+                SLOWER{end+1} = sprintf('%s %s %dx%d (x%.2f)', R(k).gateway, ...
+                    R(k).type, R(k).rows, R(k).cols, R(k).ratio); %#ok<AGROW>
+            end
+        end
+    end
+    if ~isempty(SLOWER)
+        warning('MPanSuiteWarning: slower than the baseline: %s.', strjoin(SLOWER, ', '));
+    end
+end
+
+fprintf('%-12s %-8s %9s %5s %7s %12s %12s %10s %7s\n', 'gateway', 'type', ...
+    'rows', 'cols', 'calls', 'median [us]', 'min [us]', 'MB/s', 'ratio');
+for k = 1:numel(R)
+    fprintf('%-12s %-8s %9d %5d %7d %12.2f %12.2f %10.1f %7.2f\n', R(k).gateway, ...
+        R(k).type, R(k).rows, R(k).cols, R(k).calls, R(k).median_us, ...
+        R(k).min_us, R(k).mbps, R(k).ratio);
+end
+end
+
+function T = MPanGatewayBenchTime(FUN, N, NOUT)
+% One warm-up call, then N timed calls. panget requires an output, while
+% panredraw allows none.
+T = zeros(1,N);
+if nargin > 2 && NOUT > 0
+    Y = FUN(); %#ok<NASGU>
+    for k = 1:N
+        t0 = tic;
+        Y = FUN(); %#ok<NASGU>
+        T(k) = toc(t0);
+    end
+else
+    FUN();
+    for k = 1:N
+        t0 = tic;
+        FUN();
+        T(k) = toc(t0);
+    end
+end
+end
+
+function ROW = MPanGatewayBenchRow(GATEWAY, TYPE, ROWS, COLS, T, BYTES)
+ROW = struct('gateway',GATEWAY,'type',TYPE,'rows',ROWS,'cols',COLS, ...
+    'calls',numel(T),'median_us',1e6*median(T),'min_us',1e6*min(T), ...
+    'mbps',BYTES / median(T) / 1e6,'ratio',NaN);
+end
@@ -0,0 +1,339 @@
+function R = MPanRawBench(varargin)
+% MPanRawBench measures how RAW files are read: the parsing of the header
+% and the extraction of columns by MPanVarGetRawFile in the SLOW, FAST and
+% NATIVE (panrawread) modes. The files are synthetic RAW files written by
+% bench/rawgen.c, from a few MB to tens of GB, or existing RAW files. It
+% can be run headless, e.g. matlab -batch "MPanRawBench".
+%
+% Usage: R = MPanRawBench()
+%        R = MPanRawBench(varargin)
+%
+% Build the generator first, from the repository root:
+%    gcc -O2 -o bench/rawgen bench/rawgen.c
+%
+% R = MPanRawBench() returns a struct array, one element per measure, with
+% fields
+%    file         the RAW file
+%    type         'real' or 'complex'
+%    mb           the size of the file [MB]
+%    vars         the number of variables
+%    points       the number of points
+%    reader       'index' (MPanRawIndex on an empty cache), 'index-warm'
+%                 (MPanVarInRawFile on an indexed file), 'native-header'
+%                 (panrawread with no column: header and mapping only),
+%                 'SLOW', 'FAST' or 'NATIVE' (MPanVarGetRawFile),
+%                 'convert-L' (panrawconv at the compression level L) or
+%                 'COLUMNAR-L' (MPanVarGetRawFile on the columnar file
+%                 written at the level L)
+%    columns      the number of columns extracted
+%    calls        the number of timed calls
+%    median_s     the median time of one call [s]
+%    min_s        the smallest time of one call [s]
+%    mbps         the size of the RAW file divided by median_s [MB/s], NaN
+%                 for the header measures
+%    peak_rss_mb  the peak resident memory of MATLAB during the measure
+%                 [MB] (Linux only, NaN otherwise)
+%    rss_growth_mb the growth of the peak resident memory with respect to
+%                 the resident memory before the measure [MB]
+%    check        'ok' if DATA is bit for bit equal to the one of the
+%                 reference reader and to the rows read directly from the
+%                 file, 'MISMATCH' otherwise, '-' for the header measures
+% and prints it as a table. The reference reader is the first one in
+% 'strategies' that runs on the file: SLOW, i.e. the current
+% implementation, unless it is skipped.
+%
+% R = MPanRawBench(varargin) works as above. varargin must be a sequence of
+% pairs as 'NAME1',VALUE1,... where
+%    'files'       a cell array of existing RAW files: nothing is generated
+%    'sizes'       the sizes of the generated files [MB] ([16 256 1024])
+%    'vars'        the number of variables of the generated files (64)
+%    'types'       a cell array among 'real' and 'complex'
+%    'seed'        the seed of the generator (1)
+%    'dir'         the directory of the generated files (tempdir)
+%    'keep'        keep the generated files (false). Files already present
+%                  in 'dir' are reused and never deleted
+%    'columns'     the numbers of columns extracted ([1 8])
+%    'strategies'  a cell array among 'SLOW', 'FAST' and 'NATIVE'
+%    'repeat'      the number of calls timed for every measure (3)
+%    'slow_mb'     SLOW is skipped on files larger than this [MB] (256)
+%    'fast_mb'     FAST, which loads the whole file, is skipped on files
+%                  larger than this [MB] (2048)
+%    'levels'      the compression levels of the columnar files written
+%                  by panrawconv, 0 for no compression ([0 1]). The
+%                  columnar files are written in tempdir and deleted
+%
+% The files are read through the page cache: unless a file is larger than
+% the memory, the measures are those of a warm cache.
+%
+% See also
+%    MPanVarGetRawFile, MPanRawIndex, MPanRawConvert, MPanGatewayBench
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+OPTIONS = struct('files',{{}},'sizes',[16 256 1024],'vars',64, ...
+    'types',{{'real','complex'}},'seed',1,'dir',tempdir,'keep',false, ...
+    'columns',[1 8],'strategies',{{'SLOW','FAST','NATIVE'}},'repeat',3, ...
+    'slow_mb',256,'fast_mb',2048,'levels',[0 1]);
+if rem(nargin,2) ~= 0
+    error('MPanSuiteError: an even number of inputs is expected.')
+end
+for k = 1:2:nargin
+    if ~isfield(OPTIONS,varargin{k})
+        error('MPanSuiteError: unknown option %s.', varargin{k});
+    end
+    OPTIONS.(varargin{k}) = varargin{k+1};
+end
+
+NATIVE = exist('panrawread','file') == 3;
+if ~NATIVE && any(strcmp(OPTIONS.strategies,'NATIVE'))
+    warning('MPanSuiteWarning: panrawread is not available, NATIVE is skipped.');
+    OPTIONS.strategies = setdiff(OPTIONS.strategies, {'NATIVE'}, 'stable');
+end
+
+if exist('panrawconv','file') ~= 3 && ~isempty(OPTIONS.levels)
+    warning('MPanSuiteWarning: panrawconv is not available, no columnar file is written.');
+    OPTIONS.levels = [];
+end
+
+FILES = OPTIONS.files;
+GENERATED = {};
+if isempty(FILES)
+    [FILES, GENERATED] = MPanRawBenchGenerate(OPTIONS);
+end
+CLEANUP = onCleanup(@() MPanRawBenchDelete(GENERATED));
+
+R = struct('file',{},'type',{},'mb',{},'vars',{},'points',{}, ...
+    'reader',{},'columns',{},'calls',{},'median_s',{},'min_s',{}, ...
+    'mbps',{},'peak_rss_mb',{},'rss_growth_mb',{},'check',{});
+
+for f = 1:numel(FILES)
+    FILE = FILES{f};
+    D = dir(FILE);
+    if numel(D) ~= 1
+        warning('MPanSuiteWarning: The RAW file %s cannot be found.', FILE);
+        continue
+    end
+    MB = D.bytes / 2^20;
+
+    [ROW, INDEX] = MPanRawBenchMeasure(@() MPanRawBenchIndexCold(FILE), OPTIONS.repeat);
+    if isempty(INDEX)
+        continue
+    end
+    if strncmp(INDEX.FLAGS,'complex',7)
+        TYPE = 'complex';
+    else
+        TYPE = 'real';
+    end
+    BASE = struct('file',FILE,'type',TYPE,'mb',MB,'vars',INDEX.NUM_VAR, ...
+        'points',INDEX.NUM_SAMPLES);
+
+    R(end+1) = MPanRawBenchRow(BASE, 'index', 0, ROW, NaN, '-'); %#ok<AGROW>
+    ROW = MPanRawBenchMeasure(@() MPanVarInRawFile(FILE), OPTIONS.repeat);
+    R(end+1) = MPanRawBenchRow(BASE, 'index-warm', 0, ROW, NaN, '-'); %#ok<AGROW>
+    if NATIVE
+        ROW = MPanRawBenchMeasure(@() panrawread(FILE, zeros(1,0)), OPTIONS.repeat);
+        R(end+1) = MPanRawBenchRow(BASE, 'native-header', 0, ROW, NaN, '-'); %#ok<AGROW>
+    end
+
+    COLUMNAR = cell(1,numel(OPTIONS.levels));
+    for h = 1:numel(OPTIONS.levels)
+        COLUMNAR{h} = [tempname '.rawc'];
+        LEVEL = OPTIONS.levels(h);
+        [ROW, BYTES] = MPanRawBenchMeasure(@() panrawconv(FILE, COLUMNAR{h}, LEVEL), 1);
+        R(end+1) = MPanRawBenchRow(BASE, sprintf('convert-%d', LEVEL), 0, ROW, MB, '-'); %#ok<AGROW>
+        fprintf('%s: columnar file of %.1f MB at level %d.\n', FILE, BYTES / 2^20, LEVEL);
+    end
+    CLEANUP_COLUMNAR = onCleanup(@() MPanRawBenchDelete(COLUMNAR));
+
+    SAMPLES = unique(round(linspace(1, INDEX.NUM_SAMPLES, min(64, INDEX.NUM_SAMPLES))));
+    for c = OPTIONS.columns(:).'
+        COLS = unique(round(linspace(0, INDEX.NUM_VAR - 1, min(c, INDEX.NUM_VAR))));
+        EXPECTED = MPanRawBenchRows(INDEX, COLS, SAMPLES);
+        REF = [];
+        for s = 1:numel(OPTIONS.strategies)
+            STRATEGY = OPTIONS.strategies{s};
+            if (strcmp(STRATEGY,'SLOW') && MB > OPTIONS.slow_mb) || ...
+                    (strcmp(STRATEGY,'FAST') && MB > OPTIONS.fast_mb)
+                continue
+            end
+            [ROW, DATA] = MPanRawBenchMeasure(@() MPanVarGetRawFile(FILE, ...
+                COLS, STRATEGY), OPTIONS.repeat);
+            if isempty(REF)
+                REF = DATA;
+            end
+            CHECK = MPanRawBenchCheck(DATA, REF, SAMPLES, EXPECTED);
+            clear DATA
+            R(end+1) = MPanRawBenchRow(BASE, STRATEGY, numel(COLS), ROW, MB, CHECK); %#ok<AGROW>
+        end
+        for h = 1:numel(COLUMNAR)
+            [ROW, DATA] = MPanRawBenchMeasure(@() MPanVarGetRawFile(COLUMNAR{h}, ...
+                COLS), OPTIONS.repeat);
+            if isempty(REF)
+                REF = DATA;
+            end
+            CHECK = MPanRawBenchCheck(DATA, REF, SAMPLES, EXPECTED);
+            clear DATA
+            R(end+1) = MPanRawBenchRow(BASE, sprintf('COLUMNAR-%d', ...
+                OPTIONS.levels(h)), numel(COLS), ROW, MB, CHECK); %#ok<AGROW>
+        end
+        clear REF
+    end
+    clear CLEANUP_COLUMNAR
+end
+
+fprintf('%-40s %-7s %9s %5s %11s %-13s %4s %5s %11s %11s %9s %9s %9s %s\n', ...
+    'file', 'type', 'MB', 'vars', 'points', 'reader', 'cols', 'calls', ...
+    'median [s]', 'min [s]', 'MB/s', 'peak MB', 'grow MB', 'check');
+for k = 1:numel(R)
+    [~, NAME, EXT] = fileparts(R(k).file);
+    fprintf('%-40s %-7s %9.1f %5d %11d %-13s %4d %5d %11.4f %11.4f %9.1f %9.1f %9.1f %s\n', ...
+        [NAME EXT], R(k).type, R(k).mb, R(k).vars, R(k).points, R(k).reader, ...
+        R(k).columns, R(k).calls, R(k).median_s, R(k).min_s, R(k).mbps, ...
+        R(k).peak_rss_mb, R(k).rss_growth_mb, R(k).check);
+end
+end
+
+function INDEX = MPanRawBenchIndexCold(FILE)
+MPanRawIndex('clear');
+INDEX = MPanRawIndex(FILE);
+end
+
+function [FILES, GENERATED] = MPanRawBenchGenerate(OPTIONS)
+% The generated files are named after their parameters, so that large
+% files written by a previous run are reused.
+HERE = fileparts(mfilename('fullpath'));
+RAWGEN = fullfile(HERE,'rawgen');
+if exist(RAWGEN,'file') ~= 2
+    error(['MPanSuiteError: build the generator first: gcc -O2 -o ' ...
+        'bench/rawgen bench/rawgen.c']);
+end
+
+FILES = {};
+GENERATED = {};
+for t = 1:numel(OPTIONS.types)
+    IS_COMPLEX = strcmp(OPTIONS.types{t},'complex');
+    for MB = OPTIONS.sizes(:).'
+        FILE = fullfile(OPTIONS.dir, sprintf('rawbench_%s_%dv_%gMB_s%d.raw', ...
+            OPTIONS.types{t}, OPTIONS.vars, MB, OPTIONS.seed));
+        FILES{end+1} = FILE; %#ok<AGROW>
+        if exist(FILE,'file') == 2
+            continue
+        end
+        POINTS = floor(MB * 2^20 / (8 * OPTIONS.vars * (1 + IS_COMPLEX)));
+        FLAG = '';
+        if IS_COMPLEX
+            FLAG = '-c ';
+        end
+        t0 = tic;
+        [STATUS, OUT] = system(sprintf('"%s" %s-s %d "%s" %d %d', RAWGEN, ...
+            FLAG, OPTIONS.seed, FILE, OPTIONS.vars, POINTS));
+        if STATUS ~= 0
+            MPanRawBenchDelete([GENERATED {FILE}]);
+            error('MPanSuiteError: rawgen failed: %s', OUT);
+        end
+        fprintf('Generated %s in %.1f s.\n', FILE, toc(t0));
+        if ~OPTIONS.keep
+            GENERATED{end+1} = FILE; %#ok<AGROW>
+        end
+    end
+end
+end
+
+function MPanRawBenchDelete(FILES)
+for k = 1:numel(FILES)
+    if exist(FILES{k},'file') == 2
+        delete(FILES{k});
+    end
+end
+end
+
+function [ROW, OUT] = MPanRawBenchMeasure(FUN, N)
+% N timed calls. The peak resident memory is reset before the calls, so
+% that VmHWM is the one reached during the measure.
+[~, RSS] = MPanRawBenchRss(true);
+T = zeros(1,N);
+for k = 1:N
+    OUT = [];
+    t0 = tic;
+    OUT = FUN();
+    T(k) = toc(t0);
+end
+HWM = MPanRawBenchRss(false);
+ROW = struct('calls',N,'median_s',median(T),'min_s',min(T), ...
+    'peak_rss_mb',HWM,'rss_growth_mb',HWM - RSS);
+end
+
+function [HWM, RSS] = MPanRawBenchRss(RESET)
+% Writing 5 to clear_refs resets VmHWM to the current VmRSS (Linux 4.0).
+HWM = NaN;
+RSS = NaN;
+if RESET
+    fileID = fopen('/proc/self/clear_refs','w');
+    if fileID >= 0
+        fprintf(fileID,'5');
+        fclose(fileID);
+    end
+end
+fileID = fopen('/proc/self/status','r');
+if fileID < 0
+    return
+end
+STATUS = fread(fileID,Inf,'uint8=>char')';
+fclose(fileID);
+TOKEN = regexp(STATUS,'VmHWM:\s*(\d+)','tokens','once');
+if ~isempty(TOKEN)
+    HWM = str2double(TOKEN{1}) / 1024;
+end
+TOKEN = regexp(STATUS,'VmRSS:\s*(\d+)','tokens','once');
+if ~isempty(TOKEN)
+    RSS = str2double(TOKEN{1}) / 1024;
+end
+end
+
+function DATA = MPanRawBenchRows(INDEX, COLS, SAMPLES)
+% Read the SAMPLES rows of the COLS variables straight from the file, as
+% a reference that does not depend on MPanVarGetRawFile.
+IS_COMPLEX = strncmp(INDEX.FLAGS,'complex',7);
+WIDTH = INDEX.NUM_VAR * (1 + IS_COMPLEX);
+DATA = zeros(numel(SAMPLES), numel(COLS));
+fileID = fopen(INDEX.FILE);
+for k = 1:numel(SAMPLES)
+    fseek(fileID, INDEX.DATA_OFFSET + 8 * WIDTH * (SAMPLES(k) - 1), 'bof');
+    A = fread(fileID, [WIDTH 1], 'real*8');
+    if IS_COMPLEX
+        DATA(k,:) = complex(A(2*COLS+1), A(2*COLS+2)).';
+    else
+        DATA(k,:) = A(COLS+1).';
+    end
+end
+fclose(fileID);
+end
+
+function CHECK = MPanRawBenchCheck(DATA, REF, SAMPLES, EXPECTED)
+CHECK = 'ok';
+if ~MPanRawBenchSame(DATA(SAMPLES,:), EXPECTED) || ~MPanRawBenchSame(DATA, REF)
+    CHECK = 'MISMATCH';
+end
+end
+
+function OK = MPanRawBenchSame(A, B)
+% Bit for bit: -0 and 0 differ, NaN equals NaN with the same payload.
+OK = isequal(size(A), size(B)) && ...
+    isequal(typecast(real(A(:)),'uint64'), typecast(real(B(:)),'uint64')) && ...
+    isequal(typecast(imag(A(:)),'uint64'), typecast(imag(B(:)),'uint64'));
+end
+
+function ROW = MPanRawBenchRow(BASE, READER, COLUMNS, MEASURE, MB, CHECK)
+ROW = BASE;
+ROW.reader = READER;
+ROW.columns = COLUMNS;
+ROW.calls = MEASURE.calls;
+ROW.median_s = MEASURE.median_s;
+ROW.min_s = MEASURE.min_s;
+ROW.mbps = MB / MEASURE.median_s;
+ROW.peak_rss_mb = MEASURE.peak_rss_mb;
+ROW.rss_growth_mb = MEASURE.rss_growth_mb;
+ROW.check = CHECK;
+end
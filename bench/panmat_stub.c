@@ -0,0 +1,350 @@
+/*
+ * Stand-in for the PAN panMat.so shared library, exporting the entry
+ * points used by the gateways in mex_so. It runs no simulation: it only
+ * serves synthetic memwaveforms, so that the cost of the MEX layer can be
+ * measured on any Linux box (see MPanGatewayBench.m).
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -shared -fPIC -o bench/panMat.so bench/panmat_stub.c -lm
+ *
+ * and point PAN_MAT_SHL_PATH to the bench directory.
+ *
+ * Commands given to PanMatlabExecuteCommand:
+ *
+ *   NAME wave rows=R cols=C type=real|complex|string shape=ramp|sine|random
+ *       creates (or replaces) the memwaveform NAME with R samples of C
+ *       columns; with var=V the memwaveform is NAME.V, as if V were
+ *       saved by the mem option of the analysis NAME. Numeric waveforms are stored as PAN does: a vector when
+ *       C is 1, an array of row pointers otherwise.
+ *   NAME sleep us=T
+ *       waits T microseconds, to emulate an analysis.
+ *   NAME print text=WORD
+ *       prints WORD through mexPrintf, as PAN prints its console output.
+ *   NAME alter ... value = V
+ *       sets the parameter that the samples of shape=param are offset by.
+ *   anything else
+ *       does nothing and returns 0.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#define STUB_TYPE_REAL     0
+#define STUB_TYPE_COMPLEX  1
+#define STUB_TYPE_STRING   2
+
+typedef struct StubWave
+{
+    char            *Name;
+    int              Rows, Cols, Type;
+    double          *pR, *pI;      /* Rows x Cols samples, row-major */
+    double         **ppR, **ppI;   /* row pointers when Cols > 1 */
+    char           **ppS;          /* Rows x Cols strings, row-major */
+    char          ***pppS;         /* row pointers when Cols > 1 */
+    struct StubWave *pNext;
+} StubWave;
+
+static StubWave *pWaves;
+static char      Redraw = 1;
+static double    Param;
+
+/* Resolved in the process that loads the stub: MATLAB, or panrun. */
+extern int mexPrintf( const char *Format, ... );
+
+
+
+
+static void StubFree( StubWave *pWav )
+{
+    int K;
+
+    if( pWav->ppS )
+    {
+	for( K = 0; K < pWav->Rows * pWav->Cols; K++ )
+	    free( pWav->ppS[K] );
+    }
+    free( pWav->ppS );
+    free( pWav->pppS );
+    free( pWav->pR );
+    free( pWav->pI );
+    free( pWav->ppR );
+    free( pWav->ppI );
+    free( pWav->Name );
+    free( pWav );
+}
+
+
+
+
+/* The simulator reports an error for a waveform it can not allocate. */
+static int StubFail( StubWave *pWav )
+{
+    StubFree( pWav );
+
+    return( 1 );
+}
+
+
+
+
+static StubWave **StubFind( const char *Name )
+{
+    StubWave **ppWav;
+
+    for( ppWav = &pWaves; *ppWav; ppWav = &((*ppWav)->pNext) )
+    {
+	if( ! strcmp( (*ppWav)->Name, Name ) )
+	    return( ppWav );
+    }
+
+    return( NULL );
+}
+
+
+
+
+static double StubSample( const char *Shape, long I, int J )
+{
+    if( ! strcmp( Shape, "sine" ) )
+	return( sin( 1e-3 * I + J ) );
+    if( ! strcmp( Shape, "random" ) )
+	return( (double) rand() / RAND_MAX );
+    if( ! strcmp( Shape, "param" ) )
+	return( Param + 1e-6 * I + J );
+
+    return( I + 1e-6 * J );
+}
+
+
+
+
+static int StubWaveCreate( const char *Name, int Rows, int Cols, int Type,
+                           const char *Shape )
+{
+    StubWave *pWav = calloc( 1, sizeof( StubWave ) ), **ppOld;
+    size_t N = (size_t) Rows * Cols;
+    long I;
+    int J;
+
+    if( ! pWav )
+	return( 1 );
+    if( ! (pWav->Name = strdup( Name )) )
+	return( StubFail( pWav ) );
+
+    pWav->Rows = Rows;
+    pWav->Cols = Cols;
+    pWav->Type = Type;
+
+    if( STUB_TYPE_STRING == Type )
+    {
+	pWav->ppS = calloc( N ? N : 1, sizeof( char * ) );
+	pWav->pppS = malloc( (Rows ? Rows : 1) * sizeof( char ** ) );
+	if( ! pWav->ppS || ! pWav->pppS )
+	    return( StubFail( pWav ) );
+
+	for( I = 0; I < Rows; I++ )
+	{
+	    pWav->pppS[I] = pWav->ppS + I * Cols;
+	    for( J = 0; J < Cols; J++ )
+	    {
+		if( asprintf( pWav->ppS + I * Cols + J, "s%ld_%d", I, J ) < 0 )
+		    return( StubFail( pWav ) );
+	    }
+	}
+    }
+    else
+    {
+	pWav->pR = malloc( (N ? N : 1) * sizeof( double ) );
+	pWav->ppR = malloc( (Rows ? Rows : 1) * sizeof( double * ) );
+	if( ! pWav->pR || ! pWav->ppR )
+	    return( StubFail( pWav ) );
+	if( STUB_TYPE_COMPLEX == Type )
+	{
+	    pWav->pI = malloc( (N ? N : 1) * sizeof( double ) );
+	    pWav->ppI = malloc( (Rows ? Rows : 1) * sizeof( double * ) );
+	    if( ! pWav->pI || ! pWav->ppI )
+		return( StubFail( pWav ) );
+	}
+
+	for( I = 0; I < Rows; I++ )
+	{
+	    pWav->ppR[I] = pWav->pR + I * Cols;
+	    if( pWav->pI )
+		pWav->ppI[I] = pWav->pI + I * Cols;
+	    for( J = 0; J < Cols; J++ )
+	    {
+		pWav->pR[ I * Cols + J ] = StubSample( Shape, I, J );
+		if( pWav->pI )
+		    pWav->pI[ I * Cols + J ] = -StubSample( Shape, I, J );
+	    }
+	}
+    }
+
+    if( (ppOld = StubFind( Name )) )
+    {
+	StubWave *pOld = *ppOld;
+
+	*ppOld = pOld->pNext;
+	StubFree( pOld );
+    }
+
+    pWav->pNext = pWaves;
+    pWaves = pWav;
+
+    return( 0 );
+}
+
+
+
+
+static const char *StubOption( const char *Command, const char *Key,
+                               char *pValue, size_t Size )
+{
+    const char *pText = strstr( Command, Key );
+    size_t K = 0;
+
+    if( ! pText )
+	return( NULL );
+
+    for( pText += strlen( Key ); *pText == ' '; pText++ );
+    for( ; *pText && *pText != ' ' && K + 1 < Size; pText++ )
+	pValue[ K++ ] = *pText;
+    pValue[K] = 0;
+
+    return( pValue );
+}
+
+
+
+
+void InitialiseGlobals( void )
+{
+    while( pWaves )
+    {
+	StubWave *pWav = pWaves;
+
+	pWaves = pWav->pNext;
+	StubFree( pWav );
+    }
+}
+
+
+
+
+int MatlabPanInit( int ArgCount, char **ppArgs )
+{
+    (void) ArgCount;
+    (void) ppArgs;
+
+    return( 0 );
+}
+
+
+
+
+int PanMatlabExecuteCommand( char *Command )
+{
+    char Name[ 256 ], Verb[ 32 ], Value[ 64 ], Var[ 64 ];
+    int Rows = 1, Cols = 1, Type = STUB_TYPE_REAL;
+    char Shape[ 32 ] = "ramp";
+
+    if( 2 != sscanf( Command, "%255s %31s", Name, Verb ) )
+	return( 0 );
+
+    if( ! strcmp( Verb, "sleep" ) )
+    {
+	if( StubOption( Command, "us=", Value, sizeof(Value) ) )
+	    usleep( (useconds_t) atol( Value ) );
+	return( 0 );
+    }
+
+    if( ! strcmp( Verb, "print" ) )
+    {
+	if( StubOption( Command, "text=", Value, sizeof(Value) ) )
+	    mexPrintf( "%s\n", Value );
+	return( 0 );
+    }
+
+    if( ! strcmp( Verb, "alter" ) )
+    {
+	if( StubOption( Command, "value = ", Value, sizeof(Value) ) )
+	    Param = atof( Value );
+	return( 0 );
+    }
+
+    if( strcmp( Verb, "wave" ) )
+	return( 0 );
+
+    if( StubOption( Command, "rows=", Value, sizeof(Value) ) )
+	Rows = atoi( Value );
+    if( StubOption( Command, "cols=", Value, sizeof(Value) ) )
+	Cols = atoi( Value );
+    if( StubOption( Command, "type=", Value, sizeof(Value) ) )
+	Type = ! strcmp( Value, "complex" ) ? STUB_TYPE_COMPLEX :
+	       ! strcmp( Value, "string" ) ? STUB_TYPE_STRING : STUB_TYPE_REAL;
+    StubOption( Command, "shape=", Shape, sizeof(Shape) );
+    if( StubOption( Command, "var=", Var, sizeof(Var) ) &&
+        strlen( Name ) + strlen( Var ) + 2 <= sizeof(Name) )
+	strcat( strcat( Name, "." ), Var );
+
+    if( Rows < 0 || Cols < 1 )
+	return( 1 );
+
+    return( StubWaveCreate( Name, Rows, Cols, Type, Shape ) );
+}
+
+
+
+
+int PanMatlabGet( char *Name, double **ppR, double **ppI, char **ppS,
+                  int *pRows, int *pCols )
+{
+    StubWave **ppWav = StubFind( Name ), *pWav;
+
+    if( ! ppWav )
+	return( 0 );
+    pWav = *ppWav;
+
+    *pRows = pWav->Rows;
+    *pCols = pWav->Cols;
+
+    if( STUB_TYPE_STRING == pWav->Type )
+	*ppS = 1 == pWav->Cols ? (char *) pWav->ppS : (char *) pWav->pppS;
+    else
+    {
+	*ppR = 1 == pWav->Cols ? pWav->pR : (double *) pWav->ppR;
+	if( pWav->pI )
+	    *ppI = 1 == pWav->Cols ? pWav->pI : (double *) pWav->ppI;
+    }
+
+    return( 1 );
+}
+
+
+
+
+void PanMatlabRedraw( char Flag )
+{
+    Redraw = Flag;
+}
+
+
+
+
+char MemWaveformDeleteByName( char *Name )
+{
+    StubWave **ppWav = StubFind( Name ), *pWav;
+
+    if( ! ppWav )
+	return( 0 );
+
+    pWav = *ppWav;
+    *ppWav = pWav->pNext;
+    StubFree( pWav );
+
+    return( 1 );
+}
@@ -0,0 +1,134 @@
+/*
+ * Micro-benchmark of the gather used by panget for multi-column waveforms.
+ * It compares the former naive column-major loop with PanTranspose, run
+ * on one thread and with the automatic thread split.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -pthread -Imex_so -o pantranspose_bench \
+ *       bench/pantranspose_bench.c mex_so/pantranspose.c mex_so/panquant.c
+ *   ./pantranspose_bench [repetitions]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pantranspose.h"
+
+static double Now( void )
+{
+    struct timespec Ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &Ts );
+    return( Ts.tv_sec + 1e-9 * Ts.tv_nsec );
+}
+
+
+
+
+static void NaiveTranspose( double *pDst, const double * const *ppSrc,
+                            int Rows, int Cols, int NumThreads )
+{
+    register int I, J;
+
+    (void) NumThreads;
+
+    for( J = 0; J < Cols; J++ )
+    {
+	for( I = 0; I < Rows; I++ )
+	{
+	    *pDst = ppSrc[I][J];
+	    pDst++;
+	}
+    }
+}
+
+
+
+
+static double Measure( void (*Kernel)( double *, const double * const *,
+                                       int, int, int ),
+                       double *pDst, const double * const *ppSrc,
+                       int Rows, int Cols, int NumThreads, int Repeat )
+{
+    double Best = 1e30, Start, Elapsed;
+    int K;
+
+    for( K = 0; K < Repeat; K++ )
+    {
+	Start = Now();
+	Kernel( pDst, ppSrc, Rows, Cols, NumThreads );
+	Elapsed = Now() - Start;
+	if( Elapsed < Best )
+	    Best = Elapsed;
+    }
+
+    /* Bytes read plus bytes written. */
+    return( 2.0 * sizeof(double) * Rows * Cols / Best / 1e6 );
+}
+
+
+
+
+int main( int argc, char *argv[] )
+{
+    static const int Shapes[][2] = {
+	{ 1000, 8 }, { 100000, 4 }, { 1000000, 2 }, { 1000000, 16 },
+	{ 4096, 4096 }, { 200, 200 }, { 512, 20000 }, { 20000, 512 },
+	{ 16, 400000 }, { 32, 200000 }, { 64, 100000 }
+    };
+    int Repeat = argc > 1 ? atoi( argv[1] ) : 5;
+    size_t S;
+
+    printf( "%10s %8s %14s %14s %14s  %s\n", "Rows", "Cols",
+            "naive MB/s", "tiled MB/s", "threads MB/s", "check" );
+
+    for( S = 0; S < sizeof(Shapes) / sizeof(Shapes[0]); S++ )
+    {
+	int Rows = Shapes[S][0], Cols = Shapes[S][1], I, J;
+	double **ppSrc = malloc( sizeof(double *) * Rows );
+	double *pRef = malloc( sizeof(double) * Rows * Cols );
+	double *pDst = malloc( sizeof(double) * Rows * Cols );
+	double Naive, Tiled, Threaded;
+
+	if( ! ppSrc || ! pRef || ! pDst )
+	{
+	    fprintf( stderr, "No more memory.\n" );
+	    return( 1 );
+	}
+
+	/* Rows are allocated one by one, as PAN does. */
+	for( I = 0; I < Rows; I++ )
+	{
+	    ppSrc[I] = malloc( sizeof(double) * Cols );
+	    if( ! ppSrc[I] )
+	    {
+		fprintf( stderr, "No more memory.\n" );
+		return( 1 );
+	    }
+	    for( J = 0; J < Cols; J++ )
+		ppSrc[I][J] = I + 1e-6 * J;
+	}
+
+	Naive = Measure( NaiveTranspose, pRef, (const double * const *) ppSrc,
+	                 Rows, Cols, 1, Repeat );
+	Tiled = Measure( PanTranspose, pDst, (const double * const *) ppSrc,
+	                 Rows, Cols, 1, Repeat );
+	Threaded = Measure( PanTranspose, pDst, (const double * const *) ppSrc,
+	                    Rows, Cols, 0, Repeat );
+
+	printf( "%10d %8d %14.0f %14.0f %14.0f  %s\n", Rows, Cols, Naive,
+	        Tiled, Threaded,
+	        memcmp( pRef, pDst, sizeof(double) * Rows * Cols ) ?
+	        "MISMATCH" : "ok" );
+
+	for( I = 0; I < Rows; I++ )
+	    free( ppSrc[I] );
+	free( ppSrc );
+	free( pRef );
+	free( pDst );
+    }
+
+    return( 0 );
+}
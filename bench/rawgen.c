@@ -0,0 +1,180 @@
+/*
+ * Generator of synthetic PAN raw files, used by MPanRawBench.m to measure
+ * MPanVarGetRawFile and panrawread on files from a few MB to tens of GB.
+ * The file is written in chunks, so its size is not bounded by the memory.
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -O2 -o bench/rawgen bench/rawgen.c
+ *   bench/rawgen [-c] [-s SEED] FILE NUM_VAR NUM_POINTS
+ *
+ * -c writes a complex file (Flags: complex), in which every sample is a
+ * (real, imaginary) pair. The layout is the one parsed by MPanRawIndex and
+ * panrawread:
+ *
+ *   Title: rawgen seed=SEED
+ *   Date: Thu Jan 01 00:00:00 1970
+ *   Plotname: rawgen
+ *   Flags: real
+ *   No. Variables: NUM_VAR
+ *   No. Points: NUM_POINTS
+ *   Variables:
+ *   	0	time	time	s
+ *   	1	v1	voltage	V
+ *   	...
+ *   Binary:
+ *
+ * followed by NUM_POINTS rows of NUM_VAR native doubles. The first variable
+ * is the time (the frequency for a complex file), the others are uniform
+ * pseudo random numbers in [-1, 1) that use all the bits of the mantissa.
+ * The same SEED gives the same file, byte by byte.
+ */
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define RAWGEN_USAGE \
+    "Usage: rawgen [-c] [-s SEED] FILE NUM_VAR NUM_POINTS\n"
+
+/* Bytes of rows written by every fwrite. */
+#define RAWGEN_CHUNK_BYTES  (4 << 20)
+
+static uint64_t State;
+
+static double Random( void )
+{
+    /* xorshift64*: 53 bits scaled to [-1, 1). */
+    State ^= State >> 12;
+    State ^= State << 25;
+    State ^= State >> 27;
+
+    return( (double) ((State * 2685821657736338717ULL) >> 11) /
+            (double) (1ULL << 52) - 1.0 );
+}
+
+
+
+
+static int WriteHeader( FILE *pFile, unsigned long long Seed, int IsComplex,
+                        long NumVar, long long NumPoints )
+{
+    long K;
+
+    fprintf( pFile, "Title: rawgen seed=%llu\n", Seed );
+    fprintf( pFile, "Date: Thu Jan 01 00:00:00 1970\n" );
+    fprintf( pFile, "Plotname: rawgen\n" );
+    fprintf( pFile, "Flags: %s\n", IsComplex ? "complex" : "real" );
+    fprintf( pFile, "No. Variables: %ld \n", NumVar );
+    fprintf( pFile, "No. Points: %lld \n", NumPoints );
+    fprintf( pFile, "Variables:\n" );
+
+    if( IsComplex )
+	fprintf( pFile, "\t0\tfrequency\tfrequency\tHz\n" );
+    else
+	fprintf( pFile, "\t0\ttime\ttime\ts\n" );
+    for( K = 1; K < NumVar; K++ )
+	fprintf( pFile, "\t%ld\tv%ld\tvoltage\tV\n", K, K );
+
+    fprintf( pFile, "Binary:\n" );
+
+    return( ferror( pFile ) );
+}
+
+
+
+
+int main( int argc, char *argv[] )
+{
+    unsigned long long Seed = 1;
+    int IsComplex = 0, Option;
+    long NumVar, Width, Rows, K;
+    long long NumPoints, Row;
+    size_t RowBytes;
+    double *pChunk;
+    FILE *pFile;
+
+    while( -1 != (Option = getopt( argc, argv, "cs:" )) )
+    {
+	if( 'c' == Option )
+	    IsComplex = 1;
+	else if( 's' == Option )
+	    Seed = strtoull( optarg, NULL, 10 );
+	else
+	{
+	    fprintf( stderr, RAWGEN_USAGE );
+	    return( 1 );
+	}
+    }
+
+    if( argc - optind != 3 )
+    {
+	fprintf( stderr, RAWGEN_USAGE );
+	return( 1 );
+    }
+
+    NumVar = atol( argv[ optind + 1 ] );
+    NumPoints = atoll( argv[ optind + 2 ] );
+    if( NumVar < 1 || NumPoints < 0 )
+    {
+	fprintf( stderr, "Error: NUM_VAR must be positive and NUM_POINTS "
+	         "non negative.\n" RAWGEN_USAGE );
+	return( 1 );
+    }
+
+    Width = (IsComplex ? 2 : 1) * NumVar;
+    RowBytes = Width * sizeof(double);
+    Rows = RAWGEN_CHUNK_BYTES / RowBytes;
+    if( Rows < 1 )
+	Rows = 1;
+
+    pChunk = malloc( Rows * RowBytes );
+    pFile = fopen( argv[ optind ], "wb" );
+    if( ! pChunk || ! pFile )
+    {
+	fprintf( stderr, "Error: <%s> can not be written.\n", argv[ optind ] );
+	return( 1 );
+    }
+
+    State = Seed ? Seed : 1;
+
+    if( WriteHeader( pFile, Seed, IsComplex, NumVar, NumPoints ) )
+    {
+	fprintf( stderr, "Error: <%s> can not be written.\n", argv[ optind ] );
+	return( 1 );
+    }
+
+    for( Row = 0; Row < NumPoints; Row += Rows )
+    {
+	long Count = NumPoints - Row < Rows ? (long) (NumPoints - Row) : Rows;
+	double *pDst = pChunk;
+
+	for( K = 0; K < Count; K++ )
+	{
+	    long H;
+
+	    *pDst++ = IsComplex ? 1e3 * (Row + K + 1) : 1e-9 * (Row + K);
+	    if( IsComplex )
+		*pDst++ = 0;
+	    for( H = IsComplex ? 2 : 1; H < Width; H++ )
+		*pDst++ = Random();
+	}
+
+	if( fwrite( pChunk, RowBytes, Count, pFile ) != (size_t) Count )
+	{
+	    fprintf( stderr, "Error: <%s> can not be written.\n",
+	             argv[ optind ] );
+	    return( 1 );
+	}
+    }
+
+    free( pChunk );
+    if( fclose( pFile ) )
+    {
+	fprintf( stderr, "Error: <%s> can not be written.\n", argv[ optind ] );
+	return( 1 );
+    }
+
+    return( 0 );
+}
@@ -0,0 +1,87 @@
+#include <math.h>
+#include "panmacro.h"
+
+/*
+ * Compiled kernel of PvMod.m (see there for the ports): build it with
+ *
+ *   MPanBuildMacro('PvMod')
+ *
+ * and MATLAB calls the PvMod MEX file instead of PvMod.m. The constants are
+ * those of PvMod.m, the loop over the instances is unit-stride.
+ */
+#define PV_A      1.2
+#define PV_K      1.38062259e-23
+#define PV_ZC     273.15
+#define PV_Q      1.60217733e-19
+#define PV_EG     1.12
+#define PV_T      25.0
+#define PV_TREF   25.0
+#define PV_NS     (36.0 * 8.0)
+#define PV_CT     3.25e-3
+#define PV_ISO    11.6e-9
+#define PV_KS     0.0
+#define PV_SO     1000.0
+#define PV_RSH    1000.0
+#define PV_RS     5e-3
+#define PV_ISCO   5.0
+
+
+
+
+static int PvModEvaluate( const PanMacroBatch *pBatch )
+{
+    const double *Vs = pBatch->pV + PAN_MACRO_PORT( pBatch, 0 );
+    const double *S  = pBatch->pV + PAN_MACRO_PORT( pBatch, 1 );
+    const double *Id = pBatch->pV + PAN_MACRO_PORT( pBatch, 2 );
+    const double *I1 = pBatch->pI + PAN_MACRO_PORT( pBatch, 0 );
+    const double *I2 = pBatch->pI + PAN_MACRO_PORT( pBatch, 1 );
+    double *F1 = pBatch->pF + PAN_MACRO_PORT( pBatch, 0 );
+    double *F2 = pBatch->pF + PAN_MACRO_PORT( pBatch, 1 );
+    double *F3 = pBatch->pF + PAN_MACRO_PORT( pBatch, 2 );
+    double *C11 = pBatch->pC + PAN_MACRO_ENTRY( pBatch, 0, 0 );
+    double *C12 = pBatch->pC + PAN_MACRO_ENTRY( pBatch, 0, 1 );
+    double *C13 = pBatch->pC + PAN_MACRO_ENTRY( pBatch, 0, 2 );
+    double *C31 = pBatch->pC + PAN_MACRO_ENTRY( pBatch, 2, 0 );
+    double *C33 = pBatch->pC + PAN_MACRO_ENTRY( pBatch, 2, 2 );
+    double *R11 = pBatch->pR + PAN_MACRO_ENTRY( pBatch, 0, 0 );
+    double *R22 = pBatch->pR + PAN_MACRO_ENTRY( pBatch, 1, 1 );
+    double Vt = PV_A * PV_K * (PV_T + PV_ZC) / PV_Q;
+    double Io = PV_ISO * pow( (PV_T + PV_ZC) / (PV_TREF + PV_ZC), 3 ) *
+                exp( PV_Q * PV_EG / (PV_A * PV_K) *
+                     (1 / (PV_TREF + PV_ZC) - 1 / (PV_T + PV_ZC)) );
+    double Iph0 = PV_CT * (PV_T - PV_TREF);
+    int K;
+
+    for( K = 0; K < pBatch->NumInst; K++ )
+    {
+	double Vd = Vs[K] / PV_NS + PV_RS * Id[K], Exp;
+
+	if( Vd > 0.8 )
+	    Vd = 0.8;
+	Exp = exp( Vd / Vt );
+
+	/* Cell */
+	F1[K] = -((PV_ISCO / PV_SO * S[K] + Iph0 + PV_CT * PV_KS * S[K]) -
+	          Id[K] - Vd / PV_RSH) - I1[K];
+	R11[K] = -1.0;
+	C11[K] = 1 / (PV_RSH * PV_NS);
+	C12[K] = -PV_ISCO / PV_SO + PV_CT * PV_KS;
+	C13[K] = 1 - PV_RS / PV_RSH;
+
+	/* Irradiance */
+	F2[K] = I2[K];
+	R22[K] = 1.0;
+
+	/* Id auxiliary port */
+	F3[K] = Id[K] - Io * (Exp - 1);
+	C31[K] = -Io * Exp / (PV_NS * Vt);
+	C33[K] = 1 - PV_RS * Io * Exp / Vt;
+    }
+
+    return( 0 );
+}
+
+
+
+
+const PanMacroModel PanMacro = { "PvMod", 3, 0, PvModEvaluate, NULL };
@@ -28,6 +28,7 @@ function [f,C,R]=PvMod(Pars,PN,V,I,StN,X,dX,Time)
 % Set up
 %
     Io = Iso*((T+Zc)/(Tref+Zc))^3*exp(Q*Eg/(A*K)*(1/(Tref+Zc)-1/(T+Zc)));
+    f  = zeros(1,3);
     C  = zeros(3,3);
     R  = zeros(3,3);
 
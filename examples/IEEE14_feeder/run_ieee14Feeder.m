@@ -29,6 +29,16 @@ MPanerror = 0;
 % Turn off displaying of single character or string. Output is in chunks.
 % To augment display granularity comment "panredraw".
 %panredraw('off');
+% To capture what PAN prints, showing it in the command window at most
+% twice a second while the analyses run, uncomment "panlog". The last
+% lines can then be read with panlog('tail', N).
+%panlog('on'); panlog('rate', 0.5);
+% To evaluate the PV macro with the compiled kernel PvMod.c instead of
+% PvMod.m, uncomment "MPanBuildMacro" (needs a C compiler for mex).
+%MPanBuildMacro('PvMod');
+% The compiled PvMod can also skip the PV units whose port voltages did
+% not move since the last Newton iteration: see MPanBuildMacro.
+%PvMod('bypass', 1e-6, 1e-9);
 %%
 % Perform a time domain analysis to initialise the three-phase part
 % of the circuit model. The single-phase model of the hybrid power 
@@ -0,0 +1,404 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+#include "panconsole.h"
+
+#if ! MX_HAS_INTERLEAVED_COMPLEX
+#error "panbatch requires the interleaved complex API: build it with mex -R2018a"
+#endif
+
+#define PANBATCH_USAGE \
+    "Usage: [Y, ROWS, STATUS] = panbatch(ALTER, VALUES, 'name', " \
+    "'analysis', MEM)"
+
+/* Status of a point whose MEM waveforms could not be collected. */
+#define BATCH_NO_DATA  -4
+
+/*
+ * Results are stored samples x vars x points, as pansweep returns them:
+ * every waveform has a slot of Capacity samples, set by the first point
+ * and grown (moving the slots already stored) only by a longer one. The
+ * real buffer becomes the output when no waveform is complex, after the
+ * slots are packed to the longest waveform if Capacity is larger.
+ */
+typedef struct
+{
+    size_t  NumPoints, NumVars, Capacity, Samples;
+    double *pR, *pI;
+    const double *pRows;
+} BatchResult;
+
+
+
+
+static void BatchFill( double *pData, size_t From, size_t To )
+{
+    double NaN = mxGetNaN();
+
+    for( ; From < To; From++ )
+	pData[ From ] = NaN;
+}
+
+
+
+
+/* Move the slots of pData from Capacity to Max samples, the last first. */
+static double *BatchGrow( double *pData, size_t Slots, size_t Capacity,
+                          size_t Max )
+{
+    size_t S;
+
+    pData = mxRealloc( pData, Slots * Max * sizeof( double ) );
+    for( S = Slots; S-- > 0; )
+    {
+	memmove( pData + S * Max, pData + S * Capacity,
+	         Capacity * sizeof( double ) );
+	BatchFill( pData, S * Max + Capacity, (S + 1) * Max );
+    }
+
+    return( pData );
+}
+
+
+
+
+static void BatchReserve( BatchResult *pRes, size_t Samples )
+{
+    size_t Slots = pRes->NumPoints * pRes->NumVars, Max;
+
+    if( Samples > pRes->Samples )
+	pRes->Samples = Samples;
+    if( Samples <= pRes->Capacity )
+	return;
+
+    Max = 2 * pRes->Capacity > Samples ? 2 * pRes->Capacity : Samples;
+
+    pRes->pR = BatchGrow( pRes->pR, Slots, pRes->Capacity, Max );
+    if( pRes->pI )
+	pRes->pI = BatchGrow( pRes->pI, Slots, pRes->Capacity, Max );
+
+    pRes->Capacity = Max;
+}
+
+
+
+
+static void BatchStore( BatchResult *pRes, size_t Point, size_t Var,
+                        const MemWaveform *pWav )
+{
+    size_t Slots = pRes->NumPoints * pRes->NumVars, K, S, Base;
+
+    BatchReserve( pRes, pWav->Rows );
+    Base = (Var + pRes->NumVars * Point) * pRes->Capacity;
+
+    /* The real waveforms stored before the first complex one get 0.0. */
+    if( pWav->pWavArrayI && ! pRes->pI )
+    {
+	pRes->pI = mxMalloc( Slots * pRes->Capacity * sizeof( double ) );
+	BatchFill( pRes->pI, 0, Slots * pRes->Capacity );
+	for( S = 0; S < Slots; S++ )
+	    for( K = 0; K < (size_t) pRes->pRows[S]; K++ )
+		pRes->pI[ S * pRes->Capacity + K ] = 0.0;
+    }
+
+    memcpy( pRes->pR + Base, pWav->pWavArrayR, pWav->Rows * sizeof( double ) );
+
+    if( pRes->pI )
+    {
+	for( K = 0; K < (size_t) pWav->Rows; K++ )
+	    pRes->pI[ Base + K ] = pWav->pWavArrayI ? pWav->pWavArrayI[K] : 0.0;
+    }
+}
+
+
+
+
+static mxArray *BatchOutput( BatchResult *pRes )
+{
+    size_t Slots = pRes->NumPoints * pRes->NumVars, S, K;
+    size_t N = Slots * pRes->Samples;
+    mwSize Dims[3];
+    mxArray *pMexArray;
+
+    Dims[0] = pRes->Samples;
+    Dims[1] = pRes->NumVars;
+    Dims[2] = pRes->NumPoints;
+
+    /* Pack the slots to the longest waveform: each one moves down. */
+    if( pRes->Capacity > pRes->Samples )
+    {
+	for( S = 1; S < Slots; S++ )
+	{
+	    memmove( pRes->pR + S * pRes->Samples,
+	             pRes->pR + S * pRes->Capacity,
+	             pRes->Samples * sizeof( double ) );
+	    if( pRes->pI )
+		memmove( pRes->pI + S * pRes->Samples,
+		         pRes->pI + S * pRes->Capacity,
+		         pRes->Samples * sizeof( double ) );
+	}
+	pRes->Capacity = pRes->Samples;
+    }
+
+    if( ! pRes->pI )
+    {
+	/* The buffer becomes the output: no copy. */
+	pMexArray = mxCreateNumericMatrix( 0, 0, mxDOUBLE_CLASS, mxREAL );
+	mxSetDoubles( pMexArray, mxRealloc( pRes->pR,
+	                                    (N ? N : 1) * sizeof( double ) ) );
+	mxSetDimensions( pMexArray, Dims, 3 );
+	pRes->pR = NULL;
+	return( pMexArray );
+    }
+
+    pMexArray = mxCreateUninitNumericArray( 3, Dims, mxDOUBLE_CLASS,
+                                            mxCOMPLEX );
+    if( NULL == pMexArray )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return( NULL );
+    }
+
+    double *pDst = (double *) mxGetComplexDoubles( pMexArray );
+
+    for( K = 0; K < N; K++ )
+    {
+	*pDst++ = pRes->pR[K];
+	*pDst++ = pRes->pI[K];
+    }
+
+    mxFree( pRes->pR );
+    mxFree( pRes->pI );
+    pRes->pR = pRes->pI = NULL;
+
+    return( pMexArray );
+}
+
+
+
+
+static char **GetStrings( const mxArray *pArg, size_t *pCount,
+                          const char *What )
+{
+    char **ppStrings, Buffer[ 200 ];
+    size_t K, Count;
+
+    sprintf( Buffer, "Error: %s must be a string or a cell array of "
+             "strings. " PANBATCH_USAGE, What );
+
+    if( mxIsChar( pArg ) )
+    {
+	ppStrings = mxMalloc( sizeof( char * ) );
+	ppStrings[0] = mxArrayToString( pArg );
+	*pCount = 1;
+	return( ppStrings );
+    }
+
+    if( ! mxIsCell( pArg ) )
+    {
+	mexErrMsgTxt( Buffer );
+	return( NULL );
+    }
+
+    Count = mxGetNumberOfElements( pArg );
+    ppStrings = mxMalloc( (Count ? Count : 1) * sizeof( char * ) );
+
+    for( K = 0; K < Count; K++ )
+    {
+	const mxArray *pCell = mxGetCell( pArg, K );
+
+	if( ! pCell || ! mxIsChar( pCell ) )
+	{
+	    mexErrMsgTxt( Buffer );
+	    return( NULL );
+	}
+	ppStrings[K] = mxArrayToString( pCell );
+    }
+
+    *pCount = Count;
+    return( ppStrings );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    if( nrhs != 5 )
+    {
+	mexErrMsgTxt( "Error: wrong number of arguments. " PANBATCH_USAGE );
+	return;
+    }
+    if( ! mxIsDouble( prhs[1] ) || mxIsComplex( prhs[1] ) )
+    {
+	mexErrMsgTxt( "Error: VALUES must be a real matrix. " PANBATCH_USAGE );
+	return;
+    }
+    if( ! mxIsChar( prhs[2] ) || ! mxIsChar( prhs[3] ) )
+    {
+	mexErrMsgTxt( "Error: name and analysis must be strings. "
+	              PANBATCH_USAGE );
+	return;
+    }
+    if( nlhs > 3 )
+    {
+	mexErrMsgTxt( "Error: at most three output variables are allowed. "
+	              PANBATCH_USAGE );
+	return;
+    }
+
+    PanSession *Session;
+    int Status;
+
+    PanCounterBegin( PAN_COUNTER_PANBATCH );
+
+    if( (Status = PanSessionAttach( &Session )) )
+    {
+	PanSessionErrMsg( Status, NULL );
+	return;
+    }
+    if( ! Session->Entry.PanMatlabExecuteCommand )
+    {
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabExecuteCommand" );
+	return;
+    }
+    if( ! Session->Entry.PanMatlabGet )
+    {
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabGet" );
+	return;
+    }
+
+    size_t NumParams, NumVars, Point, P, H, Length;
+    char **ppAlter = GetStrings( prhs[0], &NumParams, "ALTER" );
+    char **ppMem = GetStrings( prhs[4], &NumVars, "MEM" );
+    char *Name = mxArrayToString( prhs[2] );
+    char *Analysis = mxArrayToString( prhs[3] );
+    const double *pValues = mxGetDoubles( prhs[1] );
+    size_t NumPoints = mxGetN( prhs[1] );
+
+    if( ! Name || ! Analysis )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+    if( NumParams != mxGetM( prhs[1] ) )
+    {
+	mexErrMsgTxt( "Error: VALUES must have one row per ALTER command. "
+	              PANBATCH_USAGE );
+	return;
+    }
+
+    /*
+     * The commands are formatted once per point in a single buffer, large
+     * enough for the longest of them.
+     */
+    Length = strlen( Analysis ) + strlen( Name ) + 32;
+    for( P = 0; P < NumParams; P++ )
+    {
+	if( strlen( ppAlter[P] ) + 40 > Length )
+	    Length = strlen( ppAlter[P] ) + 40;
+    }
+
+    char *pBuffer = mxMalloc( Length * sizeof( char ) );
+    char **ppNames = mxMalloc( (NumVars ? NumVars : 1) * sizeof( char * ) );
+    MemWaveform *pWavs = mxMalloc( (NumVars ? NumVars : 1) *
+                                   sizeof( MemWaveform ) );
+    mxArray *pRowsArray = mxCreateDoubleMatrix( NumVars, NumPoints, mxREAL );
+    mxArray *pStatusArray = mxCreateDoubleMatrix( 1, NumPoints, mxREAL );
+    double *pRows = mxGetDoubles( pRowsArray );
+    double *pStatus = mxGetDoubles( pStatusArray );
+    BatchResult Res;
+
+    memset( &Res, 0, sizeof( BatchResult ) );
+    Res.NumPoints = NumPoints;
+    Res.NumVars = NumVars;
+    Res.pRows = pRows;
+    Res.pR = mxMalloc( 1 * sizeof( double ) );
+
+    /* The points that are not run, after one that failed, are NaN. */
+    for( Point = 0; Point < NumPoints; Point++ )
+	pStatus[ Point ] = mxGetNaN();
+    for( H = 0; H < NumVars; H++ )
+    {
+	ppNames[H] = mxMalloc( strlen( Name ) + strlen( ppMem[H] ) + 2 );
+	sprintf( ppNames[H], "%s.%s", Name, ppMem[H] );
+    }
+
+    for( Point = 0; Point < NumPoints; Point++ )
+    {
+	int Error = 0;
+
+	PanConsoleBegin();
+
+	for( P = 0; P < NumParams && ! Error; P++ )
+	{
+	    sprintf( pBuffer, "%s%23.16e", ppAlter[P],
+	             pValues[ Point * NumParams + P ] );
+	    errno = 0;
+	    PanCounterPanEnter();
+	    Error = (Session->Entry.PanMatlabExecuteCommand)( pBuffer );
+	    PanCounterPanLeave();
+	}
+
+	if( ! Error )
+	{
+	    sprintf( pBuffer, "%s %s", Name, Analysis );
+	    errno = 0;
+	    PanCounterPanEnter();
+	    Error = (Session->Entry.PanMatlabExecuteCommand)( pBuffer );
+	    PanCounterPanLeave();
+	}
+
+	PanConsoleEnd();
+
+	pStatus[ Point ] = Error;
+	if( Error )
+	    break;
+
+	/*
+	 * As in pansweep, the waveforms of a point are stored only if all
+	 * of them are found, numeric and single-column.
+	 */
+	for( H = 0; H < NumVars; H++ )
+	{
+	    pWavs[H].Name = ppNames[H];
+	    if( ! PanMemWaveformGet( Session, pWavs + H ) ||
+	        pWavs[H].pWavArrayS || ! pWavs[H].pWavArrayR ||
+	        1 != pWavs[H].Cols )
+	    {
+		pStatus[ Point ] = BATCH_NO_DATA;
+		break;
+	    }
+	}
+
+	for( H = 0; H < NumVars && ! pStatus[ Point ]; H++ )
+	{
+	    BatchStore( &Res, Point, H, pWavs + H );
+	    pRows[ H + NumVars * Point ] = pWavs[H].Rows;
+	}
+    }
+
+    mxFree( pBuffer );
+    mxFree( pWavs );
+    for( H = 0; H < NumVars; H++ )
+	mxFree( ppNames[H] );
+    mxFree( ppNames );
+
+    plhs[0] = BatchOutput( &Res );
+
+    PanCounterBytes( PAN_COUNTER_MX_BYTES( plhs[0] ) );
+    PanCounterEnd( Analysis );
+
+    if( nlhs > 1 )
+	plhs[1] = pRowsArray;
+    else
+	mxDestroyArray( pRowsArray );
+    if( nlhs > 2 )
+	plhs[2] = pStatusArray;
+    else
+	mxDestroyArray( pStatusArray );
+}
@@ -2,120 +2,126 @@
 #include <dlfcn.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+#include "panmemreg.h"
 
-#define PAN_MAT_SHL_NAME      "panMat.so"
+#define PANCLEARWAV_USAGE \
+    "Usage: panclearwav('name'), panclearwav('pattern'[, 'glob' | 'regex']) " \
+    "or NAMES = panclearwav(...), optionally followed by 'session', NAME"
 
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
-{
-    void *Module;
+#define CLEAR_EXACT  0
+#define CLEAR_GLOB   1
+#define CLEAR_REGEX  2
 
-    if( nrhs != 1 )
-    {
-	mexErrMsgTxt( "Error: missing argument. Usage: panclearwav('name')");
-	return;
-    }
 
-    if( ! mxIsChar(prhs[0]))
-    {
-        mexErrMsgTxt( "Error: argument must be a string. "
-	              "Usage: panrclearwav('string')" );
-	return;
-    }
-    if( nlhs != 0 )
+
+
+/*
+ * Delete the registered memwaveforms matching Pattern. Only the
+ * memwaveforms fetched by the gateways, or registered with panmemwav, are
+ * known: PAN can not enumerate its memwaveforms.
+ */
+static mxArray *ClearPattern( PanSession *Session, const char *Pattern,
+                              int Mode )
+{
+    char **ppNames;
+    mxArray *pCell;
+    int Count, K, Deleted = 0;
+
+    Count = PanMemRegSelect( Session, Pattern, CLEAR_REGEX == Mode, &ppNames );
+    if( Count < 0 )
     {
-	mexErrMsgTxt( "Error: no output variable is required. "
-	              "Usage: panclearwav('string')");
-	return;
+	if( CLEAR_REGEX == Mode )
+	    mexErrMsgTxt( "Error: invalid regular expression. "
+	                  PANCLEARWAV_USAGE );
+	mexErrMsgTxt( "No more memory.\n" );
     }
 
-    char *ShlPath = (char *) getenv( "PAN_MAT_SHL_PATH" );
-    char *Path;
+    pCell = mxCreateCellMatrix( Count, 1 );
 
-    if( ShlPath )
+    for( K = 0; K < Count; K++ )
     {
-        Path = (char *) malloc( (strlen(ShlPath) + strlen(PAN_MAT_SHL_NAME) + 20) *
-	                        sizeof( char ) );
-	if( ! Path )
-	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
-	}
+	char RetCode;
 
-	sprintf( Path, "%s/%s", ShlPath, PAN_MAT_SHL_NAME );
-    }
-    else
-    {
-        Path = (char *) malloc((strlen(PAN_MAT_SHL_NAME)+20) * sizeof( char ) );
-	if( ! Path )
-	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
-	}
+	PanCounterPanEnter();
+	RetCode = (Session->Entry.MemWaveformDeleteByName)( ppNames[K] );
+	PanCounterPanLeave();
 
-	sprintf( Path, "%s", PAN_MAT_SHL_NAME );
+	PanMemRegForget( Session, ppNames[K] );
+	if( RetCode )
+	    mxSetCell( pCell, Deleted++, mxCreateString( ppNames[K] ) );
     }
+    mxSetM( pCell, Deleted );
 
-    Module = dlopen( Path, RTLD_LAZY | RTLD_DEEPBIND | RTLD_NOLOAD );
-    if( ! Module )
-    {
-	int Count, Length;
-	char *MexErrBuffer;
+    PanMemRegFreeNames( ppNames, Count );
+
+    return( pCell );
+}
 
-	Length = strlen( Path ) + 150;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
-	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
-	}
 
-	Count = sprintf( MexErrBuffer, "The <%s> shared libray can not be "
-	    "loaded.\n"
-	    "Run \"pannet('filename')\" command before reading simulation "
-	    "results.\n", Path );
 
-	if( Count >= Length )
-	    abort();
 
-	mexErrMsgTxt( MexErrBuffer );
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    char SessionName[ PAN_SESSION_NAME_SIZE ];
+    int Mode = CLEAR_EXACT;
 
+    if( nrhs < 1 || nrhs > 4 ||
+        (nrhs = PanSessionArgs( nrhs, prhs, SessionName )) < 0 || nrhs > 2 )
+    {
+	mexErrMsgTxt( "Error: missing argument. " PANCLEARWAV_USAGE );
 	return;
     }
 
-    errno = 0;
-
-    char (*Entry)( char * );
-    char *EntryName = "MemWaveformDeleteByName";
-
-    Entry = dlsym( Module, EntryName );
-    if( NULL == Entry )
+    if( ! mxIsChar(prhs[0]))
     {
-	dlclose( Module );
-
-	int Count, Length;
-	char *MexErrBuffer;
-
-	Length = strlen( Path ) + strlen( EntryName ) + 100;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
-	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
-	}
+        mexErrMsgTxt( "Error: argument must be a string. "
+	              PANCLEARWAV_USAGE );
+	return;
+    }
+    if( nlhs > 1 )
+    {
+	mexErrMsgTxt( "Error: at most one output variable is required. "
+	              PANCLEARWAV_USAGE );
+	return;
+    }
+    if( 2 == nrhs )
+    {
+	char Buffer[ 16 ];
+
+	if( ! mxIsChar( prhs[1] ) ||
+	    mxGetString( prhs[1], Buffer, sizeof( Buffer ) ) )
+	    mexErrMsgTxt( "Error: the mode must be 'glob' or 'regex'. "
+	                  PANCLEARWAV_USAGE );
+	if( ! strcasecmp( Buffer, "glob" ) )
+	    Mode = CLEAR_GLOB;
+	else if( ! strcasecmp( Buffer, "regex" ) )
+	    Mode = CLEAR_REGEX;
+	else
+	    mexErrMsgTxt( "Error: the mode must be 'glob' or 'regex'. "
+	                  PANCLEARWAV_USAGE );
+    }
 
-	Count = sprintf( MexErrBuffer, "The <%s> evaluate routine is not "
-	        "found in <%s> shared module.\n\n", EntryName, Path );
-	if( Count >= Length )
-	    abort();
+    PanSession *Session;
+    int Status;
 
-	mexErrMsgTxt( MexErrBuffer );
+    PanCounterBegin( PAN_COUNTER_PANCLEARWAV );
 
+    if( (Status = PanSessionAttachNamed( SessionName, &Session )) )
+    {
+	PanSessionErrMsg( Status, SessionName );
 	return;
     }
 
-    free( Path );
+    if( ! Session->Entry.MemWaveformDeleteByName )
+    {
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "MemWaveformDeleteByName" );
+	return;
+    }
 
     size_t  CharNum;
     char *Argument;
@@ -132,7 +138,32 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
     mxGetString( prhs[0], Argument, 1 + CharNum );
 
-    RetCode = (Entry)( Argument );
+    /* Memwaveform names never contain wildcards. */
+    if( CLEAR_EXACT == Mode && strpbrk( Argument, "*?[" ) )
+	Mode = CLEAR_GLOB;
+
+    if( CLEAR_EXACT != Mode )
+    {
+	mxArray *pNames = ClearPattern( Session, Argument, Mode );
+
+	if( nlhs )
+	    plhs[0] = pNames;
+	else
+	    mxDestroyArray( pNames );
+
+	PanSessionDetach();
+	PanCounterEnd( Argument );
+	mxFree( Argument );
+
+	return;
+    }
+
+    PanCounterPanEnter();
+    RetCode = (Session->Entry.MemWaveformDeleteByName)( Argument );
+    PanCounterPanLeave();
+
+    PanMemRegForget( Session, Argument );
+    PanSessionDetach();
 
     if( ! RetCode )
     {
@@ -153,8 +184,14 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	mxFree( Buffer );
     }
 
+    if( nlhs )
+    {
+	plhs[0] = mxCreateCellMatrix( 1, 1 );
+	mxSetCell( plhs[0], 0, mxCreateString( Argument ) );
+    }
+
+    PanCounterEnd( Argument );
     mxFree( Argument );
 
-    dlclose( Module );
     return;
 }
@@ -0,0 +1,411 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "mex.h"
+#include "panconsole.h"
+
+#define CONSOLE_CHUNK  65536
+
+#if __ELF_NATIVE_CLASS == 64
+#define CONSOLE_R_SYM  ELF64_R_SYM
+#else
+#define CONSOLE_R_SYM  ELF32_R_SYM
+#endif
+
+/*
+ * Every gateway links its own copy of this file: Block caches the address
+ * of the shared block.
+ */
+static PanConsoleBlock *Block;
+
+
+
+
+/* The block is created and used by the MATLAB thread only. */
+PanConsoleBlock *PanConsoleBlockGet( void )
+{
+    char *Tag, Buffer[ 32 ];
+    PanConsoleBlock *pBlock = NULL;
+
+    if( Block )
+	return( Block );
+
+    Tag = getenv( PAN_MAT_CONSOLE_ENV );
+    if( Tag && 1 == sscanf( Tag, "%p", (void **) &pBlock ) && pBlock )
+	return( Block = pBlock );
+
+    pBlock = (PanConsoleBlock *) calloc( 1, sizeof( PanConsoleBlock ) );
+    if( ! pBlock )
+	return( NULL );
+
+    pthread_mutex_init( &(pBlock->Lock), NULL );
+    pBlock->FlushBytes = PAN_CONSOLE_FLUSH_BYTES;
+    pBlock->FlushSeconds = PAN_CONSOLE_FLUSH_SECONDS;
+
+    sprintf( Buffer, "%p", (void *) pBlock );
+    setenv( PAN_MAT_CONSOLE_ENV, Buffer, 1 );
+
+    return( Block = pBlock );
+}
+
+
+
+
+static double ConsoleNow( void )
+{
+    struct timespec Now;
+
+    clock_gettime( CLOCK_MONOTONIC, &Now );
+
+    return( Now.tv_sec + 1e-9 * Now.tv_nsec );
+}
+
+
+
+
+static void ConsoleStore( const char *pData, size_t Size )
+{
+    size_t Offset, Part;
+
+    /* Only the last PAN_CONSOLE_RING_SIZE bytes can be kept. */
+    pthread_mutex_lock( &(Block->Lock) );
+
+    if( Size > PAN_CONSOLE_RING_SIZE )
+    {
+	Block->Written += Size - PAN_CONSOLE_RING_SIZE;
+	pData += Size - PAN_CONSOLE_RING_SIZE;
+	Size = PAN_CONSOLE_RING_SIZE;
+    }
+
+    Offset = Block->Written % PAN_CONSOLE_RING_SIZE;
+    Part = PAN_CONSOLE_RING_SIZE - Offset < Size ?
+           PAN_CONSOLE_RING_SIZE - Offset : Size;
+
+    memcpy( Block->Ring + Offset, pData, Part );
+    memcpy( Block->Ring, pData + Part, Size - Part );
+    Block->Written += Size;
+
+    pthread_mutex_unlock( &(Block->Lock) );
+}
+
+
+
+
+/* The reader never calls the MATLAB API: it is not the MATLAB thread. */
+static void *ConsoleReader( void *pArg )
+{
+    PanConsoleCapture *pCapture = (PanConsoleCapture *) pArg;
+    char pBuffer[ CONSOLE_CHUNK ];
+    ssize_t Count;
+
+    for( ;; )
+    {
+	Count = read( pCapture->Pipe, pBuffer, CONSOLE_CHUNK );
+	if( Count < 0 && EINTR == errno )
+	    continue;
+	if( Count <= 0 )
+	    break;
+
+	ConsoleStore( pBuffer, Count );
+	if( pCapture->pMirror )
+	    fwrite( pBuffer, 1, Count, pCapture->pMirror );
+    }
+
+    return( NULL );
+}
+
+
+
+
+/*
+ * The mexPrintf of panMat.so, on the MATLAB thread: what is printed while
+ * a call is captured is echoed at the rate of the capture.
+ */
+static int ConsolePrintf( const char *Format, ... )
+{
+    PanConsoleBlock *pBlock = PanConsoleBlockGet();
+    va_list Args;
+    char *pText;
+    int Length;
+
+    va_start( Args, Format );
+    Length = vasprintf( &pText, Format, Args );
+    va_end( Args );
+    if( Length < 0 )
+	return( 0 );
+
+    if( pBlock && pBlock->Capture.Active )
+    {
+	ConsoleStore( pText, Length );
+	if( pBlock->Capture.pMirror )
+	    fwrite( pText, 1, Length, pBlock->Capture.pMirror );
+	PanConsoleEcho( 0 );
+    }
+    else
+	mexPrintf( "%s", pText );
+
+    free( pText );
+
+    return( Length );
+}
+
+
+
+
+/* A pointer of the dynamic section, relocated or not by the loader. */
+static void *ConsoleAddress( const struct link_map *pMap, ElfW(Addr) Pointer )
+{
+    return( (void *) (Pointer < pMap->l_addr ? pMap->l_addr + Pointer :
+                                               Pointer) );
+}
+
+
+
+
+void PanConsoleHook( void *Module )
+{
+    struct link_map *pMap;
+    const ElfW(Dyn) *pDyn;
+    const ElfW(Sym) *pSymbols = NULL;
+    const char *pStrings = NULL;
+    const ElfW(Rela) *ppRela[2] = { NULL, NULL };
+    size_t pSize[2] = { 0, 0 }, Page = sysconf( _SC_PAGESIZE ), K;
+    int PltRela = 0, J;
+
+    if( ! Module || dlinfo( Module, RTLD_DI_LINKMAP, &pMap ) || ! pMap->l_ld )
+	return;
+
+    for( pDyn = pMap->l_ld; DT_NULL != pDyn->d_tag; pDyn++ )
+    {
+	switch( pDyn->d_tag )
+	{
+	    case DT_SYMTAB:
+		pSymbols = ConsoleAddress( pMap, pDyn->d_un.d_ptr );
+		break;
+	    case DT_STRTAB:
+		pStrings = ConsoleAddress( pMap, pDyn->d_un.d_ptr );
+		break;
+	    case DT_JMPREL:
+		ppRela[0] = ConsoleAddress( pMap, pDyn->d_un.d_ptr );
+		break;
+	    case DT_PLTRELSZ:
+		pSize[0] = pDyn->d_un.d_val;
+		break;
+	    case DT_PLTREL:
+		PltRela = DT_RELA == pDyn->d_un.d_val;
+		break;
+	    case DT_RELA:
+		ppRela[1] = ConsoleAddress( pMap, pDyn->d_un.d_ptr );
+		break;
+	    case DT_RELASZ:
+		pSize[1] = pDyn->d_un.d_val;
+		break;
+	}
+    }
+    if( ! pSymbols || ! pStrings )
+	return;
+    if( ! PltRela )
+	ppRela[0] = NULL;
+
+    /* The PLT slots, and the GOT ones of a module taking its address. */
+    for( J = 0; J < 2; J++ )
+    {
+	for( K = 0; ppRela[J] && K < pSize[J] / sizeof( ElfW(Rela) ); K++ )
+	{
+	    const ElfW(Rela) *pRela = ppRela[J] + K;
+	    void **pSlot;
+
+	    if( strcmp( pStrings +
+	                pSymbols[ CONSOLE_R_SYM( pRela->r_info ) ].st_name,
+	                "mexPrintf" ) )
+		continue;
+
+	    /* The slot may be read only after relocation (RELRO). */
+	    pSlot = (void **) (pMap->l_addr + pRela->r_offset);
+	    mprotect( (void *) ((uintptr_t) pSlot & ~(Page - 1)), Page,
+	              PROT_READ | PROT_WRITE );
+	    *pSlot = (void *) ConsolePrintf;
+	}
+    }
+}
+
+
+
+
+void PanConsoleEcho( int Force )
+{
+    PanConsoleBlock *pBlock = PanConsoleBlockGet();
+    uint64_t Pending, Dropped = 0, K;
+    double Now = ConsoleNow();
+    char *pText;
+
+    if( ! pBlock )
+	return;
+
+    pthread_mutex_lock( &(pBlock->Lock) );
+
+    Pending = pBlock->Written - pBlock->Echoed;
+    if( ! Pending || (! Force && Pending < pBlock->FlushBytes &&
+                      Now - pBlock->LastEcho < pBlock->FlushSeconds) )
+    {
+	pthread_mutex_unlock( &(pBlock->Lock) );
+	return;
+    }
+
+    /* The ring may have been overwritten since the last echo. */
+    if( Pending > PAN_CONSOLE_RING_SIZE )
+    {
+	Dropped = Pending - PAN_CONSOLE_RING_SIZE;
+	Pending = PAN_CONSOLE_RING_SIZE;
+    }
+
+    pText = (char *) malloc( Pending + 1 );
+    if( pText )
+    {
+	for( K = 0; K < Pending; K++ )
+	    pText[K] = pBlock->Ring[ (pBlock->Written - Pending + K) %
+	                             PAN_CONSOLE_RING_SIZE ];
+	pText[ Pending ] = 0;
+    }
+    pBlock->Echoed = pBlock->Written;
+    pBlock->LastEcho = Now;
+
+    pthread_mutex_unlock( &(pBlock->Lock) );
+
+    /*
+     * mexPrintf is called without the lock: it may run MATLAB code. Within
+     * a capture it gets the original descriptors, which it writes to when
+     * MATLAB runs without its desktop.
+     */
+    if( pBlock->Capture.Active )
+    {
+	fflush( stdout );
+	fflush( stderr );
+	dup2( pBlock->Capture.Saved[0], 1 );
+	dup2( pBlock->Capture.Saved[1], 2 );
+    }
+    if( Dropped )
+	mexPrintf( "[%llu bytes of console output not shown]\n",
+	           (unsigned long long) Dropped );
+    if( pText )
+    {
+	mexPrintf( "%s", pText );
+	free( pText );
+    }
+    if( pBlock->Capture.Active )
+    {
+	fflush( stdout );
+	fflush( stderr );
+	dup2( pBlock->Capture.Sink, 1 );
+	dup2( pBlock->Capture.Sink, 2 );
+    }
+}
+
+
+
+
+/* Restore the descriptors of the capture: the reader drains the pipe. */
+static void ConsoleStop( PanConsoleCapture *pCapture )
+{
+    fflush( stdout );
+    fflush( stderr );
+    dup2( pCapture->Saved[0], 1 );
+    dup2( pCapture->Saved[1], 2 );
+    close( pCapture->Sink );
+
+    pthread_join( pCapture->Reader, NULL );
+
+    close( pCapture->Saved[0] );
+    close( pCapture->Saved[1] );
+    close( pCapture->Pipe );
+    if( pCapture->pMirror )
+	fclose( pCapture->pMirror );
+
+    pCapture->Active = 0;
+}
+
+
+
+
+void PanConsoleBegin( void )
+{
+    PanConsoleBlock *pBlock = PanConsoleBlockGet();
+    PanConsoleCapture Capture;
+    int Pipe[2];
+
+    if( ! pBlock )
+	return;
+
+    /* The calls do not nest: an active capture was left by an error. */
+    if( pBlock->Capture.Active )
+	ConsoleStop( &(pBlock->Capture) );
+
+    memset( &Capture, 0, sizeof( Capture ) );
+
+    pthread_mutex_lock( &(pBlock->Lock) );
+    if( ! pBlock->Enabled )
+    {
+	pthread_mutex_unlock( &(pBlock->Lock) );
+	return;
+    }
+    Capture.pMirror = pBlock->Mirror[0] ? fopen( pBlock->Mirror, "a" ) : NULL;
+    pthread_mutex_unlock( &(pBlock->Lock) );
+
+    fflush( stdout );
+    fflush( stderr );
+
+    if( pipe( Pipe ) )
+    {
+	if( Capture.pMirror )
+	    fclose( Capture.pMirror );
+	return;
+    }
+
+    Capture.Pipe = Pipe[0];
+    Capture.Sink = Pipe[1];
+    Capture.Saved[0] = dup( 1 );
+    Capture.Saved[1] = dup( 2 );
+    dup2( Pipe[1], 1 );
+    dup2( Pipe[1], 2 );
+
+    pBlock->Capture = Capture;
+    if( pthread_create( &(pBlock->Capture.Reader), NULL, ConsoleReader,
+                        &(pBlock->Capture) ) )
+    {
+	dup2( Capture.Saved[0], 1 );
+	dup2( Capture.Saved[1], 2 );
+	close( Capture.Saved[0] );
+	close( Capture.Saved[1] );
+	close( Capture.Sink );
+	close( Capture.Pipe );
+	if( Capture.pMirror )
+	    fclose( Capture.pMirror );
+	return;
+    }
+
+    pBlock->Capture.Active = 1;
+}
+
+
+
+
+void PanConsoleEnd( void )
+{
+    PanConsoleBlock *pBlock = PanConsoleBlockGet();
+
+    if( ! pBlock || ! pBlock->Capture.Active )
+	return;
+
+    ConsoleStop( &(pBlock->Capture) );
+
+    PanConsoleEcho( 0 );
+}
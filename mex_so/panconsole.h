@@ -0,0 +1,91 @@
+#ifndef PAN_CONSOLE_H
+#define PAN_CONSOLE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * The console settings and the ring buffer are shared by all the gateways
+ * through a block whose address is published in this environment
+ * variable, as done for PAN_MAT_STATS.
+ */
+#define PAN_MAT_CONSOLE_ENV        "PAN_MAT_CONSOLE"
+
+#define PAN_CONSOLE_RING_SIZE      (1 << 20)
+#define PAN_CONSOLE_PATH_SIZE      4096
+
+/* Default echo thresholds of the captured output. */
+#define PAN_CONSOLE_FLUSH_BYTES    4096
+#define PAN_CONSOLE_FLUSH_SECONDS  0.5
+
+/*
+ * The call being captured. It lives in the shared block so that any
+ * gateway can close a capture left open by a MATLAB error.
+ */
+typedef struct
+{
+    int        Active;
+    int        Pipe, Sink;
+    int        Saved[2];
+    FILE      *pMirror;
+    pthread_t  Reader;
+} PanConsoleCapture;
+
+typedef struct
+{
+    pthread_mutex_t Lock;
+    int             Enabled;
+    size_t          FlushBytes;
+    double          FlushSeconds;
+    char            Mirror[ PAN_CONSOLE_PATH_SIZE ];
+
+    /*
+     * Bytes ever written: the ring holds the last PAN_CONSOLE_RING_SIZE.
+     * The ones before Echoed have been printed in the command window, the
+     * last time LastEcho seconds after the epoch of the monotonic clock.
+     */
+    uint64_t        Written;
+    uint64_t        Echoed;
+    double          LastEcho;
+    char            Ring[ PAN_CONSOLE_RING_SIZE ];
+
+    PanConsoleCapture Capture;
+} PanConsoleBlock;
+
+/* The shared block: NULL only if it can not be allocated. */
+PanConsoleBlock *PanConsoleBlockGet( void );
+
+/*
+ * Calls into panMat.so that may print are enclosed in PanConsoleBegin /
+ * PanConsoleEnd, on the MATLAB thread. When the capture is enabled, what
+ * PAN prints through mexPrintf (see PanConsoleHook) is stored in the ring
+ * buffer and in the mirror file, and printed in the command window as
+ * soon as at least FlushBytes bytes are pending or FlushSeconds seconds
+ * have passed since the last time, also while the call runs. The standard
+ * output and error are redirected into a pipe for the duration of the
+ * call as well: a thread stores what is written there, which is printed
+ * with the next output of PAN or by PanConsoleEnd. The output held back
+ * at the end is printed by a later call. The calls do not nest: a capture
+ * left open by a MATLAB error is closed by the next PanConsoleBegin or
+ * PanConsoleEnd.
+ */
+void PanConsoleBegin( void );
+void PanConsoleEnd( void );
+
+/*
+ * Make the mexPrintf calls of the loaded Module go through the capture,
+ * by rewriting the entries of its global offset table (ELF RELA targets
+ * only). Used by pannet after every load: the gateway calling it must
+ * stay locked in memory for as long as Module is loaded.
+ */
+void PanConsoleHook( void *Module );
+
+/*
+ * Print the captured output not yet printed, at once if Force is set or
+ * else as PanConsoleEnd does. On the MATLAB thread only.
+ */
+void PanConsoleEcho( int Force );
+
+#endif
@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pancounter.h"
+
+const char *PanCounterNames[ PAN_COUNTER_NUM ] =
+{
+    "pannet", "dlopen", "pansimc", "pansimc_async", "panget", "panslice",
+    "panclearwav", "panredraw", "panrawread", "pansweep", "panbatch",
+    "MPanUpdateRawFilesList", "panrawconv", "pandownsample", "panmemwav"
+};
+
+typedef struct
+{
+    int      Active;
+    int      Id;
+    uint64_t Start, PanStart, PanTime, Bytes;
+} CounterCall;
+
+/*
+ * Every gateway links its own copy of this file: Block caches the address
+ * of the shared block, Call is the call in progress in this thread.
+ */
+static PanCounterBlock *Block;
+static __thread CounterCall Call;
+
+
+
+
+uint64_t PanCounterNow( void )
+{
+    struct timespec Now;
+
+    clock_gettime( CLOCK_MONOTONIC, &Now );
+
+    return( (uint64_t) Now.tv_sec * 1000000000u + Now.tv_nsec );
+}
+
+
+
+
+/*
+ * The block is created by the MATLAB thread: pansimc_async fetches it
+ * before starting its worker, which therefore never calls setenv.
+ */
+PanCounterBlock *PanCounterBlockGet( void )
+{
+    char *Tag, Buffer[ 32 ];
+    PanCounterBlock *pBlock = NULL;
+
+    if( Block )
+	return( Block );
+
+    Tag = getenv( PAN_MAT_STATS_ENV );
+    if( Tag && 1 == sscanf( Tag, "%p", (void **) &pBlock ) && pBlock )
+	return( Block = pBlock );
+
+    pBlock = (PanCounterBlock *) calloc( 1, sizeof( PanCounterBlock ) );
+    if( ! pBlock )
+	return( NULL );
+
+    pBlock->Epoch = PanCounterNow();
+
+    sprintf( Buffer, "%p", (void *) pBlock );
+    setenv( PAN_MAT_STATS_ENV, Buffer, 1 );
+
+    return( Block = pBlock );
+}
+
+
+
+
+void PanCounterBegin( PanCounterId Id )
+{
+    PanCounterBlockGet();
+
+    Call.Active = 1;
+    Call.Id = Id;
+    Call.PanTime = Call.Bytes = 0;
+    Call.Start = PanCounterNow();
+}
+
+
+
+
+void PanCounterPanEnter( void )
+{
+    if( Call.Active )
+	Call.PanStart = PanCounterNow();
+}
+
+
+
+
+void PanCounterPanLeave( void )
+{
+    if( Call.Active )
+	Call.PanTime += PanCounterNow() - Call.PanStart;
+}
+
+
+
+
+void PanCounterBytes( size_t Bytes )
+{
+    Call.Bytes += Bytes;
+}
+
+
+
+
+static void CounterRecord( PanCounterBlock *pBlock, int Id, uint64_t Start,
+                           uint64_t Time, uint64_t PanTime, uint64_t Bytes,
+                           const char *Label )
+{
+    PanCounter *pCounter = pBlock->Counter + Id;
+
+    /* pansimc_async records from the thread that feeds its worker. */
+    __atomic_add_fetch( &(pCounter->Calls), 1, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &(pCounter->Time), Time, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &(pCounter->PanTime), PanTime, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &(pCounter->Bytes), Bytes, __ATOMIC_RELAXED );
+
+    if( __atomic_load_n( &(pBlock->Tracing), __ATOMIC_RELAXED ) )
+    {
+	uint64_t K = __atomic_fetch_add( &(pBlock->TraceNext), 1,
+	                                 __ATOMIC_RELAXED );
+	PanCounterTrace *pTrace = pBlock->Trace + K % PAN_COUNTER_TRACE_SIZE;
+
+	pTrace->Id = Id;
+	pTrace->Start = Start > pBlock->Epoch ? Start - pBlock->Epoch : 0;
+	pTrace->Time = Time;
+	pTrace->PanTime = PanTime;
+	pTrace->Bytes = Bytes;
+	strncpy( pTrace->Label, Label ? Label : "", PAN_COUNTER_LABEL_SIZE - 1 );
+	pTrace->Label[ PAN_COUNTER_LABEL_SIZE - 1 ] = 0;
+    }
+}
+
+
+
+
+void PanCounterEnd( const char *Label )
+{
+    PanCounterBlock *pBlock = Block;
+
+    if( ! Call.Active )
+	return;
+    Call.Active = 0;
+
+    if( pBlock )
+	CounterRecord( pBlock, Call.Id, Call.Start, PanCounterNow() - Call.Start,
+	               Call.PanTime, Call.Bytes, Label );
+}
+
+
+
+
+void PanCounterAdd( PanCounterId Id, uint64_t Time, uint64_t Bytes,
+                    const char *Label )
+{
+    PanCounterBlock *pBlock = PanCounterBlockGet();
+
+    if( pBlock )
+	CounterRecord( pBlock, Id, PanCounterNow() - Time, Time, 0, Bytes,
+	               Label );
+}
@@ -0,0 +1,100 @@
+#ifndef PAN_COUNTER_H
+#define PAN_COUNTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The counters of all the gateways live in one block allocated by the
+ * first gateway that is called. Its address is published in this
+ * environment variable: the block survives a "clear mex" of any gateway.
+ */
+#define PAN_MAT_STATS_ENV      "PAN_MAT_STATS"
+
+/* Calls recorded in the trace, oldest first overwritten. */
+#define PAN_COUNTER_TRACE_SIZE   4096
+#define PAN_COUNTER_LABEL_SIZE   80
+
+typedef enum
+{
+    PAN_COUNTER_PANNET,
+    PAN_COUNTER_DLOPEN,
+    PAN_COUNTER_PANSIMC,
+    PAN_COUNTER_PANSIMC_ASYNC,
+    PAN_COUNTER_PANGET,
+    PAN_COUNTER_PANSLICE,
+    PAN_COUNTER_PANCLEARWAV,
+    PAN_COUNTER_PANREDRAW,
+    PAN_COUNTER_PANRAWREAD,
+    PAN_COUNTER_PANSWEEP,
+    PAN_COUNTER_PANBATCH,
+    PAN_COUNTER_RAWLIST,
+    PAN_COUNTER_PANRAWCONV,
+    PAN_COUNTER_PANDOWNSAMPLE,
+    PAN_COUNTER_PANMEMWAV,
+    PAN_COUNTER_NUM
+} PanCounterId;
+
+/*
+ * Times are in nanoseconds of CLOCK_MONOTONIC. PanTime is the time spent
+ * inside the entry points of panMat.so: the rest of Time is spent in the
+ * gateway marshalling arguments and results.
+ */
+typedef struct
+{
+    uint64_t Calls;
+    uint64_t Time;
+    uint64_t PanTime;
+    uint64_t Bytes;
+} PanCounter;
+
+typedef struct
+{
+    int      Id;
+    uint64_t Start;
+    uint64_t Time;
+    uint64_t PanTime;
+    uint64_t Bytes;
+    char     Label[ PAN_COUNTER_LABEL_SIZE ];
+} PanCounterTrace;
+
+typedef struct
+{
+    PanCounter      Counter[ PAN_COUNTER_NUM ];
+    uint64_t        Epoch;
+    int             Tracing;
+    uint64_t        TraceNext;
+    PanCounterTrace Trace[ PAN_COUNTER_TRACE_SIZE ];
+} PanCounterBlock;
+
+/* Name of a counter as reported by MPanStats. */
+extern const char *PanCounterNames[ PAN_COUNTER_NUM ];
+
+/* The shared block: NULL only if it can not be allocated. */
+PanCounterBlock *PanCounterBlockGet( void );
+
+/* Current CLOCK_MONOTONIC time in nanoseconds. */
+uint64_t PanCounterNow( void );
+
+/*
+ * A gateway call is enclosed in PanCounterBegin / PanCounterEnd. The calls
+ * into panMat.so are enclosed in PanCounterPanEnter / PanCounterPanLeave
+ * and the data copied into mxArrays is added with PanCounterBytes. The
+ * current call is kept per thread: a call that raises a MATLAB error is
+ * simply not recorded.
+ */
+void PanCounterBegin( PanCounterId Id );
+void PanCounterPanEnter( void );
+void PanCounterPanLeave( void );
+void PanCounterBytes( size_t Bytes );
+void PanCounterEnd( const char *Label );
+
+/* Bytes of the data of a numeric mxArray (to be used with mex.h). */
+#define PAN_COUNTER_MX_BYTES( pArray ) \
+    ((size_t) mxGetNumberOfElements( pArray ) * mxGetElementSize( pArray ))
+
+/* Record a call measured elsewhere (e.g. by a MATLAB function). */
+void PanCounterAdd( PanCounterId Id, uint64_t Time, uint64_t Bytes,
+                    const char *Label );
+
+#endif
@@ -0,0 +1,199 @@
+#include <math.h>
+#include "pandecim.h"
+
+
+
+
+size_t PanSeriesFirstAtLeast( const PanSeries *pTime, size_t N, double T )
+{
+    size_t Low = 0, High = N, Middle;
+
+    while( Low < High )
+    {
+	Middle = Low + (High - Low) / 2;
+	if( PanSeriesAt( pTime, Middle ) < T )
+	    Low = Middle + 1;
+	else
+	    High = Middle;
+    }
+
+    return( Low );
+}
+
+
+
+
+size_t PanSeriesFirstAbove( const PanSeries *pTime, size_t N, double T )
+{
+    size_t Low = 0, High = N, Middle;
+
+    while( Low < High )
+    {
+	Middle = Low + (High - Low) / 2;
+	if( PanSeriesAt( pTime, Middle ) <= T )
+	    Low = Middle + 1;
+	else
+	    High = Middle;
+    }
+
+    return( Low );
+}
+
+
+
+
+static size_t Copy( const PanSeries *pTime, const PanSeries *pValue,
+                    size_t First, size_t Last, double *pOutT, double *pOutY )
+{
+    size_t I;
+
+    for( I = First; I < Last; I++ )
+    {
+	*pOutT++ = PanSeriesAt( pTime, I );
+	*pOutY++ = PanSeriesAt( pValue, I );
+    }
+
+    return( Last - First );
+}
+
+
+
+
+/* The extremes of a bucket, in time order: one point if they coincide. */
+static size_t Emit( const PanSeries *pTime, const PanSeries *pValue,
+                    size_t MinI, size_t MaxI, double *pOutT, double *pOutY )
+{
+    size_t Low = MinI < MaxI ? MinI : MaxI, High = MinI < MaxI ? MaxI : MinI;
+
+    pOutT[0] = PanSeriesAt( pTime, Low );
+    pOutY[0] = PanSeriesAt( pValue, Low );
+    if( Low == High )
+	return( 1 );
+
+    pOutT[1] = PanSeriesAt( pTime, High );
+    pOutY[1] = PanSeriesAt( pValue, High );
+
+    return( 2 );
+}
+
+
+
+
+size_t PanDecimMinMax( const PanSeries *pTime, const PanSeries *pValue,
+                       size_t First, size_t Last, size_t Width,
+                       double *pOutT, double *pOutY )
+{
+    size_t I, Bucket, Current = 0, MinI = First, MaxI = First, Count = 0;
+    double T0, Span, MinY, MaxY;
+
+    if( Last - First <= 2 * Width )
+	return( Copy( pTime, pValue, First, Last, pOutT, pOutY ) );
+
+    T0 = PanSeriesAt( pTime, First );
+    Span = PanSeriesAt( pTime, Last - 1 ) - T0;
+    MinY = MaxY = PanSeriesAt( pValue, First );
+
+    for( I = First + 1; I < Last; I++ )
+    {
+	double T = PanSeriesAt( pTime, I ), Y = PanSeriesAt( pValue, I );
+
+	Bucket = Span > 0 ? (size_t) ((T - T0) / Span * Width) : 0;
+	if( Bucket >= Width )
+	    Bucket = Width - 1;
+
+	/* A time axis that is not monotonic never opens a bucket twice. */
+	if( Bucket > Current )
+	{
+	    Count += Emit( pTime, pValue, MinI, MaxI, pOutT + Count,
+	                   pOutY + Count );
+	    Current = Bucket;
+	    MinI = MaxI = I;
+	    MinY = MaxY = Y;
+	    continue;
+	}
+
+	if( Y < MinY )
+	{
+	    MinY = Y;
+	    MinI = I;
+	}
+	if( Y > MaxY )
+	{
+	    MaxY = Y;
+	    MaxI = I;
+	}
+    }
+
+    Count += Emit( pTime, pValue, MinI, MaxI, pOutT + Count, pOutY + Count );
+
+    return( Count );
+}
+
+
+
+
+size_t PanDecimLttb( const PanSeries *pTime, const PanSeries *pValue,
+                     size_t First, size_t Last, size_t Width,
+                     double *pOutT, double *pOutY )
+{
+    size_t N = Last - First, Points = 2 * Width, A = First, K, I;
+    double Every;
+
+    if( N <= Points )
+	return( Copy( pTime, pValue, First, Last, pOutT, pOutY ) );
+
+    Every = (double) (N - 2) / (Points - 2);
+
+    pOutT[0] = PanSeriesAt( pTime, First );
+    pOutY[0] = PanSeriesAt( pValue, First );
+
+    for( K = 0; K < Points - 2; K++ )
+    {
+	size_t Begin = First + (size_t) (K * Every) + 1;
+	size_t End = First + (size_t) ((K + 1) * Every) + 1;
+	size_t NextBegin = End;
+	size_t NextEnd = First + (size_t) ((K + 2) * Every) + 1;
+	double MeanT = 0, MeanY = 0, AT, AY, Area, Best = -1;
+	size_t Chosen = Begin;
+
+	if( NextEnd > Last )
+	    NextEnd = Last;
+	if( NextBegin >= NextEnd )
+	{
+	    /* The last bucket: the next point is the last sample. */
+	    NextBegin = Last - 1;
+	    NextEnd = Last;
+	}
+	for( I = NextBegin; I < NextEnd; I++ )
+	{
+	    MeanT += PanSeriesAt( pTime, I );
+	    MeanY += PanSeriesAt( pValue, I );
+	}
+	MeanT /= NextEnd - NextBegin;
+	MeanY /= NextEnd - NextBegin;
+
+	AT = PanSeriesAt( pTime, A );
+	AY = PanSeriesAt( pValue, A );
+
+	for( I = Begin; I < End && I < Last - 1; I++ )
+	{
+	    double T = PanSeriesAt( pTime, I ), Y = PanSeriesAt( pValue, I );
+
+	    Area = fabs( (AT - MeanT) * (Y - AY) - (AT - T) * (MeanY - AY) );
+	    if( Area > Best )
+	    {
+		Best = Area;
+		Chosen = I;
+	    }
+	}
+
+	pOutT[ K + 1 ] = PanSeriesAt( pTime, Chosen );
+	pOutY[ K + 1 ] = PanSeriesAt( pValue, Chosen );
+	A = Chosen;
+    }
+
+    pOutT[ Points - 1 ] = PanSeriesAt( pTime, Last - 1 );
+    pOutY[ Points - 1 ] = PanSeriesAt( pValue, Last - 1 );
+
+    return( Points );
+}
@@ -0,0 +1,59 @@
+#ifndef PAN_DECIM_H
+#define PAN_DECIM_H
+
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * A real series read in place: sample I is pBase[I * Stride], or
+ * ppRows[I][Column] for a multi-column memwaveform (PAN row pointers).
+ * pBase needs not be aligned: it may point into a mapped raw file.
+ */
+typedef struct
+{
+    const double        *pBase;
+    size_t               Stride;
+    const double * const *ppRows;
+    int                  Column;
+} PanSeries;
+
+static inline double PanSeriesAt( const PanSeries *pSeries, size_t I )
+{
+    double Value;
+
+    if( pSeries->ppRows )
+	return( pSeries->ppRows[I][ pSeries->Column ] );
+
+    memcpy( &Value, pSeries->pBase + I * pSeries->Stride, sizeof(double) );
+
+    return( Value );
+}
+
+/* First index in [0, N) of the monotonic pTime with t >= T (N if none). */
+size_t PanSeriesFirstAtLeast( const PanSeries *pTime, size_t N, double T );
+
+/* First index in [0, N) of the monotonic pTime with t > T (N if none). */
+size_t PanSeriesFirstAbove( const PanSeries *pTime, size_t N, double T );
+
+/*
+ * Both kernels reduce the samples [First, Last) to at most 2 * Width
+ * points, written in time order to pOutT and pOutY, and return their
+ * number. If there are no more than 2 * Width samples they are copied.
+ *
+ * PanDecimMinMax splits the time span in Width buckets of equal duration
+ * (one per pixel) and keeps the smallest and the largest sample of every
+ * bucket: the drawn envelope is exact.
+ *
+ * PanDecimLttb keeps the first and the last sample and one sample per
+ * bucket of equal count in between, the one that forms the largest
+ * triangle with the previous selected point and the mean of the next
+ * bucket (Largest-Triangle-Three-Buckets, S. Steinarsson, 2013).
+ */
+size_t PanDecimMinMax( const PanSeries *pTime, const PanSeries *pValue,
+                       size_t First, size_t Last, size_t Width,
+                       double *pOutT, double *pOutY );
+size_t PanDecimLttb( const PanSeries *pTime, const PanSeries *pValue,
+                     size_t First, size_t Last, size_t Width,
+                     double *pOutT, double *pOutY );
+
+#endif
@@ -0,0 +1,600 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+#include "panrawcol.h"
+#include "pandecim.h"
+#include "panmemreg.h"
+
+#if ! MX_HAS_INTERLEAVED_COMPLEX
+#error "pandownsample requires the interleaved complex API: build it with mex -R2018a"
+#endif
+
+#define PANDOWNSAMPLE_USAGE \
+    "Usage: [Y, T] = pandownsample('waveform', WIDTH[, OPTION, VALUE, ...]) " \
+    "or [Y, T] = pandownsample('file', WIDTH, 'raw', VAR_INDEX[, OPTION, " \
+    "VALUE, ...]) with the options 'mode' ('minmax' or 'lttb'), " \
+    "'window' ([T0 T1]) and 'time' ('timewaveform')"
+
+/*
+ * Columns are reduced by up to DECIM_MAX_THREADS threads, one column at a
+ * time, as soon as there are more than DECIM_THREAD_MIN_SAMPLES samples to
+ * scan.
+ */
+#define DECIM_THREAD_MIN_SAMPLES  (1 << 20)
+#define DECIM_MAX_THREADS         8
+
+typedef struct
+{
+    const PanSeries  *pTime;
+    const PanSeries  *pValues;    /* one per column, unless pRaw is set */
+    const PanRawFile *pRaw;       /* columnar raw file: decoded here */
+    const int        *pCols;
+    int               NumCols;
+    size_t            First, Last, Width;
+    int               Lttb;
+    double           *pOutT, *pOutY;
+    size_t           *pCount;
+    int               Begin, Step;
+    int               Failed;
+} DecimTask;
+
+
+
+
+/* Reduce every Step-th column from Begin on. */
+static void *DecimColumns( void *pArg )
+{
+    DecimTask *pTask = (DecimTask *) pArg;
+    const PanRawFile *pRaw = pTask->pRaw;
+    size_t Points = 2 * pTask->Width;
+    double *pColumn = NULL;
+    unsigned char *pScratch = NULL;
+    int H;
+
+    if( pRaw )
+    {
+	pColumn = malloc( sizeof(double) * pRaw->NumSamples );
+	pScratch = malloc( sizeof(double) * pRaw->Columnar.ChunkRows );
+	if( ! pColumn || ! pScratch )
+	{
+	    free( pColumn );
+	    free( pScratch );
+	    pTask->Failed = 1;
+	    return( NULL );
+	}
+    }
+
+    for( H = pTask->Begin; H < pTask->NumCols && ! pTask->Failed;
+         H += pTask->Step )
+    {
+	const PanSeries *pValue = pTask->pValues + H;
+	PanSeries Column;
+
+	if( pRaw )
+	{
+	    if( PanRawColRead( pRaw, pTask->pCols[H], pColumn, pScratch ) )
+	    {
+		pTask->Failed = 1;
+		break;
+	    }
+	    memset( &Column, 0, sizeof( PanSeries ) );
+	    Column.pBase = pColumn;
+	    Column.Stride = 1;
+	    pValue = &Column;
+	}
+
+	pTask->pCount[H] = (pTask->Lttb ? PanDecimLttb : PanDecimMinMax)(
+	                       pTask->pTime, pValue, pTask->First, pTask->Last,
+	                       pTask->Width, pTask->pOutT + Points * H,
+	                       pTask->pOutY + Points * H );
+    }
+
+    free( pColumn );
+    free( pScratch );
+
+    return( NULL );
+}
+
+
+
+
+static int Decimate( DecimTask *pTemplate )
+{
+    DecimTask Tasks[ DECIM_MAX_THREADS ];
+    pthread_t Threads[ DECIM_MAX_THREADS ];
+    size_t Samples = pTemplate->pRaw ? (size_t) pTemplate->pRaw->NumSamples :
+                                       pTemplate->Last - pTemplate->First;
+    long Cores = sysconf( _SC_NPROCESSORS_ONLN );
+    int NumThreads, K, Started = 0, Failed = 0;
+
+    NumThreads = (int) (Samples * pTemplate->NumCols /
+                        DECIM_THREAD_MIN_SAMPLES) + 1;
+    if( Cores > 0 && NumThreads > Cores )
+	NumThreads = (int) Cores;
+    if( NumThreads > DECIM_MAX_THREADS )
+	NumThreads = DECIM_MAX_THREADS;
+    if( NumThreads > pTemplate->NumCols )
+	NumThreads = pTemplate->NumCols;
+    if( NumThreads < 1 )
+	NumThreads = 1;
+
+    for( K = 0; K < NumThreads; K++ )
+    {
+	Tasks[K] = *pTemplate;
+	Tasks[K].Begin  = K;
+	Tasks[K].Step   = NumThreads;
+	Tasks[K].Failed = 0;
+    }
+
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( pthread_create( Threads + K, NULL, DecimColumns, Tasks + K ) )
+	    DecimColumns( Tasks + K );
+	else
+	    Started |= 1 << K;
+    }
+
+    DecimColumns( Tasks );
+
+    for( K = 0; K < NumThreads; K++ )
+    {
+	if( Started & (1 << K) )
+	    pthread_join( Threads[K], NULL );
+	Failed |= Tasks[K].Failed;
+    }
+
+    return( Failed ? -1 : 0 );
+}
+
+
+
+
+static void DecimErrMsg( const char *Format, const char *Name )
+{
+    char *MexErrBuffer;
+    int Length = strlen( Name ) + strlen( Format ) + 10;
+
+    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+    if( ! MexErrBuffer )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    sprintf( MexErrBuffer, Format, Name );
+    mexErrMsgTxt( MexErrBuffer );
+}
+
+
+
+
+/*
+ * Y and T are P x NumCols, P being the largest number of points of a
+ * column: the shorter columns are padded with NaN.
+ */
+static void Collect( const DecimTask *pTask, mxArray *plhs[] )
+{
+    size_t Points = 2 * pTask->Width, P = 0, I;
+    double *pY, *pT, NaN = mxGetNaN();
+    int H;
+
+    for( H = 0; H < pTask->NumCols; H++ )
+    {
+	if( pTask->pCount[H] > P )
+	    P = pTask->pCount[H];
+    }
+
+    plhs[0] = mxCreateUninitNumericMatrix( P, pTask->NumCols, mxDOUBLE_CLASS,
+                                           mxREAL );
+    plhs[1] = mxCreateUninitNumericMatrix( P, pTask->NumCols, mxDOUBLE_CLASS,
+                                           mxREAL );
+    if( NULL == plhs[0] || NULL == plhs[1] )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    pY = mxGetDoubles( plhs[0] );
+    pT = mxGetDoubles( plhs[1] );
+
+    for( H = 0; H < pTask->NumCols; H++ )
+    {
+	size_t Count = pTask->pCount[H];
+
+	memcpy( pY, pTask->pOutY + Points * H, sizeof(double) * Count );
+	memcpy( pT, pTask->pOutT + Points * H, sizeof(double) * Count );
+	for( I = Count; I < P; I++ )
+	    pY[I] = pT[I] = NaN;
+	pY += P;
+	pT += P;
+    }
+
+    PanCounterBytes( PAN_COUNTER_MX_BYTES( plhs[0] ) +
+                     PAN_COUNTER_MX_BYTES( plhs[1] ) );
+}
+
+
+
+
+/* Restrict the task to the samples with T0 <= t <= T1, if required. */
+static void Window( DecimTask *pTask, size_t Samples, const double *pWindow )
+{
+    pTask->First = 0;
+    pTask->Last = Samples;
+
+    if( pWindow )
+    {
+	pTask->First = PanSeriesFirstAtLeast( pTask->pTime, Samples,
+	                                      pWindow[0] );
+	pTask->Last = PanSeriesFirstAbove( pTask->pTime, Samples, pWindow[1] );
+	if( pTask->Last < pTask->First )
+	    pTask->Last = pTask->First;
+    }
+}
+
+
+
+
+/* Return -1 if a columnar raw file is corrupted or memory is exhausted. */
+static int Run( DecimTask *pTask, int nlhs, mxArray *plhs[] )
+{
+    mxArray *pOut[2];
+    size_t Points = 2 * pTask->Width;
+
+    pTask->pCount = mxCalloc( pTask->NumCols ? pTask->NumCols : 1,
+                              sizeof( size_t ) );
+    pTask->pOutT = mxMalloc( sizeof(double) * Points *
+                             (pTask->NumCols ? pTask->NumCols : 1) );
+    pTask->pOutY = mxMalloc( sizeof(double) * Points *
+                             (pTask->NumCols ? pTask->NumCols : 1) );
+
+    if( pTask->NumCols > 0 && pTask->Last > pTask->First &&
+        Decimate( pTask ) )
+	return( -1 );
+
+    Collect( pTask, pOut );
+    plhs[0] = pOut[0];
+    if( nlhs > 1 )
+	plhs[1] = pOut[1];
+    else
+	mxDestroyArray( pOut[1] );
+
+    mxFree( pTask->pCount );
+    mxFree( pTask->pOutT );
+    mxFree( pTask->pOutY );
+
+    return( 0 );
+}
+
+
+
+
+static void DownsampleMemWaveform( char *Name, char *TimeName,
+                                   DecimTask *pTask, const double *pWindow,
+                                   int nlhs, mxArray *plhs[] )
+{
+    PanSession *Session;
+    MemWaveform Wav, Time;
+    PanSeries TimeSeries, *pValues;
+    uint64_t Mark;
+    int Status, J;
+
+    if( (Status = PanSessionAttach( &Session )) )
+    {
+	PanSessionErrMsg( Status, NULL );
+	return;
+    }
+    Mark = PanMemRegMark( Session );
+
+    if( ! Session->Entry.PanMatlabGet )
+    {
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabGet" );
+	return;
+    }
+
+    Wav.Name = Name;
+    if( ! PanMemWaveformGet( Session, &Wav ) )
+    {
+	PanMemWaveformErrMsg( Wav.Name );
+	return;
+    }
+    PanMemRegTouch( Session, &Wav );
+    if( Wav.pWavArrayS || Wav.pWavArrayI || ! Wav.pWavArrayR )
+    {
+	mexErrMsgTxt( "Error: only real numeric memwaveforms can be "
+	              "downsampled." );
+	return;
+    }
+
+    Time.Name = TimeName;
+    if( ! PanMemWaveformGet( Session, &Time ) )
+    {
+	PanMemWaveformErrMsg( Time.Name );
+	return;
+    }
+    PanMemRegTouch( Session, &Time );
+    if( Time.pWavArrayS || Time.pWavArrayI || ! Time.pWavArrayR ||
+        1 != Time.Cols || Time.Rows != Wav.Rows )
+    {
+	DecimErrMsg( "Error: the <%s> time axis must be a real vector with "
+	             "as many samples as the waveform.", TimeName );
+	return;
+    }
+
+    memset( &TimeSeries, 0, sizeof( PanSeries ) );
+    TimeSeries.pBase = Time.pWavArrayR;
+    TimeSeries.Stride = 1;
+
+    pValues = mxCalloc( Wav.Cols ? Wav.Cols : 1, sizeof( PanSeries ) );
+    for( J = 0; J < Wav.Cols; J++ )
+    {
+	if( 1 == Wav.Cols )
+	{
+	    pValues[J].pBase = Wav.pWavArrayR;
+	    pValues[J].Stride = 1;
+	}
+	else
+	{
+	    pValues[J].ppRows = (const double * const *) Wav.pWavArrayR;
+	    pValues[J].Column = J;
+	}
+    }
+
+    pTask->pTime = &TimeSeries;
+    pTask->pValues = pValues;
+    pTask->NumCols = Wav.Cols;
+    Window( pTask, Wav.Rows, pWindow );
+
+    Run( pTask, nlhs, plhs );
+    mxFree( pValues );
+
+    PanMemRegEvict( Session, Mark );
+}
+
+
+
+
+static void DownsampleRawFile( char *FileName, const mxArray *pIndex,
+                               DecimTask *pTask, const double *pWindow,
+                               int nlhs, mxArray *plhs[] )
+{
+    PanRawFile Raw;
+    PanSeries TimeSeries, *pValues;
+    double *pTimeColumn = NULL;
+    size_t NumCols = mxGetNumberOfElements( pIndex ), H;
+    const double *pIdx = mxGetDoubles( pIndex );
+    int *pCols, Status;
+
+    Status = PanRawOpen( FileName, &Raw );
+    if( PAN_RAW_EOPEN == Status )
+    {
+	DecimErrMsg( "Error: the <%s> raw file can not be opened.", FileName );
+	return;
+    }
+    if( PAN_RAW_EMAP == Status )
+    {
+	DecimErrMsg( "Error: the <%s> raw file can not be mapped.", FileName );
+	return;
+    }
+    if( PAN_RAW_OK != Status )
+    {
+	DecimErrMsg( "Error: <%s> is not a valid raw file or it is truncated.",
+	             FileName );
+	return;
+    }
+    if( Raw.IsComplex )
+    {
+	PanRawClose( &Raw );
+	DecimErrMsg( "Error: <%s> is a complex raw file: only real raw files "
+	             "can be downsampled.", FileName );
+	return;
+    }
+
+    pCols = mxMalloc( (NumCols ? NumCols : 1) * sizeof( int ) );
+    pValues = mxCalloc( NumCols ? NumCols : 1, sizeof( PanSeries ) );
+    for( H = 0; H < NumCols; H++ )
+    {
+	if( pIdx[H] < 0 || pIdx[H] >= Raw.NumVar || pIdx[H] != (int) pIdx[H] )
+	{
+	    PanRawClose( &Raw );
+	    mexErrMsgTxt( "Error: VAR_INDEX must contain zero based variable "
+	                  "indices smaller than the number of variables." );
+	    return;
+	}
+	pCols[H] = (int) pIdx[H];
+	pValues[H].pBase = (const double *) Raw.pBinary + pCols[H];
+	pValues[H].Stride = Raw.NumVar;
+    }
+
+    /* The time axis is variable 0. */
+    memset( &TimeSeries, 0, sizeof( PanSeries ) );
+    TimeSeries.pBase = (const double *) Raw.pBinary;
+    TimeSeries.Stride = Raw.NumVar;
+
+    if( Raw.pTable && Raw.NumSamples > 0 )
+    {
+	unsigned char *pScratch;
+
+	madvise( (void *) Raw.pMap, Raw.Size, MADV_RANDOM );
+
+	pTimeColumn = mxMalloc( sizeof(double) * Raw.NumSamples );
+	pScratch = mxMalloc( sizeof(double) * Raw.Columnar.ChunkRows );
+	if( PanRawColRead( &Raw, 0, pTimeColumn, pScratch ) )
+	{
+	    PanRawClose( &Raw );
+	    DecimErrMsg( "Error: <%s> is a corrupted columnar raw file.",
+	                 FileName );
+	    return;
+	}
+	mxFree( pScratch );
+
+	TimeSeries.pBase = pTimeColumn;
+	TimeSeries.Stride = 1;
+	pTask->pRaw = &Raw;
+    }
+
+    pTask->pTime = &TimeSeries;
+    pTask->pValues = pValues;
+    pTask->pCols = pCols;
+    pTask->NumCols = NumCols;
+    Window( pTask, Raw.NumSamples, pWindow );
+
+    if( Run( pTask, nlhs, plhs ) )
+    {
+	PanRawClose( &Raw );
+	DecimErrMsg( "Error: <%s> is a corrupted columnar raw file or there "
+	             "is no more memory.", FileName );
+	return;
+    }
+
+    if( pTimeColumn )
+	mxFree( pTimeColumn );
+    mxFree( pValues );
+    mxFree( pCols );
+    PanRawClose( &Raw );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    if( nrhs < 2 || nrhs % 2 )
+    {
+	mexErrMsgTxt( "Error: wrong number of arguments. "
+	              PANDOWNSAMPLE_USAGE );
+	return;
+    }
+    if( ! mxIsChar( prhs[0] ) )
+    {
+	mexErrMsgTxt( "Error: waveform must be a string. "
+	              PANDOWNSAMPLE_USAGE );
+	return;
+    }
+    if( ! mxIsNumeric( prhs[1] ) || mxIsComplex( prhs[1] ) ||
+        1 != mxGetNumberOfElements( prhs[1] ) || mxGetScalar( prhs[1] ) < 1 ||
+        mxGetScalar( prhs[1] ) > 1e7 ||
+        mxGetScalar( prhs[1] ) != (size_t) mxGetScalar( prhs[1] ) )
+    {
+	mexErrMsgTxt( "Error: WIDTH must be a positive integer. "
+	              PANDOWNSAMPLE_USAGE );
+	return;
+    }
+    if( nlhs > 2 )
+    {
+	mexErrMsgTxt( "Error: at most two output variables are allowed. "
+	              PANDOWNSAMPLE_USAGE );
+	return;
+    }
+
+    DecimTask Task;
+    const mxArray *pIndex = NULL;
+    const double *pWindow = NULL;
+    char *Name, *TimeName = NULL;
+    int K;
+
+    memset( &Task, 0, sizeof( DecimTask ) );
+    Task.Width = (size_t) mxGetScalar( prhs[1] );
+
+    for( K = 2; K < nrhs; K += 2 )
+    {
+	char Option[ 8 ];
+
+	if( ! mxIsChar( prhs[K] ) ||
+	    mxGetString( prhs[K], Option, sizeof(Option) ) )
+	{
+	    mexErrMsgTxt( "Error: unknown option. " PANDOWNSAMPLE_USAGE );
+	    return;
+	}
+
+	if( ! strcasecmp( Option, "mode" ) )
+	{
+	    char Mode[ 8 ];
+
+	    if( ! mxIsChar( prhs[K+1] ) ||
+	        mxGetString( prhs[K+1], Mode, sizeof(Mode) ) ||
+	        (strcasecmp( Mode, "minmax" ) && strcasecmp( Mode, "lttb" )) )
+	    {
+		mexErrMsgTxt( "Error: the mode must be 'minmax' or 'lttb'. "
+		              PANDOWNSAMPLE_USAGE );
+		return;
+	    }
+	    Task.Lttb = ! strcasecmp( Mode, "lttb" );
+	}
+	else if( ! strcasecmp( Option, "window" ) )
+	{
+	    if( ! mxIsDouble( prhs[K+1] ) || mxIsComplex( prhs[K+1] ) ||
+	        2 != mxGetNumberOfElements( prhs[K+1] ) )
+	    {
+		mexErrMsgTxt( "Error: the window must be a [T0 T1] vector. "
+		              PANDOWNSAMPLE_USAGE );
+		return;
+	    }
+	    pWindow = mxGetDoubles( prhs[K+1] );
+	}
+	else if( ! strcasecmp( Option, "time" ) )
+	{
+	    if( ! mxIsChar( prhs[K+1] ) )
+	    {
+		mexErrMsgTxt( "Error: the time axis must be a string. "
+		              PANDOWNSAMPLE_USAGE );
+		return;
+	    }
+	    TimeName = mxArrayToString( prhs[K+1] );
+	}
+	else if( ! strcasecmp( Option, "raw" ) )
+	{
+	    if( ! mxIsDouble( prhs[K+1] ) || mxIsComplex( prhs[K+1] ) )
+	    {
+		mexErrMsgTxt( "Error: VAR_INDEX must be a vector of indices. "
+		              PANDOWNSAMPLE_USAGE );
+		return;
+	    }
+	    pIndex = prhs[K+1];
+	}
+	else
+	{
+	    mexErrMsgTxt( "Error: unknown option. " PANDOWNSAMPLE_USAGE );
+	    return;
+	}
+    }
+
+    PanCounterBegin( PAN_COUNTER_PANDOWNSAMPLE );
+
+    Name = mxArrayToString( prhs[0] );
+    if( NULL == Name )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    if( pIndex )
+	DownsampleRawFile( Name, pIndex, &Task, pWindow, nlhs, plhs );
+    else
+    {
+	/* As MPanWaveform: the "time" memwaveform of the same analysis. */
+	if( NULL == TimeName )
+	{
+	    char *pDot = strchr( Name, '.' );
+	    size_t Prefix = pDot ? (size_t) (pDot - Name) + 1 : 0;
+
+	    TimeName = mxCalloc( Prefix + 5, sizeof( char ) );
+	    memcpy( TimeName, Name, Prefix );
+	    strcpy( TimeName + Prefix, "time" );
+	}
+	DownsampleMemWaveform( Name, TimeName, &Task, pWindow, nlhs, plhs );
+    }
+
+    PanCounterEnd( Name );
+    if( TimeName )
+	mxFree( TimeName );
+    mxFree( Name );
+}
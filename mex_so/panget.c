@@ -4,275 +4,689 @@
 #include <string.h>
 #include <errno.h>
 #include "mex.h"
+#include "pansession.h"
+#include "pantranspose.h"
+#include "pancounter.h"
+#include "panquant.h"
+#include "panmemreg.h"
+
+/*
+ * Complex waveforms are written as mxComplexDouble pairs: the gateways must
+ * be built with "mex -R2018a" so that MATLAB does not convert them back to
+ * the separate real/imaginary storage.
+ */
+#if ! MX_HAS_INTERLEAVED_COMPLEX
+#error "panget requires the interleaved complex API: build it with mex -R2018a"
+#endif
+
+static mxClassID MexClass( int Class )
+{
+    if( PAN_CLASS_SINGLE == Class )
+	return( mxSINGLE_CLASS );
+    if( PAN_CLASS_INT16 == Class )
+	return( mxINT16_CLASS );
 
-#define PAN_MAT_SHL_NAME      "panMat.so"
+    return( mxDOUBLE_CLASS );
+}
 
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+
+
+
+/*
+ * Quantise a real memwaveform into pDst (see panquant.h): the ranges of
+ * the columns are gathered first, then every sample is quantised while it
+ * is copied. pScale and pOffset receive one value per column.
+ */
+static void QuantizeMemWaveform( int16_t *pDst, const MemWaveform *pWav,
+                                 double *pScale, double *pOffset )
 {
-    void *Module;
+    PanQuantRange *pRanges;
+    int J;
 
-    if( nrhs != 1 )
+    if( 1 == pWav->Cols )
     {
-	mexErrMsgTxt( "Error: missing waveform. Usage: panget('waveform')");
+	PanQuantRange Range;
+
+	PanQuantRangeInit( &Range );
+	PanQuantRangeVector( &Range, pWav->pWavArrayR, pWav->Rows );
+	PanQuantParams( &Range, pScale, pOffset );
+	PanQuantizeVector( pDst, pWav->pWavArrayR, pWav->Rows, *pScale,
+	                   *pOffset );
 	return;
     }
 
-    if( ! mxIsChar(prhs[0]))
+    pRanges = mxMalloc( pWav->Cols * sizeof( PanQuantRange ) );
+    PanColumnRanges( pRanges, (const double * const *) pWav->pWavArrayR,
+                     pWav->Rows, pWav->Cols );
+    for( J = 0; J < pWav->Cols; J++ )
+	PanQuantParams( pRanges + J, pScale + J, pOffset + J );
+    mxFree( pRanges );
+
+    if( PanTransposeInt16( pDst, (const double * const *) pWav->pWavArrayR,
+                           pScale, pOffset, pWav->Rows, pWav->Cols, 0 ) )
+	mexErrMsgTxt( "No more memory.\n" );
+}
+
+
+
+
+/*
+ * Copy one memwaveform into a new mxArray of the given class. Multi-column
+ * waveforms are returned by PAN as arrays of row pointers and are
+ * transposed into the column-major MATLAB layout. For PAN_CLASS_INT16
+ * pScale and pOffset receive one value per column.
+ */
+static mxArray *CopyMemWaveform( const MemWaveform *pWav, int Class,
+                                 double *pScale, double *pOffset )
+{
+    mxArray *pMexArray = NULL;
+    int     Rows = pWav->Rows, Cols = pWav->Cols;
+    double *pWavArrayR = pWav->pWavArrayR, *pWavArrayI = pWav->pWavArrayI;
+    char   *pWavArrayS = pWav->pWavArrayS;
+
+    if( pWavArrayI && PAN_CLASS_SINGLE == Class )
     {
-        mexErrMsgTxt( "Error: waveform must be a string. "
-	              "Usage: y = panget('waveform')" );
-	return;
+	pMexArray = mxCreateUninitNumericMatrix( Rows, Cols, mxSINGLE_CLASS,
+	                                         mxCOMPLEX );
+	if( NULL == pMexArray )
+	{
+	    mexErrMsgTxt( "No more memory.\n" );
+	    return( NULL );
+	}
+
+	float *pMexArrayC = (float *) mxGetComplexSingles( pMexArray );
+
+	if( 1 == Cols )
+	    PanInterleaveSingle( pMexArrayC, pWavArrayR, pWavArrayI, Rows );
+	else
+	    PanTransposeSingle( pMexArrayC, (const double * const *) pWavArrayR,
+	                        (const double * const *) pWavArrayI,
+	                        Rows, Cols, 0 );
+	PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArray ) );
     }
-    if( nlhs != 1 )
+    else if( pWavArrayI )
     {
-	mexErrMsgTxt( "Error: output variable is required. "
-	              "Usage: y = panget('waveform')");
-	return;
-    }
+	pMexArray = mxCreateUninitNumericMatrix( Rows, Cols, mxDOUBLE_CLASS,
+	                                         mxCOMPLEX );
+	if( NULL == pMexArray )
+	{
+	    mexErrMsgTxt( "No more memory.\n" );
+	    return( NULL );
+	}
 
-    char *ShlPath = (char *) getenv( "PAN_MAT_SHL_PATH" );
-    char *Path;
+	double *pMexArrayC = (double *) mxGetComplexDoubles( pMexArray );
 
-    if( ShlPath )
+	if( 1 == Cols )
+	{
+	    PanInterleave( pMexArrayC, pWavArrayR, pWavArrayI, Rows );
+	}
+	else
+	{
+	    PanTransposeComplex( pMexArrayC,
+	                         (const double * const *) pWavArrayR,
+	                         (const double * const *) pWavArrayI,
+	                         Rows, Cols, 0 );
+	}
+	PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArray ) );
+    }
+    else if( pWavArrayR && PAN_CLASS_DOUBLE != Class )
     {
-        Path = (char *) malloc((strlen(ShlPath)+strlen(PAN_MAT_SHL_NAME)+20) *
-	                        sizeof( char ) );
-	if( NULL == Path )
+	pMexArray = mxCreateUninitNumericMatrix( Rows, Cols, MexClass( Class ),
+	                                         mxREAL );
+	if( NULL == pMexArray )
 	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
+	    mexErrMsgTxt( "No more memory.\n" );
+	    return( NULL );
 	}
 
-	sprintf( Path, "%s/%s", ShlPath, PAN_MAT_SHL_NAME );
+	if( PAN_CLASS_INT16 == Class )
+	    QuantizeMemWaveform( mxGetInt16s( pMexArray ), pWav, pScale,
+	                         pOffset );
+	else if( 1 == Cols )
+	    PanConvertSingle( mxGetSingles( pMexArray ), pWavArrayR, Rows );
+	else
+	    PanTransposeSingle( mxGetSingles( pMexArray ),
+	                        (const double * const *) pWavArrayR, NULL,
+	                        Rows, Cols, 0 );
+	PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArray ) );
     }
-    else
+    else if( pWavArrayR )
     {
-        Path = (char *) malloc((strlen(PAN_MAT_SHL_NAME)+20) * sizeof(char));
-	if( NULL == Path )
+	pMexArray = mxCreateUninitNumericMatrix( Rows, Cols, mxDOUBLE_CLASS,
+	                                         mxREAL );
+	if( NULL == pMexArray )
 	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
+	    mexErrMsgTxt( "No more memory.\n" );
+	    return( NULL );
 	}
 
-	sprintf( Path, "%s", PAN_MAT_SHL_NAME );
-    }
+	double *pMexArrayR = mxGetDoubles( pMexArray );
 
-    Module = dlopen( Path, RTLD_LAZY | RTLD_DEEPBIND | RTLD_NOLOAD );
-    if( NULL == Module )
+	if( 1 == Cols )
+	{
+	    memcpy( (void *) pMexArrayR, (const void *) pWavArrayR,
+		    sizeof(double) * (Rows * Cols) );
+	}
+	else
+	{
+	    PanTranspose( pMexArrayR, (const double * const *) pWavArrayR,
+	                  Rows, Cols, 0 );
+	}
+	PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArray ) );
+    }
+    else if( pWavArrayS )
     {
-	int Count, Length;
-	char *MexErrBuffer;
+        if( 1 == Cols )
+	{
+	    register unsigned int I;
+	    mxArray *pMexArrayS;
+	    char    **pArrayS;
+
+	    pMexArray = mxCreateCellMatrix( 1, Rows );
 
-	Length = strlen( Path ) + 150;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
+	    pArrayS = (char **) pWavArrayS;
+
+	    for( I = 0; I < Rows; I++ )
+	    {
+		pMexArrayS = mxCreateString( pArrayS[I] );
+		if( NULL == pMexArrayS )
+		{
+		    mexErrMsgTxt( "No more memory.\n" );
+		    return( NULL );
+		}
+		PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArrayS ) );
+		mxSetCell( pMexArray, I, pMexArrayS );
+	    }
+	}
+	else
 	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
+	    register int I, J, I0, J0;
+	    mxArray   *pMexArrayS;
+	    char    ***pArrayS;
+
+	    pMexArray = mxCreateCellMatrix( Rows, Cols );
+
+	    pArrayS = (char ***) pWavArrayS;
+
+	    /*
+	     * Same tiling as PanTranspose. The MATLAB API is not thread safe,
+	     * hence the strings are always created by the calling thread.
+	     */
+	    for( J0 = 0; J0 < Rows; J0 += PAN_TRANSPOSE_BLOCK )
+	    {
+		for( I0 = 0; I0 < Cols; I0 += PAN_TRANSPOSE_BLOCK )
+		{
+		    for( I = I0; I < Cols && I < I0 + PAN_TRANSPOSE_BLOCK; I++ )
+		    {
+			for( J = J0; J < Rows && J < J0 + PAN_TRANSPOSE_BLOCK;
+			     J++ )
+			{
+			    pMexArrayS = mxCreateString( pArrayS[J][I] );
+			    if( NULL == pMexArrayS )
+			    {
+				mexErrMsgTxt( "No more memory.\n" );
+				return( NULL );
+			    }
+			    PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArrayS ) );
+			    mxSetCell( pMexArray, (mwIndex) I*Rows + J,
+			               pMexArrayS );
+			}
+		    }
+		}
+	    }
 	}
+    }
 
-	Count = sprintf( MexErrBuffer, "The <%s> shared libray can not be "
-	    "loaded.\n"
-	    "Run \"pannet('filename')\" command before reading simulation "
-	    "results.\n", Path );
 
-	if( Count >= Length )
-	    abort();
+    return( pMexArray );
+}
 
-	mexErrMsgTxt( MexErrBuffer );
 
-	return;
+
+
+/*
+ * Copy N single-column numeric memwaveforms of the same length into the
+ * columns of one Rows x N matrix of the given class. The columns of the
+ * waveforms that were not found are filled with NaN (with PAN_QUANT_NAN
+ * and a NaN OFFSET for PAN_CLASS_INT16).
+ */
+static mxArray *CopyMemWaveformColumns( const MemWaveform *pWavs, int N,
+                                        int Rows, int IsComplex, int Class,
+                                        double *pScale, double *pOffset )
+{
+    mxArray *pMexArray;
+    double  *pMexArrayR = NULL, *pMexArrayC = NULL;
+    float   *pMexArrayS = NULL;
+    int16_t *pMexArrayQ = NULL;
+    double   NaN = mxGetNaN();
+    register int I, K;
+
+    pMexArray = mxCreateUninitNumericMatrix( Rows, N, MexClass( Class ),
+                                      IsComplex ? mxCOMPLEX : mxREAL );
+    if( NULL == pMexArray )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return( NULL );
     }
 
-    errno = 0;
+    if( PAN_CLASS_INT16 == Class )
+	pMexArrayQ = mxGetInt16s( pMexArray );
+    else if( PAN_CLASS_SINGLE == Class )
+	pMexArrayS = IsComplex ? (float *) mxGetComplexSingles( pMexArray ) :
+	                         mxGetSingles( pMexArray );
+    else if( IsComplex )
+	pMexArrayC = (double *) mxGetComplexDoubles( pMexArray );
+    else
+	pMexArrayR = mxGetDoubles( pMexArray );
 
-    int (*Entry)( char *, double **, double **, char **, int *, int *);
-    char *EntryName = "PanMatlabGet";
+    PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArray ) );
 
-    Entry = dlsym( Module, EntryName );
-    if( NULL == Entry )
+    for( K = 0; K < N; K++ )
     {
-	dlclose( Module );
+	const MemWaveform *pWav = pWavs + K;
 
-	int Count, Length;
-	char *MexErrBuffer;
-
-	Length = strlen( Path ) + strlen( EntryName ) + 100;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
+	if( pMexArrayQ )
 	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
+	    if( pWav->Found )
+		QuantizeMemWaveform( pMexArrayQ, pWav, pScale + K,
+		                     pOffset + K );
+	    else
+	    {
+		for( I = 0; I < Rows; I++ )
+		    pMexArrayQ[I] = PAN_QUANT_NAN;
+		pScale[K] = 1.0;
+		pOffset[K] = NaN;
+	    }
+	    pMexArrayQ += Rows;
 	}
+	else if( pMexArrayS && ! IsComplex )
+	{
+	    if( pWav->Found )
+		PanConvertSingle( pMexArrayS, pWav->pWavArrayR, Rows );
+	    else
+	    {
+		for( I = 0; I < Rows; I++ )
+		    pMexArrayS[I] = (float) NaN;
+	    }
+	    pMexArrayS += Rows;
+	}
+	else if( pMexArrayS )
+	{
+	    if( pWav->Found && pWav->pWavArrayI )
+		PanInterleaveSingle( pMexArrayS, pWav->pWavArrayR,
+		                     pWav->pWavArrayI, Rows );
+	    else
+	    {
+		for( I = 0; I < Rows; I++ )
+		{
+		    pMexArrayS[2 * I] = (float) (pWav->Found ?
+		                                 pWav->pWavArrayR[I] : NaN);
+		    pMexArrayS[2 * I + 1] = (float) (pWav->Found ? 0.0 : NaN);
+		}
+	    }
+	    pMexArrayS += 2 * Rows;
+	}
+	else if( ! IsComplex )
+	{
+	    if( pWav->Found )
+	    {
+		memcpy( (void *) pMexArrayR, (const void *) pWav->pWavArrayR,
+			sizeof(double) * Rows );
+	    }
+	    else
+	    {
+		for( I = 0; I < Rows; I++ )
+		    pMexArrayR[I] = NaN;
+	    }
+	    pMexArrayR += Rows;
+	}
+	else if( pWav->Found && pWav->pWavArrayI )
+	{
+	    PanInterleave( pMexArrayC, pWav->pWavArrayR, pWav->pWavArrayI,
+	                   Rows );
+	    pMexArrayC += 2 * Rows;
+	}
+	else
+	{
+	    for( I = 0; I < Rows; I++ )
+	    {
+		*pMexArrayC++ = pWav->Found ? pWav->pWavArrayR[I] : NaN;
+		*pMexArrayC++ = pWav->Found ? 0.0 : NaN;
+	    }
+	}
+    }
 
-	Count = sprintf( MexErrBuffer, "The <%s> evaluate routine is not "
-	        "found in <%s> shared module.\n\n", EntryName, Path );
-	if( Count >= Length )
-	    abort();
+    return( pMexArray );
+}
 
-	mexErrMsgTxt( MexErrBuffer );
 
-	return;
-    }
 
-    free( Path );
 
-    size_t CharNum;
-    char *MemWaveformName;
+/*
+ * Batched form: panget(NAMES) or panget(NAMES, 'cell'). All the names are
+ * resolved in one call; the second output flags the missing ones and, for
+ * PAN_CLASS_INT16, the third and fourth ones are SCALE and OFFSET.
+ */
+static void GetMemWaveforms( PanSession *Session, int nlhs, mxArray *plhs[],
+                             const mxArray *pNames, int CellOutput,
+                             int Class )
+{
+    mxArray *pCellNames = NULL, *pScale = NULL, *pOffset = NULL;
+    MemWaveform *pWavs;
+    uint64_t Mark = PanMemRegMark( Session );
+    int N, K, Rows = -1, IsComplex = 0, Columns = 1;
 
-    CharNum = mxGetN( prhs[0]);
+    if( mxIsClass( pNames, "string" ) )
+    {
+	if( mexCallMATLAB( 1, &pCellNames, 1, (mxArray **) &pNames,
+	                   "cellstr" ) )
+	{
+	    mexErrMsgTxt( "Error: unable to convert the string array of "
+	                  "waveform names." );
+	    return;
+	}
+	pNames = pCellNames;
+    }
+
+    N = (int) mxGetNumberOfElements( pNames );
 
-    MemWaveformName = mxMalloc( 2 + CharNum );
-    if( NULL == MemWaveformName )
+    pWavs = mxCalloc( N > 0 ? N : 1, sizeof( MemWaveform ) );
+    if( NULL == pWavs )
     {
 	mexErrMsgTxt( "No more memory.\n" );
 	return;
     }
 
-    mxGetString( prhs[0], MemWaveformName, 1 + CharNum );
-
-    int Rows, Cols;
-    double *pWavArrayR, *pWavArrayI;
-    char   *pWavArrayS;
-
-    pWavArrayR = pWavArrayI = 0;
-
-    if( ! (Entry)( MemWaveformName, &(pWavArrayR), &(pWavArrayI), &(pWavArrayS),
-                   &(Rows), &(Cols) ) )
+    for( K = 0; K < N; K++ )
     {
-	dlclose( Module );
+	const mxArray *pName = mxGetCell( pNames, K );
 
-	int Count, Length;
-	char *MexErrBuffer;
+	if( NULL == pName || ! mxIsChar( pName ) )
+	{
+	    mexErrMsgTxt( "Error: waveform names must be strings. "
+	                  "Usage: [Y, MISSING] = panget({'wav1', 'wav2', ...})" );
+	    return;
+	}
 
-	Length = strlen( MemWaveformName ) + 300;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( NULL == MexErrBuffer )
+	pWavs[K].Name = mxArrayToString( pName );
+	if( NULL == pWavs[K].Name )
 	{
 	    mexErrMsgTxt( "No more memory.\n" );
 	    return;
 	}
 
-	Count = sprintf( MexErrBuffer, "The <%s> variable can not be found in "
-	    "the simulator data-bases.\n\n", MemWaveformName );
-
-	if( Count >= Length )
-	    abort();
+	if( ! PanMemWaveformGet( Session, pWavs + K ) )
+	    continue;
+	PanMemRegTouch( Session, pWavs + K );
 
-	mexErrMsgTxt( MexErrBuffer );
+	if( pWavs[K].pWavArrayS || 1 != pWavs[K].Cols ||
+	    (Rows >= 0 && Rows != pWavs[K].Rows) )
+	    Columns = 0;
 
-	mxFree( MemWaveformName );
+	Rows = pWavs[K].Rows;
+	if( pWavs[K].pWavArrayI )
+	    IsComplex = 1;
+    }
 
-        return;
+    if( ! CellOutput && ! Columns )
+    {
+	mexErrMsgTxt( "Error: the requested waveforms are not numeric vectors "
+	              "of the same length. "
+	              "Usage: [C, MISSING] = panget(NAMES, 'cell')" );
+	return;
+    }
+    if( PAN_CLASS_INT16 == Class && IsComplex )
+    {
+	mexErrMsgTxt( "Error: only real memwaveforms can be quantised to "
+	              "int16." );
+	return;
     }
 
-    mxFree( MemWaveformName );
+    if( CellOutput )
+    {
+	plhs[0] = mxCreateCellMatrix( 1, N );
 
-    if( pWavArrayI )
+	for( K = 0; K < N; K++ )
+	{
+	    if( pWavs[K].Found )
+		mxSetCell( plhs[0], K,
+		           CopyMemWaveform( pWavs + K, Class, NULL, NULL ) );
+	}
+    }
+    else
     {
-	plhs[0] = mxCreateDoubleMatrix( Rows, Cols, mxCOMPLEX );
+	if( PAN_CLASS_INT16 == Class )
+	{
+	    pScale = mxCreateDoubleMatrix( 1, N, mxREAL );
+	    pOffset = mxCreateDoubleMatrix( 1, N, mxREAL );
+	}
+	plhs[0] = CopyMemWaveformColumns( pWavs, N, Rows < 0 ? 0 : Rows,
+	                  IsComplex, Class,
+	                  pScale ? mxGetDoubles( pScale ) : NULL,
+	                  pOffset ? mxGetDoubles( pOffset ) : NULL );
+    }
 
-	double *pMexArrayR = mxGetPr( plhs[0] );
-	double *pMexArrayI = mxGetPi( plhs[0] );
+    if( nlhs > 1 )
+    {
+	mxLogical *pMissing;
 
-	if( 1 == Cols )
-	{
-	    memcpy( (void *) pMexArrayR, (const void *) pWavArrayR, 
-		    sizeof(double) * (Rows * Cols) );
+	plhs[1] = mxCreateLogicalMatrix( 1, N );
+	pMissing = mxGetLogicals( plhs[1] );
 
-	    memcpy( (void *) pMexArrayI, (const void *) pWavArrayI, 
-		    sizeof(double) * (Rows * Cols) );
-	}
+	for( K = 0; K < N; K++ )
+	    pMissing[K] = ! pWavs[K].Found;
+    }
+    if( pScale )
+    {
+	if( nlhs > 2 )
+	    plhs[2] = pScale;
 	else
-	{
-	    register unsigned int I, J;
+	    mxDestroyArray( pScale );
+	if( nlhs > 3 )
+	    plhs[3] = pOffset;
+	else
+	    mxDestroyArray( pOffset );
+    }
 
-	    for( J = 0; J < Cols; J++ )
-	    {
-		for( I = 0; I < Rows; I++ )
-		{
-		    *pMexArrayR = ((double **) pWavArrayR)[I][J];
-		    *pMexArrayI = ((double **) pWavArrayI)[I][J];
-		    pMexArrayR++;
-		    pMexArrayI++;
-		}
-	    }
-	}
+    PanMemRegEvict( Session, Mark );
+    PanCounterEnd( N > 0 ? pWavs[0].Name : NULL );
+
+    for( K = 0; K < N; K++ )
+	mxFree( pWavs[K].Name );
+    mxFree( pWavs );
+
+    if( pCellNames )
+	mxDestroyArray( pCellNames );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    int Batched, CellOutput = 0, HandleOutput = 0, Class = PAN_CLASS_DOUBLE;
+    int K;
+    char SessionName[ PAN_SESSION_NAME_SIZE ];
+
+    if( nrhs < 1 || nrhs > 5 )
+    {
+	mexErrMsgTxt( "Error: missing waveform. Usage: panget('waveform')");
+	return;
     }
-    else if( pWavArrayR )
+
+    /* Any form can be followed by 'session', NAME. */
+    if( (nrhs = PanSessionArgs( nrhs, prhs, SessionName )) < 0 || nrhs > 3 )
     {
-	plhs[0] = mxCreateDoubleMatrix( Rows, Cols, mxREAL );
+	mexErrMsgTxt( "Error: wrong arguments. "
+	              "Usage: y = panget('waveform'[, ...][, 'session', NAME])" );
+	return;
+    }
 
-	double *pMexArrayR = mxGetPr( plhs[0] );
+    Batched = mxIsCell( prhs[0] ) || mxIsClass( prhs[0], "string" );
 
-	if( 1 == Cols )
+    if( ! Batched && ! mxIsChar(prhs[0]))
+    {
+        mexErrMsgTxt( "Error: waveform must be a string. "
+	              "Usage: y = panget('waveform')" );
+	return;
+    }
+
+    /* A mode ('cell' or 'handle') and an output class, in any order. */
+    for( K = 1; K < nrhs; K++ )
+    {
+	char Mode[ 8 ];
+	int  ModeClass = -1;
+
+	if( mxIsChar( prhs[K] ) && ! mxGetString( prhs[K], Mode, sizeof(Mode) ) )
+	    ModeClass = PanClassParse( Mode );
+
+	if( ModeClass >= 0 && PAN_CLASS_DOUBLE == Class )
 	{
-	    memcpy( (void *) pMexArrayR, (const void *) pWavArrayR,
-		    sizeof(double) * (Rows * Cols) );
+	    Class = ModeClass;
+	    continue;
 	}
-	else
+	if( ModeClass < 0 && mxIsChar( prhs[K] ) && ! CellOutput &&
+	    ! HandleOutput && ! strcasecmp( Mode, Batched ? "cell" : "handle" ) )
 	{
-	    register unsigned int I, J;
-
-	    for( J = 0; J < Cols; J++ )
-	    {
-		for( I = 0; I < Rows; I++ )
-		{
-		    *pMexArrayR = ((double **) pWavArrayR)[I][J];
-		    pMexArrayR++;
-		}
-	    }
+	    CellOutput = Batched;
+	    HandleOutput = ! Batched;
+	    continue;
 	}
+
+	mexErrMsgTxt( Batched ?
+	              "Error: the allowed modes are 'cell' and an output class "
+	              "('double', 'single' or 'int16'). "
+	              "Usage: [C, MISSING] = panget(NAMES, 'cell', 'single')" :
+	              "Error: the allowed modes are 'handle' and an output class "
+	              "('double', 'single' or 'int16'). "
+	              "Usage: h = panget('waveform', 'handle') or "
+	              "[Q, SCALE, OFFSET] = panget('waveform', 'int16')" );
+	return;
     }
-    else if( pWavArrayS )
+
+    if( HandleOutput && PAN_CLASS_DOUBLE != Class )
     {
-        if( 1 == Cols )
+	mexErrMsgTxt( "Error: a handle has no output class. "
+	              "Usage: h = panget('waveform', 'handle')" );
+	return;
+    }
+    if( CellOutput && PAN_CLASS_INT16 == Class )
+    {
+	mexErrMsgTxt( "Error: int16 waveforms can not be returned in a cell. "
+	              "Usage: [Q, MISSING, SCALE, OFFSET] = "
+	              "panget(NAMES, 'int16')" );
+	return;
+    }
+    if( ! Batched && (nlhs < 1 || nlhs > (PAN_CLASS_INT16 == Class ? 3 : 1)) )
+    {
+	mexErrMsgTxt( "Error: output variable is required. "
+	              "Usage: y = panget('waveform') or "
+	              "[Q, SCALE, OFFSET] = panget('waveform', 'int16')" );
+	return;
+    }
+    if( Batched && (nlhs < 1 || nlhs > (PAN_CLASS_INT16 == Class ? 4 : 2)) )
+    {
+	mexErrMsgTxt( "Error: output variable is required. "
+	              "Usage: [Y, MISSING] = panget({'wav1', 'wav2', ...})");
+	return;
+    }
+
+    /*
+     * The handle object reads its samples on demand through panslice: no
+     * data is copied here.
+     */
+    if( HandleOutput )
+    {
+	if( *SessionName )
 	{
-	    register unsigned int I;
-	    mxArray *pMexArrayS;
-	    char    **pArrayS;
+	    mexErrMsgTxt( "Error: a handle reads the default session only. "
+	                  "Usage: h = panget('waveform', 'handle')" );
+	    return;
+	}
+	mexCallMATLAB( 1, plhs, 1, (mxArray **) prhs, "MPanWaveform" );
+	return;
+    }
 
-	    plhs[0] = mxCreateCellMatrix( 1, Rows );
+    PanSession *Session;
+    int Status;
 
-	    pArrayS = (char **) pWavArrayS;
+    PanCounterBegin( PAN_COUNTER_PANGET );
 
-	    for( I = 0; I < Rows; I++ )
-	    {
-		pMexArrayS = mxCreateString( pArrayS[I] );
-		if( NULL == pMexArrayS )
-		{
-		    mexErrMsgTxt( "No more memory.\n" );
-		    return;
-		}
-		mxSetCell( plhs[0], I, pMexArrayS );
-	    }
-	}
-	else
-	{
-	    register unsigned int I, J;
-	    mxArray   *pMexArrayS;
-	    char    ***pArrayS;
+    if( (Status = PanSessionAttachNamed( SessionName, &Session )) )
+    {
+	PanSessionErrMsg( Status, SessionName );
+	return;
+    }
 
-	    plhs[0] = mxCreateCellMatrix( Rows, Cols );
+    if( ! Session->Entry.PanMatlabGet )
+    {
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabGet" );
+	return;
+    }
 
-	    pArrayS = (char ***) pWavArrayS;
+    if( Batched )
+    {
+	GetMemWaveforms( Session, nlhs, plhs, prhs[0], CellOutput, Class );
+	PanSessionDetach();
+	return;
+    }
 
-	    for( I = 0; I < Cols; I++ )
-	    {
-		for( J = 0; J < Rows; J++ )
-		{
-		    pMexArrayS = mxCreateString( pArrayS[J][I] );
-		    if( NULL == pMexArrayS )
-		    {
-			mexErrMsgTxt( "No more memory.\n" );
-			return;
-		    }
-		    mxSetCell( plhs[0], I*Rows + J, pMexArrayS );
-		}
-	    }
+    size_t CharNum;
+    MemWaveform Wav;
+    uint64_t Mark = PanMemRegMark( Session );
+
+    CharNum = mxGetN( prhs[0]);
+
+    Wav.Name = mxMalloc( 2 + CharNum );
+    if( NULL == Wav.Name )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    mxGetString( prhs[0], Wav.Name, 1 + CharNum );
+
+    if( ! PanMemWaveformGet( Session, &Wav ) )
+    {
+	PanMemWaveformErrMsg( Wav.Name );
+
+	mxFree( Wav.Name );
+
+        return;
+    }
+    PanMemRegTouch( Session, &Wav );
+
+    if( PAN_CLASS_INT16 == Class )
+    {
+	mxArray *pScale, *pOffset;
+
+	if( Wav.pWavArrayI || Wav.pWavArrayS )
+	{
+	    mexErrMsgTxt( "Error: only real numeric memwaveforms can be "
+	                  "quantised to int16." );
+	    return;
 	}
+
+	pScale = mxCreateDoubleMatrix( 1, Wav.Cols, mxREAL );
+	pOffset = mxCreateDoubleMatrix( 1, Wav.Cols, mxREAL );
+	plhs[0] = CopyMemWaveform( &Wav, Class, mxGetDoubles( pScale ),
+	                           mxGetDoubles( pOffset ) );
+	if( nlhs > 1 )
+	    plhs[1] = pScale;
+	else
+	    mxDestroyArray( pScale );
+	if( nlhs > 2 )
+	    plhs[2] = pOffset;
+	else
+	    mxDestroyArray( pOffset );
     }
+    else
+	plhs[0] = CopyMemWaveform( &Wav, Class, NULL, NULL );
+
+    PanMemRegEvict( Session, Mark );
+    PanSessionDetach();
+    PanCounterEnd( Wav.Name );
+    mxFree( Wav.Name );
 
-    dlclose( Module );
     return;
 }
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "panconsole.h"
+
+#define PANLOG_USAGE \
+    "Usage: panlog('on'|'off'), panlog('rate', SECONDS), " \
+    "panlog('size', BYTES), panlog('mirror', 'file'), panlog('flush'), " \
+    "panlog('clear') or TEXT = panlog('tail', N)"
+
+
+
+
+static double GetScalar( const mxArray *pArg )
+{
+    if( ! mxIsNumeric( pArg ) || 1 != mxGetNumberOfElements( pArg ) ||
+        mxGetScalar( pArg ) < 0 )
+    {
+	mexErrMsgTxt( "Error: a non negative scalar is expected. "
+	              PANLOG_USAGE );
+	return( 0 );
+    }
+
+    return( mxGetScalar( pArg ) );
+}
+
+
+
+
+/*
+ * Return the last Lines lines of the ring in a malloc'd string. The block
+ * lock is held: no MATLAB function, which could raise an error, is called.
+ */
+static char *LogTail( PanConsoleBlock *pBlock, double Lines )
+{
+    uint64_t Kept = pBlock->Written < PAN_CONSOLE_RING_SIZE ?
+                    pBlock->Written : PAN_CONSOLE_RING_SIZE;
+    uint64_t First = pBlock->Written - Kept, K = pBlock->Written;
+    size_t Size, H;
+    double Count = 0;
+    char *pText;
+
+    if( Lines < 1 )
+	K = First;
+
+    /* A final newline does not start a new line. */
+    if( K > First && '\n' == pBlock->Ring[ (K - 1) % PAN_CONSOLE_RING_SIZE ] )
+	K--;
+
+    for( ; K > First; K-- )
+    {
+	if( '\n' == pBlock->Ring[ (K - 1) % PAN_CONSOLE_RING_SIZE ] &&
+	    ++Count >= Lines )
+	    break;
+    }
+
+    Size = Lines < 1 ? 0 : (size_t) (pBlock->Written - K);
+    pText = (char *) malloc( Size + 1 );
+    if( ! pText )
+	return( NULL );
+
+    for( H = 0; H < Size; H++ )
+	pText[H] = pBlock->Ring[ (K + H) % PAN_CONSOLE_RING_SIZE ];
+    pText[ Size ] = 0;
+
+    return( pText );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    PanConsoleBlock *pBlock = PanConsoleBlockGet();
+    char Mode[ 8 ];
+
+    if( ! pBlock )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+    if( nrhs < 1 || nrhs > 2 || ! mxIsChar( prhs[0] ) ||
+        mxGetString( prhs[0], Mode, sizeof(Mode) ) )
+    {
+	mexErrMsgTxt( "Error: wrong arguments. " PANLOG_USAGE );
+	return;
+    }
+    if( nlhs > 1 || (nlhs > 0 && strcasecmp( Mode, "tail" )) )
+    {
+	mexErrMsgTxt( "Error: only panlog('tail', N) has an output. "
+	              PANLOG_USAGE );
+	return;
+    }
+
+    /*
+     * panlog is never called within PAN: a capture still open was left by
+     * a MATLAB error, and the standard output is given back.
+     */
+    PanConsoleEnd();
+
+    if( 1 == nrhs && (! strcasecmp( Mode, "on" ) ||
+                      ! strcasecmp( Mode, "off" )) )
+    {
+	pthread_mutex_lock( &(pBlock->Lock) );
+	pBlock->Enabled = ! strcasecmp( Mode, "on" );
+	pthread_mutex_unlock( &(pBlock->Lock) );
+
+	/* The output held back is not left pending once capture is off. */
+	if( ! strcasecmp( Mode, "off" ) )
+	    PanConsoleEcho( 1 );
+    }
+    else if( 1 == nrhs && ! strcasecmp( Mode, "flush" ) )
+	PanConsoleEcho( 1 );
+    else if( 1 == nrhs && ! strcasecmp( Mode, "clear" ) )
+    {
+	pthread_mutex_lock( &(pBlock->Lock) );
+	pBlock->Written = pBlock->Echoed = 0;
+	pthread_mutex_unlock( &(pBlock->Lock) );
+    }
+    else if( 2 == nrhs && ! strcasecmp( Mode, "rate" ) )
+    {
+	double Seconds = GetScalar( prhs[1] );
+
+	pthread_mutex_lock( &(pBlock->Lock) );
+	pBlock->FlushSeconds = Seconds;
+	pthread_mutex_unlock( &(pBlock->Lock) );
+    }
+    else if( 2 == nrhs && ! strcasecmp( Mode, "size" ) )
+    {
+	double Bytes = GetScalar( prhs[1] );
+
+	pthread_mutex_lock( &(pBlock->Lock) );
+	pBlock->FlushBytes = (size_t) Bytes;
+	pthread_mutex_unlock( &(pBlock->Lock) );
+    }
+    else if( 2 == nrhs && ! strcasecmp( Mode, "mirror" ) )
+    {
+	char Path[ PAN_CONSOLE_PATH_SIZE ];
+
+	if( ! mxIsChar( prhs[1] ) || mxGetString( prhs[1], Path, sizeof(Path) ) )
+	{
+	    mexErrMsgTxt( "Error: the mirror file must be a string. "
+	                  PANLOG_USAGE );
+	    return;
+	}
+
+	pthread_mutex_lock( &(pBlock->Lock) );
+	strcpy( pBlock->Mirror, Path );
+	pthread_mutex_unlock( &(pBlock->Lock) );
+    }
+    else if( 2 == nrhs && ! strcasecmp( Mode, "tail" ) )
+    {
+	double Lines = GetScalar( prhs[1] );
+	char *pText;
+
+	pthread_mutex_lock( &(pBlock->Lock) );
+	pText = LogTail( pBlock, Lines );
+	pthread_mutex_unlock( &(pBlock->Lock) );
+
+	if( ! pText )
+	{
+	    mexErrMsgTxt( "No more memory.\n" );
+	    return;
+	}
+	plhs[0] = mxCreateString( pText );
+	free( pText );
+    }
+    else
+	mexErrMsgTxt( "Error: wrong arguments. " PANLOG_USAGE );
+}
@@ -0,0 +1,705 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <math.h>
+#include "mex.h"
+#include "panmacro.h"
+#include "pancounter.h"
+#include "panprof.h"
+
+/*
+ * Gateway of a compiled nport macro: build it with the kernel of the
+ * macro, e.g.
+ *
+ *   mex -R2018a -output PvMod panmacro.c pancounter.c panprof.c PvMod.c
+ *
+ * (MPanBuildMacro does so). The callback form is the one used by PAN, the
+ * batched form evaluates N instances in one call:
+ *
+ *   [f, C, R] = MACRO(Pars, PN, V, I, StN, X, dX, Time)
+ *   [F, C, R] = MACRO('batch', PARS, V, I, X, DX, TIME)
+ *
+ * where V and I are N x NumPorts, X and DX N x NumStates, PARS N x NumPars
+ * (or empty), F is N x NumPorts and C and R are N x NumPorts x NumPorts.
+ *
+ * The callbacks whose inputs did not change can bypass the evaluation, as
+ * SPICE does for its devices (MACRO('bypass', RELTOL, ABSTOL)); the hit
+ * rate is returned by MACRO('stats').
+ *
+ * When panprofile is on, one call every period is timed and recorded in
+ * the profile block (panprof.h) under the instance named by StN: the time
+ * of the whole call and the part spent evaluating the macro, the rest
+ * being spent marshalling arguments, looking up the bypass cache and
+ * copying the results.
+ */
+#define PANMACRO_USAGE \
+    "Usage: [f, C, R] = MACRO(Pars, PN, V, I, StN, X, dX, Time), " \
+    "[F, C, R] = MACRO('batch', PARS, V, I, X, DX, TIME), " \
+    "MACRO('bypass', RELTOL, ABSTOL[, SIZE]), MACRO('bypass', 'off'), " \
+    "S = MACRO('stats') or MACRO('reset')"
+
+#define PAN_MACRO_BYPASS_SIZE  256
+
+/*
+ * A cached evaluation. Key holds, compared exactly, the number of
+ * elements of V, I, X and dX, then Pars, StN (if numeric or a name) and
+ * Time; In holds V, I, X and dX, compared within the tolerances.
+ */
+typedef struct
+{
+    int       NumKey, NumIn;
+    double   *pKey, *pIn;
+    mxArray  *pOut[3];
+} BypassEntry;
+
+typedef struct
+{
+    int          Enabled;
+    double       RelTol, AbsTol;
+    int          Size, Count, Next, Cursor;
+    BypassEntry *pEntries;
+    double      *pKey, *pIn;          /* the inputs of the current call */
+    int          KeySize, InSize;
+    uint64_t     Calls, Hits;
+} BypassCache;
+
+static BypassCache Bypass;
+
+/* The call being timed: ProfEval accumulates the evaluation time. */
+static uint64_t ProfTick, ProfEval;
+static int ProfTimed;
+
+static const char *StatsFields[] =
+    { "calls", "hits", "hit_rate", "entries", "reltol", "abstol" };
+
+
+
+
+/* Message may contain a %s, replaced by What. */
+static void MacroErrMsg( const char *Message, const char *What )
+{
+    char Text[ 128 ], Buffer[ 512 ];
+
+    snprintf( Text, sizeof( Text ), Message, What ? What : "" );
+    snprintf( Buffer, sizeof( Buffer ), "Error: %s: %s " PANMACRO_USAGE,
+              PanMacro.Name, Text );
+    mexErrMsgTxt( Buffer );
+}
+
+
+
+
+/* The Rows x Cols real double array pArray (any shape if Rows < 0). */
+static const double *MacroInput( const mxArray *pArray, long Rows, long Cols,
+                                 const char *What )
+{
+    size_t Count = Rows < 0 ? (size_t) Cols : (size_t) (Rows * Cols);
+
+    if( 0 == Count )
+	return( NULL );
+
+    if( ! mxIsDouble( pArray ) || mxIsComplex( pArray ) ||
+        mxGetNumberOfElements( pArray ) != Count ||
+	(Rows >= 0 && (long) mxGetM( pArray ) != Rows) )
+    {
+	MacroErrMsg( "wrong size or type of %s.", What );
+	return( NULL );
+    }
+
+    return( mxGetDoubles( pArray ) );
+}
+
+
+
+
+static double MacroTime( const mxArray *pTime )
+{
+    if( ! mxIsDouble( pTime ) || mxIsComplex( pTime ) ||
+        1 != mxGetNumberOfElements( pTime ) )
+	MacroErrMsg( "the time must be a real scalar.", NULL );
+
+    return( mxGetScalar( pTime ) );
+}
+
+
+
+
+static void MacroEvaluate( const PanMacroBatch *pBatch )
+{
+    uint64_t Start = ProfTimed ? PanCounterNow() : 0;
+    int Status = pBatch->NumInst > 0 ? (PanMacro.Evaluate)( pBatch ) : 0;
+
+    if( ProfTimed )
+	ProfEval += PanCounterNow() - Start;
+    if( Status )
+	MacroErrMsg( "the evaluation of an instance failed.", NULL );
+}
+
+
+
+
+/* Start timing this call if it is the one of the period. */
+static uint64_t ProfBegin( void )
+{
+    int Period = PanProfPeriod();
+
+    ProfTimed = Period > 0 && 0 == ++ProfTick % (uint64_t) Period;
+    ProfEval = 0;
+
+    return( ProfTimed ? PanCounterNow() : 0 );
+}
+
+
+
+
+/* The instance is named by StN, when it is a name or a number. */
+static void ProfEnd( uint64_t Start, const mxArray *pInstance, int Hit )
+{
+    char Label[ PAN_PROF_LABEL_SIZE ] = "";
+
+    if( ! ProfTimed )
+	return;
+
+    if( pInstance && mxIsChar( pInstance ) )
+	mxGetString( pInstance, Label, sizeof( Label ) );
+    else if( pInstance && mxIsNumeric( pInstance ) &&
+             1 == mxGetNumberOfElements( pInstance ) )
+	snprintf( Label, sizeof( Label ), "%g", mxGetScalar( pInstance ) );
+    else if( ! pInstance )
+	strcpy( Label, "batch" );
+
+    PanProfRecord( PanMacro.Name, Label, PanProfPeriod(),
+                   PanCounterNow() - Start, ProfEval, Hit );
+    ProfTimed = 0;
+}
+
+
+
+
+static void BypassClear( void )
+{
+    int K, H;
+
+    for( K = 0; K < Bypass.Count; K++ )
+    {
+	for( H = 0; H < 3; H++ )
+	    mxDestroyArray( Bypass.pEntries[K].pOut[H] );
+	free( Bypass.pEntries[K].pKey );
+	free( Bypass.pEntries[K].pIn );
+    }
+    free( Bypass.pEntries );
+
+    Bypass.pEntries = NULL;
+    Bypass.Count = Bypass.Next = Bypass.Cursor = 0;
+}
+
+
+
+
+static void BypassExit( void )
+{
+    BypassClear();
+    free( Bypass.pKey );
+    free( Bypass.pIn );
+    Bypass.pKey = Bypass.pIn = NULL;
+    Bypass.KeySize = Bypass.InSize = 0;
+}
+
+
+
+
+/* Room for Count doubles in *ppBuffer: -1 if memory is exhausted. */
+static int BypassReserve( double **ppBuffer, int *pSize, long Count )
+{
+    int Size = 2 * (int) Count + 16;
+    double *pBuffer;
+
+    if( Count <= *pSize )
+	return( 0 );
+
+    if( ! (pBuffer = realloc( *ppBuffer, Size * sizeof(double) )) )
+	return( -1 );
+    *ppBuffer = pBuffer;
+    *pSize = Size;
+
+    return( 0 );
+}
+
+
+
+
+/*
+ * Append the elements of pArray (real doubles, or characters if Names) to
+ * the key or to the inputs of the current call: -1 if they can not be
+ * compared.
+ */
+static int BypassAppend( double **ppBuffer, int *pSize, int *pCount,
+                         const mxArray *pArray, int Names )
+{
+    size_t N = mxGetNumberOfElements( pArray ), K;
+
+    if( ! (mxIsDouble( pArray ) && ! mxIsComplex( pArray )) &&
+        ! (Names && mxIsChar( pArray )) )
+	return( -1 );
+
+    if( BypassReserve( ppBuffer, pSize, *pCount + (long) N ) )
+	return( -1 );
+
+    if( mxIsChar( pArray ) )
+    {
+	const mxChar *pChars = mxGetChars( pArray );
+
+	for( K = 0; K < N; K++ )
+	    (*ppBuffer)[ *pCount + K ] = (double) pChars[K];
+    }
+    else if( N )
+	memcpy( *ppBuffer + *pCount, mxGetDoubles( pArray ),
+	        N * sizeof(double) );
+    *pCount += (int) N;
+
+    return( 0 );
+}
+
+
+
+
+/*
+ * Key and inputs of the callback prhs in Bypass.pKey and Bypass.pIn.
+ * *pNumKey is 0 if the callback can not be bypassed, e.g. when Pars is not
+ * numeric.
+ */
+static void BypassInputs( const mxArray *prhs[], int *pNumKey, int *pNumIn )
+{
+    static const int InArgs[4] = { 2, 3, 5, 6 };
+    int NumKey = 4, H;
+
+    *pNumKey = *pNumIn = 0;
+
+    if( BypassReserve( &Bypass.pKey, &Bypass.KeySize, NumKey ) )
+	return;
+    for( H = 0; H < 4; H++ )
+	Bypass.pKey[H] = (double) mxGetNumberOfElements( prhs[ InArgs[H] ] );
+
+    if( BypassAppend( &Bypass.pKey, &Bypass.KeySize, &NumKey, prhs[0], 0 ) ||
+        BypassAppend( &Bypass.pKey, &Bypass.KeySize, &NumKey, prhs[7], 0 ) )
+	return;
+    /* StN takes part in the key only if it names the instance. */
+    if( mxIsDouble( prhs[4] ) || mxIsChar( prhs[4] ) )
+    {
+	if( BypassAppend( &Bypass.pKey, &Bypass.KeySize, &NumKey,
+	                  prhs[4], 1 ) )
+	    return;
+    }
+
+    for( H = 0; H < 4; H++ )
+    {
+	if( BypassAppend( &Bypass.pIn, &Bypass.InSize, pNumIn,
+	                  prhs[ InArgs[H] ], 0 ) )
+	    return;
+    }
+
+    *pNumKey = NumKey;
+}
+
+
+
+
+static int BypassMatch( const BypassEntry *pEntry, int NumKey, int NumIn )
+{
+    int K;
+
+    if( pEntry->NumKey != NumKey || pEntry->NumIn != NumIn ||
+        memcmp( pEntry->pKey, Bypass.pKey, NumKey * sizeof(double) ) )
+	return( 0 );
+
+    for( K = 0; K < NumIn; K++ )
+    {
+	double A = pEntry->pIn[K], B = Bypass.pIn[K];
+
+	if( ! (fabs( A - B ) <= Bypass.AbsTol +
+	                        Bypass.RelTol * fmax( fabs( A ), fabs( B ) )) )
+	    return( 0 );
+    }
+
+    return( 1 );
+}
+
+
+
+
+/*
+ * The outputs of a bypassed callback. When f, C and R have the shapes of a
+ * macro with as many ports as V and I, f is moved along the cached
+ * linearisation: f + C (V - V0) + R (I - I0).
+ */
+static void BypassOutputs( const BypassEntry *pEntry, int nlhs,
+                           mxArray *plhs[] )
+{
+    const mxArray *pF = pEntry->pOut[0], *pC = pEntry->pOut[1],
+                  *pR = pEntry->pOut[2];
+    size_t P = (size_t) Bypass.pKey[0], J, Q;
+    int H;
+
+    for( H = 0; H < nlhs && H < 3; H++ )
+	plhs[H] = mxDuplicateArray( pEntry->pOut[H] );
+
+    if( (size_t) Bypass.pKey[1] != P ||
+        ! mxIsDouble( pF ) || mxIsComplex( pF ) ||
+	mxGetNumberOfElements( pF ) != P ||
+	! mxIsDouble( pC ) || mxIsComplex( pC ) ||
+	mxGetM( pC ) != P || mxGetN( pC ) != P ||
+	! mxIsDouble( pR ) || mxIsComplex( pR ) ||
+	mxGetM( pR ) != P || mxGetN( pR ) != P )
+	return;
+
+    double *pDst = mxGetDoubles( plhs[0] );
+    const double *pCv = mxGetDoubles( pC ), *pRv = mxGetDoubles( pR );
+    const double *pV0 = pEntry->pIn, *pI0 = pEntry->pIn + P;
+    const double *pV = Bypass.pIn, *pI = Bypass.pIn + P;
+
+    for( Q = 0; Q < P; Q++ )
+    {
+	double dV = pV[Q] - pV0[Q], dI = pI[Q] - pI0[Q];
+
+	if( 0.0 == dV && 0.0 == dI )
+	    continue;
+	for( J = 0; J < P; J++ )
+	    pDst[J] += pCv[ J + Q * P ] * dV + pRv[ J + Q * P ] * dI;
+    }
+}
+
+
+
+
+/* Look the current call up: 1 if it is bypassed and plhs is set. */
+static int BypassLookup( int NumKey, int NumIn, int nlhs, mxArray *plhs[] )
+{
+    int K, H;
+
+    /* PAN calls the instances in the same order at every iteration. */
+    for( H = 0; H < Bypass.Count; H++ )
+    {
+	K = (Bypass.Cursor + H) % Bypass.Count;
+	if( BypassMatch( Bypass.pEntries + K, NumKey, NumIn ) )
+	{
+	    BypassOutputs( Bypass.pEntries + K, nlhs, plhs );
+	    Bypass.Cursor = (K + 1) % Bypass.Count;
+	    Bypass.Hits++;
+	    return( 1 );
+	}
+    }
+
+    return( 0 );
+}
+
+
+
+
+/* Record the evaluation of the current call: pOut is kept by the cache. */
+static void BypassStore( int NumKey, int NumIn, mxArray *pOut[3] )
+{
+    BypassEntry *pEntry;
+    double *pKey, *pIn;
+    int H;
+
+    if( ! Bypass.pEntries )
+	Bypass.pEntries = calloc( Bypass.Size, sizeof( BypassEntry ) );
+    if( ! Bypass.pEntries )
+    {
+	for( H = 0; H < 3; H++ )
+	    mxDestroyArray( pOut[H] );
+	return;
+    }
+
+    /* The slots are reused in turn, as the instances are called. */
+    pEntry = Bypass.pEntries + Bypass.Next;
+    if( Bypass.Next < Bypass.Count )
+    {
+	for( H = 0; H < 3; H++ )
+	    mxDestroyArray( pEntry->pOut[H] );
+    }
+    else
+	Bypass.Count++;
+    Bypass.Next = Bypass.Cursor = (Bypass.Next + 1) % Bypass.Size;
+
+    pKey = realloc( pEntry->pKey, NumKey * sizeof(double) );
+    if( pKey )
+	pEntry->pKey = pKey;
+    pIn = realloc( pEntry->pIn, (NumIn ? NumIn : 1) * sizeof(double) );
+    if( pIn )
+	pEntry->pIn = pIn;
+
+    if( pKey && pIn )
+    {
+	memcpy( pEntry->pKey, Bypass.pKey, NumKey * sizeof(double) );
+	memcpy( pEntry->pIn, Bypass.pIn, NumIn * sizeof(double) );
+	pEntry->NumKey = NumKey;
+	pEntry->NumIn = NumIn;
+    }
+    else
+	pEntry->NumKey = -1;    /* never matched */
+
+    for( H = 0; H < 3; H++ )
+    {
+	mexMakeArrayPersistent( pOut[H] );
+	pEntry->pOut[H] = pOut[H];
+    }
+}
+
+
+
+
+/* Evaluate one instance into pOut: f is a row, C and R are square. */
+static void MacroInstance( const mxArray *prhs[], mxArray *pOut[3] )
+{
+    PanMacroBatch Batch;
+
+    if( PanMacro.Forward )
+    {
+	uint64_t Start = ProfTimed ? PanCounterNow() : 0;
+	int Status = mexCallMATLAB( 3, pOut, 8, (mxArray **) prhs,
+	                            PanMacro.Forward );
+
+	if( ProfTimed )
+	    ProfEval += PanCounterNow() - Start;
+	if( Status )
+	    MacroErrMsg( "the evaluation of an instance failed.", NULL );
+	return;
+    }
+
+    memset( &Batch, 0, sizeof( PanMacroBatch ) );
+    Batch.NumInst = 1;
+    Batch.NumPorts = PanMacro.NumPorts;
+    Batch.NumStates = PanMacro.NumStates;
+
+    if( mxIsDouble( prhs[0] ) && ! mxIsComplex( prhs[0] ) )
+    {
+	Batch.NumPars = (int) mxGetNumberOfElements( prhs[0] );
+	Batch.pPars = Batch.NumPars ? mxGetDoubles( prhs[0] ) : NULL;
+    }
+    Batch.pV = MacroInput( prhs[2], -1, Batch.NumPorts, "V" );
+    Batch.pI = MacroInput( prhs[3], -1, Batch.NumPorts, "I" );
+    Batch.pX = MacroInput( prhs[5], -1, Batch.NumStates, "X" );
+    Batch.pdX = MacroInput( prhs[6], -1, Batch.NumStates, "dX" );
+    Batch.Time = MacroTime( prhs[7] );
+
+    pOut[0] = mxCreateDoubleMatrix( 1, Batch.NumPorts, mxREAL );
+    pOut[1] = mxCreateDoubleMatrix( Batch.NumPorts, Batch.NumPorts, mxREAL );
+    pOut[2] = mxCreateDoubleMatrix( Batch.NumPorts, Batch.NumPorts, mxREAL );
+    Batch.pF = mxGetDoubles( pOut[0] );
+    Batch.pC = mxGetDoubles( pOut[1] );
+    Batch.pR = mxGetDoubles( pOut[2] );
+
+    MacroEvaluate( &Batch );
+}
+
+
+
+
+/* One instance, as called back by PAN. */
+static void MacroCallback( int nlhs, mxArray *plhs[], const mxArray *prhs[] )
+{
+    mxArray *pOut[3];
+    int NumKey = 0, NumIn = 0, NumOut = nlhs ? nlhs : 1, H;
+    uint64_t Start = ProfBegin();
+
+    Bypass.Calls++;
+
+    if( Bypass.Enabled )
+    {
+	BypassInputs( prhs, &NumKey, &NumIn );
+	if( NumKey > 0 && BypassLookup( NumKey, NumIn, NumOut, plhs ) )
+	{
+	    ProfEnd( Start, prhs[4], 1 );
+	    return;
+	}
+    }
+
+    MacroInstance( prhs, pOut );
+
+    if( NumKey > 0 )
+    {
+	for( H = 0; H < NumOut; H++ )
+	    plhs[H] = mxDuplicateArray( pOut[H] );
+	BypassStore( NumKey, NumIn, pOut );
+    }
+    else
+    {
+	for( H = 0; H < 3; H++ )
+	{
+	    if( H < NumOut )
+		plhs[H] = pOut[H];
+	    else
+		mxDestroyArray( pOut[H] );
+	}
+    }
+
+    ProfEnd( Start, prhs[4], 0 );
+}
+
+
+
+
+static void MacroBatch( int nlhs, mxArray *plhs[], const mxArray *prhs[] )
+{
+    PanMacroBatch Batch;
+    mxArray *pC, *pR;
+    mwSize Dims[3];
+    uint64_t Start = ProfBegin();
+    long N;
+
+    if( ! PanMacro.Evaluate )
+	MacroErrMsg( "the batched form needs the compiled kernel of %s.",
+	             PanMacro.Forward );
+    if( ! mxIsDouble( prhs[2] ) )
+	MacroErrMsg( "wrong size or type of %s.", "V" );
+
+    memset( &Batch, 0, sizeof( PanMacroBatch ) );
+    N = (long) mxGetM( prhs[2] );
+    Batch.NumInst = (int) N;
+    Batch.NumPorts = PanMacro.NumPorts;
+    Batch.NumStates = PanMacro.NumStates;
+
+    if( ! mxIsEmpty( prhs[1] ) )
+    {
+	Batch.NumPars = (int) mxGetN( prhs[1] );
+	Batch.pPars = MacroInput( prhs[1], N, Batch.NumPars, "PARS" );
+    }
+    Batch.pV = MacroInput( prhs[2], N, Batch.NumPorts, "V" );
+    Batch.pI = MacroInput( prhs[3], N, Batch.NumPorts, "I" );
+    Batch.pX = MacroInput( prhs[4], N, Batch.NumStates, "X" );
+    Batch.pdX = MacroInput( prhs[5], N, Batch.NumStates, "DX" );
+    Batch.Time = MacroTime( prhs[6] );
+
+    Dims[0] = N;
+    Dims[1] = Dims[2] = Batch.NumPorts;
+    plhs[0] = mxCreateDoubleMatrix( N, Batch.NumPorts, mxREAL );
+    Batch.pF = mxGetDoubles( plhs[0] );
+
+    /* C and R are computed anyway: the kernel writes all the outputs. */
+    pC = mxCreateNumericArray( 3, Dims, mxDOUBLE_CLASS, mxREAL );
+    pR = mxCreateNumericArray( 3, Dims, mxDOUBLE_CLASS, mxREAL );
+    Batch.pC = mxGetDoubles( pC );
+    Batch.pR = mxGetDoubles( pR );
+
+    MacroEvaluate( &Batch );
+
+    if( nlhs > 1 )
+	plhs[1] = pC;
+    else
+	mxDestroyArray( pC );
+    if( nlhs > 2 )
+	plhs[2] = pR;
+    else
+	mxDestroyArray( pR );
+
+    ProfEnd( Start, NULL, 0 );
+}
+
+
+
+
+static double MacroScalar( const mxArray *pArray, const char *What )
+{
+    double Value = -1;
+
+    if( mxIsNumeric( pArray ) && 1 == mxGetNumberOfElements( pArray ) )
+	Value = mxGetScalar( pArray );
+    if( ! (Value >= 0) )
+	MacroErrMsg( "%s must be a non negative scalar.", What );
+
+    return( Value );
+}
+
+
+
+
+/* MACRO('bypass', RELTOL, ABSTOL[, SIZE]) or MACRO('bypass', 'off'). */
+static void MacroBypass( int nrhs, const mxArray *prhs[] )
+{
+    char Mode[ 4 ];
+    double Size = PAN_MACRO_BYPASS_SIZE;
+
+    if( 2 == nrhs && mxIsChar( prhs[1] ) &&
+        ! mxGetString( prhs[1], Mode, sizeof(Mode) ) &&
+	! strcasecmp( Mode, "off" ) )
+    {
+	BypassClear();
+	Bypass.Enabled = 0;
+	return;
+    }
+    if( nrhs < 3 || nrhs > 4 )
+	MacroErrMsg( "wrong arguments of %s.", "bypass" );
+
+    Bypass.RelTol = MacroScalar( prhs[1], "RELTOL" );
+    Bypass.AbsTol = MacroScalar( prhs[2], "ABSTOL" );
+    if( 4 == nrhs )
+	Size = MacroScalar( prhs[3], "SIZE" );
+    if( Size < 1 || Size > 1e6 )
+	MacroErrMsg( "%s must be between 1 and 1e6.", "SIZE" );
+
+    BypassClear();
+    Bypass.Size = (int) Size;
+    Bypass.Enabled = 1;
+
+    mexAtExit( BypassExit );
+}
+
+
+
+
+static mxArray *MacroStats( void )
+{
+    mxArray *pStats = mxCreateStructMatrix( 1, 1, 6, StatsFields );
+
+    mxSetField( pStats, 0, "calls",
+                mxCreateDoubleScalar( (double) Bypass.Calls ) );
+    mxSetField( pStats, 0, "hits",
+                mxCreateDoubleScalar( (double) Bypass.Hits ) );
+    mxSetField( pStats, 0, "hit_rate", mxCreateDoubleScalar( Bypass.Calls ?
+                (double) Bypass.Hits / (double) Bypass.Calls : 0.0 ) );
+    mxSetField( pStats, 0, "entries",
+                mxCreateDoubleScalar( (double) Bypass.Count ) );
+    mxSetField( pStats, 0, "reltol", mxCreateDoubleScalar(
+                Bypass.Enabled ? Bypass.RelTol : mxGetNaN() ) );
+    mxSetField( pStats, 0, "abstol", mxCreateDoubleScalar(
+                Bypass.Enabled ? Bypass.AbsTol : mxGetNaN() ) );
+
+    return( pStats );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    char Mode[ 8 ];
+
+    if( nlhs > 3 )
+    {
+	MacroErrMsg( "at most three output variables are allowed.", NULL );
+	return;
+    }
+
+    if( nrhs < 1 || ! mxIsChar( prhs[0] ) ||
+        mxGetString( prhs[0], Mode, sizeof(Mode) ) )
+	Mode[0] = 0;
+
+    if( 7 == nrhs && ! strcasecmp( Mode, "batch" ) )
+	MacroBatch( nlhs, plhs, prhs );
+    else if( 8 == nrhs )
+	MacroCallback( nlhs, plhs, prhs );
+    else if( ! strcasecmp( Mode, "bypass" ) )
+	MacroBypass( nrhs, prhs );
+    else if( ! strcasecmp( Mode, "stats" ) && 1 == nrhs )
+	plhs[0] = MacroStats();
+    else if( ! strcasecmp( Mode, "reset" ) && 1 == nrhs )
+    {
+	BypassClear();
+	Bypass.Calls = Bypass.Hits = 0;
+    }
+    else
+	MacroErrMsg( "wrong number of arguments.", NULL );
+}
@@ -0,0 +1,67 @@
+#ifndef PAN_MACRO_H
+#define PAN_MACRO_H
+
+#include <stddef.h>
+
+/*
+ * Compiled evaluation of the nport macro devices ("model NAME nport
+ * macro=yes evaluate=MACRO"). PAN calls MACRO by name, once per instance,
+ * as [f,C,R] = MACRO(Pars,PN,V,I,StN,X,dX,Time): panmacro.c, linked with
+ * a C kernel, builds the MACRO MEX file that MATLAB prefers to MACRO.m.
+ *
+ * A kernel evaluates a batch of NumInst instances at once. Every quantity
+ * is stored port-major (struct-of-arrays), so that the loop over the
+ * instances of a kernel is unit-stride and vectorisable:
+ *
+ *   V, I, f          port P of instance K at [ P * NumInst + K ]
+ *   X, dX            state S of instance K at [ S * NumInst + K ]
+ *   Pars             parameter J of instance K at [ J * NumInst + K ]
+ *   C, R             entry (P, Q) of instance K at
+ *                    [ (Q * NumPorts + P) * NumInst + K ]
+ *
+ * With NumInst = 1 this is the column-major layout of MATLAB: the kernel
+ * writes straight into the f, C and R returned to PAN. The outputs are
+ * zeroed before the call, so only the nonzero entries need to be set.
+ */
+typedef struct
+{
+    int           NumInst;
+    int           NumPorts;
+    int           NumStates;
+    int           NumPars;
+    double        Time;
+    const double *pPars;
+    const double *pV, *pI;
+    const double *pX, *pdX;
+    double       *pF, *pC, *pR;
+} PanMacroBatch;
+
+#define PAN_MACRO_PORT( pBatch, P ) \
+    ((size_t) (P) * (size_t) (pBatch)->NumInst)
+
+#define PAN_MACRO_ENTRY( pBatch, P, Q ) \
+    (((size_t) (Q) * (size_t) (pBatch)->NumPorts + (size_t) (P)) * \
+     (size_t) (pBatch)->NumInst)
+
+/*
+ * Every kernel defines one PanMacro. Evaluate returns 0, or a nonzero
+ * value if an instance can not be evaluated (the call then fails with
+ * Name in the message).
+ *
+ * panmacrofwd.c defines instead a PanMacro with no Evaluate, which
+ * forwards the callbacks to the MATLAB function Forward: the gateway then
+ * only adds the bypass of the unchanged instances. NumPorts and NumStates
+ * are -1 when they are not known.
+ */
+typedef struct
+{
+    const char *Name;
+    int         NumPorts;
+    int         NumStates;
+    int       (*Evaluate)( const PanMacroBatch *pBatch );
+    const char *Forward;
+} PanMacroModel;
+
+extern const PanMacroModel PanMacro;
+
+#endif
@@ -0,0 +1,24 @@
+#include "panmacro.h"
+
+/*
+ * Model of a bypass-only gateway, built by MPanBuildMacro(MACRO, 'bypass')
+ * as
+ *
+ *   mex -R2018a -output MACRO_bypass -DPAN_MACRO_FORWARD=MACRO \
+ *       panmacro.c panmacrofwd.c
+ *
+ * The netlist then names MACRO_bypass in evaluate=: the callbacks whose
+ * inputs changed are forwarded to MACRO, interpreted or compiled.
+ */
+#ifndef PAN_MACRO_FORWARD
+#error "PAN_MACRO_FORWARD must be defined as the name of the macro"
+#endif
+
+#define PAN_MACRO_STRING( Name )   PAN_MACRO_STRING2( Name )
+#define PAN_MACRO_STRING2( Name )  #Name
+
+const PanMacroModel PanMacro =
+{
+    PAN_MACRO_STRING( PAN_MACRO_FORWARD ), -1, -1, NULL,
+    PAN_MACRO_STRING( PAN_MACRO_FORWARD )
+};
@@ -0,0 +1,426 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include "panmemreg.h"
+#include "pancounter.h"
+
+/*
+ * Every gateway links its own copy of this file: Registry caches the
+ * address of the shared block.
+ */
+static PanMemRegistry *Registry;
+
+
+
+
+PanMemRegistry *PanMemRegGet( void )
+{
+    char *Tag, Buffer[ 32 ];
+    PanMemRegistry *pReg = NULL;
+
+    if( Registry )
+	return( Registry );
+
+    Tag = getenv( PAN_MAT_MEMWAV_ENV );
+    if( Tag && 1 == sscanf( Tag, "%p", (void **) &pReg ) && pReg )
+	return( Registry = pReg );
+
+    pReg = (PanMemRegistry *) calloc( 1, sizeof( PanMemRegistry ) );
+    if( ! pReg )
+	return( NULL );
+
+    pthread_mutex_init( &(pReg->Lock), NULL );
+
+    sprintf( Buffer, "%p", (void *) pReg );
+    setenv( PAN_MAT_MEMWAV_ENV, Buffer, 1 );
+
+    return( Registry = pReg );
+}
+
+
+
+
+static void RemoveEntry( PanMemRegistry *pReg, int K )
+{
+    pReg->Total -= pReg->pEntries[K].Bytes;
+    free( pReg->pEntries[K].Name );
+    pReg->pEntries[K] = pReg->pEntries[ --pReg->Count ];
+}
+
+
+
+
+/* The registry of Session: a named session gets its own at first use. */
+static PanMemRegistry *RegistryOf( const PanSession *Session )
+{
+    PanSession *pNamed = (PanSession *) Session;
+    PanMemRegistry *pReg;
+
+    if( ! Session->Index )
+	return( PanMemRegGet() );
+    if( pNamed->pMemReg )
+	return( (PanMemRegistry *) pNamed->pMemReg );
+
+    pReg = (PanMemRegistry *) calloc( 1, sizeof( PanMemRegistry ) );
+    if( ! pReg )
+	return( NULL );
+
+    pthread_mutex_init( &(pReg->Lock), NULL );
+
+    return( (PanMemRegistry *) (pNamed->pMemReg = pReg) );
+}
+
+
+
+
+/* Drop the entries of a previous netlist. Called with the lock held. */
+static void Sync( PanMemRegistry *pReg, const PanSession *Session )
+{
+    if( pReg->Generation == Session->Generation )
+	return;
+
+    while( pReg->Count > 0 )
+	RemoveEntry( pReg, pReg->Count - 1 );
+    pReg->Generation = Session->Generation;
+}
+
+
+
+
+static int FindEntry( const PanMemRegistry *pReg, const char *Name )
+{
+    int K;
+
+    for( K = 0; K < pReg->Count; K++ )
+    {
+	if( ! strcmp( pReg->pEntries[K].Name, Name ) )
+	    return( K );
+    }
+
+    return( -1 );
+}
+
+
+
+
+/* Bytes held by PAN: the samples and, for matrices, the row pointers. */
+static uint64_t WaveformBytes( const MemWaveform *pWav )
+{
+    uint64_t Cells = (uint64_t) pWav->Rows * pWav->Cols, Bytes;
+    int Rows = pWav->Rows, Cols = pWav->Cols, I, J;
+
+    if( pWav->pWavArrayS )
+    {
+	Bytes = Cells * sizeof(char *) + (Cols > 1 ? Rows * sizeof(char **) : 0);
+	for( I = 0; I < Rows; I++ )
+	{
+	    for( J = 0; J < Cols; J++ )
+	    {
+		const char *String = 1 == Cols ?
+		                     ((char **) pWav->pWavArrayS)[I] :
+		                     ((char ***) pWav->pWavArrayS)[I][J];
+
+		if( String )
+		    Bytes += strlen( String ) + 1;
+	    }
+	}
+	return( Bytes );
+    }
+
+    Bytes = Cells * sizeof(double) + (Cols > 1 ? Rows * sizeof(double *) : 0);
+
+    return( pWav->pWavArrayI ? 2 * Bytes : Bytes );
+}
+
+
+
+
+uint64_t PanMemRegMark( const PanSession *Session )
+{
+    PanMemRegistry *pReg = RegistryOf( Session );
+    uint64_t Mark;
+
+    if( ! pReg )
+	return( 0 );
+
+    pthread_mutex_lock( &(pReg->Lock) );
+    Mark = pReg->Sequence;
+    pthread_mutex_unlock( &(pReg->Lock) );
+
+    return( Mark );
+}
+
+
+
+
+void PanMemRegTouch( const PanSession *Session, const MemWaveform *pWav )
+{
+    PanMemRegistry *pReg = RegistryOf( Session );
+    PanMemRegEntry *pEntry;
+    uint64_t Bytes;
+    int K;
+
+    if( ! pReg || ! pWav->Found )
+	return;
+
+    Bytes = WaveformBytes( pWav );
+
+    pthread_mutex_lock( &(pReg->Lock) );
+    Sync( pReg, Session );
+
+    K = FindEntry( pReg, pWav->Name );
+    if( K < 0 )
+    {
+	if( pReg->Count == pReg->Size )
+	{
+	    int Size = pReg->Size ? 2 * pReg->Size : 64;
+	    PanMemRegEntry *pEntries = realloc( pReg->pEntries,
+	                                        Size * sizeof( PanMemRegEntry ) );
+
+	    if( ! pEntries )
+	    {
+		pthread_mutex_unlock( &(pReg->Lock) );
+		return;
+	    }
+	    pReg->pEntries = pEntries;
+	    pReg->Size = Size;
+	}
+
+	pEntry = pReg->pEntries + pReg->Count;
+	memset( pEntry, 0, sizeof( PanMemRegEntry ) );
+	pEntry->Name = strdup( pWav->Name );
+	if( ! pEntry->Name )
+	{
+	    pthread_mutex_unlock( &(pReg->Lock) );
+	    return;
+	}
+	pReg->Count++;
+    }
+    else
+	pEntry = pReg->pEntries + K;
+
+    pReg->Total += Bytes - pEntry->Bytes;
+    pEntry->Rows = pWav->Rows;
+    pEntry->Cols = pWav->Cols;
+    pEntry->Type = pWav->pWavArrayS ? PAN_MEMREG_STRING :
+                   pWav->pWavArrayI ? PAN_MEMREG_COMPLEX : PAN_MEMREG_REAL;
+    pEntry->Bytes = Bytes;
+    pEntry->LastUse = PanCounterNow();
+    pEntry->Sequence = pReg->Sequence++;
+
+    pthread_mutex_unlock( &(pReg->Lock) );
+}
+
+
+
+
+void PanMemRegForget( const PanSession *Session, const char *Name )
+{
+    PanMemRegistry *pReg = RegistryOf( Session );
+    int K;
+
+    if( ! pReg )
+	return;
+
+    pthread_mutex_lock( &(pReg->Lock) );
+    if( (K = FindEntry( pReg, Name )) >= 0 )
+	RemoveEntry( pReg, K );
+    pthread_mutex_unlock( &(pReg->Lock) );
+}
+
+
+
+
+int PanMemRegEvict( const PanSession *Session, uint64_t Mark )
+{
+    PanMemRegistry *pReg = RegistryOf( Session );
+    int Evicted = 0;
+
+    if( ! pReg || ! Session->Entry.MemWaveformDeleteByName )
+	return( 0 );
+
+    for( ;; )
+    {
+	int K, Victim = -1;
+	char *Name;
+
+	pthread_mutex_lock( &(pReg->Lock) );
+	Sync( pReg, Session );
+
+	if( pReg->Budget > 0 && pReg->Total > pReg->Budget )
+	{
+	    for( K = 0; K < pReg->Count; K++ )
+	    {
+		if( pReg->pEntries[K].Sequence < Mark &&
+		    (Victim < 0 || pReg->pEntries[K].Sequence <
+		                   pReg->pEntries[Victim].Sequence) )
+		    Victim = K;
+	    }
+	}
+	if( Victim < 0 )
+	{
+	    pthread_mutex_unlock( &(pReg->Lock) );
+	    break;
+	}
+
+	/* The entry is dropped even if PAN no longer knows the name. */
+	Name = pReg->pEntries[Victim].Name;
+	pReg->pEntries[Victim].Name = NULL;
+	RemoveEntry( pReg, Victim );
+	pthread_mutex_unlock( &(pReg->Lock) );
+
+	PanCounterPanEnter();
+	(Session->Entry.MemWaveformDeleteByName)( Name );
+	PanCounterPanLeave();
+
+	free( Name );
+	Evicted++;
+    }
+
+    return( Evicted );
+}
+
+
+
+
+int PanMemRegSelect( const PanSession *Session, const char *Pattern,
+                     int Regex, char ***pppNames )
+{
+    PanMemRegistry *pReg = RegistryOf( Session );
+    char **ppNames;
+    regex_t Compiled;
+    int K, Count = 0;
+
+    *pppNames = NULL;
+    if( ! pReg )
+	return( -1 );
+
+    if( Regex && regcomp( &Compiled, Pattern, REG_EXTENDED | REG_NOSUB ) )
+	return( -1 );
+
+    pthread_mutex_lock( &(pReg->Lock) );
+    Sync( pReg, Session );
+
+    ppNames = malloc( (pReg->Count ? pReg->Count : 1) * sizeof( char * ) );
+    for( K = 0; ppNames && K < pReg->Count; K++ )
+    {
+	const char *Name = pReg->pEntries[K].Name;
+
+	if( Regex ? regexec( &Compiled, Name, 0, NULL, 0 ) :
+	            fnmatch( Pattern, Name, 0 ) )
+	    continue;
+
+	if( ! (ppNames[ Count ] = strdup( Name )) )
+	{
+	    PanMemRegFreeNames( ppNames, Count );
+	    ppNames = NULL;
+	    break;
+	}
+	Count++;
+    }
+
+    pthread_mutex_unlock( &(pReg->Lock) );
+
+    if( Regex )
+	regfree( &Compiled );
+    if( ! ppNames )
+	return( -1 );
+
+    *pppNames = ppNames;
+
+    return( Count );
+}
+
+
+
+
+void PanMemRegFreeNames( char **ppNames, int Count )
+{
+    int K;
+
+    for( K = 0; K < Count; K++ )
+	free( ppNames[K] );
+    free( ppNames );
+}
+
+
+
+
+static int BySequence( const void *pA, const void *pB )
+{
+    const PanMemRegEntry *A = pA, *B = pB;
+
+    return( A->Sequence < B->Sequence ? -1 : A->Sequence > B->Sequence );
+}
+
+
+
+
+int PanMemRegList( const PanSession *Session, PanMemRegEntry **ppEntries,
+                   uint64_t *pTotal, uint64_t *pBudget )
+{
+    PanMemRegistry *pReg = RegistryOf( Session );
+    PanMemRegEntry *pEntries;
+    int K, Count;
+
+    *ppEntries = NULL;
+    if( ! pReg )
+	return( -1 );
+
+    pthread_mutex_lock( &(pReg->Lock) );
+    Sync( pReg, Session );
+
+    Count = pReg->Count;
+    pEntries = malloc( (Count ? Count : 1) * sizeof( PanMemRegEntry ) );
+    for( K = 0; pEntries && K < Count; K++ )
+    {
+	pEntries[K] = pReg->pEntries[K];
+	if( ! (pEntries[K].Name = strdup( pReg->pEntries[K].Name )) )
+	{
+	    PanMemRegFreeEntries( pEntries, K );
+	    pEntries = NULL;
+	}
+    }
+    *pTotal = pReg->Total;
+    *pBudget = pReg->Budget;
+
+    pthread_mutex_unlock( &(pReg->Lock) );
+
+    if( ! pEntries )
+	return( -1 );
+
+    qsort( pEntries, Count, sizeof( PanMemRegEntry ), BySequence );
+    *ppEntries = pEntries;
+
+    return( Count );
+}
+
+
+
+
+void PanMemRegFreeEntries( PanMemRegEntry *pEntries, int Count )
+{
+    int K;
+
+    for( K = 0; K < Count; K++ )
+	free( pEntries[K].Name );
+    free( pEntries );
+}
+
+
+
+
+void PanMemRegSetBudget( uint64_t Budget )
+{
+    PanMemRegistry *pReg = PanMemRegGet();
+
+    if( ! pReg )
+	return;
+
+    pthread_mutex_lock( &(pReg->Lock) );
+    pReg->Budget = Budget;
+    pthread_mutex_unlock( &(pReg->Lock) );
+}
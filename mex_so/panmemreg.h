@@ -0,0 +1,91 @@
+#ifndef PAN_MEMREG_H
+#define PAN_MEMREG_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "pansession.h"
+
+/*
+ * PAN can not enumerate its memwaveforms: the gateways record in a shared
+ * registry every memwaveform they fetch (panget, panslice, pandownsample)
+ * or that is registered with panmemwav, together with its size and the
+ * time of its last fetch. The address of the registry is published in
+ * this environment variable, as done for PAN_MAT_STATS.
+ */
+#define PAN_MAT_MEMWAV_ENV   "PAN_MAT_MEMWAV"
+
+#define PAN_MEMREG_REAL      0
+#define PAN_MEMREG_COMPLEX   1
+#define PAN_MEMREG_STRING    2
+
+typedef struct
+{
+    char     *Name;
+    int       Rows, Cols, Type;
+    uint64_t  Bytes;
+    uint64_t  LastUse;     /* PanCounterNow() of the last fetch */
+    uint64_t  Sequence;    /* order of the last fetch */
+} PanMemRegEntry;
+
+/*
+ * The entries belong to the netlist of Generation: they are dropped when
+ * pannet loads panMat.so again. Budget is 0 when there is no limit.
+ *
+ * The registry published in PAN_MAT_MEMWAV_ENV is the one of the default
+ * session; every named session has its own (pMemReg), with no budget.
+ */
+typedef struct
+{
+    pthread_mutex_t  Lock;
+    unsigned long    Generation;
+    uint64_t         Budget;
+    uint64_t         Total;
+    uint64_t         Sequence;
+    int              Count, Size;
+    PanMemRegEntry  *pEntries;
+} PanMemRegistry;
+
+/* The shared registry: NULL only if it can not be allocated. */
+PanMemRegistry *PanMemRegGet( void );
+
+/*
+ * Sequence number of the next fetch. The memwaveforms fetched from then
+ * on are never evicted by PanMemRegEvict( Session, Mark ).
+ */
+uint64_t PanMemRegMark( const PanSession *Session );
+
+/* Record a memwaveform just returned by PanMemWaveformGet. */
+void PanMemRegTouch( const PanSession *Session, const MemWaveform *pWav );
+
+/* Drop the entry of Name, if any. */
+void PanMemRegForget( const PanSession *Session, const char *Name );
+
+/*
+ * While the registered memwaveforms exceed the budget, delete from PAN the
+ * least recently fetched one, among those fetched before Mark. Return the
+ * number of memwaveforms deleted.
+ */
+int PanMemRegEvict( const PanSession *Session, uint64_t Mark );
+
+/*
+ * Names of the registered memwaveforms that match Pattern, a glob or an
+ * extended regular expression, in *pppNames (to be released with
+ * PanMemRegFreeNames). Return their number, -1 if Pattern is not a valid
+ * regular expression or memory is exhausted.
+ */
+int  PanMemRegSelect( const PanSession *Session, const char *Pattern,
+                      int Regex, char ***pppNames );
+void PanMemRegFreeNames( char **ppNames, int Count );
+
+/*
+ * A copy of the entries, least recently fetched first, to be released with
+ * PanMemRegFreeEntries. Return their number, -1 if memory is exhausted.
+ */
+int  PanMemRegList( const PanSession *Session, PanMemRegEntry **ppEntries,
+                    uint64_t *pTotal, uint64_t *pBudget );
+void PanMemRegFreeEntries( PanMemRegEntry *pEntries, int Count );
+
+/* Set the budget of the default session in bytes, 0 for no limit. */
+void PanMemRegSetBudget( uint64_t Budget );
+
+#endif
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+#include "panmemreg.h"
+
+#define PANMEMWAV_USAGE \
+    "Usage: S = panmemwav('list'), U = panmemwav('usage'), " \
+    "panmemwav('budget', BYTES) or MISSING = panmemwav('register', NAMES)"
+
+static const char *ListFields[] =
+    { "name", "rows", "cols", "type", "bytes", "age" };
+
+static const char *TypeNames[] = { "real", "complex", "string" };
+
+
+
+
+/* The registered memwaveforms, least recently fetched first. */
+static mxArray *MemWavList( PanSession *Session )
+{
+    PanMemRegEntry *pEntries;
+    uint64_t Total, Budget, Now = PanCounterNow();
+    mxArray *pStruct;
+    int Count, K;
+
+    Count = PanMemRegList( Session, &pEntries, &Total, &Budget );
+    if( Count < 0 )
+	mexErrMsgTxt( "No more memory.\n" );
+
+    pStruct = mxCreateStructMatrix( Count, 1, 6, ListFields );
+
+    for( K = 0; K < Count; K++ )
+    {
+	PanMemRegEntry *pEntry = pEntries + K;
+
+	mxSetField( pStruct, K, "name", mxCreateString( pEntry->Name ) );
+	mxSetField( pStruct, K, "rows",
+	            mxCreateDoubleScalar( (double) pEntry->Rows ) );
+	mxSetField( pStruct, K, "cols",
+	            mxCreateDoubleScalar( (double) pEntry->Cols ) );
+	mxSetField( pStruct, K, "type",
+	            mxCreateString( TypeNames[ pEntry->Type ] ) );
+	mxSetField( pStruct, K, "bytes",
+	            mxCreateDoubleScalar( (double) pEntry->Bytes ) );
+	mxSetField( pStruct, K, "age", mxCreateDoubleScalar(
+	            1e-9 * (double) (Now - pEntry->LastUse) ) );
+    }
+
+    PanMemRegFreeEntries( pEntries, Count );
+
+    return( pStruct );
+}
+
+
+
+
+/* [TOTAL, BUDGET] in bytes, BUDGET is Inf when there is no limit. */
+static mxArray *MemWavUsage( PanSession *Session )
+{
+    PanMemRegEntry *pEntries;
+    uint64_t Total, Budget;
+    mxArray *pUsage;
+    int Count;
+
+    Count = PanMemRegList( Session, &pEntries, &Total, &Budget );
+    if( Count < 0 )
+	mexErrMsgTxt( "No more memory.\n" );
+    PanMemRegFreeEntries( pEntries, Count );
+
+    pUsage = mxCreateDoubleMatrix( 1, 2, mxREAL );
+    mxGetDoubles( pUsage )[0] = (double) Total;
+    mxGetDoubles( pUsage )[1] = Budget ? (double) Budget : mxGetInf();
+
+    return( pUsage );
+}
+
+
+
+
+/* Set the budget and evict at once: the number of deleted memwaveforms. */
+static mxArray *MemWavBudget( PanSession *Session, const mxArray *pBytes )
+{
+    double Bytes;
+
+    if( ! mxIsNumeric( pBytes ) || 1 != mxGetNumberOfElements( pBytes ) ||
+        mxIsComplex( pBytes ) || ! ((Bytes = mxGetScalar( pBytes )) >= 0) )
+    {
+	mexErrMsgTxt( "Error: BYTES must be a non negative scalar. "
+	              PANMEMWAV_USAGE );
+	return( NULL );
+    }
+
+    PanMemRegSetBudget( isinf( Bytes ) ? 0 : (uint64_t) ceil( Bytes ) );
+
+    return( mxCreateDoubleScalar( (double)
+            PanMemRegEvict( Session, UINT64_MAX ) ) );
+}
+
+
+
+
+/*
+ * Register memwaveforms created by the MPan* wrappers without being
+ * fetched: a logical flag per name marks the missing ones.
+ */
+static mxArray *MemWavRegister( PanSession *Session, const mxArray *pNames )
+{
+    mxArray *pCellNames = NULL, *pMissing;
+    mxLogical *pFlags;
+    uint64_t Mark = PanMemRegMark( Session );
+    size_t N, K;
+
+    if( mxIsChar( pNames ) )
+    {
+	pCellNames = mxCreateCellMatrix( 1, 1 );
+	mxSetCell( pCellNames, 0, mxDuplicateArray( pNames ) );
+	pNames = pCellNames;
+    }
+    else if( mxIsClass( pNames, "string" ) )
+    {
+	if( mexCallMATLAB( 1, &pCellNames, 1, (mxArray **) &pNames,
+	                   "cellstr" ) )
+	{
+	    mexErrMsgTxt( "Error: unable to convert the memwaveform names." );
+	    return( NULL );
+	}
+	pNames = pCellNames;
+    }
+    if( ! mxIsCell( pNames ) )
+    {
+	mexErrMsgTxt( "Error: NAMES must be a string or a cell array of "
+	              "strings. " PANMEMWAV_USAGE );
+	return( NULL );
+    }
+
+    N = mxGetNumberOfElements( pNames );
+    pMissing = mxCreateLogicalMatrix( 1, N );
+    pFlags = mxGetLogicals( pMissing );
+
+    for( K = 0; K < N; K++ )
+    {
+	const mxArray *pName = mxGetCell( pNames, K );
+	MemWaveform Wav;
+
+	if( NULL == pName || ! mxIsChar( pName ) ||
+	    NULL == (Wav.Name = mxArrayToString( pName )) )
+	{
+	    pFlags[K] = 1;
+	    continue;
+	}
+
+	if( PanMemWaveformGet( Session, &Wav ) )
+	    PanMemRegTouch( Session, &Wav );
+	else
+	    pFlags[K] = 1;
+
+	mxFree( Wav.Name );
+    }
+
+    PanMemRegEvict( Session, Mark );
+
+    if( pCellNames )
+	mxDestroyArray( pCellNames );
+
+    return( pMissing );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    PanSession *Session;
+    char Mode[ 12 ];
+    int Status;
+
+    if( nrhs < 1 || nrhs > 2 || ! mxIsChar( prhs[0] ) ||
+        mxGetString( prhs[0], Mode, sizeof(Mode) ) )
+    {
+	mexErrMsgTxt( "Error: the allowed modes are 'list', 'usage', "
+	              "'budget' and 'register'. " PANMEMWAV_USAGE );
+	return;
+    }
+    if( nlhs > 1 )
+    {
+	mexErrMsgTxt( "Error: at most one output variable is allowed. "
+	              PANMEMWAV_USAGE );
+	return;
+    }
+
+    PanCounterBegin( PAN_COUNTER_PANMEMWAV );
+
+    if( (Status = PanSessionAttach( &Session )) )
+    {
+	PanSessionErrMsg( Status, NULL );
+	return;
+    }
+
+    if( ! Session->Entry.PanMatlabGet )
+    {
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabGet" );
+	return;
+    }
+
+    if( ! strcasecmp( Mode, "list" ) && 1 == nrhs )
+	plhs[0] = MemWavList( Session );
+    else if( ! strcasecmp( Mode, "usage" ) && 1 == nrhs )
+	plhs[0] = MemWavUsage( Session );
+    else if( ! strcasecmp( Mode, "budget" ) && 2 == nrhs )
+    {
+	if( ! Session->Entry.MemWaveformDeleteByName )
+	{
+	    PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "MemWaveformDeleteByName" );
+	    return;
+	}
+	plhs[0] = MemWavBudget( Session, prhs[1] );
+    }
+    else if( ! strcasecmp( Mode, "register" ) && 2 == nrhs )
+	plhs[0] = MemWavRegister( Session, prhs[1] );
+    else
+    {
+	mexErrMsgTxt( "Error: wrong arguments. " PANMEMWAV_USAGE );
+	return;
+    }
+
+    PanCounterEnd( Mode );
+}
@@ -2,249 +2,598 @@
 #include <dlfcn.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <errno.h>
 #include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+#include "panconsole.h"
 
 #define MEX_ERROR_BUFFER_SIZE 1000
-#define PAN_MAT_SHL_NAME      "panMat.so"
 
-static void *Module = (void *) 0;
+#define PANNET_USAGE \
+    "Usage: [error, reused] = pannet('command line'[, 'reuse']" \
+    "[, 'session', NAME]), NAMES = pannet('-sessions') or " \
+    "pannet('-close', 'session', NAME). With 'reuse', a netlist unchanged " \
+    "since it was loaded without errors is not loaded again: its circuit " \
+    "keeps the parameters and the analysis state left by the previous " \
+    "commands, and its analyses are not run again."
 
-static void *GetEntry( char *Path, void *Module, const char *EntryName )
+/* Deepest chain of include files followed by the netlist fingerprint. */
+#define FINGERPRINT_MAX_DEPTH  16
+
+#define FNV_OFFSET  UINT64_C(14695981039346656037)
+#define FNV_PRIME   UINT64_C(1099511628211)
+
+/*
+ * Arguments given to MatlabPanInit. The simulator may keep pointers to
+ * them (the netlist name, the raw directory, ...): they are released only
+ * when the module they were given to has been unloaded, that is at the
+ * next load of the same session.
+ *
+ * LastFingerprint is the fingerprint of the last netlist loaded without
+ * errors: the command line and the contents of the netlist, of its
+ * include files and of the Verilog-A sources it references.
+ */
+typedef struct
+{
+    char     *ArgBuffer;
+    char    **ppArgs;
+    int       ArgCount;
+    uint64_t  LastFingerprint;
+    int       LastValid;
+} NetArgs;
+
+/* Indexed by the session: 0 is the default one. */
+static NetArgs Nets[ PAN_SESSION_MAX_NAMED + 1 ];
+
+
+
+
+static uint64_t HashBytes( uint64_t Hash, const void *pData, size_t Size )
 {
-    void (*Entry)();
-    Entry = dlsym( Module, EntryName );
-    if( ! Entry )
+    const unsigned char *pByte = (const unsigned char *) pData;
+
+    while( Size-- )
     {
-	dlclose( Module );
+	Hash ^= *pByte++;
+	Hash *= FNV_PRIME;
+    }
 
-	int Count, Length;
-	char *MexErrBuffer;
-	char *Format = "The <%s> evaluate routine is not found in <%s> shared "
-	               "module.\n";
+    return( Hash );
+}
 
-	Length = strlen( Path ) + strlen( EntryName ) + 100;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
-	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return( 0 );
-	}
 
-	Count = sprintf( MexErrBuffer, Format, EntryName, Path );
-	if( Count >= Length )
-	    abort();
 
-	mexErrMsgTxt( MexErrBuffer );
-	return( 0 );
+
+/*
+ * Return the file name that follows pText, either quoted or up to the next
+ * blank, in a malloc'd string; NULL if there is none.
+ */
+static char *FileNameGet( const char *pText )
+{
+    const char *pEnd;
+    char *Name, Quote = 0;
+
+    while( *pText == ' ' || *pText == '\t' )
+	pText++;
+    if( *pText == '"' || *pText == '\'' || *pText == '<' )
+	Quote = *pText == '<' ? '>' : *pText++;
+
+    for( pEnd = pText; *pEnd && *pEnd != '\n' && *pEnd != '\r'; pEnd++ )
+    {
+	if( Quote ? *pEnd == Quote : (*pEnd == ' ' || *pEnd == '\t') )
+	    break;
+    }
+    if( pEnd == pText )
+	return( NULL );
+
+    Name = (char *) malloc( pEnd - pText + 1 );
+    if( Name )
+    {
+	memcpy( Name, pText, pEnd - pText );
+	Name[ pEnd - pText ] = 0;
     }
-    return( Entry );
+
+    return( Name );
 }
 
 
 
 
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+static char *FileRead( const char *Path, size_t *pSize )
 {
-    static void *Module = NULL;
-    size_t  CharNum;
-    int (*Entry)();
-    char *CommandLine;
+    FILE *pFile = fopen( Path, "rb" );
+    char *pData;
+    long Size;
+
+    if( ! pFile )
+	return( NULL );
 
-    if( nrhs != 1 )
+    if( fseek( pFile, 0, SEEK_END ) || (Size = ftell( pFile )) < 0 ||
+        fseek( pFile, 0, SEEK_SET ) )
     {
-	mexErrMsgTxt( "Error: missing filename. Usage: pannet('filename')");
-	return;
+	fclose( pFile );
+	return( NULL );
     }
 
-    if( ! mxIsChar(prhs[0]))
+    pData = (char *) malloc( Size + 1 );
+    if( pData && fread( pData, 1, Size, pFile ) != (size_t) Size )
     {
-        mexErrMsgTxt( "Error: filename must be a string. "
-	              "Usage: pannet('filename')" );
-	return;
+	free( pData );
+	pData = NULL;
     }
-    if( nlhs != 0 )
+    fclose( pFile );
+
+    if( pData )
     {
-	mexErrMsgTxt( "Error: output variable is not required. "
-	              "Usage: pannet('filename')");
-	return;
+	pData[ Size ] = 0;
+	*pSize = Size;
     }
 
-    char *ShlPath = (char *) getenv( "PAN_MAT_SHL_PATH" );
-    char *Path;
+    return( pData );
+}
+
 
-    if( ShlPath )
+
+
+static void FileHash( uint64_t *pHash, const char *Dir, const char *Name,
+                      int Depth );
+
+
+
+
+/*
+ * Follow the files referenced by a netlist or by a Verilog-A source: the
+ * "include" (and ".include", "`include", "#include") lines and the
+ * veriloga="..." model parameters.
+ */
+static void FileHashReferences( uint64_t *pHash, const char *Dir,
+                                const char *pData, int Depth )
+{
+    const char *pLine, *pText;
+    char *Name;
+
+    for( pLine = pData; *pLine; )
     {
-        Path = (char *) malloc( (strlen(ShlPath) + strlen(PAN_MAT_SHL_NAME) + 20) *
-	                        sizeof( char ) );
-	if( ! Path )
+	for( pText = pLine; *pText == ' ' || *pText == '\t'; pText++ );
+	if( *pText == '.' || *pText == '`' || *pText == '#' )
+	    pText++;
+
+	if( ! strncmp( pText, "include", 7 ) &&
+	    (pText[7] == ' ' || pText[7] == '\t' || pText[7] == '"') &&
+	    (Name = FileNameGet( pText + 7 )) )
+	{
+	    FileHash( pHash, Dir, Name, Depth + 1 );
+	    free( Name );
+	}
+
+	for( pText = pLine; *pText && *pText != '\n'; pText++ )
 	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
+	    const char *pValue;
+
+	    if( strncmp( pText, "veriloga", 8 ) )
+		continue;
+
+	    for( pValue = pText + 8; *pValue == ' ' || *pValue == '\t';
+	         pValue++ );
+	    if( *pValue != '=' )
+		continue;
+
+	    if( (Name = FileNameGet( pValue + 1 )) )
+	    {
+		FileHash( pHash, Dir, Name, Depth + 1 );
+		free( Name );
+	    }
 	}
 
-	sprintf( Path, "%s/%s", ShlPath, PAN_MAT_SHL_NAME );
+	pLine = *pText ? pText + 1 : pText;
     }
+}
+
+
+
+
+static void FileHash( uint64_t *pHash, const char *Dir, const char *Name,
+                      int Depth )
+{
+    char *Path, *pData, *pSlash;
+    size_t Size;
+
+    if( Depth > FINGERPRINT_MAX_DEPTH )
+	return;
+
+    Path = (char *) malloc( strlen( Dir ) + strlen( Name ) + 2 );
+    if( ! Path )
+	return;
+    if( Name[0] == '/' || ! *Dir )
+	strcpy( Path, Name );
     else
+	sprintf( Path, "%s/%s", Dir, Name );
+
+    /*
+     * A missing file is hashed by name only: it changes the fingerprint
+     * when it appears.
+     */
+    *pHash = HashBytes( *pHash, Path, strlen( Path ) + 1 );
+
+    pData = FileRead( Path, &Size );
+    if( pData )
     {
-        Path = (char *) malloc((strlen(PAN_MAT_SHL_NAME)+20) * sizeof( char ) );
-	if( ! Path )
-	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
-	}
+	*pHash = HashBytes( *pHash, &Size, sizeof( Size ) );
+	*pHash = HashBytes( *pHash, pData, Size );
 
-	sprintf( Path, "%s", PAN_MAT_SHL_NAME );
+	pSlash = strrchr( Path, '/' );
+	if( pSlash )
+	    *pSlash = 0;
+	else
+	    Path[0] = 0;
+
+	FileHashReferences( pHash, Path, pData, Depth );
+	free( pData );
     }
 
-    if( Module )
-        dlclose( Module );
+    free( Path );
+}
+
+
+
+
+static uint64_t Fingerprint( const NetArgs *pNet, const char *CommandLine )
+{
+    uint64_t Hash = HashBytes( FNV_OFFSET, CommandLine,
+                               strlen( CommandLine ) + 1 );
+
+    /* The netlist is the first argument. */
+    if( pNet->ArgCount > 1 )
+	FileHash( &Hash, "", pNet->ppArgs[1], 0 );
+
+    return( Hash );
+}
+
+
+
+
+/*
+ * Split CommandLine at blanks into ppArgs[1..ArgCount-1]: ppArgs[0] is the
+ * empty program name. The arguments point into a single buffer.
+ */
+static int Tokenise( NetArgs *pNet, const char *CommandLine )
+{
+    size_t Length = strlen( CommandLine );
+    char *pCr, *ArgBuffer, **ppArgs;
+    int Count = 1, Blank = 1, ArgCount = 0;
 
-    Module = dlopen( Path, RTLD_LAZY | RTLD_DEEPBIND | RTLD_GLOBAL );
-    if( ! Module )
+    free( pNet->ppArgs );
+    free( pNet->ArgBuffer );
+    pNet->ppArgs = NULL;
+    pNet->ArgCount = 0;
+
+    ArgBuffer = pNet->ArgBuffer = (char *) malloc( Length + 2 );
+    if( ! ArgBuffer )
+	return( 0 );
+
+    ArgBuffer[0] = 0;
+    strcpy( ArgBuffer + 1, CommandLine );
+
+    for( pCr = ArgBuffer + 1; *pCr; pCr++ )
     {
-	char *String = dlerror();
-	if( String )
+	if( *pCr == ' ' || *pCr == '\t' )
+	    Blank = 1;
+	else if( Blank )
 	{
-	    mexPrintf( "Reason for loading failure is \"%s\"\n", String );
+	    Count++;
+	    Blank = 0;
 	}
+    }
 
-	int Count, Length;
-	char *MexErrBuffer;
-	char *Format = "The <%s> shared library can not be loaded.\n";
+    ppArgs = pNet->ppArgs = (char **) malloc( (Count + 1) * sizeof( char * ) );
+    if( ! ppArgs )
+	return( 0 );
 
-	Length = strlen( Path ) + strlen( Format ) + 10;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
+    ppArgs[ ArgCount++ ] = ArgBuffer;
+
+    for( pCr = ArgBuffer + 1, Blank = 1; *pCr; pCr++ )
+    {
+	if( *pCr == ' ' || *pCr == '\t' )
 	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
+	    *pCr = 0;
+	    Blank = 1;
 	}
-	
-	Count = sprintf( MexErrBuffer, Format, Path );
-	if( Count >= Length )
-	    abort();
+	else if( Blank )
+	{
+	    ppArgs[ ArgCount++ ] = pCr;
+	    Blank = 0;
+	}
+    }
+    ppArgs[ ArgCount ] = NULL;
+    pNet->ArgCount = ArgCount;
 
-	mexErrMsgTxt( MexErrBuffer );
+    return( 1 );
+}
+
+
+
+
+/*
+ * Return the error code of the load, or store it in the MPanerror global
+ * variable when no output is requested.
+ */
+static void NetResult( int nlhs, mxArray *plhs[], int Error, int Reused )
+{
+    if( nlhs > 0 )
+    {
+	plhs[0] = mxCreateDoubleScalar( (double) Error );
+	if( nlhs > 1 )
+	    plhs[1] = mxCreateLogicalScalar( Reused );
 	return;
     }
-/*
-*/
-    if( ! (Entry = GetEntry( Path, Module, "InitialiseGlobals" ) ) )
-        return;
-    (Entry)();
-/*
-*/
-    if( ! (Entry = GetEntry( Path, Module, "MatlabPanInit" ) ) )
-        return;
-/*
-*/
-    free( Path );
 
-    CharNum = mxGetN( prhs[0]);
+    mxArray *pAnaError = mexGetVariable( "global", "MPanerror" );
 
-    CommandLine = mxMalloc( 2 + CharNum );
-    if( NULL == CommandLine )
+    if( pAnaError )
     {
-	mexErrMsgTxt( "No more memory.\n" );
-	return;
+	mwSize Nelem = mxGetNumberOfElements( pAnaError );
+	double *pDoubleData = (double *) mxGetData( pAnaError );
+
+	if( Nelem == 1 )
+	{
+	    pDoubleData[0] = (double) Error;
+	    mexPutVariable( "global", "MPanerror", pAnaError );
+	}
+
+	mxDestroyArray( pAnaError );
     }
+    else if( Error )
+	mexErrMsgTxt( "A severe error blocked the command execution." );
+}
 
-    mxGetString( prhs[0], CommandLine, 1 + CharNum  );
 
-    register char *pCr;
-    char **ppArgs, *pCl;
-    int ArgCount = 1;
 
-    ppArgs = (char **) malloc( sizeof( char * ) );
-    if( ! ppArgs )
+
+/* NAMES = pannet('-sessions'): the named sessions, in a column cell. */
+static void NetSessions( mxArray *plhs[] )
+{
+    char **ppNames;
+    int Count, K;
+
+    Count = PanSessionList( &ppNames );
+
+    plhs[0] = mxCreateCellMatrix( Count, 1 );
+    for( K = 0; K < Count; K++ )
+	mxSetCell( plhs[0], K, mxCreateString( ppNames[K] ) );
+
+    free( ppNames );
+}
+
+
+
+
+/* pannet('-close', 'session', NAME): unload a named session. */
+static void NetClose( const char *Name )
+{
+    PanSession *Session;
+    int Status;
+
+    if( ! *Name )
     {
-	mexErrMsgTxt( "No more memory.\n" );
+	mexErrMsgTxt( "Error: only a named session can be closed. "
+	              PANNET_USAGE );
 	return;
     }
-    ppArgs[0] = (char *) malloc( sizeof( char ) );
-    if( ! ppArgs )
+
+    Status = PanSessionAttachNamed( Name, &Session );
+    if( PAN_SESSION_UNKNOWN == Status || PAN_SESSION_NO_MEMORY == Status )
     {
-	mexErrMsgTxt( "No more memory.\n" );
+	PanSessionErrMsg( Status, Name );
 	return;
     }
-    ppArgs[0] = (char) 0;
-
-    for( pCr = CommandLine; *pCr && (*pCr == ' ' || *pCr == '\t'); pCr++ );
-    pCl = pCr;
 
-    while( *pCr )
+    /*
+     * The arguments of the unloaded module can go, as at a reload. A
+     * session still used by another thread is unloaded by it later on:
+     * its arguments then go at the next load of the slot.
+     */
+    if( ! PanSessionClose( Name ) )
     {
-        if( *pCr == ' ' || *pCr == '\t' )
-	{
-	    *pCr = 0;
+	free( Nets[ Session->Index ].ppArgs );
+	free( Nets[ Session->Index ].ArgBuffer );
+	memset( Nets + Session->Index, 0, sizeof( NetArgs ) );
+    }
+}
 
-	    ppArgs = (char **) realloc( ppArgs, sizeof(char *) * (ArgCount+1) );
-	    if( ! ppArgs )
-	    {
-		mexErrMsgTxt( "No more memory.\n" );
-		return;
-	    }
 
-	    ppArgs[ ArgCount ] = (char *) malloc(sizeof(char)*(strlen(pCl)+10));
-	    if( ! ppArgs[ ArgCount ] )
-	    {
-		mexErrMsgTxt( "No more memory.\n" );
-		return;
-	    }
 
-	    strcpy( ppArgs[ ArgCount ], pCl );
 
-	    ArgCount += 1;
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    PanSession *Session;
+    NetArgs *pNet;
+    size_t  CharNum;
+    int Status, Reuse = 0;
+    char *CommandLine, SessionName[ PAN_SESSION_NAME_SIZE ];
+    uint64_t Hash;
 
-	    for( pCr++; *pCr && (*pCr == ' ' || *pCr == '\t'); pCr++ );
+    if( nrhs < 1 || nrhs > 4 )
+    {
+	mexErrMsgTxt( "Error: missing filename. " PANNET_USAGE );
+	return;
+    }
 
-	    pCl = pCr;
+    if( ! mxIsChar(prhs[0]))
+    {
+        mexErrMsgTxt( "Error: filename must be a string. " PANNET_USAGE );
+	return;
+    }
+    if( (nrhs = PanSessionArgs( nrhs, prhs, SessionName )) < 0 )
+    {
+	mexErrMsgTxt( "Error: the session NAME must be a string of at most "
+	              "63 characters. " PANNET_USAGE );
+	return;
+    }
+    if( 2 == nrhs )
+    {
+	char Mode[ 8 ];
+
+	if( ! mxIsChar( prhs[1] ) || mxGetString( prhs[1], Mode, sizeof(Mode) )
+	    || strcasecmp( Mode, "reuse" ) )
+	{
+	    mexErrMsgTxt( "Error: the only allowed options are 'reuse' and "
+	                  "'session'. " PANNET_USAGE );
+	    return;
 	}
-	else
-	    pCr += 1;
+	Reuse = 1;
+    }
+    else if( nrhs > 2 )
+    {
+	mexErrMsgTxt( "Error: the only allowed options are 'reuse' and "
+	              "'session'. " PANNET_USAGE );
+	return;
+    }
+    if( nlhs > 2 )
+    {
+	mexErrMsgTxt( "Error: at most two output variables are allowed. "
+	              PANNET_USAGE );
+	return;
     }
 
-    if( *pCl )
+    CharNum = mxGetN( prhs[0]);
+
+    CommandLine = mxMalloc( 2 + CharNum );
+    if( NULL == CommandLine )
     {
-	ppArgs = (char **) realloc( ppArgs, sizeof(char *) * (ArgCount+1) );
-	if( ! ppArgs )
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    mxGetString( prhs[0], CommandLine, 1 + CharNum  );
+
+    if( ! strcmp( CommandLine, "-sessions" ) && ! Reuse && ! *SessionName )
+    {
+	NetSessions( plhs );
+	mxFree( CommandLine );
+	return;
+    }
+    if( ! strcmp( CommandLine, "-close" ) && ! Reuse )
+    {
+	NetClose( SessionName );
+	mxFree( CommandLine );
+	return;
+    }
+
+    PanCounterBegin( PAN_COUNTER_PANNET );
+
+    /*
+     * With 'reuse', a netlist whose fingerprint has not changed since it was
+     * loaded without errors is not loaded again. Nothing is reset: the
+     * circuit keeps the state left by the previous analyses (see the usage).
+     */
+    if( Reuse && ! PanSessionAttachNamed( SessionName, &Session ) &&
+        Session->Module && Nets[ Session->Index ].LastValid )
+    {
+	NetArgs Probe;
+
+	/* The arguments of the loaded module stay alive. */
+	memset( &Probe, 0, sizeof( Probe ) );
+	if( ! Tokenise( &Probe, CommandLine ) )
 	{
+	    PanSessionDetach();
+	    PanCounterEnd( CommandLine );
 	    mexErrMsgTxt( "No more memory.\n" );
 	    return;
 	}
+	Hash = Fingerprint( &Probe, CommandLine );
+	free( Probe.ppArgs );
+	free( Probe.ArgBuffer );
 
-	ppArgs[ ArgCount ] = (char *) malloc(sizeof(char)*(strlen(pCl)+10));
-	if( ! ppArgs[ ArgCount ] )
+	if( Hash == Nets[ Session->Index ].LastFingerprint )
 	{
-	    mexErrMsgTxt( "No more memory.\n" );
+	    PanSessionDetach();
+	    PanCounterEnd( CommandLine );
+	    mxFree( CommandLine );
+	    NetResult( nlhs, plhs, 0, 1 );
 	    return;
 	}
+    }
 
-	strcpy( ppArgs[ ArgCount ], pCl );
+    uint64_t Start = PanCounterNow();
 
-	ArgCount += 1;
+    Status = PanSessionLoadNamed( SessionName, &Session );
+    if( ! Status )
+    {
+	pNet = Nets + Session->Index;
+	pNet->LastValid = 0;
+	PanCounterAdd( PAN_COUNTER_DLOPEN, PanCounterNow() - Start, 0,
+	               Session->Path );
     }
+    if( PAN_SESSION_NOT_LOADED == Status )
+    {
+	int Count, Length;
+	char *MexErrBuffer;
+	char *Format = "The <%s> shared library can not be loaded.\n";
 
-    mxFree( CommandLine );
+	Length = strlen( Session->Path ) + strlen( Format ) + 10;
+	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+	if( ! MexErrBuffer )
+	{
+	    mexErrMsgTxt( "No more memory.\n" );
+	    return;
+	}
+	
+	Count = sprintf( MexErrBuffer, Format, Session->Path );
+	if( Count >= Length )
+	    abort();
 
-    int Error = (Entry)( ArgCount, ppArgs );
+	mexErrMsgTxt( MexErrBuffer );
+	return;
+    }
+    else if( PAN_SESSION_NO_ENTRY == Status )
+    {
+	PanSessionErrMsg( Status, Session->Entry.InitialiseGlobals ?
+	                          "MatlabPanInit" : "InitialiseGlobals" );
+	return;
+    }
+    else if( Status )
+    {
+	PanSessionErrMsg( Status, SessionName );
+	return;
+    }
 
-    mxArray *pAnaError = mexGetVariable( "global", "MPanerror" );
+    /* The module prints through this gateway, which must stay loaded. */
+    PanConsoleHook( Session->Module );
+    if( ! mexIsLocked() )
+	mexLock();
 
-    if( pAnaError )
+    PanConsoleBegin();
+    PanCounterPanEnter();
+    (Session->Entry.InitialiseGlobals)();
+    PanCounterPanLeave();
+
+    /* The previous module is gone: so can be its arguments. */
+    if( ! Tokenise( pNet, CommandLine ) )
     {
-	mwSize Nelem = mxGetNumberOfElements( pAnaError );
-	double *pDoubleData = (double *) mxGetData( pAnaError );
+	PanConsoleEnd();
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
 
-	if( Nelem == 1 )
-	{
-	    pDoubleData[0] = (double) Error;
-	    mexPutVariable( "global", "MPanerror", pAnaError );
-	}
+    /* Hashed before PAN writes its log and raw files next to the netlist. */
+    Hash = Fingerprint( pNet, CommandLine );
 
-	mxDestroyArray( pAnaError );
+    PanCounterPanEnter();
+    int Error = (Session->Entry.MatlabPanInit)( pNet->ArgCount, pNet->ppArgs );
+    PanCounterPanLeave();
+    PanConsoleEnd();
+    PanSessionDetach();
+
+    PanCounterEnd( CommandLine );
+    mxFree( CommandLine );
+
+    if( ! Error )
+    {
+	pNet->LastFingerprint = Hash;
+	pNet->LastValid = 1;
     }
-    else if( Error )
-	mexErrMsgTxt( "A severe error blocked the command execution." );
+
+    NetResult( nlhs, plhs, Error, 0 );
 }
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "panprof.h"
+#include "pancounter.h"
+
+/*
+ * Every gateway links its own copy of this file: Block caches the address
+ * of the shared block, Cursor the entry after the last one recorded, since
+ * PAN calls the instances in the same order at every iteration.
+ */
+static PanProfBlock *Block;
+static int Cursor;
+
+
+
+
+PanProfBlock *PanProfGet( void )
+{
+    char *Tag, Buffer[ 32 ];
+    PanProfBlock *pBlock = NULL;
+
+    if( Block )
+	return( Block );
+
+    Tag = getenv( PAN_MAT_PROF_ENV );
+    if( Tag && 1 == sscanf( Tag, "%p", (void **) &pBlock ) && pBlock )
+	return( Block = pBlock );
+
+    pBlock = (PanProfBlock *) calloc( 1, sizeof( PanProfBlock ) );
+    if( ! pBlock )
+	return( NULL );
+
+    pthread_mutex_init( &(pBlock->Lock), NULL );
+    pBlock->Epoch = PanCounterNow();
+
+    sprintf( Buffer, "%p", (void *) pBlock );
+    setenv( PAN_MAT_PROF_ENV, Buffer, 1 );
+
+    return( Block = pBlock );
+}
+
+
+
+
+/* PAN_PROF_SUB buckets per octave; the first octaves are exact. */
+static int ProfBucket( uint64_t Time )
+{
+    int Octave;
+
+    if( Time < PAN_PROF_SUB )
+	return( (int) Time );
+
+    Octave = 63 - __builtin_clzll( Time );
+    if( Octave >= PAN_PROF_BUCKETS / PAN_PROF_SUB )
+	return( PAN_PROF_BUCKETS - 1 );
+
+    return( PAN_PROF_SUB * Octave +
+            (int) ((Time >> (Octave - 2)) & (PAN_PROF_SUB - 1)) );
+}
+
+
+
+
+static double ProfBucketLow( int Bucket )
+{
+    int Octave = Bucket / PAN_PROF_SUB, Sub = Bucket % PAN_PROF_SUB;
+
+    if( Octave < 2 )
+	return( (double) Bucket );
+
+    return( (double) (PAN_PROF_SUB + Sub) * (double) (1ull << (Octave - 2)) );
+}
+
+
+
+
+static int ProfFind( PanProfBlock *pBlock, const char *Model,
+                     const char *Instance )
+{
+    int H, K;
+
+    for( H = 0; H < pBlock->Count; H++ )
+    {
+	K = (Cursor + H) % pBlock->Count;
+	if( ! strcmp( pBlock->pEntries[K].Instance, Instance ) &&
+	    ! strcmp( pBlock->pEntries[K].Model, Model ) )
+	    return( K );
+    }
+
+    if( pBlock->Count == pBlock->Size )
+    {
+	int Size = pBlock->Size ? 2 * pBlock->Size : 64;
+	PanProfEntry *pEntries = realloc( pBlock->pEntries,
+	                                  Size * sizeof( PanProfEntry ) );
+
+	if( ! pEntries )
+	    return( -1 );
+	pBlock->pEntries = pEntries;
+	pBlock->Size = Size;
+    }
+
+    K = pBlock->Count++;
+    memset( pBlock->pEntries + K, 0, sizeof( PanProfEntry ) );
+    snprintf( pBlock->pEntries[K].Model, PAN_PROF_NAME_SIZE, "%s", Model );
+    snprintf( pBlock->pEntries[K].Instance, PAN_PROF_LABEL_SIZE, "%s",
+              Instance );
+
+    return( K );
+}
+
+
+
+
+void PanProfRecord( const char *Model, const char *Instance, int Weight,
+                    uint64_t Time, uint64_t EvalTime, int Hit )
+{
+    PanProfBlock *pBlock = PanProfGet();
+    PanProfEntry *pEntry;
+    int K;
+
+    if( ! pBlock )
+	return;
+
+    pthread_mutex_lock( &(pBlock->Lock) );
+
+    if( (K = ProfFind( pBlock, Model, Instance )) >= 0 )
+    {
+	pEntry = pBlock->pEntries + K;
+	pEntry->Samples++;
+	pEntry->Calls += Weight;
+	if( Hit )
+	    pEntry->Hits += Weight;
+	pEntry->Time += Weight * Time;
+	pEntry->EvalTime += Weight * EvalTime;
+	pEntry->Histogram[ ProfBucket( Time ) ]++;
+	Cursor = (K + 1) % pBlock->Count;
+    }
+
+    pthread_mutex_unlock( &(pBlock->Lock) );
+}
+
+
+
+
+int PanProfList( PanProfEntry **ppEntries )
+{
+    PanProfBlock *pBlock = PanProfGet();
+    int Count;
+
+    *ppEntries = NULL;
+    if( ! pBlock )
+	return( -1 );
+
+    pthread_mutex_lock( &(pBlock->Lock) );
+
+    Count = pBlock->Count;
+    *ppEntries = malloc( (Count ? Count : 1) * sizeof( PanProfEntry ) );
+    if( *ppEntries && Count )
+	memcpy( *ppEntries, pBlock->pEntries, Count * sizeof( PanProfEntry ) );
+
+    pthread_mutex_unlock( &(pBlock->Lock) );
+
+    return( *ppEntries ? Count : -1 );
+}
+
+
+
+
+double PanProfPercentile( const PanProfEntry *pEntry, double P )
+{
+    uint64_t Sum = 0, Target;
+    int K;
+
+    if( 0 == pEntry->Samples )
+	return( 0.0 );
+
+    Target = (uint64_t) (P * (double) pEntry->Samples);
+    if( Target >= pEntry->Samples )
+	Target = pEntry->Samples - 1;
+
+    /* The centre of the bucket of the sample of rank Target. */
+    for( K = 0; K < PAN_PROF_BUCKETS - 1; K++ )
+    {
+	Sum += pEntry->Histogram[K];
+	if( Sum > Target )
+	    break;
+    }
+
+    return( 0.5 * (ProfBucketLow( K ) + ProfBucketLow( K + 1 )) );
+}
+
+
+
+
+void PanProfReset( void )
+{
+    PanProfBlock *pBlock = PanProfGet();
+
+    if( ! pBlock )
+	return;
+
+    pthread_mutex_lock( &(pBlock->Lock) );
+    pBlock->Count = 0;
+    pBlock->Epoch = PanCounterNow();
+    Cursor = 0;
+    pthread_mutex_unlock( &(pBlock->Lock) );
+}
+
+
+
+
+void PanProfSetPeriod( int Period )
+{
+    PanProfBlock *pBlock = PanProfGet();
+
+    if( pBlock )
+	pBlock->Period = Period > 0 ? Period : 0;
+}
@@ -0,0 +1,76 @@
+#ifndef PAN_PROF_H
+#define PAN_PROF_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Profile of the macro device callbacks (evaluate=MACRO) served by the
+ * gateways built from panmacro.c. Every MACRO MEX file records its calls
+ * in this block, whose address is published in an environment variable
+ * as done for PAN_MAT_STATS.
+ *
+ * Only one call every Period is timed: a timed call stands for Period
+ * calls, so Calls and the times are estimates unless Period is 1. The
+ * latencies of the timed calls are kept in a histogram with
+ * PAN_PROF_SUB buckets per octave, from which the percentiles are read.
+ */
+#define PAN_MAT_PROF_ENV      "PAN_MAT_PROF"
+
+#define PAN_PROF_NAME_SIZE    32
+#define PAN_PROF_LABEL_SIZE   48
+#define PAN_PROF_SUB          4
+#define PAN_PROF_BUCKETS      (40 * PAN_PROF_SUB)
+
+typedef struct
+{
+    char      Model[ PAN_PROF_NAME_SIZE ];
+    char      Instance[ PAN_PROF_LABEL_SIZE ];
+    uint64_t  Samples;
+    uint64_t  Calls, Hits;          /* estimated: weighted by the period */
+    uint64_t  Time;                 /* ns spent in the gateway */
+    uint64_t  EvalTime;             /* ns spent evaluating the macro */
+    uint32_t  Histogram[ PAN_PROF_BUCKETS ];
+} PanProfEntry;
+
+typedef struct
+{
+    pthread_mutex_t  Lock;
+    volatile int     Period;        /* 0 when profiling is off */
+    uint64_t         Epoch;
+    int              Count, Size;
+    PanProfEntry    *pEntries;
+} PanProfBlock;
+
+/* The shared block: NULL only if it can not be allocated. */
+PanProfBlock *PanProfGet( void );
+
+/* The sampling period, 0 if profiling is off. */
+static inline int PanProfPeriod( void )
+{
+    PanProfBlock *pBlock = PanProfGet();
+
+    return( pBlock ? pBlock->Period : 0 );
+}
+
+/*
+ * Record a timed call of Instance of Model (the instance may be "") that
+ * stands for Weight calls. Time is the whole call, EvalTime the part spent
+ * in the kernel or in the interpreted macro; Hit flags a bypassed call.
+ */
+void PanProfRecord( const char *Model, const char *Instance, int Weight,
+                    uint64_t Time, uint64_t EvalTime, int Hit );
+
+/*
+ * A copy of the entries, to be released with free(): their number, -1 if
+ * memory is exhausted.
+ */
+int  PanProfList( PanProfEntry **ppEntries );
+
+/* The latency in ns below which a fraction P of the samples of pEntry lie. */
+double PanProfPercentile( const PanProfEntry *pEntry, double P );
+
+void PanProfReset( void );
+void PanProfSetPeriod( int Period );
+
+#endif
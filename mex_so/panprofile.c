@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "mex.h"
+#include "panprof.h"
+
+#define PANPROFILE_USAGE \
+    "Usage: S = panprofile(), panprofile('on'[, PERIOD]), " \
+    "panprofile('off'), panprofile('reset') or PERIOD = panprofile('period')"
+
+static const char *ProfileFields[] =
+    { "model", "instance", "samples", "calls", "hits", "time", "eval_time",
+      "marshal_time", "p50", "p90", "p99" };
+
+#define PROFILE_VALUES  9
+
+
+
+
+/* One row per instance of every macro model; times are in seconds. */
+static mxArray *ProfileTable( void )
+{
+    mxArray *pStruct = mxCreateStructMatrix( 1, 1, 11, ProfileFields );
+    mxArray *pModels, *pInstances, *pValues[ PROFILE_VALUES ];
+    PanProfEntry *pEntries;
+    double *pV[ PROFILE_VALUES ];
+    int Count, K, H;
+
+    if( (Count = PanProfList( &pEntries )) < 0 )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return( NULL );
+    }
+
+    pModels = mxCreateCellMatrix( Count, 1 );
+    pInstances = mxCreateCellMatrix( Count, 1 );
+    for( H = 0; H < PROFILE_VALUES; H++ )
+    {
+	pValues[H] = mxCreateDoubleMatrix( Count, 1, mxREAL );
+	pV[H] = mxGetDoubles( pValues[H] );
+    }
+
+    for( K = 0; K < Count; K++ )
+    {
+	PanProfEntry *pEntry = pEntries + K;
+
+	mxSetCell( pModels, K, mxCreateString( pEntry->Model ) );
+	mxSetCell( pInstances, K, mxCreateString( pEntry->Instance ) );
+	pV[0][K] = (double) pEntry->Samples;
+	pV[1][K] = (double) pEntry->Calls;
+	pV[2][K] = (double) pEntry->Hits;
+	pV[3][K] = 1e-9 * (double) pEntry->Time;
+	pV[4][K] = 1e-9 * (double) pEntry->EvalTime;
+	pV[5][K] = 1e-9 * (double) (pEntry->Time - pEntry->EvalTime);
+	pV[6][K] = 1e-9 * PanProfPercentile( pEntry, 0.50 );
+	pV[7][K] = 1e-9 * PanProfPercentile( pEntry, 0.90 );
+	pV[8][K] = 1e-9 * PanProfPercentile( pEntry, 0.99 );
+    }
+    free( pEntries );
+
+    mxSetField( pStruct, 0, "model", pModels );
+    mxSetField( pStruct, 0, "instance", pInstances );
+    for( H = 0; H < PROFILE_VALUES; H++ )
+	mxSetField( pStruct, 0, ProfileFields[ H + 2 ], pValues[H] );
+
+    return( pStruct );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    char Mode[ 8 ];
+
+    if( ! PanProfGet() )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+    if( nlhs > 1 )
+    {
+	mexErrMsgTxt( "Error: at most one output variable is allowed. "
+	              PANPROFILE_USAGE );
+	return;
+    }
+
+    if( 0 == nrhs )
+    {
+	plhs[0] = ProfileTable();
+	return;
+    }
+
+    if( nrhs > 2 || ! mxIsChar( prhs[0] ) ||
+        mxGetString( prhs[0], Mode, sizeof(Mode) ) )
+    {
+	mexErrMsgTxt( "Error: the allowed modes are 'on', 'off', 'reset' and "
+	              "'period'. " PANPROFILE_USAGE );
+	return;
+    }
+
+    if( ! strcasecmp( Mode, "on" ) )
+    {
+	double Period = 1;
+
+	if( 2 == nrhs )
+	{
+	    if( ! mxIsNumeric( prhs[1] ) ||
+	        1 != mxGetNumberOfElements( prhs[1] ) ||
+		! ((Period = mxGetScalar( prhs[1] )) >= 1) || Period > 1e9 )
+	    {
+		mexErrMsgTxt( "Error: PERIOD must be a positive integer. "
+		              PANPROFILE_USAGE );
+		return;
+	    }
+	}
+	PanProfSetPeriod( (int) Period );
+    }
+    else if( ! strcasecmp( Mode, "off" ) && 1 == nrhs )
+	PanProfSetPeriod( 0 );
+    else if( ! strcasecmp( Mode, "reset" ) && 1 == nrhs )
+	PanProfReset();
+    else if( ! strcasecmp( Mode, "period" ) && 1 == nrhs )
+	plhs[0] = mxCreateDoubleScalar( (double) PanProfPeriod() );
+    else
+	mexErrMsgTxt( "Error: wrong arguments. " PANPROFILE_USAGE );
+}
@@ -0,0 +1,96 @@
+#include <string.h>
+#include <strings.h>
+#include "panquant.h"
+
+
+
+
+int PanClassParse( const char *Name )
+{
+    if( ! strcasecmp( Name, "double" ) )
+	return( PAN_CLASS_DOUBLE );
+    if( ! strcasecmp( Name, "single" ) )
+	return( PAN_CLASS_SINGLE );
+    if( ! strcasecmp( Name, "int16" ) )
+	return( PAN_CLASS_INT16 );
+
+    return( -1 );
+}
+
+
+
+
+void PanQuantRangeInit( PanQuantRange *pRange )
+{
+    pRange->Min = HUGE_VAL;
+    pRange->Max = -HUGE_VAL;
+}
+
+
+
+
+void PanQuantRangeMerge( PanQuantRange *pDst, const PanQuantRange *pSrc )
+{
+    if( pSrc->Min < pDst->Min )
+	pDst->Min = pSrc->Min;
+    if( pSrc->Max > pDst->Max )
+	pDst->Max = pSrc->Max;
+}
+
+
+
+
+void PanQuantParams( const PanQuantRange *pRange, double *pScale,
+                     double *pOffset )
+{
+    *pScale = 1.0;
+
+    if( pRange->Min > pRange->Max )
+    {
+	*pOffset = 0.0;
+	return;
+    }
+
+    /* Halved first: Max - Min may overflow. */
+    *pOffset = pRange->Min / 2 + pRange->Max / 2;
+    if( pRange->Max > pRange->Min )
+	*pScale = (pRange->Max / 2 - pRange->Min / 2) / PAN_QUANT_MAX;
+    if( 0.0 == *pScale )
+	*pScale = 1.0;
+}
+
+
+
+
+void PanConvertSingle( float *pDst, const double *pSrc, size_t N )
+{
+    register size_t I;
+
+    for( I = 0; I < N; I++ )
+	pDst[I] = (float) pSrc[I];
+}
+
+
+
+
+void PanQuantRangeVector( PanQuantRange *pRange, const double *pSrc,
+                          size_t N )
+{
+    register size_t I;
+
+    for( I = 0; I < N; I++ )
+	PanQuantRangeAdd( pRange, pSrc[I] );
+}
+
+
+
+
+void PanQuantizeVector( int16_t *pDst, const double *pSrc, size_t N,
+                        double Scale, double Offset )
+{
+    double InvScale = 1.0 / Scale;
+    register size_t I;
+
+    for( I = 0; I < N; I++ )
+	pDst[I] = PanQuantize( pSrc[I], InvScale, Offset );
+}
@@ -0,0 +1,83 @@
+#ifndef PAN_QUANT_H
+#define PAN_QUANT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+/*
+ * Output classes of panget and panrawread. Samples are converted by the
+ * copy kernels while they are gathered: no double copy of the output is
+ * ever made.
+ *
+ * With PAN_CLASS_INT16 every real column is stored as Q, with
+ * Y ~ double(Q) * SCALE + OFFSET. OFFSET is the centre of the range of the
+ * finite samples of the column and SCALE its half width divided by
+ * PAN_QUANT_MAX, so that the error is at most SCALE / 2. NaN samples are
+ * stored as PAN_QUANT_NAN, infinite ones saturate to +-PAN_QUANT_MAX.
+ */
+#define PAN_CLASS_DOUBLE  0
+#define PAN_CLASS_SINGLE  1
+#define PAN_CLASS_INT16   2
+
+#define PAN_QUANT_MAX     32767
+#define PAN_QUANT_NAN     (-32768)
+
+typedef struct
+{
+    double Min, Max;
+} PanQuantRange;
+
+/* The class named Name ("double", "single" or "int16"), -1 if unknown. */
+int PanClassParse( const char *Name );
+
+/* An empty range: Min > Max until a finite sample is added. */
+void PanQuantRangeInit( PanQuantRange *pRange );
+
+static inline void PanQuantRangeAdd( PanQuantRange *pRange, double Y )
+{
+    if( ! isfinite( Y ) )
+	return;
+    if( Y < pRange->Min )
+	pRange->Min = Y;
+    if( Y > pRange->Max )
+	pRange->Max = Y;
+}
+
+void PanQuantRangeMerge( PanQuantRange *pDst, const PanQuantRange *pSrc );
+
+/*
+ * SCALE and OFFSET of a column. A constant column has SCALE 1 and OFFSET
+ * equal to its value, a column with no finite sample SCALE 1 and OFFSET 0.
+ */
+void PanQuantParams( const PanQuantRange *pRange, double *pScale,
+                     double *pOffset );
+
+static inline int16_t PanQuantize( double Y, double InvScale, double Offset )
+{
+    double Q;
+
+    if( isnan( Y ) )
+	return( PAN_QUANT_NAN );
+
+    Q = (Y - Offset) * InvScale;
+    if( Q >= PAN_QUANT_MAX )
+	return( PAN_QUANT_MAX );
+    if( Q <= -PAN_QUANT_MAX )
+	return( -PAN_QUANT_MAX );
+
+    return( (int16_t) (Q >= 0 ? Q + 0.5 : Q - 0.5) );
+}
+
+/* Convert N doubles to single precision. */
+void PanConvertSingle( float *pDst, const double *pSrc, size_t N );
+
+/* Range of N doubles, added to pRange. */
+void PanQuantRangeVector( PanQuantRange *pRange, const double *pSrc,
+                          size_t N );
+
+/* Quantise N doubles of a column with the given SCALE and OFFSET. */
+void PanQuantizeVector( int16_t *pDst, const double *pSrc, size_t N,
+                        double Scale, double Offset );
+
+#endif
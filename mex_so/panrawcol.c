@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "panrawcol.h"
+
+
+
+
+static const char *HeaderValue( const char *pHeader, const char *pEnd,
+                                const char *Key )
+{
+    size_t Length = strlen( Key );
+    const char *pLine = pHeader;
+
+    while( pLine < pEnd )
+    {
+	if( (size_t) (pEnd - pLine) > Length && ! strncmp( pLine, Key, Length ) )
+	    return( pLine + Length );
+
+	pLine = memchr( pLine, '\n', pEnd - pLine );
+	if( ! pLine )
+	    break;
+	pLine++;
+    }
+
+    return( NULL );
+}
+
+
+
+
+/* Validate the container header that follows the text header. */
+static int ColumnarOpen( PanRawFile *pRaw )
+{
+    PanRawColHeader *pHeader = &(pRaw->Columnar);
+    size_t Available = pRaw->pMap + pRaw->Size - pRaw->pBinary;
+    size_t Size = sizeof( PanRawColHeader );
+    uint64_t Chunks;
+
+    if( ! memcmp( pRaw->pBinary, PAN_RAWCOL_MAGIC_V1, PAN_RAWCOL_MAGIC_SIZE ) )
+	Size = offsetof( PanRawColHeader, SourceMtime );
+
+    if( Available < Size )
+	return( PAN_RAW_EINVALID );
+    memset( pHeader, 0, sizeof( PanRawColHeader ) );
+    memcpy( pHeader, pRaw->pBinary, Size );
+
+    if( pHeader->Codec > PAN_RAWCOL_CODEC_DEFLATE || pHeader->ChunkRows < 1 )
+	return( PAN_RAW_EINVALID );
+
+    Chunks = (pRaw->NumSamples + pHeader->ChunkRows - 1) / pHeader->ChunkRows;
+    if( Chunks != pHeader->NumChunks || pHeader->TableOffset % 8 ||
+        pHeader->TableOffset > pRaw->Size ||
+        (Chunks && (uint64_t) pRaw->NumVar >
+                   (pRaw->Size - pHeader->TableOffset) / Chunks /
+                   sizeof( PanRawColChunk )) )
+	return( PAN_RAW_EINVALID );
+
+    pRaw->pTable = (const PanRawColChunk *) (pRaw->pMap + pHeader->TableOffset);
+
+    return( PAN_RAW_OK );
+}
+
+
+
+
+int PanRawOpen( const char *FileName, PanRawFile *pRaw )
+{
+    struct stat Stat;
+    const char *pBinary, *pValue, *pEnd;
+    int Fd, Status = PAN_RAW_OK;
+
+    memset( pRaw, 0, sizeof( PanRawFile ) );
+
+    Fd = open( FileName, O_RDONLY );
+    if( Fd < 0 || fstat( Fd, &Stat ) || 0 == Stat.st_size )
+    {
+	if( Fd >= 0 )
+	    close( Fd );
+	return( PAN_RAW_EOPEN );
+    }
+
+    pRaw->pMap = mmap( NULL, Stat.st_size, PROT_READ, MAP_PRIVATE, Fd, 0 );
+    close( Fd );
+    if( MAP_FAILED == pRaw->pMap )
+	return( PAN_RAW_EMAP );
+    pRaw->Size = Stat.st_size;
+    pRaw->Mtime = (uint64_t) Stat.st_mtim.tv_sec * 1000000000ull +
+                  Stat.st_mtim.tv_nsec;
+
+    pEnd = pRaw->pMap + pRaw->Size;
+    pBinary = memmem( pRaw->pMap, pRaw->Size, "Binary:", 7 );
+    pRaw->NumVar = -1;
+    pRaw->NumSamples = -1;
+
+    if( pBinary )
+    {
+	if( (pValue = HeaderValue( pRaw->pMap, pBinary, "Flags:" )) )
+	{
+	    while( pValue < pBinary && (' ' == *pValue || '\t' == *pValue) )
+		pValue++;
+	    pRaw->IsComplex = ! strncmp( pValue, "complex", 7 );
+	}
+	if( (pValue = HeaderValue( pRaw->pMap, pBinary, "No. Variables:" )) )
+	    pRaw->NumVar = strtol( pValue, NULL, 10 );
+	if( (pValue = HeaderValue( pRaw->pMap, pBinary, "No. Points:" )) )
+	    pRaw->NumSamples = strtol( pValue, NULL, 10 );
+
+	/* The marker is followed by one separator character. */
+	pBinary += 8;
+    }
+    pRaw->pBinary = pBinary;
+
+    size_t RowBytes = (pRaw->IsComplex ? 2 : 1) * sizeof(double) *
+                      (pRaw->NumVar > 0 ? pRaw->NumVar : 0);
+
+    if( ! pBinary || pRaw->NumVar <= 0 || pRaw->NumSamples < 0 ||
+        pBinary > pEnd )
+	Status = PAN_RAW_EINVALID;
+    else if( (size_t) (pEnd - pBinary) >= PAN_RAWCOL_MAGIC_SIZE &&
+             (! memcmp( pBinary, PAN_RAWCOL_MAGIC, PAN_RAWCOL_MAGIC_SIZE ) ||
+              ! memcmp( pBinary, PAN_RAWCOL_MAGIC_V1, PAN_RAWCOL_MAGIC_SIZE )) )
+	Status = ColumnarOpen( pRaw );
+    else if( RowBytes * pRaw->NumSamples > (size_t) (pEnd - pBinary) )
+	Status = PAN_RAW_EINVALID;
+
+    if( PAN_RAW_OK != Status )
+	PanRawClose( pRaw );
+
+    return( Status );
+}
+
+
+
+
+void PanRawClose( PanRawFile *pRaw )
+{
+    if( pRaw->pMap && MAP_FAILED != pRaw->pMap )
+	munmap( (void *) pRaw->pMap, pRaw->Size );
+    pRaw->pMap = NULL;
+    pRaw->pTable = NULL;
+}
+
+
+
+
+int PanRawColFresh( const char *Source, const char *Companion )
+{
+    struct stat Stat;
+    PanRawFile Raw;
+    int Fresh;
+
+    if( stat( Source, &Stat ) || PAN_RAW_OK != PanRawOpen( Companion, &Raw ) )
+	return( 0 );
+
+    Fresh = Raw.pTable && Raw.Columnar.SourceBytes == (uint64_t) Stat.st_size &&
+            Raw.Columnar.SourceMtime ==
+            (uint64_t) Stat.st_mtim.tv_sec * 1000000000ull + Stat.st_mtim.tv_nsec;
+    PanRawClose( &Raw );
+
+    return( Fresh );
+}
+
+
+
+
+void PanRawDropPages( const char *pBegin, const char *pEnd )
+{
+    long PageSize = sysconf( _SC_PAGESIZE );
+    uintptr_t Begin = ((uintptr_t) pBegin + PageSize - 1) & ~(PageSize - 1);
+    uintptr_t End = (uintptr_t) pEnd & ~(PageSize - 1);
+
+    if( End > Begin )
+	madvise( (void *) Begin, End - Begin, MADV_DONTNEED );
+}
+
+
+
+
+size_t PanRawColChunkRows( const PanRawFile *pRaw, uint64_t K )
+{
+    uint64_t First = K * pRaw->Columnar.ChunkRows;
+
+    if( First >= (uint64_t) pRaw->NumSamples )
+	return( 0 );
+
+    return( (uint64_t) pRaw->NumSamples - First < pRaw->Columnar.ChunkRows ?
+            (uint64_t) pRaw->NumSamples - First : pRaw->Columnar.ChunkRows );
+}
+
+
+
+
+int PanRawColReadChunk( const PanRawFile *pRaw, long Var, uint64_t K,
+                        double *pDst, unsigned char *pScratch )
+{
+    size_t Count = (pRaw->IsComplex ? 2 : 1) * PanRawColChunkRows( pRaw, K );
+    const PanRawColChunk *pChunk = pRaw->pTable +
+                                   (size_t) Var * pRaw->Columnar.NumChunks + K;
+    const char *pSrc = pRaw->pMap + pChunk->Offset;
+
+    if( pChunk->Offset > pRaw->Size ||
+        pChunk->Bytes > pRaw->Size - pChunk->Offset ||
+        PanRawColDecode( (const unsigned char *) pSrc, pChunk->Bytes,
+                         Count, pScratch, pDst ) )
+	return( -1 );
+
+    PanRawDropPages( pSrc, pSrc + pChunk->Bytes );
+
+    return( 0 );
+}
+
+
+
+
+int PanRawColRead( const PanRawFile *pRaw, long Var, double *pDst,
+                   unsigned char *pScratch )
+{
+    size_t Width = pRaw->IsComplex ? 2 : 1;
+    uint64_t K;
+
+    for( K = 0; K < pRaw->Columnar.NumChunks; K++ )
+    {
+	if( PanRawColReadChunk( pRaw, Var, K, pDst, pScratch ) )
+	    return( -1 );
+	pDst += Width * PanRawColChunkRows( pRaw, K );
+    }
+
+    return( 0 );
+}
+
+
+
+
+size_t PanRawColBound( size_t Count )
+{
+    return( compressBound( Count * sizeof(double) ) );
+}
+
+
+
+
+size_t PanRawColEncode( const double *pSrc, size_t Count, int Level,
+                        unsigned char *pScratch, unsigned char *pDst )
+{
+    const unsigned char *pBytes = (const unsigned char *) pSrc;
+    size_t Size = Count * sizeof(double), K;
+    uLongf Bytes = compressBound( Size );
+    int B;
+
+    if( Level > 0 )
+    {
+	for( B = 0; B < (int) sizeof(double); B++ )
+	{
+	    unsigned char *pPlane = pScratch + B * Count;
+
+	    for( K = 0; K < Count; K++ )
+		pPlane[K] = pBytes[ K * sizeof(double) + B ];
+	}
+
+	if( Z_OK == compress2( pDst, &Bytes, pScratch, Size, Level ) &&
+	    Bytes < Size )
+	    return( Bytes );
+    }
+
+    memcpy( pDst, pSrc, Size );
+
+    return( Size );
+}
+
+
+
+
+int PanRawColDecode( const unsigned char *pSrc, size_t Bytes, size_t Count,
+                     unsigned char *pScratch, double *pDst )
+{
+    unsigned char *pBytes = (unsigned char *) pDst;
+    size_t Size = Count * sizeof(double), K;
+    uLongf Length = Size;
+    int B;
+
+    if( Bytes == Size )
+    {
+	memcpy( pDst, pSrc, Size );
+	return( 0 );
+    }
+
+    if( Z_OK != uncompress( pScratch, &Length, pSrc, Bytes ) || Length != Size )
+	return( -1 );
+
+    for( B = 0; B < (int) sizeof(double); B++ )
+    {
+	const unsigned char *pPlane = pScratch + B * Count;
+
+	for( K = 0; K < Count; K++ )
+	    pBytes[ K * sizeof(double) + B ] = pPlane[K];
+    }
+
+    return( 0 );
+}
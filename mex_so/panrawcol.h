@@ -0,0 +1,132 @@
+#ifndef PAN_RAWCOL_H
+#define PAN_RAWCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A raw file is either the row major file written by PAN, or the columnar
+ * container written by panrawconv. Both start with the same text header,
+ * up to and including the "Binary:" line, so that the variable list is
+ * parsed in the same way. In the container the binary section is
+ *
+ *   PanRawColHeader                 at the first byte after "Binary:\n"
+ *   padding                         up to TableOffset, a multiple of 8
+ *   PanRawColChunk[NumVar][NumChunks]
+ *   the chunks
+ *
+ * Every variable is split into chunks of ChunkRows samples (the last one
+ * may be shorter), stored one after the other for all the variables of a
+ * block of rows. The time (or frequency) axis is variable 0: like any
+ * other column it is stored once and shared by all the variables. A
+ * complex sample is a (real, imaginary) pair, as in mxComplexDouble.
+ *
+ * With PAN_RAWCOL_CODEC_DEFLATE a chunk is byte shuffled (the k-th bytes
+ * of all its doubles are stored together) and compressed with zlib. A
+ * chunk that would not shrink is stored as it is: its stored size is then
+ * the size of its samples.
+ *
+ * SourceBytes and SourceMtime identify the row major file a container was
+ * converted from: its companion is up to date only if both match exactly.
+ * The PANCOLv1 header has no SourceMtime, which is read as 0.
+ */
+#define PAN_RAWCOL_MAGIC          "PANCOLv2"
+#define PAN_RAWCOL_MAGIC_V1       "PANCOLv1"
+#define PAN_RAWCOL_MAGIC_SIZE     8
+
+#define PAN_RAWCOL_CODEC_NONE     0
+#define PAN_RAWCOL_CODEC_DEFLATE  1
+
+/* Bytes of the block of rows transposed at once by panrawconv. */
+#define PAN_RAWCOL_BLOCK_BYTES    (64 << 20)
+#define PAN_RAWCOL_MIN_ROWS       1024
+#define PAN_RAWCOL_MAX_ROWS       (1 << 20)
+
+typedef struct
+{
+    char     Magic[ PAN_RAWCOL_MAGIC_SIZE ];
+    uint32_t Codec;
+    uint32_t Level;
+    uint64_t ChunkRows;
+    uint64_t NumChunks;
+    uint64_t TableOffset;   /* from the beginning of the file */
+    uint64_t SourceBytes;   /* size of the row major file converted */
+    uint64_t SourceMtime;   /* its modification time in ns, 0 if none */
+} PanRawColHeader;
+
+typedef struct
+{
+    uint64_t Offset;        /* from the beginning of the file */
+    uint64_t Bytes;         /* stored bytes */
+} PanRawColChunk;
+
+typedef struct
+{
+    const char           *pMap;
+    size_t                Size;
+    uint64_t              Mtime;    /* modification time in ns */
+    const char           *pBinary;  /* first byte after "Binary:\n" */
+    long                  NumVar;
+    long                  NumSamples;
+    int                   IsComplex;
+
+    /* Columnar container only: pTable is NULL for a row major file. */
+    PanRawColHeader       Columnar;
+    const PanRawColChunk *pTable;
+} PanRawFile;
+
+#define PAN_RAW_OK        0
+#define PAN_RAW_EOPEN     1
+#define PAN_RAW_EMAP      2
+#define PAN_RAW_EINVALID  3
+
+/*
+ * Map FileName and parse its header. On success the file must be released
+ * with PanRawClose; on failure nothing is left mapped.
+ */
+int PanRawOpen( const char *FileName, PanRawFile *pRaw );
+void PanRawClose( PanRawFile *pRaw );
+
+/*
+ * 1 if Companion is a columnar file converted from Source as it is now,
+ * i.e. with the same size and modification time, 0 otherwise.
+ */
+int PanRawColFresh( const char *Source, const char *Companion );
+
+/* Give back to the kernel the whole pages of the mapping in [pBegin, pEnd). */
+void PanRawDropPages( const char *pBegin, const char *pEnd );
+
+/* Samples of the chunk K of a columnar file. */
+size_t PanRawColChunkRows( const PanRawFile *pRaw, uint64_t K );
+
+/*
+ * Decode the whole variable Var of a columnar file into pDst, which holds
+ * NumSamples samples; pScratch holds the doubles of one chunk. The pages
+ * of the chunks are dropped once decoded. Return 0 on success, -1 if the
+ * file is corrupted.
+ */
+int PanRawColRead( const PanRawFile *pRaw, long Var, double *pDst,
+                   unsigned char *pScratch );
+
+/* As PanRawColRead, for the chunk K only. */
+int PanRawColReadChunk( const PanRawFile *pRaw, long Var, uint64_t K,
+                        double *pDst, unsigned char *pScratch );
+
+/*
+ * Encode Count doubles with the given zlib Level into pDst, which holds at
+ * least PanRawColBound( Count ) bytes; pScratch holds Count doubles.
+ * Return the stored bytes, Count * sizeof(double) if the chunk is stored
+ * as it is.
+ */
+size_t PanRawColBound( size_t Count );
+size_t PanRawColEncode( const double *pSrc, size_t Count, int Level,
+                        unsigned char *pScratch, unsigned char *pDst );
+
+/*
+ * Decode a stored chunk of Count doubles into pDst; pScratch holds Count
+ * doubles. Return 0 on success, -1 if the chunk is corrupted.
+ */
+int PanRawColDecode( const unsigned char *pSrc, size_t Bytes, size_t Count,
+                     unsigned char *pScratch, double *pDst );
+
+#endif
@@ -0,0 +1,419 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mex.h"
+#include "pancounter.h"
+#include "panrawcol.h"
+
+#define PANRAWCONV_USAGE \
+    "Usage: BYTES = panrawconv('source', 'destination'[, LEVEL]) or " \
+    "[FRESH, MTIME] = panrawconv('-fresh', 'source', 'destination')"
+
+/*
+ * Blocks of rows are transposed into one chunk per variable, which is
+ * compressed (LEVEL 1 to 9) by up to CONV_MAX_THREADS threads.
+ */
+#define CONV_MAX_THREADS  8
+
+typedef struct
+{
+    const double   *pColumns;   /* NumVar chunks of Count doubles */
+    unsigned char  *pOut;       /* NumVar buffers of Bound bytes */
+    size_t         *pBytes;
+    size_t          Count, Bound;
+    int             Level;
+    long            First, Last;
+    unsigned char  *pScratch;
+} ConvTask;
+
+typedef struct
+{
+    PanRawFile      Raw;
+    FILE           *pFile;
+    char           *Temporary;
+    double         *pColumns;
+    unsigned char  *pOut;
+    size_t         *pBytes;
+    PanRawColChunk *pTable;
+    unsigned char  *pScratch[ CONV_MAX_THREADS ];
+} ConvState;
+
+
+
+
+static void *EncodeColumns( void *pArg )
+{
+    ConvTask *pTask = (ConvTask *) pArg;
+    long H;
+
+    for( H = pTask->First; H < pTask->Last; H++ )
+	pTask->pBytes[H] = PanRawColEncode( pTask->pColumns + H * pTask->Count,
+	                                    pTask->Count, pTask->Level,
+	                                    pTask->pScratch,
+	                                    pTask->pOut + H * pTask->Bound );
+
+    return( NULL );
+}
+
+
+
+
+static void Encode( ConvState *pState, size_t Count, size_t Bound, int Level,
+                    int NumThreads )
+{
+    ConvTask  Tasks[ CONV_MAX_THREADS ];
+    pthread_t Threads[ CONV_MAX_THREADS ];
+    long NumVar = pState->Raw.NumVar;
+    long Chunk = (NumVar + NumThreads - 1) / NumThreads;
+    int K, Started = 0;
+
+    for( K = 0; K < NumThreads; K++ )
+    {
+	Tasks[K].pColumns = pState->pColumns;
+	Tasks[K].pOut     = pState->pOut;
+	Tasks[K].pBytes   = pState->pBytes;
+	Tasks[K].Count    = Count;
+	Tasks[K].Bound    = Bound;
+	Tasks[K].Level    = Level;
+	Tasks[K].First    = K * Chunk < NumVar ? K * Chunk : NumVar;
+	Tasks[K].Last     = (K + 1) * Chunk < NumVar ? (K + 1) * Chunk : NumVar;
+	Tasks[K].pScratch = pState->pScratch[K];
+    }
+
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( pthread_create( Threads + K, NULL, EncodeColumns, Tasks + K ) )
+	    EncodeColumns( Tasks + K );
+	else
+	    Started |= 1 << K;
+    }
+
+    EncodeColumns( Tasks );
+
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( Started & (1 << K) )
+	    pthread_join( Threads[K], NULL );
+    }
+}
+
+
+
+
+static void ConvRelease( ConvState *pState )
+{
+    int K;
+
+    if( pState->pFile )
+	fclose( pState->pFile );
+    if( pState->Temporary )
+    {
+	unlink( pState->Temporary );
+	free( pState->Temporary );
+    }
+    PanRawClose( &(pState->Raw) );
+    free( pState->pColumns );
+    free( pState->pOut );
+    free( pState->pBytes );
+    free( pState->pTable );
+    for( K = 0; K < CONV_MAX_THREADS; K++ )
+	free( pState->pScratch[K] );
+}
+
+
+
+
+/* Release everything, remove the partial destination and raise an error. */
+static void ConvErrMsg( ConvState *pState, const char *Format,
+                        const char *FileName )
+{
+    char *MexErrBuffer;
+    int Length = strlen( FileName ) + strlen( Format ) + 10;
+
+    ConvRelease( pState );
+
+    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+    if( ! MexErrBuffer )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    sprintf( MexErrBuffer, Format, FileName );
+    mexErrMsgTxt( MexErrBuffer );
+}
+
+
+
+
+/*
+ * The destination is written to a temporary file renamed at the end, so
+ * that a reader never finds a partial container.
+ */
+static size_t Convert( ConvState *pState, const char *Source,
+                       const char *Destination, int Level )
+{
+    PanRawFile *pRaw = &(pState->Raw);
+    PanRawColHeader Header;
+    size_t Width, RowBytes, Count, Bound, Rows, Row, Offset;
+    long Cores = sysconf( _SC_NPROCESSORS_ONLN ), H;
+    uint64_t K;
+    int NumThreads = 1, NoMemory = 0, Status;
+
+    Status = PanRawOpen( Source, pRaw );
+    if( PAN_RAW_OK != Status )
+    {
+	ConvErrMsg( pState, PAN_RAW_EINVALID == Status ?
+	            "Error: <%s> is not a valid raw file or it is truncated." :
+	            "Error: the <%s> raw file can not be opened.", Source );
+	return( 0 );
+    }
+    if( pRaw->pTable )
+    {
+	ConvErrMsg( pState, "Error: <%s> is already a columnar raw file.",
+	            Source );
+	return( 0 );
+    }
+
+    Width = pRaw->IsComplex ? 2 : 1;
+    RowBytes = Width * sizeof(double) * pRaw->NumVar;
+    Rows = PAN_RAWCOL_BLOCK_BYTES / RowBytes;
+    if( Rows < PAN_RAWCOL_MIN_ROWS )
+	Rows = PAN_RAWCOL_MIN_ROWS;
+    if( Rows > PAN_RAWCOL_MAX_ROWS )
+	Rows = PAN_RAWCOL_MAX_ROWS;
+    if( Rows > (size_t) pRaw->NumSamples && pRaw->NumSamples > 0 )
+	Rows = pRaw->NumSamples;
+
+    memset( &Header, 0, sizeof( Header ) );
+    memcpy( Header.Magic, PAN_RAWCOL_MAGIC, PAN_RAWCOL_MAGIC_SIZE );
+    Header.Codec = Level > 0 ? PAN_RAWCOL_CODEC_DEFLATE : PAN_RAWCOL_CODEC_NONE;
+    Header.Level = Level;
+    Header.ChunkRows = Rows;
+    Header.NumChunks = (pRaw->NumSamples + Rows - 1) / Rows;
+    Header.SourceBytes = pRaw->Size;
+    Header.SourceMtime = pRaw->Mtime;
+    Offset = (pRaw->pBinary - pRaw->pMap) + sizeof( Header );
+    Header.TableOffset = (Offset + 7) & ~(size_t) 7;
+
+    Count = Width * Rows;
+    Bound = PanRawColBound( Count );
+    if( Level > 0 )
+    {
+	NumThreads = Cores > 0 ? (int) Cores : 1;
+	if( NumThreads > CONV_MAX_THREADS )
+	    NumThreads = CONV_MAX_THREADS;
+	if( NumThreads > pRaw->NumVar )
+	    NumThreads = (int) pRaw->NumVar;
+    }
+
+    pState->pColumns = malloc( sizeof(double) * Count * pRaw->NumVar );
+    if( Level > 0 )
+	pState->pOut = malloc( Bound * pRaw->NumVar );
+    pState->pBytes = malloc( sizeof(size_t) * pRaw->NumVar );
+    pState->pTable = calloc( pRaw->NumVar * Header.NumChunks + 1,
+                             sizeof( PanRawColChunk ) );
+    if( asprintf( &(pState->Temporary), "%s.%ld.tmp", Destination,
+                  (long) getpid() ) < 0 )
+	pState->Temporary = NULL;
+    for( H = 0; H < NumThreads && Level > 0; H++ )
+    {
+	if( ! (pState->pScratch[H] = malloc( sizeof(double) * Count )) )
+	    NoMemory = 1;
+    }
+    if( NoMemory || ! pState->pColumns || ! pState->pBytes ||
+        (Level > 0 && ! pState->pOut) || ! pState->pTable ||
+        ! pState->Temporary )
+    {
+	ConvErrMsg( pState, "Error: no more memory to convert <%s>.", Source );
+	return( 0 );
+    }
+
+    pState->pFile = fopen( pState->Temporary, "wb" );
+    if( ! pState->pFile )
+    {
+	ConvErrMsg( pState, "Error: <%s> can not be written.", Destination );
+	return( 0 );
+    }
+
+    /* The text header, the container header and room for the table. */
+    fwrite( pRaw->pMap, 1, pRaw->pBinary - pRaw->pMap, pState->pFile );
+    fwrite( &Header, sizeof( Header ), 1, pState->pFile );
+    for( ; Offset < Header.TableOffset; Offset++ )
+	fputc( 0, pState->pFile );
+    fwrite( pState->pTable, sizeof( PanRawColChunk ),
+            pRaw->NumVar * Header.NumChunks, pState->pFile );
+    Offset = Header.TableOffset +
+             sizeof( PanRawColChunk ) * pRaw->NumVar * Header.NumChunks;
+
+    madvise( (void *) pRaw->pMap, pRaw->Size, MADV_SEQUENTIAL );
+
+    for( K = 0; K < Header.NumChunks; K++ )
+    {
+	size_t Samples = pRaw->NumSamples - K * Rows < Rows ?
+	                 pRaw->NumSamples - K * Rows : Rows;
+	const char *pBlock = pRaw->pBinary + K * Rows * RowBytes;
+	size_t N = Width * Samples;
+
+	/* Transpose the block of rows into one chunk per variable. */
+	for( Row = 0; Row < Samples; Row++ )
+	{
+	    const double *pSrc = (const double *) (pBlock + Row * RowBytes);
+
+	    for( H = 0; H < pRaw->NumVar; H++ )
+		memcpy( pState->pColumns + H * N + Width * Row,
+		        pSrc + Width * H, Width * sizeof(double) );
+	}
+	PanRawDropPages( pBlock, pBlock + Samples * RowBytes );
+
+	if( Level > 0 )
+	    Encode( pState, N, Bound, Level, NumThreads );
+
+	for( H = 0; H < pRaw->NumVar; H++ )
+	{
+	    PanRawColChunk *pChunk = pState->pTable + H * Header.NumChunks + K;
+	    const void *pData = pState->pColumns + H * N;
+
+	    pChunk->Offset = Offset;
+	    pChunk->Bytes = N * sizeof(double);
+	    if( Level > 0 )
+	    {
+		pData = pState->pOut + H * Bound;
+		pChunk->Bytes = pState->pBytes[H];
+	    }
+	    fwrite( pData, 1, pChunk->Bytes, pState->pFile );
+	    Offset += pChunk->Bytes;
+	}
+    }
+
+    if( fseeko( pState->pFile, Header.TableOffset, SEEK_SET ) ||
+        fwrite( pState->pTable, sizeof( PanRawColChunk ),
+                pRaw->NumVar * Header.NumChunks, pState->pFile ) !=
+        pRaw->NumVar * Header.NumChunks ||
+        ferror( pState->pFile ) )
+    {
+	ConvErrMsg( pState, "Error: <%s> can not be written.", Destination );
+	return( 0 );
+    }
+
+    Status = fclose( pState->pFile );
+    pState->pFile = NULL;
+    if( Status || rename( pState->Temporary, Destination ) )
+    {
+	ConvErrMsg( pState, "Error: <%s> can not be written.", Destination );
+	return( 0 );
+    }
+
+    free( pState->Temporary );
+    pState->Temporary = NULL;
+    ConvRelease( pState );
+
+    return( Offset );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    ConvState State;
+    double Level = 0;
+    size_t Bytes;
+
+    /*
+     * '-fresh': whether destination was converted from source as it is
+     * now. The size and the modification time (in ns) recorded in its
+     * header must match exactly. MTIME is that of source, 0 if missing.
+     */
+    if( 3 == nrhs && mxIsChar( prhs[0] ) && mxIsChar( prhs[1] ) &&
+        mxIsChar( prhs[2] ) )
+    {
+	char *Mode = mxArrayToString( prhs[0] );
+	int Fresh = Mode && ! strcmp( Mode, "-fresh" );
+
+	mxFree( Mode );
+	if( Fresh )
+	{
+	    char *Source = mxArrayToString( prhs[1] );
+	    char *Destination = mxArrayToString( prhs[2] );
+
+	    if( NULL == Source || NULL == Destination )
+	    {
+		mexErrMsgTxt( "No more memory.\n" );
+		return;
+	    }
+	    plhs[0] = mxCreateLogicalScalar( PanRawColFresh( Source,
+	                                                     Destination ) );
+	    if( nlhs > 1 )
+	    {
+		struct stat Stat;
+		uint64_t *pMtime;
+
+		plhs[1] = mxCreateNumericMatrix( 1, 1, mxUINT64_CLASS, mxREAL );
+		pMtime = (uint64_t *) mxGetData( plhs[1] );
+		if( ! stat( Source, &Stat ) )
+		    *pMtime = (uint64_t) Stat.st_mtim.tv_sec * 1000000000ull +
+		              Stat.st_mtim.tv_nsec;
+	    }
+	    mxFree( Source );
+	    mxFree( Destination );
+	    return;
+	}
+    }
+
+    if( nrhs < 2 || nrhs > 3 )
+    {
+	mexErrMsgTxt( "Error: wrong number of arguments. " PANRAWCONV_USAGE );
+	return;
+    }
+    if( ! mxIsChar( prhs[0] ) || ! mxIsChar( prhs[1] ) )
+    {
+	mexErrMsgTxt( "Error: source and destination must be strings. "
+	              PANRAWCONV_USAGE );
+	return;
+    }
+    if( 3 == nrhs )
+    {
+	if( ! mxIsNumeric( prhs[2] ) || 1 != mxGetNumberOfElements( prhs[2] ) ||
+	    mxGetScalar( prhs[2] ) < 0 || mxGetScalar( prhs[2] ) > 9 )
+	{
+	    mexErrMsgTxt( "Error: LEVEL must be an integer between 0 (no "
+	                  "compression) and 9. " PANRAWCONV_USAGE );
+	    return;
+	}
+	Level = mxGetScalar( prhs[2] );
+    }
+    if( nlhs > 1 )
+    {
+	mexErrMsgTxt( "Error: only one output variable is allowed. "
+	              PANRAWCONV_USAGE );
+	return;
+    }
+
+    char *Source = mxArrayToString( prhs[0] );
+    char *Destination = mxArrayToString( prhs[1] );
+
+    if( NULL == Source || NULL == Destination )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    PanCounterBegin( PAN_COUNTER_PANRAWCONV );
+
+    memset( &State, 0, sizeof( State ) );
+    Bytes = Convert( &State, Source, Destination, (int) Level );
+
+    PanCounterBytes( Bytes );
+    PanCounterEnd( Source );
+
+    plhs[0] = mxCreateDoubleScalar( (double) Bytes );
+    mxFree( Source );
+    mxFree( Destination );
+}
@@ -0,0 +1,610 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "mex.h"
+#include "pancounter.h"
+#include "panrawcol.h"
+#include "panquant.h"
+
+#if ! MX_HAS_INTERLEAVED_COMPLEX
+#error "panrawread requires the interleaved complex API: build it with mex -R2018a"
+#endif
+
+#define PANRAWREAD_USAGE \
+    "Usage: DATA = panrawread('file', VAR_INDEX[, CLASS]) or " \
+    "[Q, SCALE, OFFSET] = panrawread('file', VAR_INDEX, 'int16')"
+
+/*
+ * Rows are gathered in chunks of RAW_CHUNK_ROWS. Once a chunk has been
+ * copied its pages are dropped, so that the resident memory stays bounded
+ * by the output matrix and not by the size of the raw file.
+ */
+#define RAW_CHUNK_ROWS         4096
+#define RAW_THREAD_MIN_BYTES   (64 << 20)
+#define RAW_MAX_THREADS        8
+
+/*
+ * In a columnar file only the chunks of the requested variables are
+ * touched. They are decoded by up to RAW_MAX_THREADS threads, one variable
+ * at a time, as soon as the output exceeds RAW_COLUMN_MIN_BYTES.
+ */
+#define RAW_COLUMN_MIN_BYTES   (8 << 20)
+
+/*
+ * The output is written to pDst, pDstS or pDstQ according to its class
+ * (see panquant.h). An int16 output takes two passes over a row major
+ * file: the first one only gathers the range of every column in pRanges.
+ */
+typedef struct
+{
+    const char    *pBinary;
+    size_t         RowBytes;
+    size_t         NumSamples;
+    int            IsComplex;
+    int            NumCols;
+    const int     *pCols;
+    double        *pDst;
+    float         *pDstS;
+    int16_t       *pDstQ;
+    PanQuantRange *pRanges;
+    const double  *pInvScale, *pOffset;
+    size_t         RowBegin, RowEnd;
+} RawTask;
+
+/* For an int16 output pScale and pOffset receive one value per column. */
+typedef struct
+{
+    const PanRawFile *pRaw;
+    int               NumCols;
+    const int        *pCols;
+    double           *pDst;
+    float            *pDstS;
+    int16_t          *pDstQ;
+    double           *pScale, *pOffset;
+    int               First, Step;
+    int               Failed;
+} ColumnTask;
+
+
+
+
+static void *GatherRows( void *pArg )
+{
+    RawTask *pTask = (RawTask *) pArg;
+    size_t Row, ChunkEnd, Samples = pTask->NumSamples;
+    int H;
+
+    for( Row = pTask->RowBegin; Row < pTask->RowEnd; Row = ChunkEnd )
+    {
+	const char *pChunk = pTask->pBinary + Row * pTask->RowBytes;
+
+	ChunkEnd = Row + RAW_CHUNK_ROWS;
+	if( ChunkEnd > pTask->RowEnd )
+	    ChunkEnd = pTask->RowEnd;
+
+	for( H = 0; H < pTask->NumCols; H++ )
+	{
+	    register size_t K;
+	    register const char *pSrc;
+	    double Y;
+
+	    if( pTask->pRanges )
+	    {
+		PanQuantRange *pRange = pTask->pRanges + H;
+
+		pSrc = pChunk + sizeof(double) * pTask->pCols[H];
+		for( K = Row; K < ChunkEnd; K++, pSrc += pTask->RowBytes )
+		{
+		    memcpy( &Y, pSrc, sizeof(double) );
+		    PanQuantRangeAdd( pRange, Y );
+		}
+	    }
+	    else if( pTask->pDstQ )
+	    {
+		int16_t *pDst = pTask->pDstQ + H * Samples + Row;
+		double InvScale = pTask->pInvScale[H];
+		double Offset = pTask->pOffset[H];
+
+		pSrc = pChunk + sizeof(double) * pTask->pCols[H];
+		for( K = Row; K < ChunkEnd; K++, pSrc += pTask->RowBytes )
+		{
+		    memcpy( &Y, pSrc, sizeof(double) );
+		    *pDst++ = PanQuantize( Y, InvScale, Offset );
+		}
+	    }
+	    else if( pTask->pDstS )
+	    {
+		size_t Width = pTask->IsComplex ? 2 : 1, W;
+		float *pDst = pTask->pDstS + Width * (H * Samples + Row);
+
+		pSrc = pChunk + Width * sizeof(double) * pTask->pCols[H];
+		for( K = Row; K < ChunkEnd; K++, pSrc += pTask->RowBytes )
+		{
+		    for( W = 0; W < Width; W++ )
+		    {
+			memcpy( &Y, pSrc + W * sizeof(double), sizeof(double) );
+			*pDst++ = (float) Y;
+		    }
+		}
+	    }
+	    else if( pTask->IsComplex )
+	    {
+		/* A complex variable is a (real, imaginary) pair, as in
+		 * mxComplexDouble: one 16 byte copy per sample. */
+		double *pDst = pTask->pDst + 2 * (H * Samples + Row);
+
+		pSrc = pChunk + 2 * sizeof(double) * pTask->pCols[H];
+		for( K = Row; K < ChunkEnd; K++, pSrc += pTask->RowBytes )
+		{
+		    memcpy( pDst, pSrc, 2 * sizeof(double) );
+		    pDst += 2;
+		}
+	    }
+	    else
+	    {
+		double *pDst = pTask->pDst + H * Samples + Row;
+
+		pSrc = pChunk + sizeof(double) * pTask->pCols[H];
+		for( K = Row; K < ChunkEnd; K++, pSrc += pTask->RowBytes )
+		    memcpy( pDst++, pSrc, sizeof(double) );
+	    }
+	}
+
+	PanRawDropPages( pChunk, pTask->pBinary + ChunkEnd * pTask->RowBytes );
+    }
+
+    return( NULL );
+}
+
+
+
+
+static void Gather( RawTask *pTemplate )
+{
+    RawTask   Tasks[ RAW_MAX_THREADS ];
+    pthread_t Threads[ RAW_MAX_THREADS ];
+    size_t Bytes = pTemplate->RowBytes * pTemplate->NumSamples, Chunk;
+    long Cores = sysconf( _SC_NPROCESSORS_ONLN );
+    int NumThreads = (int) (Bytes / RAW_THREAD_MIN_BYTES), K, H, Started = 0;
+    PanQuantRange *pRanges = NULL;
+
+    if( Cores > 0 && NumThreads > Cores )
+	NumThreads = (int) Cores;
+    if( NumThreads > RAW_MAX_THREADS )
+	NumThreads = RAW_MAX_THREADS;
+    if( NumThreads < 1 )
+	NumThreads = 1;
+
+    /*
+     * The file is row major: every thread reads its own block of rows for
+     * all the requested columns, so each page of the file is touched once.
+     */
+    Chunk = (pTemplate->NumSamples + NumThreads - 1) / NumThreads;
+
+    for( K = 0; K < NumThreads; K++ )
+    {
+	Tasks[K] = *pTemplate;
+	Tasks[K].RowBegin = K * Chunk < pTemplate->NumSamples ?
+	                    K * Chunk : pTemplate->NumSamples;
+	Tasks[K].RowEnd = (K + 1) * Chunk < pTemplate->NumSamples ?
+	                  (K + 1) * Chunk : pTemplate->NumSamples;
+    }
+
+    /* Every thread gathers the ranges of its rows, merged at the end. */
+    if( pTemplate->pRanges )
+    {
+	pRanges = mxMalloc( NumThreads * pTemplate->NumCols *
+	                    sizeof( PanQuantRange ) );
+	for( K = 0; K < NumThreads; K++ )
+	{
+	    Tasks[K].pRanges = pRanges + K * pTemplate->NumCols;
+	    for( H = 0; H < pTemplate->NumCols; H++ )
+		PanQuantRangeInit( Tasks[K].pRanges + H );
+	}
+    }
+
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( pthread_create( Threads + K, NULL, GatherRows, Tasks + K ) )
+	    GatherRows( Tasks + K );
+	else
+	    Started |= 1 << K;
+    }
+
+    GatherRows( Tasks );
+
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( Started & (1 << K) )
+	    pthread_join( Threads[K], NULL );
+    }
+
+    if( pRanges )
+    {
+	for( K = 0; K < NumThreads; K++ )
+	{
+	    for( H = 0; H < pTemplate->NumCols; H++ )
+		PanQuantRangeMerge( pTemplate->pRanges + H,
+		                    Tasks[K].pRanges + H );
+	}
+	mxFree( pRanges );
+    }
+}
+
+
+
+
+/*
+ * Decode the chunks of every Step-th requested variable from First on. A
+ * single precision output is converted chunk by chunk; an int16 one needs
+ * the range of the whole variable, which is decoded first.
+ */
+static void *GatherColumns( void *pArg )
+{
+    ColumnTask *pTask = (ColumnTask *) pArg;
+    const PanRawFile *pRaw = pTask->pRaw;
+    size_t Width = pRaw->IsComplex ? 2 : 1, Samples = pRaw->NumSamples;
+    size_t Buffer = pTask->pDstQ ? Samples : pTask->pDstS ?
+                    Width * pRaw->Columnar.ChunkRows : 0;
+    unsigned char *pScratch;
+    double *pColumn = NULL;
+    int H;
+
+    pScratch = malloc( Width * sizeof(double) * pRaw->Columnar.ChunkRows );
+    if( Buffer )
+	pColumn = malloc( Buffer * sizeof(double) );
+    if( ! pScratch || (Buffer && ! pColumn) )
+    {
+	free( pScratch );
+	free( pColumn );
+	pTask->Failed = 1;
+	return( NULL );
+    }
+
+    for( H = pTask->First; H < pTask->NumCols && ! pTask->Failed;
+         H += pTask->Step )
+    {
+	long Var = pTask->pCols[H];
+
+	if( pTask->pDstQ )
+	{
+	    PanQuantRange Range;
+
+	    if( PanRawColRead( pRaw, Var, pColumn, pScratch ) )
+	    {
+		pTask->Failed = 1;
+		break;
+	    }
+	    PanQuantRangeInit( &Range );
+	    PanQuantRangeVector( &Range, pColumn, Samples );
+	    PanQuantParams( &Range, pTask->pScale + H, pTask->pOffset + H );
+	    PanQuantizeVector( pTask->pDstQ + H * Samples, pColumn, Samples,
+	                       pTask->pScale[H], pTask->pOffset[H] );
+	}
+	else if( pTask->pDstS )
+	{
+	    float *pDst = pTask->pDstS + Width * H * Samples;
+	    uint64_t K;
+
+	    for( K = 0; K < pRaw->Columnar.NumChunks; K++ )
+	    {
+		size_t Count = Width * PanRawColChunkRows( pRaw, K );
+
+		if( PanRawColReadChunk( pRaw, Var, K, pColumn, pScratch ) )
+		{
+		    pTask->Failed = 1;
+		    break;
+		}
+		PanConvertSingle( pDst, pColumn, Count );
+		pDst += Count;
+	    }
+	}
+	else if( PanRawColRead( pRaw, Var, pTask->pDst + Width * H * Samples,
+	                        pScratch ) )
+	    pTask->Failed = 1;
+    }
+
+    free( pColumn );
+    free( pScratch );
+
+    return( NULL );
+}
+
+
+
+
+static int GatherColumnar( const ColumnTask *pTemplate )
+{
+    ColumnTask Tasks[ RAW_MAX_THREADS ];
+    pthread_t  Threads[ RAW_MAX_THREADS ];
+    const PanRawFile *pRaw = pTemplate->pRaw;
+    int NumCols = pTemplate->NumCols;
+    size_t Bytes = (pRaw->IsComplex ? 2 : 1) * sizeof(double) *
+                   pRaw->NumSamples * NumCols;
+    long Cores = sysconf( _SC_NPROCESSORS_ONLN );
+    int NumThreads = (int) (Bytes / RAW_COLUMN_MIN_BYTES) + 1, K;
+    int Started = 0, Failed = 0;
+
+    if( Cores > 0 && NumThreads > Cores )
+	NumThreads = (int) Cores;
+    if( NumThreads > RAW_MAX_THREADS )
+	NumThreads = RAW_MAX_THREADS;
+    if( NumThreads > NumCols )
+	NumThreads = NumCols;
+    if( NumThreads < 1 )
+	NumThreads = 1;
+
+    for( K = 0; K < NumThreads; K++ )
+    {
+	Tasks[K]        = *pTemplate;
+	Tasks[K].First  = K;
+	Tasks[K].Step   = NumThreads;
+	Tasks[K].Failed = 0;
+    }
+
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( pthread_create( Threads + K, NULL, GatherColumns, Tasks + K ) )
+	    GatherColumns( Tasks + K );
+	else
+	    Started |= 1 << K;
+    }
+
+    GatherColumns( Tasks );
+
+    for( K = 0; K < NumThreads; K++ )
+    {
+	if( Started & (1 << K) )
+	    pthread_join( Threads[K], NULL );
+	Failed |= Tasks[K].Failed;
+    }
+
+    return( Failed ? -1 : 0 );
+}
+
+
+
+
+static void RawErrMsg( const char *Format, const char *FileName )
+{
+    char *MexErrBuffer;
+    int Length = strlen( FileName ) + strlen( Format ) + 10;
+
+    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+    if( ! MexErrBuffer )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    sprintf( MexErrBuffer, Format, FileName );
+    mexErrMsgTxt( MexErrBuffer );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    if( nrhs < 2 || nrhs > 3 )
+    {
+	mexErrMsgTxt( "Error: wrong number of arguments. " PANRAWREAD_USAGE );
+	return;
+    }
+    if( ! mxIsChar( prhs[0] ) )
+    {
+	mexErrMsgTxt( "Error: file must be a string. " PANRAWREAD_USAGE );
+	return;
+    }
+    if( ! mxIsDouble( prhs[1] ) || mxIsComplex( prhs[1] ) )
+    {
+	mexErrMsgTxt( "Error: VAR_INDEX must be a vector of indices. "
+	              PANRAWREAD_USAGE );
+	return;
+    }
+
+    int Class = PAN_CLASS_DOUBLE;
+
+    if( 3 == nrhs )
+    {
+	char Name[ 8 ];
+
+	if( ! mxIsChar( prhs[2] ) || mxGetString( prhs[2], Name, sizeof(Name) )
+	    || (Class = PanClassParse( Name )) < 0 )
+	{
+	    mexErrMsgTxt( "Error: CLASS must be 'double', 'single' or 'int16'. "
+	                  PANRAWREAD_USAGE );
+	    return;
+	}
+    }
+    if( nlhs > (PAN_CLASS_INT16 == Class ? 3 : 1) )
+    {
+	mexErrMsgTxt( "Error: too many output variables. " PANRAWREAD_USAGE );
+	return;
+    }
+
+    char *FileName = mxArrayToString( prhs[0] );
+    PanRawFile Raw;
+    int Status;
+
+    PanCounterBegin( PAN_COUNTER_PANRAWREAD );
+
+    if( NULL == FileName )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    Status = PanRawOpen( FileName, &Raw );
+    if( PAN_RAW_EOPEN == Status )
+    {
+	RawErrMsg( "Error: the <%s> raw file can not be opened.", FileName );
+	return;
+    }
+    if( PAN_RAW_EMAP == Status )
+    {
+	RawErrMsg( "Error: the <%s> raw file can not be mapped.", FileName );
+	return;
+    }
+    if( PAN_RAW_OK != Status )
+    {
+	RawErrMsg( "Error: <%s> is not a valid raw file or it is truncated.",
+	           FileName );
+	return;
+    }
+    if( PAN_CLASS_INT16 == Class && Raw.IsComplex )
+    {
+	PanRawClose( &Raw );
+	RawErrMsg( "Error: <%s> is a complex raw file: only real variables "
+	           "can be quantised to int16.", FileName );
+	return;
+    }
+
+    size_t NumCols = mxGetNumberOfElements( prhs[1] ), H;
+    const double *pIndex = mxGetDoubles( prhs[1] );
+    int *pCols = mxMalloc( (NumCols ? NumCols : 1) * sizeof( int ) );
+
+    for( H = 0; H < NumCols; H++ )
+    {
+	if( pIndex[H] < 0 || pIndex[H] >= Raw.NumVar ||
+	    pIndex[H] != (int) pIndex[H] )
+	{
+	    PanRawClose( &Raw );
+	    mexErrMsgTxt( "Error: VAR_INDEX must contain zero based variable "
+	                  "indices smaller than the number of variables." );
+	    return;
+	}
+	pCols[H] = (int) pIndex[H];
+    }
+
+    plhs[0] = mxCreateUninitNumericMatrix( Raw.NumSamples, NumCols,
+                     PAN_CLASS_INT16 == Class ? mxINT16_CLASS :
+                     PAN_CLASS_SINGLE == Class ? mxSINGLE_CLASS :
+                     mxDOUBLE_CLASS, Raw.IsComplex ? mxCOMPLEX : mxREAL );
+    if( NULL == plhs[0] )
+    {
+	PanRawClose( &Raw );
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    double *pDst = NULL, *pScale = NULL, *pOffset = NULL;
+    float *pDstS = NULL;
+    int16_t *pDstQ = NULL;
+    mxArray *pScaleArray = NULL, *pOffsetArray = NULL;
+
+    if( PAN_CLASS_INT16 == Class )
+    {
+	pDstQ = mxGetInt16s( plhs[0] );
+	pScaleArray = mxCreateDoubleMatrix( 1, NumCols, mxREAL );
+	pOffsetArray = mxCreateDoubleMatrix( 1, NumCols, mxREAL );
+	pScale = mxGetDoubles( pScaleArray );
+	pOffset = mxGetDoubles( pOffsetArray );
+	for( H = 0; H < NumCols; H++ )
+	{
+	    pScale[H] = 1.0;
+	    pOffset[H] = 0.0;
+	}
+    }
+    else if( PAN_CLASS_SINGLE == Class )
+	pDstS = Raw.IsComplex ? (float *) mxGetComplexSingles( plhs[0] ) :
+	                        mxGetSingles( plhs[0] );
+    else
+	pDst = Raw.IsComplex ? (double *) mxGetComplexDoubles( plhs[0] ) :
+	                       mxGetDoubles( plhs[0] );
+
+    if( Raw.NumSamples > 0 && NumCols > 0 && Raw.pTable )
+    {
+	ColumnTask Task;
+
+	madvise( (void *) Raw.pMap, Raw.Size, MADV_RANDOM );
+
+	memset( &Task, 0, sizeof( ColumnTask ) );
+	Task.pRaw    = &Raw;
+	Task.NumCols = NumCols;
+	Task.pCols   = pCols;
+	Task.pDst    = pDst;
+	Task.pDstS   = pDstS;
+	Task.pDstQ   = pDstQ;
+	Task.pScale  = pScale;
+	Task.pOffset = pOffset;
+
+	if( GatherColumnar( &Task ) )
+	{
+	    PanRawClose( &Raw );
+	    RawErrMsg( "Error: <%s> is a corrupted columnar raw file or there "
+	               "is no more memory.", FileName );
+	    return;
+	}
+    }
+    else if( Raw.NumSamples > 0 && NumCols > 0 )
+    {
+	RawTask Task;
+
+	madvise( (void *) Raw.pMap, Raw.Size, MADV_SEQUENTIAL );
+
+	memset( &Task, 0, sizeof( RawTask ) );
+	Task.pBinary    = Raw.pBinary;
+	Task.RowBytes   = (Raw.IsComplex ? 2 : 1) * sizeof(double) * Raw.NumVar;
+	Task.NumSamples = Raw.NumSamples;
+	Task.IsComplex  = Raw.IsComplex;
+	Task.NumCols    = NumCols;
+	Task.pCols      = pCols;
+	Task.pDst       = pDst;
+	Task.pDstS      = pDstS;
+
+	if( pDstQ )
+	{
+	    PanQuantRange *pRanges = mxMalloc( NumCols * sizeof( PanQuantRange ) );
+	    double *pInvScale = mxMalloc( NumCols * sizeof(double) );
+
+	    /* A first pass for the ranges, a second one to quantise. */
+	    for( H = 0; H < NumCols; H++ )
+		PanQuantRangeInit( pRanges + H );
+	    Task.pRanges = pRanges;
+	    Gather( &Task );
+
+	    for( H = 0; H < NumCols; H++ )
+	    {
+		PanQuantParams( pRanges + H, pScale + H, pOffset + H );
+		pInvScale[H] = 1.0 / pScale[H];
+	    }
+	    Task.pRanges   = NULL;
+	    Task.pDstQ     = pDstQ;
+	    Task.pInvScale = pInvScale;
+	    Task.pOffset   = pOffset;
+	    Gather( &Task );
+
+	    mxFree( pInvScale );
+	    mxFree( pRanges );
+	}
+	else
+	    Gather( &Task );
+    }
+
+    if( pScaleArray )
+    {
+	PanCounterBytes( PAN_COUNTER_MX_BYTES( pScaleArray ) +
+	                 PAN_COUNTER_MX_BYTES( pOffsetArray ) );
+	if( nlhs > 1 )
+	    plhs[1] = pScaleArray;
+	else
+	    mxDestroyArray( pScaleArray );
+	if( nlhs > 2 )
+	    plhs[2] = pOffsetArray;
+	else
+	    mxDestroyArray( pOffsetArray );
+    }
+
+    mxFree( pCols );
+    PanRawClose( &Raw );
+
+    PanCounterBytes( PAN_COUNTER_MX_BYTES( plhs[0] ) );
+    PanCounterEnd( FileName );
+    mxFree( FileName );
+}
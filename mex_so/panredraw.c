@@ -4,13 +4,11 @@
 #include <string.h>
 #include <errno.h>
 #include "mex.h"
-
-#define PAN_MAT_SHL_NAME      "panMat.so"
+#include "pansession.h"
+#include "pancounter.h"
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
-    void *Module;
-
     if( nrhs != 1 )
     {
 	mexErrMsgTxt( "Error: missing argument. Usage: panredraw('on/off')");
@@ -30,93 +28,23 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	return;
     }
 
-    char *ShlPath = (char *) getenv( "PAN_MAT_SHL_PATH" );
-    char *Path;
-
-    if( ShlPath )
-    {
-        Path = (char *) malloc((strlen(ShlPath)+strlen(PAN_MAT_SHL_NAME) + 20) *
-	                        sizeof( char ) );
-	if( ! Path )
-	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
-	}
-
-	sprintf( Path, "%s/%s", ShlPath, PAN_MAT_SHL_NAME );
-    }
-    else
-    {
-        Path = (char *) malloc((strlen(PAN_MAT_SHL_NAME)+20) * sizeof( char ));
-	if( ! Path )
-	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
-	}
+    PanSession *Session;
+    int Status;
 
-	sprintf( Path, "%s", PAN_MAT_SHL_NAME );
-    }
+    PanCounterBegin( PAN_COUNTER_PANREDRAW );
 
-    Module = dlopen( Path, RTLD_LAZY | RTLD_DEEPBIND | RTLD_NOLOAD );
-    if( ! Module )
+    if( (Status = PanSessionAttach( &Session )) )
     {
-	int Count, Length;
-	char *MexErrBuffer;
-
-	Length = strlen( Path ) + 150;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
-	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
-	}
-
-	Count = sprintf( MexErrBuffer, "The <%s> shared libray can not be "
-	    "loaded.\n"
-	    "Run \"pannet('filename')\" command before reading simulation "
-	    "results.\n", Path );
-
-	if( Count >= Length )
-	    abort();
-
-	mexErrMsgTxt( MexErrBuffer );
-
+	PanSessionErrMsg( Status, NULL );
 	return;
     }
 
-    errno = 0;
-
-    void (*Entry)( char );
-    char *EntryName = "PanMatlabRedraw";
-
-    Entry = dlsym( Module, EntryName );
-    if( NULL == Entry )
+    if( ! Session->Entry.PanMatlabRedraw )
     {
-	dlclose( Module );
-
-	int Count, Length;
-	char *MexErrBuffer;
-
-	Length = strlen( Path ) + strlen( EntryName ) + 100;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
-	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
-	}
-
-	Count = sprintf( MexErrBuffer, "The <%s> evaluate routine is not "
-	        "found in <%s> shared module.\n\n", EntryName, Path );
-	if( Count >= Length )
-	    abort();
-
-	mexErrMsgTxt( MexErrBuffer );
-
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabRedraw" );
 	return;
     }
 
-    free( Path );
-
     size_t  CharNum;
     char *Argument;
     char Flag;
@@ -140,14 +68,16 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     {
 	mxFree( Argument );
         mexErrMsgTxt( "Error: argument must be the 'on' or 'off' string." );
-	dlclose( Module );
         return;
     }
 
     mxFree( Argument );
 
-    (Entry)( Flag );
+    PanCounterPanEnter();
+    (Session->Entry.PanMatlabRedraw)( Flag );
+    PanCounterPanLeave();
+
+    PanCounterEnd( Flag ? "on" : "off" );
 
-    dlclose( Module );
     return;
 }
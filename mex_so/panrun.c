@@ -0,0 +1,1061 @@
+/*
+ * Headless runner: loads panMat.so through the entry points used by the
+ * gateways, runs a script of analyses and writes the requested
+ * memwaveforms to a raw file, without starting MATLAB.
+ *
+ * Built by MPanSuiteInstall, or from the repository root with
+ *
+ *   gcc -O2 -fvisibility=hidden -rdynamic -o mex_so/panrun \
+ *       mex_so/panrun.c mex_so/panrawcol.c mex_so/pancounter.c -ldl -lz
+ *
+ * and run as
+ *
+ *   panrun [-c LEVEL] [-i INIT] [-l LOG] [-r RAW_DIR] [-w DIR] [-o OUTPUT]
+ *          [-q] [-t] NETLIST SCRIPT [NAME ...]
+ *
+ * NETLIST is loaded as MPanLoadNet does ("NETLIST -l LOG -r RAW_DIR", by
+ * default RADIX.log and RADIX.raw next to NETLIST, or in DIR with -w).
+ * SCRIPT (- for the standard input) holds one command per line, the
+ * strings given to pansimc by the MPanSuite wrappers (see
+ * MPanStrCommandComplete), e.g.
+ *
+ *   Tr tran tstop=1 mem=["bus1" "bus2"]
+ *
+ * Blank lines and lines starting with ';' or '%' are skipped. The run
+ * stops at the first command that fails. The script INIT, if given, is
+ * run in the same way right after the netlist is loaded: the gateways
+ * replay there the alter commands of the MATLAB session.
+ *
+ * The memwaveforms NAME are then written to OUTPUT, in the order given,
+ * as the variables of a raw file: a multi-column memwaveform gives one
+ * variable per column, NAME(1), NAME(2), ... All of them must have the
+ * same number of samples; the file is complex if any of them is. OUTPUT
+ * is the row major layout written by PAN or, with -c LEVEL, the columnar
+ * container of panrawconv compressed with zlib LEVEL (0 stores the
+ * chunks as they are): MPanVarGetRawFile and panrawread read both.
+ *
+ * -q discards the console output of PAN, -t reports the milliseconds
+ * spent loading the netlist, running the script and writing OUTPUT on
+ * the standard error.
+ *
+ * With -s panrun serves the commands read from the standard input,
+ *
+ *   panrun -s [-c LEVEL] [-i INIT] [-l LOG] [-r RAW_DIR] [-w DIR] [-q]
+ *             NETLIST
+ *
+ * as pansweep and pansimc_async do with their workers. Every line is a
+ * command, except
+ *
+ *   > OUTPUT NAME ...
+ *
+ * which writes the memwaveforms NAME to OUTPUT, as above, and answers
+ * with the line "ERROR STATUS" on the standard output: ERROR is the PAN
+ * error of the first command that failed since the previous answer (the
+ * commands after it are skipped, and OUTPUT is not written), STATUS is 0
+ * if OUTPUT was written and 4 otherwise. A bare ">" writes nothing and
+ * answers with STATUS 0, to learn how the commands before it went. The
+ * line
+ *
+ *   ? NAME ...
+ *
+ * checks the memwaveforms NAME as "=" below does, without writing them,
+ * and answers "ERROR STATUS ROWS COMPLEX": ROWS is their number of
+ * samples, COMPLEX is 1 if any of them is complex. The line
+ *
+ *   = FILE OFFSET CAPACITY WIDTH NAME ...
+ *
+ * writes the memwaveforms NAME, which must be single-column, straight
+ * into FILE, a result array of doubles shared with the gateway (mapped
+ * once, and again only when FILE changes): the samples of the K-th NAME
+ * (from 0) start at the double OFFSET + K * CAPACITY * WIDTH, real and
+ * imaginary parts interleaved if WIDTH is 2. The answer is "ERROR STATUS
+ * ROWS": STATUS is 6 if there are more than CAPACITY samples, 4 if the
+ * memwaveforms can not be written there (not found, multi-column, of
+ * different lengths, or complex with WIDTH 1). The answers of all these
+ * lines get STATUS 5, followed by the name of the function, if a command
+ * since the previous answer called a MATLAB function (see below). The
+ * console output of PAN goes to the standard error. panrun exits at the
+ * end of the input.
+ *
+ * panMat.so is searched in PAN_MAT_SHL_PATH, then in the folder of
+ * panrun. Every run loads its own copy: runners can be started in
+ * parallel, each with its own -w (or -l and -r) when they share a
+ * netlist.
+ *
+ * PAN prints through mexPrintf and warns through mexWarnMsgTxt: panrun
+ * exports its own mexPrintf, mexWarnMsgTxt, mexEvalString and
+ * mexCallMATLAB (hence -rdynamic), which write to the standard output
+ * and the standard error, ignore the MATLAB commands and fail the calls
+ * of MATLAB functions. panMat.so must therefore take the rest of the
+ * MATLAB API, if it uses any, from libraries found without MATLAB: it
+ * must not be linked against libmex, whose copy of these functions can
+ * not run outside of MATLAB. Netlists whose macro devices are evaluated
+ * by MATLAB functions need MATLAB and can not be run.
+ *
+ * Exit status: 0 on success, 1 for a wrong command line, 2 if the netlist
+ * can not be loaded, 3 if a command fails, 4 if OUTPUT can not be written,
+ * 5 if the netlist or a command called a MATLAB function.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Only the types of pansession.h are used, outside of MATLAB. */
+#define PAN_SESSION_NO_MEX
+#include "pansession.h"
+#include "pancounter.h"
+#include "panrawcol.h"
+
+#define PANRUN_USAGE \
+    "Usage: panrun [-c LEVEL] [-i INIT] [-l LOG] [-r RAW_DIR] [-w DIR] " \
+    "[-o OUTPUT]\n              [-q] [-t] NETLIST SCRIPT [NAME ...]\n" \
+    "       panrun -s [-c LEVEL] [-i INIT] [-l LOG] [-r RAW_DIR] [-w DIR] " \
+    "[-q] NETLIST\n"
+
+/* The MATLAB API functions panrun provides to panMat.so. */
+#define PANRUN_EXPORT  __attribute__(( visibility( "default" ) ))
+
+#define PANRUN_OK        0
+#define PANRUN_EUSAGE    1
+#define PANRUN_ELOAD     2
+#define PANRUN_ECOMMAND  3
+#define PANRUN_EOUTPUT   4
+#define PANRUN_EMATLAB   5
+#define PANRUN_ESPACE    6
+
+typedef struct
+{
+    PanEntryTable  Entry;
+    MemWaveform   *pWavs;
+    int            NumWavs;
+    long           NumVar;
+    int            Rows, IsComplex;
+    char          *Shared;      /* the result array of "=", if mapped */
+    double        *pShared;
+    size_t         SharedSize;  /* doubles */
+} RunState;
+
+/* The first MATLAB function PAN called since it was last cleared. */
+static char RunMatlab[ 64 ];
+
+
+
+
+PANRUN_EXPORT int mexPrintf( const char *Format, ... )
+{
+    va_list Args;
+    int Length;
+
+    va_start( Args, Format );
+    Length = vprintf( Format, Args );
+    va_end( Args );
+
+    return( Length );
+}
+
+
+
+
+PANRUN_EXPORT void mexWarnMsgTxt( const char *Message )
+{
+    fflush( stdout );
+    fprintf( stderr, "Warning: %s\n", Message );
+}
+
+
+
+
+/* drawnow and the like: there is no MATLAB to run them. */
+PANRUN_EXPORT int mexEvalString( const char *Command )
+{
+    (void) Command;
+
+    return( 0 );
+}
+
+
+
+
+PANRUN_EXPORT int mexCallMATLAB( int nlhs, void *plhs[], int nrhs,
+                                 void *prhs[], const char *Function )
+{
+    (void) nlhs;
+    (void) plhs;
+    (void) nrhs;
+    (void) prhs;
+
+    fflush( stdout );
+    fprintf( stderr, "The <%s> MATLAB function can not be called by "
+             "panrun.\n", Function );
+    if( ! RunMatlab[0] )
+	snprintf( RunMatlab, sizeof( RunMatlab ), "%s", Function );
+
+    return( 1 );
+}
+
+
+
+
+/* Sample (Row, Col) of a memwaveform array, as stored by PAN. */
+static double RunSample( const MemWaveform *pWav, const double *pArray,
+                         int Row, int Col )
+{
+    if( ! pArray )
+	return( 0.0 );
+    if( 1 == pWav->Cols )
+	return( pArray[ Row ] );
+
+    return( ((const double * const *) pArray)[ Row ][ Col ] );
+}
+
+
+
+
+static double RunMs( uint64_t Start )
+{
+    return( 1e-6 * (double) (PanCounterNow() - Start) );
+}
+
+
+
+
+/*
+ * PAN_MAT_SHL_PATH/panMat.so, or panMat.so in the folder of the runner,
+ * in a malloc'd string.
+ */
+static char *RunLibraryPath( void )
+{
+    char Self[ 4096 ], *Dir = getenv( PAN_MAT_SHL_PATH_ENV ), *Path;
+    ssize_t Length;
+
+    if( ! Dir )
+    {
+	Length = readlink( "/proc/self/exe", Self, sizeof( Self ) - 1 );
+	if( Length > 0 )
+	{
+	    Self[ Length ] = 0;
+	    Dir = dirname( Self );
+	}
+    }
+
+    if( ! Dir )
+	return( strdup( PAN_MAT_SHL_NAME ) );
+    if( asprintf( &Path, "%s/%s", Dir, PAN_MAT_SHL_NAME ) < 0 )
+	return( NULL );
+
+    return( Path );
+}
+
+
+
+
+static int RunLoad( RunState *pState, char *Netlist, const char *Log,
+                    const char *RawDir, const char *WorkDir )
+{
+    PanEntryTable *pEntry = &(pState->Entry);
+    char *Path = RunLibraryPath(), *Radix, *ppArgs[ 7 ];
+    void *Module;
+    size_t Length;
+
+    if( ! Path )
+    {
+	fprintf( stderr, "No more memory.\n" );
+	return( PANRUN_ELOAD );
+    }
+
+    /*
+     * Unlike the gateways, no RTLD_DEEPBIND: the MATLAB API used by
+     * panMat.so must resolve to the functions exported by panrun, which
+     * come first in the lookup scope.
+     */
+    Module = dlopen( Path, RTLD_LAZY | RTLD_GLOBAL );
+    if( ! Module )
+    {
+	fprintf( stderr, "The <%s> shared library can not be loaded: %s\n",
+	         Path, dlerror() );
+	return( PANRUN_ELOAD );
+    }
+
+    *(void **) &(pEntry->InitialiseGlobals) =
+	dlsym( Module, "InitialiseGlobals" );
+    *(void **) &(pEntry->MatlabPanInit) =
+	dlsym( Module, "MatlabPanInit" );
+    *(void **) &(pEntry->PanMatlabExecuteCommand) =
+	dlsym( Module, "PanMatlabExecuteCommand" );
+    *(void **) &(pEntry->PanMatlabGet) =
+	dlsym( Module, "PanMatlabGet" );
+
+    if( ! pEntry->InitialiseGlobals || ! pEntry->MatlabPanInit ||
+        ! pEntry->PanMatlabExecuteCommand || ! pEntry->PanMatlabGet )
+    {
+	fprintf( stderr, "The <%s> shared module does not export the entry "
+	         "points of MPanSuite.\n", Path );
+	return( PANRUN_ELOAD );
+    }
+
+    /* The radix of the netlist, as in MPanLoadNet. */
+    Radix = strdup( Netlist );
+    if( ! Radix )
+    {
+	fprintf( stderr, "No more memory.\n" );
+	return( PANRUN_ELOAD );
+    }
+    Length = strlen( Radix );
+    if( Length > 4 && ! strcmp( Radix + Length - 4, ".pan" ) )
+	Radix[ Length - 4 ] = 0;
+    if( WorkDir )
+    {
+	char *Name = strrchr( Radix, '/' ), *Joined;
+
+	mkdir( WorkDir, 0777 );
+	if( asprintf( &Joined, "%s/%s", WorkDir, Name ? Name + 1 : Radix ) < 0 )
+	    Joined = NULL;
+	free( Radix );
+	Radix = Joined;
+    }
+
+    /* PAN may keep pointers to its arguments: they are never released. */
+    ppArgs[0] = "";
+    ppArgs[1] = Netlist;
+    ppArgs[2] = "-l";
+    if( Radix && Log )
+	ppArgs[3] = strdup( Log );
+    else if( Radix && asprintf( ppArgs + 3, "%s.log", Radix ) < 0 )
+	ppArgs[3] = NULL;
+    ppArgs[4] = "-r";
+    if( Radix && RawDir )
+	ppArgs[5] = strdup( RawDir );
+    else if( Radix && asprintf( ppArgs + 5, "%s.raw", Radix ) < 0 )
+	ppArgs[5] = NULL;
+    ppArgs[6] = NULL;
+
+    if( ! Radix || ! ppArgs[3] || ! ppArgs[5] )
+    {
+	free( Radix );
+	fprintf( stderr, "No more memory.\n" );
+	return( PANRUN_ELOAD );
+    }
+    free( Radix );
+
+    (pEntry->InitialiseGlobals)();
+    if( (pEntry->MatlabPanInit)( 6, ppArgs ) )
+    {
+	fprintf( stderr, "A severe error blocked the loading of <%s>.\n",
+	         Netlist );
+	return( PANRUN_ELOAD );
+    }
+
+    return( PANRUN_OK );
+}
+
+
+
+
+/* Strip the blanks around a line read by getline. */
+static char *RunTrim( char *pLine )
+{
+    char *pCommand, *pEnd;
+
+    for( pCommand = pLine; *pCommand == ' ' || *pCommand == '\t';
+         pCommand++ );
+    for( pEnd = pCommand + strlen( pCommand ); pEnd > pCommand &&
+         (pEnd[-1] == '\n' || pEnd[-1] == '\r' || pEnd[-1] == ' ' ||
+          pEnd[-1] == '\t'); pEnd-- );
+    *pEnd = 0;
+
+    return( pCommand );
+}
+
+
+
+
+static int RunScript( RunState *pState, const char *Script, int *pCount )
+{
+    FILE *pFile = strcmp( Script, "-" ) ? fopen( Script, "r" ) : stdin;
+    char *pLine = NULL, *pCommand;
+    size_t Size = 0;
+    int Line = 0, Error = 0;
+
+    *pCount = 0;
+    if( ! pFile )
+    {
+	fprintf( stderr, "The <%s> script can not be read.\n", Script );
+	return( PANRUN_EUSAGE );
+    }
+
+    while( ! Error && getline( &pLine, &Size, pFile ) >= 0 )
+    {
+	Line++;
+	pCommand = RunTrim( pLine );
+
+	if( ! *pCommand || *pCommand == ';' || *pCommand == '%' )
+	    continue;
+
+	Error = (pState->Entry.PanMatlabExecuteCommand)( pCommand );
+	(*pCount)++;
+	if( Error )
+	    fprintf( stderr, "The command at line %d of <%s> failed with "
+	             "error %d:\n  %s\n", Line, Script, Error, pCommand );
+    }
+
+    free( pLine );
+    if( pFile != stdin )
+	fclose( pFile );
+
+    return( Error ? PANRUN_ECOMMAND : PANRUN_OK );
+}
+
+
+
+
+/* Look up the memwaveforms and check that they fit in one raw file. */
+static int RunFetch( RunState *pState, char **ppNames, int NumNames )
+{
+    int K;
+
+    free( pState->pWavs );
+    pState->NumVar = 0;
+    pState->Rows = 0;
+    pState->IsComplex = 0;
+
+    pState->pWavs = calloc( NumNames ? NumNames : 1, sizeof( MemWaveform ) );
+    if( ! pState->pWavs )
+    {
+	fprintf( stderr, "No more memory.\n" );
+	return( PANRUN_EOUTPUT );
+    }
+    pState->NumWavs = NumNames;
+
+    for( K = 0; K < NumNames; K++ )
+    {
+	MemWaveform *pWav = pState->pWavs + K;
+
+	pWav->Name = ppNames[K];
+	pWav->Found = (pState->Entry.PanMatlabGet)( pWav->Name,
+	                   &(pWav->pWavArrayR), &(pWav->pWavArrayI),
+	                   &(pWav->pWavArrayS), &(pWav->Rows), &(pWav->Cols) );
+	if( ! pWav->Found )
+	{
+	    fprintf( stderr, "The <%s> variable can not be found in the "
+	             "simulator data-bases.\n", pWav->Name );
+	    return( PANRUN_EOUTPUT );
+	}
+	if( pWav->pWavArrayS || ! pWav->pWavArrayR )
+	{
+	    fprintf( stderr, "The <%s> variable is not numeric: it can not be "
+	             "written to a raw file.\n", pWav->Name );
+	    return( PANRUN_EOUTPUT );
+	}
+	if( K && pWav->Rows != pState->Rows )
+	{
+	    fprintf( stderr, "The <%s> variable has %d samples, <%s> %d: they "
+	             "can not be written to the same raw file.\n", pWav->Name,
+	             pWav->Rows, pState->pWavs[0].Name, pState->Rows );
+	    return( PANRUN_EOUTPUT );
+	}
+
+	pState->Rows = pWav->Rows;
+	pState->NumVar += pWav->Cols;
+	if( pWav->pWavArrayI )
+	    pState->IsComplex = 1;
+    }
+
+    return( PANRUN_OK );
+}
+
+
+
+
+static void RunHeader( const RunState *pState, FILE *pFile,
+                       const char *Netlist )
+{
+    time_t Now = time( NULL );
+    long Var = 0;
+    int K, J;
+
+    fprintf( pFile, "Title: panrun %s\n", Netlist );
+    fprintf( pFile, "Date: %s", ctime( &Now ) );
+    fprintf( pFile, "Plotname: memwaveforms\n" );
+    fprintf( pFile, "Flags: %s\n", pState->IsComplex ? "complex" : "real" );
+    fprintf( pFile, "No. Variables: %ld \n", pState->NumVar );
+    fprintf( pFile, "No. Points: %d \n", pState->Rows );
+    fprintf( pFile, "Variables:\n" );
+
+    for( K = 0; K < pState->NumWavs; K++ )
+    {
+	const MemWaveform *pWav = pState->pWavs + K;
+
+	for( J = 0; J < pWav->Cols; J++ )
+	{
+	    if( 1 == pWav->Cols )
+		fprintf( pFile, "\t%ld\t%s\tmemwaveform\t-\n", Var++,
+		         pWav->Name );
+	    else
+		fprintf( pFile, "\t%ld\t%s(%d)\tmemwaveform\t-\n", Var++,
+		         pWav->Name, J + 1 );
+	}
+    }
+
+    fprintf( pFile, "Binary:\n" );
+}
+
+
+
+
+/* Samples [First, First + Count) of the variable (K, J) into pDst. */
+static void RunColumn( const RunState *pState, int K, int J, size_t First,
+                       size_t Count, double *pDst )
+{
+    const MemWaveform *pWav = pState->pWavs + K;
+    size_t Row;
+
+    for( Row = 0; Row < Count; Row++ )
+    {
+	int I = (int) (First + Row);
+
+	if( pState->IsComplex )
+	{
+	    pDst[ 2 * Row ] = RunSample( pWav, pWav->pWavArrayR, I, J );
+	    pDst[ 2 * Row + 1 ] = RunSample( pWav, pWav->pWavArrayI, I, J );
+	}
+	else
+	    pDst[ Row ] = RunSample( pWav, pWav->pWavArrayR, I, J );
+    }
+}
+
+
+
+
+static int RunWriteRows( const RunState *pState, FILE *pFile )
+{
+    size_t Width = pState->IsComplex ? 2 : 1;
+    double *pRow = malloc( Width * sizeof(double) * pState->NumVar );
+    int Row, K, J;
+
+    if( ! pRow )
+	return( -1 );
+
+    for( Row = 0; Row < pState->Rows; Row++ )
+    {
+	double *pDst = pRow;
+
+	for( K = 0; K < pState->NumWavs; K++ )
+	{
+	    for( J = 0; J < pState->pWavs[K].Cols; J++, pDst += Width )
+		RunColumn( pState, K, J, Row, 1, pDst );
+	}
+	fwrite( pRow, Width * sizeof(double), pState->NumVar, pFile );
+    }
+
+    free( pRow );
+
+    return( 0 );
+}
+
+
+
+
+/* The columnar container of panrawconv, written chunk by chunk. */
+static int RunWriteColumns( const RunState *pState, FILE *pFile, int Level )
+{
+    PanRawColHeader Header;
+    PanRawColChunk *pTable;
+    size_t Width = pState->IsComplex ? 2 : 1, Rows, Count, Bound, Offset;
+    off_t Text = ftello( pFile );
+    double *pColumn;
+    unsigned char *pScratch = NULL, *pOut = NULL;
+    uint64_t C;
+    long Var;
+    int K, J, Status = 0;
+
+    Rows = PAN_RAWCOL_BLOCK_BYTES / (Width * sizeof(double) * pState->NumVar);
+    if( Rows < PAN_RAWCOL_MIN_ROWS )
+	Rows = PAN_RAWCOL_MIN_ROWS;
+    if( Rows > PAN_RAWCOL_MAX_ROWS )
+	Rows = PAN_RAWCOL_MAX_ROWS;
+    if( Rows > (size_t) pState->Rows && pState->Rows > 0 )
+	Rows = pState->Rows;
+
+    memset( &Header, 0, sizeof( Header ) );
+    memcpy( Header.Magic, PAN_RAWCOL_MAGIC, PAN_RAWCOL_MAGIC_SIZE );
+    Header.Codec = Level > 0 ? PAN_RAWCOL_CODEC_DEFLATE : PAN_RAWCOL_CODEC_NONE;
+    Header.Level = Level;
+    Header.ChunkRows = Rows;
+    Header.NumChunks = (pState->Rows + Rows - 1) / Rows;
+    Offset = Text + sizeof( Header );
+    Header.TableOffset = (Offset + 7) & ~(size_t) 7;
+    Header.SourceBytes = Text + Width * sizeof(double) * pState->NumVar *
+                                pState->Rows;
+
+    Count = Width * Rows;
+    Bound = PanRawColBound( Count );
+    pColumn = malloc( sizeof(double) * Count );
+    pTable = calloc( pState->NumVar * Header.NumChunks + 1,
+                     sizeof( PanRawColChunk ) );
+    if( Level > 0 )
+    {
+	pScratch = malloc( sizeof(double) * Count );
+	pOut = malloc( Bound );
+    }
+    if( ! pColumn || ! pTable || (Level > 0 && (! pScratch || ! pOut)) )
+	Status = -1;
+
+    if( ! Status )
+    {
+	fwrite( &Header, sizeof( Header ), 1, pFile );
+	for( ; Offset < Header.TableOffset; Offset++ )
+	    fputc( 0, pFile );
+	fwrite( pTable, sizeof( PanRawColChunk ),
+	        pState->NumVar * Header.NumChunks, pFile );
+	Offset = Header.TableOffset +
+	         sizeof( PanRawColChunk ) * pState->NumVar * Header.NumChunks;
+    }
+
+    for( C = 0; ! Status && C < Header.NumChunks; C++ )
+    {
+	size_t First = C * Rows;
+	size_t Samples = pState->Rows - First < Rows ?
+	                 pState->Rows - First : Rows;
+
+	for( K = 0, Var = 0; K < pState->NumWavs; K++ )
+	{
+	    for( J = 0; J < pState->pWavs[K].Cols; J++, Var++ )
+	    {
+		PanRawColChunk *pChunk = pTable + Var * Header.NumChunks + C;
+		const void *pData = pColumn;
+
+		RunColumn( pState, K, J, First, Samples, pColumn );
+		pChunk->Offset = Offset;
+		pChunk->Bytes = Width * Samples * sizeof(double);
+		if( Level > 0 )
+		{
+		    pChunk->Bytes = PanRawColEncode( pColumn, Width * Samples,
+		                                     Level, pScratch, pOut );
+		    pData = pOut;
+		}
+		fwrite( pData, 1, pChunk->Bytes, pFile );
+		Offset += pChunk->Bytes;
+	    }
+	}
+    }
+
+    if( ! Status &&
+        (fseeko( pFile, Header.TableOffset, SEEK_SET ) ||
+         fwrite( pTable, sizeof( PanRawColChunk ),
+                 pState->NumVar * Header.NumChunks, pFile ) !=
+         pState->NumVar * Header.NumChunks) )
+	Status = -1;
+
+    free( pColumn );
+    free( pTable );
+    free( pScratch );
+    free( pOut );
+
+    return( Status );
+}
+
+
+
+
+/*
+ * Output is written to a temporary file renamed at the end, so that a
+ * reader never finds a partial file.
+ */
+static int RunWrite( const RunState *pState, const char *Output,
+                     const char *Netlist, int Level )
+{
+    char *Temporary;
+    FILE *pFile;
+    int Status;
+
+    if( asprintf( &Temporary, "%s.%ld.tmp", Output, (long) getpid() ) < 0 )
+    {
+	fprintf( stderr, "No more memory.\n" );
+	return( PANRUN_EOUTPUT );
+    }
+
+    pFile = fopen( Temporary, "wb" );
+    if( ! pFile )
+    {
+	fprintf( stderr, "<%s> can not be written.\n", Output );
+	free( Temporary );
+	return( PANRUN_EOUTPUT );
+    }
+
+    RunHeader( pState, pFile, Netlist );
+    if( Level < 0 )
+	Status = RunWriteRows( pState, pFile );
+    else
+	Status = RunWriteColumns( pState, pFile, Level );
+
+    if( ferror( pFile ) )
+	Status = -1;
+    if( fclose( pFile ) )
+	Status = -1;
+    if( ! Status && rename( Temporary, Output ) )
+	Status = -1;
+
+    if( Status )
+    {
+	unlink( Temporary );
+	fprintf( stderr, "<%s> can not be written.\n", Output );
+    }
+    free( Temporary );
+
+    return( Status ? PANRUN_EOUTPUT : PANRUN_OK );
+}
+
+
+
+
+/* The result array FILE of "=", mapped once for all the requests. */
+static int RunMap( RunState *pState, const char *File )
+{
+    struct stat Stat;
+    void *pMap;
+    int Fd;
+
+    if( pState->Shared && ! strcmp( pState->Shared, File ) )
+	return( 0 );
+
+    if( pState->Shared )
+	munmap( pState->pShared, sizeof(double) * pState->SharedSize );
+    free( pState->Shared );
+    pState->Shared = NULL;
+    pState->pShared = NULL;
+    pState->SharedSize = 0;
+
+    if( (Fd = open( File, O_RDWR )) < 0 )
+	return( -1 );
+    if( fstat( Fd, &Stat ) || Stat.st_size < (off_t) sizeof(double) )
+    {
+	close( Fd );
+	return( -1 );
+    }
+    pMap = mmap( NULL, Stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd,
+                 0 );
+    close( Fd );
+    if( MAP_FAILED == pMap )
+	return( -1 );
+
+    if( ! (pState->Shared = strdup( File )) )
+    {
+	munmap( pMap, Stat.st_size );
+	return( -1 );
+    }
+    pState->pShared = pMap;
+    pState->SharedSize = Stat.st_size / sizeof(double);
+
+    return( 0 );
+}
+
+
+
+
+/* The memwaveforms of "?" and "=" give one variable each. */
+static int RunSingle( const RunState *pState )
+{
+    if( pState->NumVar == pState->NumWavs )
+	return( PANRUN_OK );
+
+    fprintf( stderr, "The memwaveforms must be single-column to be written "
+             "to the result array.\n" );
+
+    return( PANRUN_EOUTPUT );
+}
+
+
+
+
+/*
+ * Write the memwaveforms fetched by RunFetch to the result array File,
+ * as "= FILE OFFSET CAPACITY WIDTH NAME ..." does.
+ */
+static int RunShare( RunState *pState, const char *File, size_t Offset,
+                     size_t Capacity, int Width )
+{
+    size_t Stride = Capacity * Width;
+    int K, Row;
+
+    if( RunSingle( pState ) )
+	return( PANRUN_EOUTPUT );
+    if( pState->IsComplex && Width < 2 )
+    {
+	fprintf( stderr, "The memwaveforms are complex: they can not be "
+	         "written to a real result array.\n" );
+	return( PANRUN_EOUTPUT );
+    }
+    if( (size_t) pState->Rows > Capacity )
+    {
+	fprintf( stderr, "The memwaveforms have %d samples: only %zu fit in "
+	         "the result array.\n", pState->Rows, Capacity );
+	return( PANRUN_ESPACE );
+    }
+    if( RunMap( pState, File ) ||
+        Offset + pState->NumWavs * Stride > pState->SharedSize )
+    {
+	fprintf( stderr, "The <%s> result array can not be written.\n", File );
+	return( PANRUN_EOUTPUT );
+    }
+
+    for( K = 0; K < pState->NumWavs; K++ )
+    {
+	const MemWaveform *pWav = pState->pWavs + K;
+	double *pDst = pState->pShared + Offset + K * Stride;
+
+	for( Row = 0; Row < pState->Rows; Row++ )
+	{
+	    pDst[ Width * Row ] = RunSample( pWav, pWav->pWavArrayR, Row, 0 );
+	    if( 2 == Width )
+		pDst[ 2 * Row + 1 ] = RunSample( pWav, pWav->pWavArrayI, Row,
+		                                 0 );
+	}
+    }
+
+    return( PANRUN_OK );
+}
+
+
+
+
+/*
+ * The -s loop. The answers go to the standard output of panrun, the
+ * console output of PAN to the standard error (or nowhere if Quiet).
+ */
+static int RunServe( RunState *pState, const char *Netlist, const char *Init,
+                     int Level, int Quiet )
+{
+    FILE *pReply;
+    char *pLine = NULL, *pCommand, **ppNames = NULL, *pToken, Kind;
+    size_t Size = 0;
+    int Fd, Error = 0, Status, NumNames, Width;
+
+    fflush( stdout );
+    Fd = dup( STDOUT_FILENO );
+    pReply = Fd >= 0 ? fdopen( Fd, "w" ) : NULL;
+    if( ! pReply )
+    {
+	fprintf( stderr, "The answers of panrun can not be written.\n" );
+	return( PANRUN_EOUTPUT );
+    }
+    Fd = Quiet ? open( "/dev/null", O_WRONLY ) : dup( STDERR_FILENO );
+    if( Fd >= 0 )
+    {
+	dup2( Fd, STDOUT_FILENO );
+	close( Fd );
+    }
+
+    /* A worker whose INIT fails exits before answering, as if not loaded. */
+    if( Init && RunScript( pState, Init, &NumNames ) )
+    {
+	fclose( pReply );
+	return( RunMatlab[0] ? PANRUN_EMATLAB : PANRUN_ECOMMAND );
+    }
+
+    while( getline( &pLine, &Size, stdin ) >= 0 )
+    {
+	pCommand = RunTrim( pLine );
+	Kind = *pCommand;
+
+	if( '>' != Kind && '?' != Kind && '=' != Kind )
+	{
+	    if( *pCommand && *pCommand != ';' && *pCommand != '%' && ! Error )
+		Error = (pState->Entry.PanMatlabExecuteCommand)( pCommand );
+	    continue;
+	}
+
+	/* At most one token every two characters. */
+	ppNames = realloc( ppNames, (strlen( pCommand ) / 2 + 2) *
+	                            sizeof( char * ) );
+	if( ! ppNames )
+	{
+	    fprintf( stderr, "No more memory.\n" );
+	    return( PANRUN_EOUTPUT );
+	}
+	NumNames = 0;
+	for( pToken = strtok( pCommand + 1, " \t" ); pToken;
+	     pToken = strtok( NULL, " \t" ) )
+	    ppNames[ NumNames++ ] = pToken;
+
+	Status = PANRUN_EOUTPUT;
+	Width = NumNames > 3 ? atoi( ppNames[3] ) : 0;
+	if( Error )
+	    ;
+	else if( '>' == Kind && NumNames > 1 )
+	{
+	    Status = RunFetch( pState, ppNames + 1, NumNames - 1 );
+	    if( ! Status )
+		Status = RunWrite( pState, ppNames[0], Netlist, Level );
+	}
+	else if( '>' == Kind && 0 == NumNames )
+	    Status = PANRUN_OK;
+	else if( '>' == Kind )
+	    fprintf( stderr, "Error: both the OUTPUT file and the NAME of the "
+	             "memwaveforms are needed.\n" );
+	else if( '?' == Kind && NumNames > 0 )
+	{
+	    Status = RunFetch( pState, ppNames, NumNames );
+	    if( ! Status )
+		Status = RunSingle( pState );
+	}
+	else if( '=' == Kind && NumNames > 4 && (1 == Width || 2 == Width) )
+	{
+	    Status = RunFetch( pState, ppNames + 4, NumNames - 4 );
+	    if( ! Status )
+		Status = RunShare( pState, ppNames[0],
+		                   strtoull( ppNames[1], NULL, 10 ),
+		                   strtoull( ppNames[2], NULL, 10 ), Width );
+	}
+	else
+	    fprintf( stderr, "Error: the <%c> request needs %s.\n", Kind,
+	             '?' == Kind ? "the NAME of the memwaveforms" :
+	             "FILE, OFFSET, CAPACITY, WIDTH (1 or 2) and the NAME of "
+	             "the memwaveforms" );
+
+	fflush( stdout );
+	if( RunMatlab[0] )
+	    fprintf( pReply, "%d %d %s\n", Error, PANRUN_EMATLAB, RunMatlab );
+	else if( '?' == Kind )
+	    fprintf( pReply, "%d %d %d %d\n", Error, Status,
+	             Status ? 0 : pState->Rows, Status ? 0 : pState->IsComplex );
+	else if( '=' == Kind )
+	    fprintf( pReply, "%d %d %d\n", Error, Status,
+	             Status ? 0 : pState->Rows );
+	else
+	    fprintf( pReply, "%d %d\n", Error, Status );
+	fflush( pReply );
+	Error = 0;
+	RunMatlab[0] = 0;
+    }
+
+    if( pState->Shared )
+	munmap( pState->pShared, sizeof(double) * pState->SharedSize );
+    free( pState->Shared );
+    free( ppNames );
+    free( pLine );
+    fclose( pReply );
+
+    return( PANRUN_OK );
+}
+
+
+
+
+int main( int argc, char *argv[] )
+{
+    RunState State;
+    char *Log = NULL, *RawDir = NULL, *WorkDir = NULL, *Output = NULL;
+    char *Init = NULL;
+    int Level = -1, Quiet = 0, Timing = 0, Serve = 0, Option, Status;
+    int Commands = 0;
+    uint64_t Start;
+    double LoadMs, ScriptMs;
+
+    while( -1 != (Option = getopt( argc, argv, "c:i:l:r:w:o:qst" )) )
+    {
+	switch( Option )
+	{
+	    case 'c':
+		Level = atoi( optarg );
+		if( Level < 0 || Level > 9 )
+		{
+		    fprintf( stderr, "Error: LEVEL must be an integer between 0 "
+		             "(no compression) and 9.\n" PANRUN_USAGE );
+		    return( PANRUN_EUSAGE );
+		}
+		break;
+	    case 'i': Init = optarg;    break;
+	    case 'l': Log = optarg;     break;
+	    case 'r': RawDir = optarg;  break;
+	    case 'w': WorkDir = optarg; break;
+	    case 'o': Output = optarg;  break;
+	    case 'q': Quiet = 1;        break;
+	    case 's': Serve = 1;        break;
+	    case 't': Timing = 1;       break;
+	    default:
+		fprintf( stderr, PANRUN_USAGE );
+		return( PANRUN_EUSAGE );
+	}
+    }
+
+    if( Serve && (argc - optind != 1 || Output || Timing) )
+    {
+	fprintf( stderr, "Error: -s takes the netlist only.\n" PANRUN_USAGE );
+	return( PANRUN_EUSAGE );
+    }
+    if( ! Serve && argc - optind < 2 )
+    {
+	fprintf( stderr, "Error: missing netlist or script.\n" PANRUN_USAGE );
+	return( PANRUN_EUSAGE );
+    }
+    if( (argc - optind > 2) != (NULL != Output) )
+    {
+	fprintf( stderr, "Error: both the OUTPUT file and the NAME of the "
+	         "memwaveforms are needed.\n" PANRUN_USAGE );
+	return( PANRUN_EUSAGE );
+    }
+
+    /* The console output of PAN goes to the standard output. */
+    if( Quiet && ! Serve )
+    {
+	int Fd = open( "/dev/null", O_WRONLY );
+
+	fflush( stdout );
+	if( Fd >= 0 )
+	{
+	    dup2( Fd, STDOUT_FILENO );
+	    close( Fd );
+	}
+    }
+
+    memset( &State, 0, sizeof( State ) );
+
+    Start = PanCounterNow();
+    Status = RunLoad( &State, argv[ optind ], Log, RawDir, WorkDir );
+    if( ! Status && Init && ! Serve )
+	Status = RunScript( &State, Init, &Commands );
+    LoadMs = RunMs( Start );
+    if( Status )
+	return( RunMatlab[0] ? PANRUN_EMATLAB : Status );
+
+    if( Serve )
+    {
+	Status = RunServe( &State, argv[ optind ], Init, Level, Quiet );
+	free( State.pWavs );
+	return( Status );
+    }
+
+    Start = PanCounterNow();
+    Status = RunScript( &State, argv[ optind + 1 ], &Commands );
+    ScriptMs = RunMs( Start );
+    if( Status )
+	return( RunMatlab[0] ? PANRUN_EMATLAB : Status );
+
+    Start = PanCounterNow();
+    if( Output )
+    {
+	Status = RunFetch( &State, argv + optind + 2, argc - optind - 2 );
+	if( ! Status )
+	    Status = RunWrite( &State, Output, argv[ optind ], Level );
+    }
+    fflush( stdout );
+
+    if( Timing )
+	fprintf( stderr, "panrun: load %.1f ms, %d commands %.1f ms, "
+	         "output %.1f ms\n", LoadMs, Commands, ScriptMs,
+	         RunMs( Start ) );
+
+    free( State.pWavs );
+
+    return( Status );
+}
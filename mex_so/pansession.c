@@ -0,0 +1,772 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+
+/*
+ * Every gateway links its own copy of this file and therefore owns its own
+ * Session. The copies are kept consistent through the PAN_MAT_SESSION_ENV
+ * generation number published by pannet.
+ */
+static PanSession Session;
+
+/* The address of the shared table of the named sessions. */
+static PanSessionTable *Table;
+
+
+
+
+static int SessionPath( PanSession *pSession )
+{
+    char *ShlPath = (char *) getenv( PAN_MAT_SHL_PATH_ENV );
+    char *Path;
+
+    if( ShlPath )
+    {
+        Path = (char *) malloc( (strlen(ShlPath) + strlen(PAN_MAT_SHL_NAME) + 20) *
+	                        sizeof( char ) );
+	if( ! Path )
+	    return( PAN_SESSION_NO_MEMORY );
+
+	sprintf( Path, "%s/%s", ShlPath, PAN_MAT_SHL_NAME );
+    }
+    else
+    {
+        Path = (char *) malloc((strlen(PAN_MAT_SHL_NAME)+20) * sizeof( char ) );
+	if( ! Path )
+	    return( PAN_SESSION_NO_MEMORY );
+
+	sprintf( Path, "%s", PAN_MAT_SHL_NAME );
+    }
+
+    free( pSession->Path );
+    pSession->Path = Path;
+
+    return( PAN_SESSION_OK );
+}
+
+
+
+
+static void SessionResolve( PanSession *pSession, void *Module )
+{
+    PanEntryTable *pEntry = &(pSession->Entry);
+
+    *(void **) &(pEntry->InitialiseGlobals) =
+	dlsym( Module, "InitialiseGlobals" );
+    *(void **) &(pEntry->MatlabPanInit) =
+	dlsym( Module, "MatlabPanInit" );
+    *(void **) &(pEntry->PanMatlabExecuteCommand) =
+	dlsym( Module, "PanMatlabExecuteCommand" );
+    *(void **) &(pEntry->PanMatlabGet) =
+	dlsym( Module, "PanMatlabGet" );
+    *(void **) &(pEntry->PanMatlabRedraw) =
+	dlsym( Module, "PanMatlabRedraw" );
+    *(void **) &(pEntry->MemWaveformDeleteByName) =
+	dlsym( Module, "MemWaveformDeleteByName" );
+}
+
+
+
+
+static void SessionClear( void )
+{
+    memset( &(Session.Entry), 0, sizeof( PanEntryTable ) );
+    Session.Generation = 0;
+}
+
+
+
+
+static PanSessionTable *SessionTableGet( void )
+{
+    char *Tag, Buffer[ 32 ];
+    PanSessionTable *pTable = NULL;
+
+    if( Table )
+	return( Table );
+
+    Tag = getenv( PAN_MAT_SESSIONS_ENV );
+    if( Tag && 1 == sscanf( Tag, "%p", (void **) &pTable ) && pTable )
+	return( Table = pTable );
+
+    pTable = (PanSessionTable *) calloc( 1, sizeof( PanSessionTable ) );
+    if( ! pTable )
+	return( NULL );
+
+    pthread_mutex_init( &(pTable->Lock), NULL );
+
+    sprintf( Buffer, "%p", (void *) pTable );
+    setenv( PAN_MAT_SESSIONS_ENV, Buffer, 1 );
+
+    return( Table = pTable );
+}
+
+
+
+
+int PanSessionLoad( PanSession **ppSession )
+{
+    PanSessionTable *pTable = SessionTableGet();
+    unsigned long Generation;
+    char Buffer[ 32 ];
+
+    *ppSession = &Session;
+
+    /*
+     * Withdraw the published generation first: if loading fails the other
+     * gateways must not keep using entry points of the unloaded module.
+     */
+    unsetenv( PAN_MAT_SESSION_ENV );
+    SessionClear();
+
+    if( ! pTable )
+	return( PAN_SESSION_NO_MEMORY );
+
+    /*
+     * Every attempt takes a new number from the shared counter, which
+     * outlives pannet: a generation is never published twice, even after a
+     * failed load, so no gateway can mistake the new module for the one
+     * whose entries it resolved.
+     */
+    pthread_mutex_lock( &(pTable->Lock) );
+    Generation = ++pTable->Generation;
+    pthread_mutex_unlock( &(pTable->Lock) );
+
+    if( Session.Module )
+    {
+        dlclose( Session.Module );
+	Session.Module = NULL;
+    }
+
+    if( SessionPath( &Session ) )
+        return( PAN_SESSION_NO_MEMORY );
+
+    Session.Module = dlopen( Session.Path,
+                             RTLD_LAZY | RTLD_DEEPBIND | RTLD_GLOBAL );
+    if( ! Session.Module )
+    {
+	char *String = dlerror();
+	if( String )
+	{
+	    mexPrintf( "Reason for loading failure is \"%s\"\n", String );
+	}
+	return( PAN_SESSION_NOT_LOADED );
+    }
+
+    SessionResolve( &Session, Session.Module );
+
+    if( ! Session.Entry.InitialiseGlobals || ! Session.Entry.MatlabPanInit )
+    {
+        dlclose( Session.Module );
+	Session.Module = NULL;
+	return( PAN_SESSION_NO_ENTRY );
+    }
+
+    Session.Generation = Generation;
+
+    sprintf( Buffer, "%lu", Session.Generation );
+    setenv( PAN_MAT_SESSION_ENV, Buffer, 1 );
+
+    return( PAN_SESSION_OK );
+}
+
+
+
+
+int PanSessionAttach( PanSession **ppSession )
+{
+    char *Tag = getenv( PAN_MAT_SESSION_ENV );
+    unsigned long Generation;
+    void *Module;
+
+    *ppSession = &Session;
+
+    if( ! Tag )
+    {
+        SessionClear();
+	return( PAN_SESSION_NOT_LOADED );
+    }
+
+    Generation = strtoul( Tag, NULL, 10 );
+    if( Generation == Session.Generation )
+        return( PAN_SESSION_OK );
+
+    /*
+     * pannet (re)loaded the netlist since the last call: resolve the entry
+     * points of the new module once and release the borrowed reference.
+     */
+    SessionClear();
+
+    if( SessionPath( &Session ) )
+        return( PAN_SESSION_NO_MEMORY );
+
+    Module = dlopen( Session.Path, RTLD_LAZY | RTLD_DEEPBIND | RTLD_NOLOAD );
+    if( ! Module )
+        return( PAN_SESSION_NOT_LOADED );
+
+    SessionResolve( &Session, Module );
+    dlclose( Module );
+
+    Session.Generation = Generation;
+
+    return( PAN_SESSION_OK );
+}
+
+
+
+
+/* The named session Name, NULL if there is none. Called with the lock held. */
+static PanSession *SessionFind( PanSessionTable *pTable, const char *Name )
+{
+    int K;
+
+    for( K = 0; K < PAN_SESSION_MAX_NAMED; K++ )
+    {
+	if( pTable->Named[K].Name[0] && ! strcmp( pTable->Named[K].Name, Name ) )
+	    return( pTable->Named + K );
+    }
+
+    return( NULL );
+}
+
+
+
+
+static void SessionUnload( PanSession *pSession )
+{
+    memset( &(pSession->Entry), 0, sizeof( PanEntryTable ) );
+    pSession->Generation = 0;
+
+    if( pSession->Module )
+    {
+	dlclose( pSession->Module );
+	pSession->Module = NULL;
+    }
+}
+
+
+
+
+static void SessionFree( PanSession *pSession )
+{
+    /* The slot keeps its memwaveform registry for the next session. */
+    SessionUnload( pSession );
+    free( pSession->Path );
+    pSession->Path = NULL;
+    pSession->Name[0] = 0;
+}
+
+
+
+
+/*
+ * Drop the reference of the calling thread, unloading the session if it
+ * was closed meanwhile. Called with the lock held.
+ */
+static void SessionRelease( PanSessionTable *pTable )
+{
+    pthread_t Self = pthread_self();
+    PanSession *pSession;
+    int K;
+
+    for( K = 0; K < PAN_SESSION_MAX_HOLDERS; K++ )
+    {
+	if( ! pTable->Holders[K].Slot ||
+	    ! pthread_equal( pTable->Holders[K].Thread, Self ) )
+	    continue;
+
+	pSession = pTable->Named + pTable->Holders[K].Slot - 1;
+	pTable->Holders[K].Slot = 0;
+	if( ! --pSession->Users && ! pSession->Name[0] )
+	    SessionFree( pSession );
+	return;
+    }
+}
+
+
+
+
+/* Make the calling thread hold pSession. Called with the lock held. */
+static int SessionHold( PanSessionTable *pTable, PanSession *pSession )
+{
+    int K;
+
+    for( K = 0; K < PAN_SESSION_MAX_HOLDERS; K++ )
+    {
+	if( ! pTable->Holders[K].Slot )
+	{
+	    pTable->Holders[K].Thread = pthread_self();
+	    pTable->Holders[K].Slot = pSession->Index;
+	    pSession->Users++;
+	    return( PAN_SESSION_OK );
+	}
+    }
+
+    return( PAN_SESSION_BUSY );
+}
+
+
+
+
+/*
+ * dlopen returns the module already loaded for a path: a named session
+ * maps a private copy of panMat.so instead, so that the globals of the
+ * simulator are not shared with the other sessions. Its undefined symbols,
+ * the MATLAB API among them, are resolved as for the default session,
+ * while RTLD_DEEPBIND binds its own symbols to the copy. The copy is
+ * unlinked as soon as it is mapped.
+ */
+static void *SessionOpenCopy( const char *Path )
+{
+    const char *Dir = getenv( "TMPDIR" );
+    struct link_map *pMap;
+    void *Module = NULL, *Found = NULL;
+    char *Copy, Buffer[ 65536 ];
+    ssize_t Read = 0;
+    int In = -1, Out = -1;
+
+    /* A bare name stands for the file a plain dlopen would map. */
+    if( ! strchr( Path, '/' ) )
+    {
+	if( ! (Found = dlopen( Path, RTLD_LAZY | RTLD_LOCAL )) )
+	    return( NULL );
+	if( dlinfo( Found, RTLD_DI_LINKMAP, &pMap ) )
+	{
+	    dlclose( Found );
+	    return( NULL );
+	}
+	Path = pMap->l_name;
+    }
+
+    if( asprintf( &Copy, "%s/panMat.XXXXXX.so", Dir && *Dir ? Dir : "/tmp" ) < 0 )
+    {
+	if( Found )
+	    dlclose( Found );
+	return( NULL );
+    }
+
+    if( (In = open( Path, O_RDONLY | O_CLOEXEC )) >= 0 &&
+        (Out = mkostemps( Copy, 3, O_CLOEXEC )) >= 0 )
+    {
+	while( (Read = read( In, Buffer, sizeof( Buffer ) )) > 0 ||
+	       (Read < 0 && EINTR == errno) )
+	{
+	    if( Read > 0 && write( Out, Buffer, Read ) != Read )
+	    {
+		Read = -1;
+		break;
+	    }
+	}
+	if( close( Out ) )
+	    Read = -1;
+	if( ! Read )
+	    Module = dlopen( Copy, RTLD_LAZY | RTLD_LOCAL | RTLD_DEEPBIND );
+	unlink( Copy );
+    }
+    else
+	Read = -1;
+
+    if( Read )
+	mexPrintf( "Reason for loading failure is \"%s\"\n", strerror( errno ) );
+
+    if( In >= 0 )
+	close( In );
+    if( Found )
+	dlclose( Found );
+    free( Copy );
+
+    return( Module );
+}
+
+
+
+
+/*
+ * A named session loads its own copy of panMat.so (see SessionOpenCopy).
+ * The libraries panMat.so depends on are loaded once and shared by all the
+ * sessions: only the state kept in panMat.so itself is private.
+ */
+int PanSessionLoadNamed( const char *Name, PanSession **ppSession )
+{
+    PanSessionTable *pTable;
+    PanSession *pSession;
+    int K, Status = PAN_SESSION_OK;
+
+    PanSessionDetach();
+    if( ! *Name )
+	return( PanSessionLoad( ppSession ) );
+
+    *ppSession = &Session;
+    if( ! (pTable = SessionTableGet()) )
+	return( PAN_SESSION_NO_MEMORY );
+
+    pthread_mutex_lock( &(pTable->Lock) );
+
+    pSession = SessionFind( pTable, Name );
+    if( pSession && pSession->Users )
+    {
+	pthread_mutex_unlock( &(pTable->Lock) );
+	*ppSession = pSession;
+	return( PAN_SESSION_BUSY );
+    }
+    for( K = 0; ! pSession && K < PAN_SESSION_MAX_NAMED; K++ )
+    {
+	if( ! pTable->Named[K].Name[0] && ! pTable->Named[K].Users )
+	{
+	    pSession = pTable->Named + K;
+	    pSession->Index = K + 1;
+	    snprintf( pSession->Name, PAN_SESSION_NAME_SIZE, "%s", Name );
+	}
+    }
+    if( ! pSession )
+    {
+	pthread_mutex_unlock( &(pTable->Lock) );
+	return( PAN_SESSION_NO_SLOT );
+    }
+    *ppSession = pSession;
+
+    /* A session that can not be held keeps its module. */
+    if( SessionHold( pTable, pSession ) )
+    {
+	/* A slot just taken goes back. */
+	if( ! pSession->Path )
+	    pSession->Name[0] = 0;
+	pthread_mutex_unlock( &(pTable->Lock) );
+	return( PAN_SESSION_BUSY );
+    }
+
+    SessionUnload( pSession );
+
+    if( SessionPath( pSession ) )
+	Status = PAN_SESSION_NO_MEMORY;
+    else if( ! (pSession->Module = SessionOpenCopy( pSession->Path )) )
+    {
+	char *String = dlerror();
+	if( String )
+	{
+	    mexPrintf( "Reason for loading failure is \"%s\"\n", String );
+	}
+	Status = PAN_SESSION_NOT_LOADED;
+    }
+    else
+    {
+	SessionResolve( pSession, pSession->Module );
+
+	/* The entries are kept to name the missing one. */
+	if( ! pSession->Entry.InitialiseGlobals ||
+	    ! pSession->Entry.MatlabPanInit )
+	{
+	    dlclose( pSession->Module );
+	    pSession->Module = NULL;
+	    Status = PAN_SESSION_NO_ENTRY;
+	}
+	else
+	    pSession->Generation = ++pTable->Generation;
+    }
+
+    pthread_mutex_unlock( &(pTable->Lock) );
+
+    return( Status );
+}
+
+
+
+
+int PanSessionClose( const char *Name )
+{
+    PanSessionTable *pTable = SessionTableGet();
+    PanSession *pSession;
+    int Status = PAN_SESSION_UNKNOWN;
+
+    if( ! pTable )
+	return( PAN_SESSION_NO_MEMORY );
+
+    pthread_mutex_lock( &(pTable->Lock) );
+
+    SessionRelease( pTable );
+    pSession = SessionFind( pTable, Name );
+    if( pSession && pSession->Users )
+    {
+	/* The last holder unloads it. */
+	pSession->Name[0] = 0;
+	Status = PAN_SESSION_BUSY;
+    }
+    else if( pSession )
+    {
+	SessionFree( pSession );
+	Status = PAN_SESSION_OK;
+    }
+
+    pthread_mutex_unlock( &(pTable->Lock) );
+
+    return( Status );
+}
+
+
+
+
+int PanSessionList( char ***pppNames )
+{
+    PanSessionTable *pTable = SessionTableGet();
+    char **ppNames;
+    int K, Count = 0;
+
+    *pppNames = NULL;
+    ppNames = (char **) malloc( PAN_SESSION_MAX_NAMED *
+                                (sizeof( char * ) + PAN_SESSION_NAME_SIZE) );
+    if( ! pTable || ! ppNames )
+    {
+	free( ppNames );
+	return( 0 );
+    }
+
+    pthread_mutex_lock( &(pTable->Lock) );
+    for( K = 0; K < PAN_SESSION_MAX_NAMED; K++ )
+    {
+	if( ! pTable->Named[K].Name[0] )
+	    continue;
+
+	ppNames[ Count ] = (char *) (ppNames + PAN_SESSION_MAX_NAMED) +
+	                   Count * PAN_SESSION_NAME_SIZE;
+	strcpy( ppNames[ Count++ ], pTable->Named[K].Name );
+    }
+    pthread_mutex_unlock( &(pTable->Lock) );
+
+    *pppNames = ppNames;
+
+    return( Count );
+}
+
+
+
+
+int PanSessionAttachNamed( const char *Name, PanSession **ppSession )
+{
+    PanSessionTable *pTable;
+    PanSession *pSession;
+    int Status;
+
+    PanSessionDetach();
+    if( ! *Name )
+	return( PanSessionAttach( ppSession ) );
+
+    *ppSession = &Session;
+    if( ! (pTable = SessionTableGet()) )
+	return( PAN_SESSION_NO_MEMORY );
+
+    /* The reference keeps a concurrent PanSessionClose from unloading it. */
+    pthread_mutex_lock( &(pTable->Lock) );
+    if( ! (pSession = SessionFind( pTable, Name )) )
+	Status = PAN_SESSION_UNKNOWN;
+    else if( ! (Status = SessionHold( pTable, pSession )) )
+    {
+	*ppSession = pSession;
+	Status = pSession->Module ? PAN_SESSION_OK : PAN_SESSION_NOT_LOADED;
+    }
+    pthread_mutex_unlock( &(pTable->Lock) );
+
+    return( Status );
+}
+
+
+
+
+void PanSessionDetach( void )
+{
+    PanSessionTable *pTable;
+
+    /* Nothing is held before the first named session. */
+    if( ! Table && ! getenv( PAN_MAT_SESSIONS_ENV ) )
+	return;
+    if( ! (pTable = SessionTableGet()) )
+	return;
+
+    pthread_mutex_lock( &(pTable->Lock) );
+    SessionRelease( pTable );
+    pthread_mutex_unlock( &(pTable->Lock) );
+}
+
+
+
+
+int PanSessionArgs( int nrhs, const mxArray *prhs[], char *Name )
+{
+    char Key[ 8 ];
+
+    Name[0] = 0;
+    if( nrhs < 3 || ! mxIsChar( prhs[ nrhs - 2 ] ) ||
+        mxGetString( prhs[ nrhs - 2 ], Key, sizeof( Key ) ) ||
+        strcasecmp( Key, "session" ) )
+	return( nrhs );
+
+    if( ! mxIsChar( prhs[ nrhs - 1 ] ) ||
+        mxGetString( prhs[ nrhs - 1 ], Name, PAN_SESSION_NAME_SIZE ) )
+	return( -1 );
+
+    return( nrhs - 2 );
+}
+
+
+
+
+void PanSessionErrMsg( int Status, const char *EntryName )
+{
+    const char *Path = Session.Path ? Session.Path : PAN_MAT_SHL_NAME;
+    int Count, Length;
+    char *MexErrBuffer;
+
+    switch( Status )
+    {
+	case PAN_SESSION_NO_MEMORY:
+	    mexErrMsgTxt( "Unable to allocate memory.\n" );
+	    return;
+
+	case PAN_SESSION_NO_SLOT:
+	    Length = strlen( EntryName ) + 150;
+	    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+	    if( ! MexErrBuffer )
+	    {
+		mexErrMsgTxt( "No more memory.\n" );
+		return;
+	    }
+
+	    Count = sprintf( MexErrBuffer, "The <%s> session can not be "
+		"created: at most %d named sessions can be loaded.\n",
+		EntryName, PAN_SESSION_MAX_NAMED );
+	    break;
+
+	case PAN_SESSION_BUSY:
+	    Length = strlen( EntryName ) + 150;
+	    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+	    if( ! MexErrBuffer )
+	    {
+		mexErrMsgTxt( "No more memory.\n" );
+		return;
+	    }
+
+	    Count = sprintf( MexErrBuffer, "The <%s> session is in use by "
+		"another thread.\n", EntryName );
+	    break;
+
+	case PAN_SESSION_UNKNOWN:
+	    Length = 2 * strlen( EntryName ) + 150;
+	    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+	    if( ! MexErrBuffer )
+	    {
+		mexErrMsgTxt( "No more memory.\n" );
+		return;
+	    }
+
+	    Count = sprintf( MexErrBuffer, "The <%s> session does not exist.\n"
+		"Run \"pannet('filename', 'session', '%s')\" command first.\n",
+		EntryName, EntryName );
+	    break;
+
+	case PAN_SESSION_NOT_LOADED:
+	    if( EntryName && *EntryName )
+	    {
+		Length = 2 * strlen( EntryName ) + 150;
+		MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+		if( ! MexErrBuffer )
+		{
+		    mexErrMsgTxt( "No more memory.\n" );
+		    return;
+		}
+
+		Count = sprintf( MexErrBuffer, "No netlist is loaded in the <%s> "
+		    "session.\nRun \"pannet('filename', 'session', '%s')\" "
+		    "command before reading simulation results.\n",
+		    EntryName, EntryName );
+		break;
+	    }
+
+	    Length = strlen( Path ) + 150;
+	    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+	    if( ! MexErrBuffer )
+	    {
+		mexErrMsgTxt( "No more memory.\n" );
+		return;
+	    }
+
+	    Count = sprintf( MexErrBuffer, "The <%s> shared libray can not be "
+		"loaded.\n"
+		"Run \"pannet('filename')\" command before reading simulation "
+		"results.\n", Path );
+	    break;
+
+	case PAN_SESSION_NO_ENTRY:
+	    Length = strlen( Path ) + strlen( EntryName ) + 100;
+	    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+	    if( ! MexErrBuffer )
+	    {
+		mexErrMsgTxt( "No more memory.\n" );
+		return;
+	    }
+
+	    Count = sprintf( MexErrBuffer, "The <%s> evaluate routine is not "
+		    "found in <%s> shared module.\n\n", EntryName, Path );
+	    break;
+
+	default:
+	    return;
+    }
+
+    if( Count >= Length )
+	abort();
+
+    mexErrMsgTxt( MexErrBuffer );
+}
+
+
+
+
+int PanMemWaveformGet( PanSession *Session, MemWaveform *pWav )
+{
+    pWav->pWavArrayR = pWav->pWavArrayI = 0;
+    pWav->pWavArrayS = 0;
+    pWav->Rows = pWav->Cols = 0;
+
+    PanCounterPanEnter();
+    pWav->Found = (Session->Entry.PanMatlabGet)( pWav->Name,
+                       &(pWav->pWavArrayR), &(pWav->pWavArrayI),
+                       &(pWav->pWavArrayS), &(pWav->Rows), &(pWav->Cols) );
+    PanCounterPanLeave();
+
+    return( pWav->Found );
+}
+
+
+
+
+void PanMemWaveformErrMsg( const char *MemWaveformName )
+{
+    int Count, Length;
+    char *MexErrBuffer;
+
+    Length = strlen( MemWaveformName ) + 300;
+    MexErrBuffer = mxCalloc( Length, sizeof( char ) );
+    if( NULL == MexErrBuffer )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    Count = sprintf( MexErrBuffer, "The <%s> variable can not be found in "
+	"the simulator data-bases.\n\n", MemWaveformName );
+
+    if( Count >= Length )
+	abort();
+
+    mexErrMsgTxt( MexErrBuffer );
+}
@@ -0,0 +1,177 @@
+#ifndef PAN_SESSION_H
+#define PAN_SESSION_H
+
+#include <pthread.h>
+#ifndef PAN_SESSION_NO_MEX
+#include "mex.h"
+#endif
+
+#define PAN_MAT_SHL_NAME      "panMat.so"
+#define PAN_MAT_SHL_PATH_ENV  "PAN_MAT_SHL_PATH"
+
+/*
+ * pannet publishes the generation number of the currently loaded netlist
+ * in this environment variable. The other gateways compare it with the
+ * generation they resolved their entry points for and refresh their table
+ * only when pannet has reloaded panMat.so.
+ */
+#define PAN_MAT_SESSION_ENV   "PAN_MAT_SESSION"
+
+/*
+ * pannet publishes the address of the PanSessionTable of the named
+ * sessions in this environment variable, as done for PAN_MAT_STATS.
+ */
+#define PAN_MAT_SESSIONS_ENV  "PAN_MAT_SESSIONS"
+
+/*
+ * Every named session loads a private copy of panMat.so, with its own
+ * globals; the libraries it depends on, MATLAB's among them, are shared
+ * with the default session. A thread holds at most one reference to a
+ * named session, hence PAN_SESSION_MAX_HOLDERS threads can use them at
+ * once.
+ */
+#define PAN_SESSION_MAX_NAMED    15
+#define PAN_SESSION_MAX_HOLDERS  64
+#define PAN_SESSION_NAME_SIZE    64
+
+#define PAN_SESSION_OK          0
+#define PAN_SESSION_NO_MEMORY   1
+#define PAN_SESSION_NOT_LOADED  2
+#define PAN_SESSION_NO_ENTRY    3
+#define PAN_SESSION_NO_SLOT     4
+#define PAN_SESSION_UNKNOWN     5
+#define PAN_SESSION_BUSY        6
+
+/*
+ * Entry points of panMat.so. An entry is NULL if the shared module does
+ * not export it: every gateway checks the one it needs before calling it.
+ */
+typedef struct
+{
+    void (*InitialiseGlobals)( void );
+    int  (*MatlabPanInit)( int, char ** );
+    int  (*PanMatlabExecuteCommand)( char * );
+    int  (*PanMatlabGet)( char *, double **, double **, char **, int *, int * );
+    void (*PanMatlabRedraw)( char );
+    char (*MemWaveformDeleteByName)( char * );
+} PanEntryTable;
+
+/*
+ * Only pannet owns a reference to Module: the other gateways release the
+ * handle right after resolving the entries, so that a reload done by
+ * pannet really unloads the previous copy of panMat.so.
+ *
+ * The default session (Index 0, Name "") is the one loaded by pannet
+ * without a session name: every gateway keeps its own copy of it. The
+ * named sessions (Index 1 to PAN_SESSION_MAX_NAMED) live in the shared
+ * PanSessionTable and are used in place by all the gateways. pMemReg is
+ * the memwaveform registry of a named session, owned by panmemreg.c, and
+ * Users the number of threads that hold a reference to it.
+ */
+typedef struct
+{
+    void          *Module;
+    char          *Path;
+    unsigned long  Generation;
+    PanEntryTable  Entry;
+    int            Index;
+    char           Name[ PAN_SESSION_NAME_SIZE ];
+    void          *pMemReg;
+    int            Users;
+} PanSession;
+
+/* The reference of Thread to the named session Slot, 0 if none. */
+typedef struct
+{
+    pthread_t  Thread;
+    int        Slot;
+} PanSessionHolder;
+
+/*
+ * The named sessions: a slot is free when its Name is empty and nobody
+ * holds it. A closed session still held is unloaded by its last holder.
+ * Generation numbers the load attempts of all the sessions, the default
+ * one included, and never goes back.
+ */
+typedef struct
+{
+    pthread_mutex_t   Lock;
+    unsigned long     Generation;
+    PanSession        Named[ PAN_SESSION_MAX_NAMED ];
+    PanSessionHolder  Holders[ PAN_SESSION_MAX_HOLDERS ];
+} PanSessionTable;
+
+/*
+ * A memwaveform as returned by PanMatlabGet. Single-column numeric data is
+ * a plain vector, multi-column data an array of row pointers.
+ */
+typedef struct
+{
+    char   *Name;
+    int     Found;
+    int     Rows, Cols;
+    double *pWavArrayR, *pWavArrayI;
+    char   *pWavArrayS;
+} MemWaveform;
+
+/* Used by pannet: drop the current session and load panMat.so again. */
+int  PanSessionLoad( PanSession **ppSession );
+
+/*
+ * Used by pannet: load panMat.so again in the session Name, which is
+ * created if needed. The default session if Name is "". The calling
+ * thread then holds the session, which PAN_SESSION_BUSY reports to be
+ * held by another thread.
+ */
+int  PanSessionLoadNamed( const char *Name, PanSession **ppSession );
+
+/*
+ * Unload the named session Name and free its slot. PAN_SESSION_BUSY if
+ * another thread holds it: its name is released at once, the module when
+ * the last holder lets it go.
+ */
+int  PanSessionClose( const char *Name );
+
+/*
+ * The names of the named sessions in *pppNames, to be released with
+ * free() (one block): their number.
+ */
+int  PanSessionList( char ***pppNames );
+
+/* Used by the other gateways: return the session loaded by pannet. */
+int  PanSessionAttach( PanSession **ppSession );
+
+/*
+ * As PanSessionAttach for the session Name, the default one if Name is
+ * "". A named session stays loaded until the calling thread releases it
+ * with PanSessionDetach, or attaches, loads or closes a session again:
+ * the latter also covers a gateway left by a MATLAB error.
+ */
+int  PanSessionAttachNamed( const char *Name, PanSession **ppSession );
+
+/* Release the named session held by the calling thread, if any. */
+void PanSessionDetach( void );
+
+#ifndef PAN_SESSION_NO_MEX
+/*
+ * Strip a trailing 'session', NAME pair from the arguments of a gateway,
+ * which take at least one argument before it: copy NAME into Name ("" if
+ * there is no pair) and return the number of the other arguments, -1 if
+ * NAME is not a string shorter than PAN_SESSION_NAME_SIZE.
+ */
+int  PanSessionArgs( int nrhs, const mxArray *prhs[], char *Name );
+#endif
+
+/* Look up pWav->Name in the simulator data-bases: return pWav->Found. */
+int  PanMemWaveformGet( PanSession *Session, MemWaveform *pWav );
+
+/* Raise the MATLAB error for a memwaveform that was not found. */
+void PanMemWaveformErrMsg( const char *MemWaveformName );
+
+/*
+ * Raise the MATLAB error corresponding to a PanSession* status code. The
+ * name of the session for PAN_SESSION_NO_SLOT and PAN_SESSION_UNKNOWN.
+ */
+void PanSessionErrMsg( int Status, const char *EntryName );
+
+#endif
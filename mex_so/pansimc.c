@@ -4,17 +4,26 @@
 #include <string.h>
 #include <errno.h>
 #include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+#include "panconsole.h"
 
-#define PAN_MAT_SHL_NAME      "panMat.so"
+#define PANSIMC_USAGE \
+    "Usage: [error = ] pansimc('command'[, 'session', NAME])"
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
-    void *Module;
+    char SessionName[ PAN_SESSION_NAME_SIZE ];
 
-    if( nrhs != 1 )
+    if( nrhs < 1 || nrhs > 3 )
     {
-	mexErrMsgTxt( "Error: missed simulator command. Usage: "
-	              "pansimc('command')");
+	mexErrMsgTxt( "Error: missed simulator command. " PANSIMC_USAGE );
+	return;
+    }
+    if( 1 != PanSessionArgs( nrhs, prhs, SessionName ) )
+    {
+	mexErrMsgTxt( "Error: the only allowed option is 'session', NAME. "
+	              PANSIMC_USAGE );
 	return;
     }
 
@@ -24,97 +33,30 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	              "Usage: pansimc('command')" );
 	return;
     }
-    if( nlhs != 0 )
+    if( nlhs > 1 )
     {
-	mexErrMsgTxt( "Error: output variable is not required. "
-	              "Usage: pansimc('command')");
+	mexErrMsgTxt( "Error: at most one output variable is allowed. "
+	              "Usage: [error = ] pansimc('command')");
 	return;
     }
 
-    char *ShlPath = (char *) getenv( "PAN_MAT_SHL_PATH" );
-    char *Path;
+    PanSession *Session;
+    int Status;
 
-    if( ShlPath )
-    {
-        Path = (char *) malloc((strlen(ShlPath)+strlen(PAN_MAT_SHL_NAME)+20) *
-	                        sizeof( char ) );
-	if( ! Path )
-	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
-	}
+    PanCounterBegin( PAN_COUNTER_PANSIMC );
 
-	sprintf( Path, "%s/%s", ShlPath, PAN_MAT_SHL_NAME );
-    }
-    else
+    if( (Status = PanSessionAttachNamed( SessionName, &Session )) )
     {
-        Path = (char *) malloc( (strlen(PAN_MAT_SHL_NAME) + 20)*sizeof(char) );
-	if( ! Path )
-	{
-	     mexErrMsgTxt( "Unable to allocate memory.\n" );
-	     return;
-	}
-
-	sprintf( Path, "%s", PAN_MAT_SHL_NAME );
-    }
-
-    Module = dlopen( Path, RTLD_LAZY | RTLD_DEEPBIND | RTLD_NOLOAD );
-    if( ! Module )
-    {
-	int Count, Length;
-	char *MexErrBuffer;
-
-	Length = strlen( Path ) + 100;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( ! MexErrBuffer )
-	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
-	}
-
-	Count = sprintf( MexErrBuffer, "The <%s> shared libray can not be "
-	    "loaded. Run \"pannet('command')\" command to read a circuit "
-	    "netlist.\n", Path );
-
-	if( Count >= Length )
-	    abort();
-
-	mexErrMsgTxt( MexErrBuffer );
-
+	PanSessionErrMsg( Status, SessionName );
 	return;
     }
 
-    int (*Entry)( char * );
-    char *EntryName = "PanMatlabExecuteCommand";
-
-    Entry = dlsym( Module, EntryName );
-    if( ! Entry )
+    if( ! Session->Entry.PanMatlabExecuteCommand )
     {
-	dlclose( Module );
-
-	int Count, Length;
-	char *MexErrBuffer;
-
-	Length = strlen( Path ) + strlen( EntryName ) + 100;
-	MexErrBuffer = mxCalloc( Length, sizeof( char ) );
-	if( NULL == MexErrBuffer )
-	{
-	    mexErrMsgTxt( "No more memory.\n" );
-	    return;
-	}
-
-	Count = sprintf( MexErrBuffer, "The <%s> evaluate routine is not "
-	        "found in <%s> shared module.\n\n", EntryName, Path );
-	if( Count >= Length )
-	    abort();
-
-	mexErrMsgTxt( MexErrBuffer );
-
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabExecuteCommand" );
 	return;
     }
 
-    free( Path );
-
     char   *Command;
     size_t  CharNum;
 
@@ -131,10 +73,22 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
     errno = 0;
 
-    int Error = (Entry)( Command );
+    PanConsoleBegin();
+    PanCounterPanEnter();
+    int Error = (Session->Entry.PanMatlabExecuteCommand)( Command );
+    PanCounterPanLeave();
+    PanConsoleEnd();
+    PanSessionDetach();
 
+    PanCounterEnd( Command );
     mxFree( Command );
 
+    if( 1 == nlhs )
+    {
+	plhs[0] = mxCreateDoubleScalar( (double) Error );
+	return;
+    }
+
     mxArray *pAnaError = mexGetVariable( "global", "MPanerror" );
 
     if( pAnaError )
@@ -155,11 +109,9 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     }
     else if( Error )
     {
-	dlclose( Module );
         mexErrMsgTxt( "An error blocked the command execution." );
 	return;
     }
 
-    dlclose( Module );
     return;
 }
@@ -0,0 +1,621 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include "mex.h"
+#include "pancounter.h"
+#include "panworker.h"
+
+#define PANSIMC_ASYNC_USAGE \
+    "Usage: ID = pansimc_async('command', NETLIST, LOG, RAW_DIR, INIT[, " \
+    "OUTPUT, NAMES]), " \
+    "DONE = pansimc_async('isdone', ID), " \
+    "ERROR = pansimc_async('wait', ID[, TIMEOUT]) or " \
+    "OK = pansimc_async('cancel', ID)"
+
+#define ASYNC_QUEUED     0
+#define ASYNC_RUNNING    1
+#define ASYNC_DONE       2
+#define ASYNC_CANCELLED  3
+
+/* Error of a job that did not complete, as for the points of pansweep. */
+#define ASYNC_ABORTED    -2
+#define ASYNC_NO_DATA    -4
+#define ASYNC_NO_NETLIST -6
+#define ASYNC_MATLAB     -7
+
+/* The console output of the workers: LOG with this suffix for ".log". */
+#define ASYNC_CONSOLE    ".console.log"
+
+/*
+ * Jobs are run one at a time, in the order they were queued, by a panrun
+ * worker process (see panworker.h): PAN calls the MATLAB API, which must
+ * not be used off the MATLAB thread. The thread of this gateway only
+ * feeds the worker and waits for its answers. Every job gets a worker of
+ * its own, which loads the netlist, replays the INIT commands (the alters
+ * of the MATLAB session when the job was queued) and writes its raw files
+ * in RAW_DIR, a folder private to the job. The identifier of a job is its
+ * index in Jobs plus one.
+ */
+typedef struct
+{
+    char *Netlist, *Log, *RawDir;
+    char *Init;                 /* the INIT commands, one per line */
+    char *Command;
+    char *Request;              /* "> OUTPUT NAME ...", or ">" */
+    int   State;
+    int   Error;
+} AsyncJob;
+
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  Changed = PTHREAD_COND_INITIALIZER;
+static AsyncJob  *pJobs;
+static size_t     NumJobs, MaxJobs, NextJob;
+static char      *Runner;
+static int        Started;
+
+/* Only the thread uses Worker; RunningPid is under Lock. */
+static PanWorker  Worker = { -1, -1, -1, 0, "" };
+static pid_t      RunningPid;
+
+
+
+
+static void AsyncJobFree( AsyncJob *pJob )
+{
+    free( pJob->Netlist );
+    free( pJob->Log );
+    free( pJob->RawDir );
+    free( pJob->Init );
+    free( pJob->Command );
+    free( pJob->Request );
+    pJob->Netlist = pJob->Log = pJob->RawDir = NULL;
+    pJob->Init = pJob->Command = pJob->Request = NULL;
+}
+
+
+
+
+/*
+ * Start the worker of the job, with the INIT commands in RAW_DIR/init.cmd:
+ * return 0 if it is running, the error of the job otherwise.
+ */
+static int AsyncWorkerStart( const AsyncJob *pJob )
+{
+    char *Init = NULL, *Console = NULL, *ppArgs[8];
+    size_t Length = strlen( pJob->Log );
+    FILE *pFile;
+    int Status = 0, K = 0;
+
+    if( *pJob->Init )
+    {
+	if( asprintf( &Init, "%s/init.cmd", pJob->RawDir ) < 0 )
+	    return( ASYNC_ABORTED );
+	if( (pFile = fopen( Init, "w" )) )
+	{
+	    Status = fputs( pJob->Init, pFile ) < 0;
+	    Status |= 0 != fclose( pFile );
+	}
+	if( ! pFile || Status )
+	{
+	    free( Init );
+	    return( ASYNC_ABORTED );
+	}
+    }
+
+    if( Length > 4 && ! strcmp( pJob->Log + Length - 4, ".log" ) )
+	Length -= 4;
+    if( asprintf( &Console, "%.*s%s", (int) Length, pJob->Log,
+                  ASYNC_CONSOLE ) < 0 )
+    {
+	free( Init );
+	return( ASYNC_ABORTED );
+    }
+
+    ppArgs[K++] = "-l";
+    ppArgs[K++] = pJob->Log;
+    ppArgs[K++] = "-r";
+    ppArgs[K++] = pJob->RawDir;
+    if( Init )
+    {
+	ppArgs[K++] = "-i";
+	ppArgs[K++] = Init;
+    }
+    ppArgs[K++] = pJob->Netlist;
+    ppArgs[K] = NULL;
+    Status = PanWorkerStart( &Worker, Runner, ppArgs, Console );
+    free( Console );
+    free( Init );
+
+    return( Status ? ASYNC_ABORTED : 0 );
+}
+
+
+
+
+/* Send the job to the worker and wait for its answer "ERROR STATUS". */
+static int AsyncRun( const AsyncJob *pJob )
+{
+    char *pText;
+    int Error, Status, Read = -1, Length;
+
+    if( (Length = asprintf( &pText, "%s\n%s\n", pJob->Command,
+                            pJob->Request )) < 0 )
+	return( ASYNC_ABORTED );
+
+    if( ! PanWorkerSend( &Worker, pText, Length ) )
+	while( 0 == (Read = PanWorkerRead( &Worker )) )
+	    ;
+    free( pText );
+
+    if( Read > 0 && 2 == sscanf( Worker.Answer, "%d %d", &Error, &Status ) )
+    {
+	if( PAN_WORKER_EMATLAB == Status )
+	    return( ASYNC_MATLAB );
+	return( Error ? Error : (Status ? ASYNC_NO_DATA : 0) );
+    }
+
+    /*
+     * The worker died, was killed by cancel, could not load NETLIST or
+     * replay INIT.
+     */
+    pthread_mutex_lock( &Lock );
+    RunningPid = 0;
+    pthread_mutex_unlock( &Lock );
+
+    /* A worker that closed its output is exiting: its status is kept. */
+    Status = PanWorkerStop( &Worker, 0 );
+
+    if( PAN_WORKER_EMATLAB == Status )
+	return( ASYNC_MATLAB );
+    if( PAN_WORKER_ELOAD == Status || PAN_WORKER_ECOMMAND == Status )
+	return( ASYNC_NO_NETLIST );
+
+    return( ASYNC_ABORTED );
+}
+
+
+
+
+static void *AsyncThread( void *pArg )
+{
+    pthread_mutex_lock( &Lock );
+
+    for( ;; )
+    {
+	AsyncJob Job;
+	size_t K;
+	int Error, Run;
+
+	while( NextJob == NumJobs )
+	    pthread_cond_wait( &Changed, &Lock );
+
+	K = NextJob++;
+	if( ASYNC_QUEUED != pJobs[K].State )
+	    continue;
+
+	/* Jobs may be reallocated by AsyncSubmit: the thread uses a copy. */
+	pJobs[K].State = ASYNC_RUNNING;
+	Job = pJobs[K];
+	pthread_cond_broadcast( &Changed );
+	pthread_mutex_unlock( &Lock );
+
+	/* A job is recorded as one pansimc_async call, by this thread. */
+	PanCounterBegin( PAN_COUNTER_PANSIMC_ASYNC );
+	PanCounterPanEnter();
+
+	Error = AsyncWorkerStart( &Job );
+	if( ! Error )
+	{
+	    /* The job may have been cancelled while the worker started. */
+	    pthread_mutex_lock( &Lock );
+	    if( (Run = ASYNC_RUNNING == pJobs[K].State) )
+		RunningPid = Worker.Pid;
+	    pthread_mutex_unlock( &Lock );
+
+	    if( Run )
+		Error = AsyncRun( &Job );
+	    if( Worker.Pid > 0 )
+		PanWorkerStop( &Worker, ! Run );
+	}
+
+	PanCounterPanLeave();
+	PanCounterEnd( Job.Command );
+
+	pthread_mutex_lock( &Lock );
+	RunningPid = 0;
+	if( ASYNC_RUNNING == pJobs[K].State )
+	{
+	    pJobs[K].Error = Error;
+	    pJobs[K].State = ASYNC_DONE;
+	}
+	AsyncJobFree( pJobs + K );
+	pthread_cond_broadcast( &Changed );
+    }
+
+    return( NULL );
+}
+
+
+
+
+static void AsyncStart( void )
+{
+    pthread_t Thread;
+    sigset_t All, Saved;
+    int Status;
+
+    if( Started )
+	return;
+
+    if( ! (Runner = PanWorkerRunner()) )
+    {
+	mexErrMsgTxt( "Error: the panrun runner, which runs the background "
+	              "analyses, can not be found next to pansimc_async. Run "
+	              "MPanSuiteInstall to build it." );
+	return;
+    }
+
+    /* The thread must find the shared block already published. */
+    PanCounterBlockGet();
+
+    /*
+     * The signals are left to the MATLAB threads: a worker that dies makes
+     * the writes of the thread fail with EPIPE instead of raising SIGPIPE.
+     */
+    sigfillset( &All );
+    pthread_sigmask( SIG_BLOCK, &All, &Saved );
+    Status = pthread_create( &Thread, NULL, AsyncThread, NULL );
+    pthread_sigmask( SIG_SETMASK, &Saved, NULL );
+    if( Status )
+    {
+	mexErrMsgTxt( "Error: the analysis thread can not be started." );
+	return;
+    }
+    pthread_detach( Thread );
+
+    /*
+     * The thread and the jobs must outlive any "clear mex": the gateway is
+     * never unloaded once it has been used.
+     */
+    mexLock();
+
+    Started = 1;
+}
+
+
+
+
+/* "> OUTPUT NAME ...", or ">" without OUTPUT. */
+static char *AsyncRequest( int nrhs, const mxArray *prhs[] )
+{
+    char *pText = NULL, *String;
+    size_t Size = 0, K, Count;
+    FILE *pFile;
+
+    if( ! (pFile = open_memstream( &pText, &Size )) )
+	return( NULL );
+
+    fprintf( pFile, ">" );
+
+    if( nrhs > 5 )
+    {
+	String = mxArrayToString( prhs[5] );
+	fprintf( pFile, " %s", String );
+	mxFree( String );
+
+	Count = mxGetNumberOfElements( prhs[6] );
+	for( K = 0; K < Count; K++ )
+	{
+	    String = mxArrayToString( mxGetCell( prhs[6], K ) );
+	    fprintf( pFile, " %s", String );
+	    mxFree( String );
+	}
+    }
+
+    fclose( pFile );
+
+    return( pText );
+}
+
+
+
+
+/* The INIT commands, one per line, in a malloc'd string. */
+static char *AsyncInit( const mxArray *pInit )
+{
+    char *pText = NULL, *String;
+    size_t Size = 0, K, Count = mxGetNumberOfElements( pInit );
+    FILE *pFile;
+
+    if( ! (pFile = open_memstream( &pText, &Size )) )
+	return( NULL );
+
+    for( K = 0; K < Count; K++ )
+    {
+	String = mxArrayToString( mxGetCell( pInit, K ) );
+	fprintf( pFile, "%s\n", String );
+	mxFree( String );
+    }
+
+    fclose( pFile );
+
+    return( pText );
+}
+
+
+
+
+/* A malloc'd copy of the string: the thread releases it. */
+static char *AsyncString( const mxArray *pString )
+{
+    char *String = mxArrayToString( pString ), *Copy;
+
+    Copy = String ? strdup( String ) : NULL;
+    mxFree( String );
+
+    return( Copy );
+}
+
+
+
+
+static void AsyncSubmit( mxArray *plhs[], int nrhs, const mxArray *prhs[] )
+{
+    AsyncJob Job;
+    int K, N;
+
+    for( K = 1; K < nrhs; K++ )
+    {
+	if( (4 == K || 6 == K) && mxIsCell( prhs[K] ) )
+	    continue;
+	if( ! mxIsChar( prhs[K] ) )
+	{
+	    mexErrMsgTxt( "Error: NETLIST, LOG, RAW_DIR and OUTPUT must be "
+	                  "strings, INIT and NAMES cell arrays of strings. "
+	                  PANSIMC_ASYNC_USAGE );
+	    return;
+	}
+    }
+    for( K = 4; K < nrhs; K += 2 )
+    {
+	for( N = 0; N < (int) mxGetNumberOfElements( prhs[K] ); N++ )
+	    if( ! mxIsChar( mxGetCell( prhs[K], N ) ) )
+	    {
+		mexErrMsgTxt( "Error: INIT and NAMES must be cell arrays of "
+		              "strings. " PANSIMC_ASYNC_USAGE );
+		return;
+	    }
+    }
+
+    AsyncStart();
+
+    memset( &Job, 0, sizeof( AsyncJob ) );
+    Job.State = ASYNC_QUEUED;
+    Job.Request = AsyncRequest( nrhs, prhs );
+    Job.Init = AsyncInit( prhs[4] );
+    Job.Command = AsyncString( prhs[0] );
+    Job.Netlist = AsyncString( prhs[1] );
+    Job.Log = AsyncString( prhs[2] );
+    Job.RawDir = AsyncString( prhs[3] );
+
+    if( ! Job.Command || ! Job.Request || ! Job.Init || ! Job.Netlist ||
+        ! Job.Log || ! Job.RawDir )
+    {
+	AsyncJobFree( &Job );
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    pthread_mutex_lock( &Lock );
+
+    if( NumJobs == MaxJobs )
+    {
+	size_t Max = MaxJobs ? 2 * MaxJobs : 64;
+	AsyncJob *pNew = (AsyncJob *) realloc( pJobs, Max * sizeof( AsyncJob ) );
+
+	if( ! pNew )
+	{
+	    pthread_mutex_unlock( &Lock );
+	    AsyncJobFree( &Job );
+	    mexErrMsgTxt( "No more memory.\n" );
+	    return;
+	}
+	pJobs = pNew;
+	MaxJobs = Max;
+    }
+
+    pJobs[ NumJobs++ ] = Job;
+
+    plhs[0] = mxCreateDoubleScalar( (double) NumJobs );
+
+    pthread_cond_broadcast( &Changed );
+    pthread_mutex_unlock( &Lock );
+}
+
+
+
+
+static size_t AsyncJobIndex( const mxArray *pId )
+{
+    double Id;
+
+    if( ! mxIsNumeric( pId ) || 1 != mxGetNumberOfElements( pId ) )
+    {
+	mexErrMsgTxt( "Error: ID must be a scalar. " PANSIMC_ASYNC_USAGE );
+	return( 0 );
+    }
+
+    Id = mxGetScalar( pId );
+
+    pthread_mutex_lock( &Lock );
+    if( Id < 1 || Id > NumJobs || Id != (size_t) Id )
+    {
+	pthread_mutex_unlock( &Lock );
+	mexErrMsgTxt( "Error: ID is not a valid analysis identifier. "
+	              PANSIMC_ASYNC_USAGE );
+	return( 0 );
+    }
+    pthread_mutex_unlock( &Lock );
+
+    return( (size_t) Id - 1 );
+}
+
+
+
+
+/* The lock is held. */
+static mxArray *AsyncResult( size_t K )
+{
+    switch( pJobs[K].State )
+    {
+	case ASYNC_DONE:
+	    return( mxCreateDoubleScalar( (double) pJobs[K].Error ) );
+
+	case ASYNC_CANCELLED:
+	    return( mxCreateDoubleScalar( mxGetNaN() ) );
+
+	default:
+	    return( mxCreateDoubleMatrix( 0, 0, mxREAL ) );
+    }
+}
+
+
+
+
+static void AsyncWait( mxArray *plhs[], size_t K, double Timeout )
+{
+    struct timespec Deadline;
+    int Finite = ! mxIsInf( Timeout );
+
+    if( Finite )
+    {
+	clock_gettime( CLOCK_REALTIME, &Deadline );
+	Deadline.tv_sec += (time_t) Timeout;
+	Deadline.tv_nsec += (long) ((Timeout - floor( Timeout )) * 1e9);
+	if( Deadline.tv_nsec >= 1000000000L )
+	{
+	    Deadline.tv_sec++;
+	    Deadline.tv_nsec -= 1000000000L;
+	}
+    }
+
+    pthread_mutex_lock( &Lock );
+
+    while( ASYNC_QUEUED == pJobs[K].State || ASYNC_RUNNING == pJobs[K].State )
+    {
+	if( ! Finite )
+	    pthread_cond_wait( &Changed, &Lock );
+	else if( ETIMEDOUT == pthread_cond_timedwait( &Changed, &Lock,
+	                                              &Deadline ) )
+	    break;
+    }
+
+    plhs[0] = AsyncResult( K );
+
+    pthread_mutex_unlock( &Lock );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    if( nrhs < 2 || 4 == nrhs || 6 == nrhs || nrhs > 7 ||
+        ! mxIsChar( prhs[0] ) )
+    {
+	mexErrMsgTxt( "Error: wrong arguments. " PANSIMC_ASYNC_USAGE );
+	return;
+    }
+    if( nlhs > 1 )
+    {
+	mexErrMsgTxt( "Error: at most one output variable is allowed. "
+	              PANSIMC_ASYNC_USAGE );
+	return;
+    }
+
+    if( nrhs >= 5 )
+    {
+	AsyncSubmit( plhs, nrhs, prhs );
+	return;
+    }
+
+    char Mode[ 8 ];
+    size_t K;
+
+    if( mxGetString( prhs[0], Mode, sizeof(Mode) ) )
+    {
+	mexErrMsgTxt( "Error: the allowed modes are 'isdone', 'wait' and "
+	              "'cancel'. " PANSIMC_ASYNC_USAGE );
+	return;
+    }
+
+    K = AsyncJobIndex( prhs[1] );
+
+    if( ! strcasecmp( Mode, "isdone" ) && 2 == nrhs )
+    {
+	pthread_mutex_lock( &Lock );
+	plhs[0] = mxCreateLogicalScalar( ASYNC_DONE == pJobs[K].State ||
+	                                 ASYNC_CANCELLED == pJobs[K].State );
+	pthread_mutex_unlock( &Lock );
+    }
+    else if( ! strcasecmp( Mode, "wait" ) )
+    {
+	double Timeout = mxGetInf();
+
+	if( 3 == nrhs )
+	{
+	    if( ! mxIsNumeric( prhs[2] ) ||
+	        1 != mxGetNumberOfElements( prhs[2] ) ||
+		mxGetScalar( prhs[2] ) < 0 )
+	    {
+		mexErrMsgTxt( "Error: TIMEOUT must be a non negative scalar. "
+		              PANSIMC_ASYNC_USAGE );
+		return;
+	    }
+	    Timeout = mxGetScalar( prhs[2] );
+	}
+
+	AsyncWait( plhs, K, Timeout );
+    }
+    else if( ! strcasecmp( Mode, "cancel" ) && 2 == nrhs )
+    {
+	int Cancelled = 0;
+
+	/*
+	 * A job that has not been started yet is dropped; a running one is
+	 * interrupted by killing its worker, which the thread then reaps.
+	 */
+	pthread_mutex_lock( &Lock );
+	if( ASYNC_QUEUED == pJobs[K].State )
+	{
+	    AsyncJobFree( pJobs + K );
+	    Cancelled = 1;
+	}
+	else if( ASYNC_RUNNING == pJobs[K].State )
+	{
+	    if( RunningPid > 0 )
+		kill( RunningPid, SIGKILL );
+	    RunningPid = 0;
+	    Cancelled = 1;
+	}
+	if( Cancelled )
+	{
+	    pJobs[K].State = ASYNC_CANCELLED;
+	    pthread_cond_broadcast( &Changed );
+	}
+	pthread_mutex_unlock( &Lock );
+
+	plhs[0] = mxCreateLogicalScalar( Cancelled );
+    }
+    else
+    {
+	mexErrMsgTxt( "Error: the allowed modes are 'isdone', 'wait' and "
+	              "'cancel'. " PANSIMC_ASYNC_USAGE );
+    }
+}
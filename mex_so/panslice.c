@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "pansession.h"
+#include "pancounter.h"
+#include "panmemreg.h"
+
+#if ! MX_HAS_INTERLEAVED_COMPLEX
+#error "panslice requires the interleaved complex API: build it with mex -R2018a"
+#endif
+
+#define PANSLICE_USAGE \
+    "Usage: SZ = panslice('waveform'), " \
+    "Y = panslice('waveform', FIRST, LAST[, STRIDE]) or " \
+    "IDX = panslice('time', 'window', T0, T1)"
+
+
+
+
+static double GetScalar( const mxArray *pArg, const char *What )
+{
+    if( ! mxIsNumeric( pArg ) || mxIsComplex( pArg ) ||
+        1 != mxGetNumberOfElements( pArg ) )
+    {
+	char Buffer[ 200 ];
+
+	sprintf( Buffer, "Error: %s must be a real scalar.", What );
+	mexErrMsgTxt( Buffer );
+    }
+
+    return( mxGetScalar( pArg ) );
+}
+
+
+
+
+/*
+ * Rows FIRST:STRIDE:LAST (zero based here) of every column. Only these
+ * rows are copied out of the simulator memory.
+ */
+static mxArray *SliceMemWaveform( const MemWaveform *pWav, size_t First,
+                                  size_t Last, size_t Stride )
+{
+    size_t Rows = (Last - First) / Stride + 1, I, K;
+    int J, Cols = pWav->Cols;
+    mxArray *pMexArray;
+
+    pMexArray = mxCreateUninitNumericMatrix( Rows, Cols, mxDOUBLE_CLASS,
+                          pWav->pWavArrayI ? mxCOMPLEX : mxREAL );
+    if( NULL == pMexArray )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return( NULL );
+    }
+
+    if( pWav->pWavArrayI )
+    {
+	double *pMexArrayC = (double *) mxGetComplexDoubles( pMexArray );
+
+	for( J = 0; J < Cols; J++ )
+	{
+	    for( I = 0, K = First; I < Rows; I++, K += Stride )
+	    {
+		if( 1 == Cols )
+		{
+		    *pMexArrayC++ = pWav->pWavArrayR[K];
+		    *pMexArrayC++ = pWav->pWavArrayI[K];
+		}
+		else
+		{
+		    *pMexArrayC++ = ((double **) pWav->pWavArrayR)[K][J];
+		    *pMexArrayC++ = ((double **) pWav->pWavArrayI)[K][J];
+		}
+	    }
+	}
+    }
+    else
+    {
+	double *pMexArrayR = mxGetDoubles( pMexArray );
+
+	if( 1 == Cols && 1 == Stride )
+	{
+	    memcpy( (void *) pMexArrayR,
+	            (const void *) (pWav->pWavArrayR + First),
+		    sizeof(double) * Rows );
+	}
+	else if( 1 == Cols )
+	{
+	    for( I = 0, K = First; I < Rows; I++, K += Stride )
+		*pMexArrayR++ = pWav->pWavArrayR[K];
+	}
+	else
+	{
+	    for( J = 0; J < Cols; J++ )
+	    {
+		for( I = 0, K = First; I < Rows; I++, K += Stride )
+		    *pMexArrayR++ = ((double **) pWav->pWavArrayR)[K][J];
+	    }
+	}
+    }
+
+    return( pMexArray );
+}
+
+
+
+
+/*
+ * One based [FIRST LAST] indices of the samples of the monotonic time axis
+ * pWav such that T0 <= t <= T1. FIRST > LAST if there are none.
+ */
+static mxArray *WindowMemWaveform( const MemWaveform *pWav, double T0,
+                                   double T1 )
+{
+    const double *pTime = pWav->pWavArrayR;
+    size_t Low, High, Middle, First, Last;
+    mxArray *pMexArray;
+    double *pIndex;
+
+    if( pWav->pWavArrayS || pWav->pWavArrayI || 1 != pWav->Cols )
+    {
+	mexErrMsgTxt( "Error: the time axis must be a real vector. "
+	              PANSLICE_USAGE );
+	return( NULL );
+    }
+
+    /* First sample with t >= T0. */
+    Low = 0;
+    High = pWav->Rows;
+    while( Low < High )
+    {
+	Middle = Low + (High - Low) / 2;
+	if( pTime[Middle] < T0 )
+	    Low = Middle + 1;
+	else
+	    High = Middle;
+    }
+    First = Low;
+
+    /* First sample with t > T1. */
+    High = pWav->Rows;
+    while( Low < High )
+    {
+	Middle = Low + (High - Low) / 2;
+	if( pTime[Middle] <= T1 )
+	    Low = Middle + 1;
+	else
+	    High = Middle;
+    }
+    Last = Low;
+
+    pMexArray = mxCreateDoubleMatrix( 1, 2, mxREAL );
+    pIndex = mxGetDoubles( pMexArray );
+    pIndex[0] = (double) (First + 1);
+    pIndex[1] = (double) Last;
+
+    return( pMexArray );
+}
+
+
+
+
+static void SliceDone( const PanSession *Session, uint64_t Mark,
+                       const mxArray *pMexArray, char *Name )
+{
+    PanMemRegEvict( Session, Mark );
+    PanCounterBytes( PAN_COUNTER_MX_BYTES( pMexArray ) );
+    PanCounterEnd( Name );
+    mxFree( Name );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    if( nrhs < 1 || nrhs > 4 )
+    {
+	mexErrMsgTxt( "Error: wrong number of arguments. " PANSLICE_USAGE );
+	return;
+    }
+
+    if( ! mxIsChar(prhs[0]))
+    {
+        mexErrMsgTxt( "Error: waveform must be a string. " PANSLICE_USAGE );
+	return;
+    }
+    if( nlhs > 1 )
+    {
+	mexErrMsgTxt( "Error: only one output variable is allowed. "
+	              PANSLICE_USAGE );
+	return;
+    }
+
+    PanSession *Session;
+    int Status;
+
+    PanCounterBegin( PAN_COUNTER_PANSLICE );
+
+    if( (Status = PanSessionAttach( &Session )) )
+    {
+	PanSessionErrMsg( Status, NULL );
+	return;
+    }
+
+    if( ! Session->Entry.PanMatlabGet )
+    {
+	PanSessionErrMsg( PAN_SESSION_NO_ENTRY, "PanMatlabGet" );
+	return;
+    }
+
+    MemWaveform Wav;
+    uint64_t Mark = PanMemRegMark( Session );
+
+    Wav.Name = mxArrayToString( prhs[0] );
+    if( NULL == Wav.Name )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    if( ! PanMemWaveformGet( Session, &Wav ) )
+    {
+	PanMemWaveformErrMsg( Wav.Name );
+	return;
+    }
+    PanMemRegTouch( Session, &Wav );
+
+    if( 1 == nrhs )
+    {
+	double *pSize;
+
+	plhs[0] = mxCreateDoubleMatrix( 1, 2, mxREAL );
+	pSize = mxGetDoubles( plhs[0] );
+	pSize[0] = Wav.Rows;
+	pSize[1] = Wav.Cols;
+	SliceDone( Session, Mark, plhs[0], Wav.Name );
+	return;
+    }
+
+    if( mxIsChar( prhs[1] ) )
+    {
+	char Mode[ 8 ];
+
+	if( 4 != nrhs || mxGetString( prhs[1], Mode, sizeof(Mode) ) ||
+	    strcasecmp( Mode, "window" ) )
+	{
+	    mexErrMsgTxt( "Error: the only allowed mode is 'window'. "
+	                  PANSLICE_USAGE );
+	    return;
+	}
+
+	plhs[0] = WindowMemWaveform( &Wav, GetScalar( prhs[2], "T0" ),
+	                             GetScalar( prhs[3], "T1" ) );
+	SliceDone( Session, Mark, plhs[0], Wav.Name );
+	return;
+    }
+
+    if( nrhs < 3 )
+    {
+	mexErrMsgTxt( "Error: missing LAST index. " PANSLICE_USAGE );
+	return;
+    }
+
+    if( Wav.pWavArrayS || ! Wav.pWavArrayR )
+    {
+	mexErrMsgTxt( "Error: only numeric memwaveforms can be sliced. "
+	              "Use panget to read string memwaveforms." );
+	return;
+    }
+
+    double First = GetScalar( prhs[1], "FIRST" );
+    double Last = GetScalar( prhs[2], "LAST" );
+    double Stride = 4 == nrhs ? GetScalar( prhs[3], "STRIDE" ) : 1.0;
+
+    if( First < 1 || Last < 0 || Last > Wav.Rows || Stride < 1 ||
+        First != (size_t) First || Last != (size_t) Last ||
+	Stride != (size_t) Stride )
+    {
+	mexErrMsgTxt( "Error: FIRST, LAST and STRIDE must be integers with "
+	              "1 <= FIRST, LAST <= number of samples and STRIDE >= 1." );
+	return;
+    }
+
+    if( Last < First )
+    {
+	plhs[0] = mxCreateDoubleMatrix( 0, Wav.Cols,
+	                                Wav.pWavArrayI ? mxCOMPLEX : mxREAL );
+	SliceDone( Session, Mark, plhs[0], Wav.Name );
+	return;
+    }
+
+    plhs[0] = SliceMemWaveform( &Wav, (size_t) First - 1, (size_t) Last - 1,
+                                (size_t) Stride );
+    SliceDone( Session, Mark, plhs[0], Wav.Name );
+}
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "pancounter.h"
+
+#define PANSTATS_USAGE \
+    "Usage: S = panstats(), panstats('reset'), panstats('trace', FLAG), " \
+    "T = panstats('trace') or panstats('record', 'name', SECONDS[, BYTES])"
+
+static const char *CounterFields[] =
+    { "name", "calls", "time", "pan_time", "bytes" };
+
+static const char *TraceFields[] =
+    { "name", "start", "time", "pan_time", "bytes", "label" };
+
+
+
+
+static mxArray *StatsCounters( PanCounterBlock *pBlock )
+{
+    mxArray *pStruct = mxCreateStructMatrix( 1, 1, 5, CounterFields );
+    mxArray *pNames = mxCreateCellMatrix( PAN_COUNTER_NUM, 1 );
+    mxArray *pValues[4];
+    int K, H;
+
+    for( H = 0; H < 4; H++ )
+	pValues[H] = mxCreateDoubleMatrix( PAN_COUNTER_NUM, 1, mxREAL );
+
+    for( K = 0; K < PAN_COUNTER_NUM; K++ )
+    {
+	PanCounter *pCounter = pBlock->Counter + K;
+
+	mxSetCell( pNames, K, mxCreateString( PanCounterNames[K] ) );
+	mxGetDoubles( pValues[0] )[K] = (double)
+	    __atomic_load_n( &(pCounter->Calls), __ATOMIC_RELAXED );
+	mxGetDoubles( pValues[1] )[K] = 1e-9 * (double)
+	    __atomic_load_n( &(pCounter->Time), __ATOMIC_RELAXED );
+	mxGetDoubles( pValues[2] )[K] = 1e-9 * (double)
+	    __atomic_load_n( &(pCounter->PanTime), __ATOMIC_RELAXED );
+	mxGetDoubles( pValues[3] )[K] = (double)
+	    __atomic_load_n( &(pCounter->Bytes), __ATOMIC_RELAXED );
+    }
+
+    mxSetField( pStruct, 0, "name", pNames );
+    for( H = 0; H < 4; H++ )
+	mxSetField( pStruct, 0, CounterFields[ H + 1 ], pValues[H] );
+
+    return( pStruct );
+}
+
+
+
+
+/* The records are returned oldest first. */
+static mxArray *StatsTrace( PanCounterBlock *pBlock )
+{
+    uint64_t Next = __atomic_load_n( &(pBlock->TraceNext), __ATOMIC_ACQUIRE );
+    uint64_t First = Next > PAN_COUNTER_TRACE_SIZE ?
+                     Next - PAN_COUNTER_TRACE_SIZE : 0;
+    size_t N = (size_t) (Next - First), K;
+    mxArray *pStruct = mxCreateStructMatrix( 1, 1, 6, TraceFields );
+    mxArray *pNames = mxCreateCellMatrix( N, 1 );
+    mxArray *pLabels = mxCreateCellMatrix( N, 1 );
+    double *pStart, *pTime, *pPanTime, *pBytes;
+    mxArray *pValues[4];
+    int H;
+
+    for( H = 0; H < 4; H++ )
+	pValues[H] = mxCreateDoubleMatrix( N, 1, mxREAL );
+    pStart = mxGetDoubles( pValues[0] );
+    pTime = mxGetDoubles( pValues[1] );
+    pPanTime = mxGetDoubles( pValues[2] );
+    pBytes = mxGetDoubles( pValues[3] );
+
+    for( K = 0; K < N; K++ )
+    {
+	PanCounterTrace *pTrace = pBlock->Trace +
+	                          (First + K) % PAN_COUNTER_TRACE_SIZE;
+	int Id = pTrace->Id >= 0 && pTrace->Id < PAN_COUNTER_NUM ?
+	         pTrace->Id : 0;
+	char Label[ PAN_COUNTER_LABEL_SIZE ];
+
+	memcpy( Label, pTrace->Label, PAN_COUNTER_LABEL_SIZE );
+	Label[ PAN_COUNTER_LABEL_SIZE - 1 ] = 0;
+
+	mxSetCell( pNames, K, mxCreateString( PanCounterNames[ Id ] ) );
+	mxSetCell( pLabels, K, mxCreateString( Label ) );
+	pStart[K] = 1e-9 * (double) pTrace->Start;
+	pTime[K] = 1e-9 * (double) pTrace->Time;
+	pPanTime[K] = 1e-9 * (double) pTrace->PanTime;
+	pBytes[K] = (double) pTrace->Bytes;
+    }
+
+    mxSetField( pStruct, 0, "name", pNames );
+    for( H = 0; H < 4; H++ )
+	mxSetField( pStruct, 0, TraceFields[ H + 1 ], pValues[H] );
+    mxSetField( pStruct, 0, "label", pLabels );
+
+    return( pStruct );
+}
+
+
+
+
+static void StatsReset( PanCounterBlock *pBlock )
+{
+    int K;
+
+    for( K = 0; K < PAN_COUNTER_NUM; K++ )
+    {
+	PanCounter *pCounter = pBlock->Counter + K;
+
+	__atomic_store_n( &(pCounter->Calls), 0, __ATOMIC_RELAXED );
+	__atomic_store_n( &(pCounter->Time), 0, __ATOMIC_RELAXED );
+	__atomic_store_n( &(pCounter->PanTime), 0, __ATOMIC_RELAXED );
+	__atomic_store_n( &(pCounter->Bytes), 0, __ATOMIC_RELAXED );
+    }
+
+    __atomic_store_n( &(pBlock->TraceNext), 0, __ATOMIC_RELEASE );
+    pBlock->Epoch = PanCounterNow();
+}
+
+
+
+
+static void StatsRecord( int nrhs, const mxArray *prhs[] )
+{
+    char Name[ 64 ];
+    double Seconds, Bytes = 0;
+    int K;
+
+    if( nrhs < 3 || nrhs > 4 || ! mxIsChar( prhs[1] ) ||
+        mxGetString( prhs[1], Name, sizeof(Name) ) ||
+	! mxIsNumeric( prhs[2] ) || 1 != mxGetNumberOfElements( prhs[2] ) ||
+	(4 == nrhs && (! mxIsNumeric( prhs[3] ) ||
+	               1 != mxGetNumberOfElements( prhs[3] ))) )
+    {
+	mexErrMsgTxt( "Error: wrong arguments. " PANSTATS_USAGE );
+	return;
+    }
+
+    for( K = 0; K < PAN_COUNTER_NUM; K++ )
+    {
+	if( ! strcmp( Name, PanCounterNames[K] ) )
+	    break;
+    }
+    if( PAN_COUNTER_NUM == K )
+    {
+	mexErrMsgTxt( "Error: unknown counter name. " PANSTATS_USAGE );
+	return;
+    }
+
+    Seconds = mxGetScalar( prhs[2] );
+    if( 4 == nrhs )
+	Bytes = mxGetScalar( prhs[3] );
+
+    PanCounterAdd( (PanCounterId) K,
+                   (uint64_t) (Seconds > 0 ? 1e9 * Seconds : 0),
+                   (uint64_t) (Bytes > 0 ? Bytes : 0), NULL );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    PanCounterBlock *pBlock = PanCounterBlockGet();
+    char Mode[ 8 ];
+
+    if( ! pBlock )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+    if( nlhs > 1 )
+    {
+	mexErrMsgTxt( "Error: at most one output variable is allowed. "
+	              PANSTATS_USAGE );
+	return;
+    }
+
+    if( 0 == nrhs )
+    {
+	plhs[0] = StatsCounters( pBlock );
+	return;
+    }
+
+    if( ! mxIsChar( prhs[0] ) || mxGetString( prhs[0], Mode, sizeof(Mode) ) )
+    {
+	mexErrMsgTxt( "Error: the allowed modes are 'reset', 'trace' and "
+	              "'record'. " PANSTATS_USAGE );
+	return;
+    }
+
+    if( ! strcasecmp( Mode, "reset" ) && 1 == nrhs )
+	StatsReset( pBlock );
+    else if( ! strcasecmp( Mode, "trace" ) && 1 == nrhs )
+	plhs[0] = StatsTrace( pBlock );
+    else if( ! strcasecmp( Mode, "trace" ) && 2 == nrhs )
+    {
+	int Flag = mxIsLogicalScalarTrue( prhs[1] ) ||
+	           (mxIsNumeric( prhs[1] ) && 0 != mxGetScalar( prhs[1] ));
+
+	__atomic_store_n( &(pBlock->Tracing), Flag, __ATOMIC_RELAXED );
+    }
+    else if( ! strcasecmp( Mode, "record" ) )
+	StatsRecord( nrhs, prhs );
+    else
+    {
+	mexErrMsgTxt( "Error: the allowed modes are 'reset', 'trace' and "
+	              "'record'. " PANSTATS_USAGE );
+    }
+}
@@ -0,0 +1,886 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mex.h"
+#include "pancounter.h"
+#include "panworker.h"
+
+#if ! MX_HAS_INTERLEAVED_COMPLEX
+#error "pansweep requires the interleaved complex API: build it with mex -R2018a"
+#endif
+
+#define PANSWEEP_USAGE \
+    "Usage: [Y, ROWS, STATUS] = pansweep(NETLIST, DIR, INIT, ALTER, VALUES, " \
+    "'name', 'analysis', MEM[, WORKERS[, TIMEOUT[, SAMPLES]]])"
+
+#define SWEEP_MAX_WORKERS   256
+
+/* The result array is shared memory, or a file in DIR if there is none. */
+#define SWEEP_SHARED_DIR    "/dev/shm"
+
+/* Status of a sweep point that did not complete. */
+#define SWEEP_NOT_RUN       -1
+#define SWEEP_ABORTED       -2
+#define SWEEP_NO_MEMORY     -3
+#define SWEEP_NO_DATA       -4
+#define SWEEP_TIMEOUT       -5
+#define SWEEP_NO_NETLIST    -6
+
+/*
+ * Every worker owns a range [Next, End) of sweep points and runs them in
+ * order, so that consecutive points (usually close to each other in the
+ * parameter space) are simulated by the same copy of the circuit. A worker
+ * whose range is empty steals the upper half of the largest range left.
+ */
+typedef struct
+{
+    long Next, End;
+} SweepRange;
+
+/*
+ * A worker loads the netlist once, runs the INIT commands and then runs
+ * the points sent to it, answering after every point.
+ */
+typedef struct
+{
+    PanWorker W;
+    long      Point;            /* running, -1 if idle */
+    uint64_t  Deadline;         /* ns, 0 if there is no time limit */
+    int       Answered;         /* a point has been answered */
+    int       Probing;          /* the result array did not exist yet */
+    char     *WorkDir, *Log;
+} SweepWorker;
+
+/*
+ * The memwaveforms of all the points are written by the workers into one
+ * result array, the SAMPLES x VARS x POINTS array returned to MATLAB with
+ * Capacity samples per memwaveform. It is sized and filled with NaN once
+ * the first point is answered.
+ */
+typedef struct
+{
+    char         **ppAlter;
+    int            NumParams;
+    const double  *pValues;
+    long           NumPoints;
+    char          *Name;
+    char          *Analysis;
+    char         **ppMem;
+    int            NumVars;
+    char          *Netlist;
+    char          *Dir;
+    char          *Init;        /* script of the INIT commands, or NULL */
+    uint64_t       Timeout;     /* ns per point, 0 if there is none */
+    SweepRange     Range[ SWEEP_MAX_WORKERS ];
+    SweepWorker    Workers[ SWEEP_MAX_WORKERS ];
+    int            NumWorkers;
+    int            LoadFailures;
+    char          *Shared;      /* the file of the result array */
+    double        *pShared;
+    size_t         Capacity;    /* 0 until the result array exists */
+    size_t         MinCapacity; /* SAMPLES */
+    int            Width;       /* 2 if the result array is complex */
+    int           *pRows;
+    int           *pStatus;
+    int            NeedsMatlab; /* a worker called a MATLAB function */
+    char           Matlab[ 64 ];
+} Sweep;
+
+
+
+
+static long SweepTake( Sweep *pSweep, int Worker )
+{
+    SweepRange *pOwn = pSweep->Range + Worker;
+    long Point = -1, Left, MaxLeft = 0;
+    int K, Victim = -1;
+
+    if( pOwn->Next >= pOwn->End )
+    {
+	for( K = 0; K < pSweep->NumWorkers; K++ )
+	{
+	    Left = pSweep->Range[K].End - pSweep->Range[K].Next;
+	    if( Left > MaxLeft )
+	    {
+		MaxLeft = Left;
+		Victim = K;
+	    }
+	}
+
+	if( Victim >= 0 )
+	{
+	    SweepRange *pVictim = pSweep->Range + Victim;
+	    long Middle = pVictim->Next + MaxLeft / 2;
+
+	    pOwn->Next = Middle;
+	    pOwn->End = pVictim->End;
+	    pVictim->End = Middle;
+	}
+    }
+
+    if( pOwn->Next < pOwn->End )
+	Point = pOwn->Next++;
+
+    return( Point );
+}
+
+
+
+
+/* The "?" or "=" request of the memwaveforms of a point, see panrun.c. */
+static void SweepRequest( const Sweep *pSweep, FILE *pFile, long Point )
+{
+    int H;
+
+    if( pSweep->Capacity )
+	fprintf( pFile, "= %s %zu %zu %d", pSweep->Shared,
+	         (size_t) Point * pSweep->NumVars * pSweep->Capacity *
+	         pSweep->Width, pSweep->Capacity, pSweep->Width );
+    else
+	fprintf( pFile, "?" );
+    for( H = 0; H < pSweep->NumVars; H++ )
+	fprintf( pFile, " %s.%s", pSweep->Name, pSweep->ppMem[H] );
+    fprintf( pFile, "\n" );
+}
+
+
+
+
+/*
+ * Send the next point to the worker: the alter commands, the analysis and
+ * the request of its memwaveforms. Return 0 if there is none left, -1 if
+ * the worker can not be reached.
+ */
+static int SweepSend( Sweep *pSweep, int Worker )
+{
+    SweepWorker *pWorker = pSweep->Workers + Worker;
+    char *pText = NULL;
+    size_t Size = 0;
+    FILE *pFile;
+    long Point = SweepTake( pSweep, Worker );
+    int P, Status;
+
+    pWorker->Point = Point;
+    if( Point < 0 )
+	return( 0 );
+
+    pSweep->pStatus[ Point ] = SWEEP_ABORTED;
+
+    if( ! (pFile = open_memstream( &pText, &Size )) )
+	return( -1 );
+
+    for( P = 0; P < pSweep->NumParams; P++ )
+	fprintf( pFile, "%s%23.16e\n", pSweep->ppAlter[P],
+	         pSweep->pValues[ Point * pSweep->NumParams + P ] );
+    fprintf( pFile, "%s %s\n", pSweep->Name, pSweep->Analysis );
+    SweepRequest( pSweep, pFile, Point );
+    fclose( pFile );
+
+    pWorker->Probing = ! pSweep->Capacity;
+    Status = PanWorkerSend( &(pWorker->W), pText, Size );
+    free( pText );
+
+    if( pSweep->Timeout )
+	pWorker->Deadline = PanCounterNow() + pSweep->Timeout;
+
+    return( Status ? -1 : 1 );
+}
+
+
+
+
+/*
+ * Create the result array. Every memwaveform gets the samples of the first
+ * point answered, or SAMPLES if they are more: the points with more
+ * samples than that do not fit.
+ */
+static int SweepShare( Sweep *pSweep, size_t Rows, int IsComplex )
+{
+    size_t Capacity = Rows > pSweep->MinCapacity ? Rows : pSweep->MinCapacity;
+    size_t Width = IsComplex ? 2 : 1, Count, K;
+    double NaN = mxGetNaN();
+    void *pMap;
+    int Fd;
+
+    if( ! Capacity )
+	Capacity = 1;
+    if( Capacity > SIZE_MAX / sizeof(double) / Width / pSweep->NumVars /
+                   pSweep->NumPoints )
+	return( -1 );
+    Count = Capacity * Width * pSweep->NumVars * pSweep->NumPoints;
+
+    if( asprintf( &(pSweep->Shared), "%s/pansweep.XXXXXX",
+                  SWEEP_SHARED_DIR ) < 0 )
+	return( -1 );
+    if( (Fd = mkstemp( pSweep->Shared )) < 0 )
+    {
+	free( pSweep->Shared );
+	if( asprintf( &(pSweep->Shared), "%s/result.XXXXXX", pSweep->Dir ) < 0 )
+	    pSweep->Shared = NULL;
+	Fd = pSweep->Shared ? mkstemp( pSweep->Shared ) : -1;
+    }
+    if( Fd < 0 )
+    {
+	free( pSweep->Shared );
+	pSweep->Shared = NULL;
+	return( -1 );
+    }
+
+    /* The space is reserved now: a full tmpfs must not fault the writers. */
+    pMap = MAP_FAILED;
+    if( ! posix_fallocate( Fd, 0, Count * sizeof(double) ) )
+	pMap = mmap( NULL, Count * sizeof(double), PROT_READ | PROT_WRITE,
+	             MAP_SHARED, Fd, 0 );
+    close( Fd );
+    if( MAP_FAILED == pMap )
+    {
+	unlink( pSweep->Shared );
+	free( pSweep->Shared );
+	pSweep->Shared = NULL;
+	return( -1 );
+    }
+
+    pSweep->pShared = pMap;
+    for( K = 0; K < Count; K++ )
+	pSweep->pShared[K] = NaN;
+    pSweep->Capacity = Capacity;
+    pSweep->Width = (int) Width;
+
+    return( 0 );
+}
+
+
+
+
+static int SweepSpawn( Sweep *pSweep, const char *Runner, int Worker )
+{
+    SweepWorker *pWorker = pSweep->Workers + Worker;
+    char *ppArgs[6];
+    int K = 0;
+
+    pWorker->Point = -1;
+
+    if( ! pWorker->Log )
+    {
+	if( asprintf( &(pWorker->WorkDir), "%s/%d", pSweep->Dir, Worker ) < 0 )
+	    pWorker->WorkDir = NULL;
+	if( asprintf( &(pWorker->Log), "%s/%d.log", pSweep->Dir, Worker ) < 0 )
+	    pWorker->Log = NULL;
+	if( ! pWorker->WorkDir || ! pWorker->Log )
+	{
+	    pWorker->W.Pid = -1;
+	    return( -1 );
+	}
+
+	/* A worker started again after a timeout appends to its log. */
+	unlink( pWorker->Log );
+    }
+
+    ppArgs[K++] = "-w";
+    ppArgs[K++] = pWorker->WorkDir;
+    if( pSweep->Init )
+    {
+	ppArgs[K++] = "-i";
+	ppArgs[K++] = pSweep->Init;
+    }
+    ppArgs[K++] = pSweep->Netlist;
+    ppArgs[K] = NULL;
+
+    return( PanWorkerStart( &(pWorker->W), Runner, ppArgs, pWorker->Log ) );
+}
+
+
+
+
+/*
+ * Close the pipes of the worker and reap it: it is killed if Kill is set.
+ * A worker that exits before answering because it could not load the
+ * netlist or run the INIT commands is recorded as a load failure.
+ */
+static void SweepStop( Sweep *pSweep, SweepWorker *pWorker, int Kill )
+{
+    int Status = PanWorkerStop( &(pWorker->W), Kill );
+
+    if( ! pWorker->Answered && (PAN_WORKER_ELOAD == Status ||
+        PAN_WORKER_ECOMMAND == Status || PAN_WORKER_EMATLAB == Status) )
+    {
+	pSweep->LoadFailures++;
+	if( pWorker->Point >= 0 )
+	    pSweep->pStatus[ pWorker->Point ] = SWEEP_NO_NETLIST;
+    }
+    if( PAN_WORKER_EMATLAB == Status )
+	pSweep->NeedsMatlab = 1;
+
+    pWorker->Point = -1;
+}
+
+
+
+
+/*
+ * Parse the answer of the worker to its point: "ERROR STATUS ROWS
+ * COMPLEX" to "?", "ERROR STATUS ROWS" to "=". Once a probed point is
+ * fine the result array is created, if it does not exist yet, and the
+ * worker is asked to write the point there: return 1 if it was.
+ */
+static int SweepAnswer( Sweep *pSweep, int Worker )
+{
+    SweepWorker *pWorker = pSweep->Workers + Worker;
+    long Rows = 0;
+    int Error, Status, IsComplex = 0, Count;
+
+    pWorker->Answered = 1;
+    Count = sscanf( pWorker->W.Answer, "%d %d %ld %d", &Error, &Status,
+                    &Rows, &IsComplex );
+
+    if( Count < 2 )
+	Error = SWEEP_ABORTED;
+    else if( PAN_WORKER_EMATLAB == Status )
+    {
+	if( ! pSweep->NeedsMatlab )
+	    sscanf( pWorker->W.Answer, "%*d %*d %63s", pSweep->Matlab );
+	pSweep->NeedsMatlab = 1;
+	Error = SWEEP_ABORTED;
+    }
+    else if( ! Error && Status )
+	Error = PAN_WORKER_ESPACE == Status ? SWEEP_NO_MEMORY : SWEEP_NO_DATA;
+    else if( ! Error && Count < (pWorker->Probing ? 4 : 3) )
+	Error = SWEEP_ABORTED;
+    else if( ! Error && pWorker->Probing )
+    {
+	if( pSweep->Capacity || ! SweepShare( pSweep, Rows, IsComplex ) )
+	{
+	    char *pText = NULL;
+	    size_t Size = 0;
+	    FILE *pFile = open_memstream( &pText, &Size );
+
+	    /* A worker that can not be reached is seen dead by poll. */
+	    if( pFile )
+	    {
+		SweepRequest( pSweep, pFile, pWorker->Point );
+		fclose( pFile );
+		pWorker->Probing = 0;
+		PanWorkerSend( &(pWorker->W), pText, Size );
+		free( pText );
+		return( 1 );
+	    }
+	}
+	Error = SWEEP_NO_MEMORY;
+    }
+    else if( ! Error )
+	pSweep->pRows[ pWorker->Point ] = (int) Rows;
+
+    pSweep->pStatus[ pWorker->Point ] = Error;
+
+    return( 0 );
+}
+
+
+
+
+/*
+ * Start worker K and send it its first point. A worker that times out or
+ * dies is started again in the same way, so that the points left are
+ * still run.
+ */
+static int SweepStart( Sweep *pSweep, const char *Runner, int Worker )
+{
+    SweepWorker *pWorker = pSweep->Workers + Worker;
+
+    if( SweepSpawn( pSweep, Runner, Worker ) )
+	return( 0 );
+
+    pWorker->Answered = 0;
+    pWorker->Deadline = 0;
+    if( SweepSend( pSweep, Worker ) <= 0 )
+	SweepStop( pSweep, pWorker, pWorker->Point >= 0 );
+
+    return( 1 );
+}
+
+
+
+
+/*
+ * Start the workers and feed them the points until none is left, or until
+ * a worker needs MATLAB. Return the number of workers started.
+ */
+static int SweepRun( Sweep *pSweep, const char *Runner )
+{
+    struct pollfd Fds[ SWEEP_MAX_WORKERS ];
+    int Index[ SWEEP_MAX_WORKERS ];
+    sigset_t Pipe, Saved;
+    struct timespec Zero = { 0, 0 };
+    uint64_t Now, Next;
+    int K, N, Started = 0, Live, Wait;
+
+    /*
+     * A worker that dies closes its pipes: writing to it must fail with
+     * EPIPE instead of raising SIGPIPE in MATLAB.
+     */
+    sigemptyset( &Pipe );
+    sigaddset( &Pipe, SIGPIPE );
+    pthread_sigmask( SIG_BLOCK, &Pipe, &Saved );
+
+    for( K = 0; K < pSweep->NumWorkers; K++ )
+	Started += SweepStart( pSweep, Runner, K );
+
+    while( ! pSweep->NeedsMatlab )
+    {
+	Now = PanCounterNow();
+	Next = 0;
+	for( K = N = 0; K < pSweep->NumWorkers; K++ )
+	{
+	    SweepWorker *pWorker = pSweep->Workers + K;
+
+	    if( pWorker->W.Pid <= 0 )
+		continue;
+
+	    if( pWorker->Deadline && Now >= pWorker->Deadline )
+	    {
+		pSweep->pStatus[ pWorker->Point ] = SWEEP_TIMEOUT;
+		SweepStop( pSweep, pWorker, 1 );
+		SweepStart( pSweep, Runner, K );
+		if( pWorker->W.Pid <= 0 )
+		    continue;
+	    }
+	    if( pWorker->Deadline && (! Next || pWorker->Deadline < Next) )
+		Next = pWorker->Deadline;
+
+	    Fds[N].fd = pWorker->W.Out;
+	    Fds[N].events = POLLIN;
+	    Fds[N].revents = 0;
+	    Index[N++] = K;
+	}
+
+	if( 0 == (Live = N) )
+	    break;
+
+	Wait = Next ? (int) ((Next - Now) / 1000000 + 1) : -1;
+	if( poll( Fds, N, Wait ) < 0 && EINTR != errno )
+	    break;
+
+	for( K = 0; K < Live; K++ )
+	{
+	    SweepWorker *pWorker = pSweep->Workers + Index[K];
+	    int Read;
+
+	    if( ! Fds[K].revents )
+		continue;
+
+	    if( (Read = PanWorkerRead( &(pWorker->W) )) < 0 )
+	    {
+		int Failures = pSweep->LoadFailures;
+
+		/*
+		 * A worker that closed its output is exiting: its status tells
+		 * if it could not load the netlist, and then it is not restarted.
+		 */
+		SweepStop( pSweep, pWorker, 0 );
+		if( Failures == pSweep->LoadFailures )
+		    SweepStart( pSweep, Runner, Index[K] );
+	    }
+	    else if( Read > 0 && ! SweepAnswer( pSweep, Index[K] ) )
+	    {
+		if( SweepSend( pSweep, Index[K] ) <= 0 )
+		    SweepStop( pSweep, pWorker, pWorker->Point >= 0 );
+	    }
+	}
+    }
+
+    /* The workers left if poll failed or MATLAB is needed. */
+    for( K = 0; K < pSweep->NumWorkers; K++ )
+	SweepStop( pSweep, pSweep->Workers + K, 1 );
+
+    while( sigtimedwait( &Pipe, NULL, &Zero ) > 0 )
+	;
+    pthread_sigmask( SIG_SETMASK, &Saved, NULL );
+
+    return( Started );
+}
+
+
+
+
+/*
+ * Copy the result array to MATLAB, trimmed to the samples of the longest
+ * point: a point is a single copy when no point is shorter than Capacity.
+ * The points that did not complete are NaN.
+ */
+static mxArray *SweepCollect( Sweep *pSweep, mxArray **ppRows,
+                              mxArray **ppStatus )
+{
+    size_t MaxRows = 0, Width = pSweep->Width ? pSweep->Width : 1;
+    size_t Block, Stride = pSweep->Capacity * Width, P, K;
+    int H, Done;
+    mwSize Dims[3];
+    mxArray *pMexArray;
+    double *pRows, *pStatus, *pDst, NaN = mxGetNaN();
+
+    for( P = 0; P < (size_t) pSweep->NumPoints; P++ )
+    {
+	if( ! pSweep->pStatus[P] && pSweep->pRows[P] > (int) MaxRows )
+	    MaxRows = pSweep->pRows[P];
+    }
+    Block = Width * MaxRows;
+
+    Dims[0] = MaxRows;
+    Dims[1] = pSweep->NumVars;
+    Dims[2] = pSweep->NumPoints;
+
+    pMexArray = mxCreateUninitNumericArray( 3, Dims, mxDOUBLE_CLASS,
+                                            2 == Width ? mxCOMPLEX : mxREAL );
+    *ppRows = mxCreateDoubleMatrix( pSweep->NumVars, pSweep->NumPoints,
+                                    mxREAL );
+    *ppStatus = mxCreateDoubleMatrix( 1, pSweep->NumPoints, mxREAL );
+    if( ! pMexArray || ! *ppRows || ! *ppStatus )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return( NULL );
+    }
+
+    pRows = mxGetDoubles( *ppRows );
+    pStatus = mxGetDoubles( *ppStatus );
+    pDst = 2 == Width ? (double *) mxGetComplexDoubles( pMexArray ) :
+                        mxGetDoubles( pMexArray );
+
+    for( P = 0; P < (size_t) pSweep->NumPoints; P++ )
+    {
+	double *pPoint = pDst + P * pSweep->NumVars * Block;
+	const double *pSrc;
+
+	pStatus[P] = (double) pSweep->pStatus[P];
+	Done = ! pSweep->pStatus[P] && pSweep->pShared;
+
+	for( H = 0; H < pSweep->NumVars; H++ )
+	    pRows[ P * pSweep->NumVars + H ] = Done ? pSweep->pRows[P] : 0;
+
+	if( ! Block )
+	    continue;
+	if( ! Done )
+	{
+	    for( K = 0; K < pSweep->NumVars * Block; K++ )
+		pPoint[K] = NaN;
+	    continue;
+	}
+
+	pSrc = pSweep->pShared + P * pSweep->NumVars * Stride;
+	if( Block == Stride )
+	    memcpy( pPoint, pSrc, sizeof(double) * pSweep->NumVars * Block );
+	else
+	{
+	    for( H = 0; H < pSweep->NumVars; H++ )
+		memcpy( pPoint + H * Block, pSrc + H * Stride,
+		        sizeof(double) * Block );
+	}
+    }
+
+    return( pMexArray );
+}
+
+
+
+
+static char **GetStrings( const mxArray *pArg, int *pCount, const char *What )
+{
+    char **ppStrings, Buffer[ 200 ];
+    int K, Count;
+
+    if( mxIsChar( pArg ) )
+    {
+	ppStrings = mxMalloc( sizeof( char * ) );
+	ppStrings[0] = mxArrayToString( pArg );
+	*pCount = 1;
+	return( ppStrings );
+    }
+
+    if( ! mxIsCell( pArg ) )
+    {
+	sprintf( Buffer, "Error: %s must be a string or a cell array of "
+	         "strings. " PANSWEEP_USAGE, What );
+	mexErrMsgTxt( Buffer );
+	return( NULL );
+    }
+
+    Count = (int) mxGetNumberOfElements( pArg );
+    ppStrings = mxMalloc( (Count ? Count : 1) * sizeof( char * ) );
+
+    for( K = 0; K < Count; K++ )
+    {
+	const mxArray *pCell = mxGetCell( pArg, K );
+
+	if( ! pCell || ! mxIsChar( pCell ) )
+	{
+	    sprintf( Buffer, "Error: %s must be a string or a cell array of "
+		     "strings. " PANSWEEP_USAGE, What );
+	    mexErrMsgTxt( Buffer );
+	    return( NULL );
+	}
+	ppStrings[K] = mxArrayToString( pCell );
+    }
+
+    *pCount = Count;
+    return( ppStrings );
+}
+
+
+
+
+/*
+ * The INIT commands in the script DIR/init.cmd, which every worker runs
+ * after loading the netlist: NULL if there are none.
+ */
+static char *SweepInit( const char *Dir, char **ppInit, int NumInit )
+{
+    char *Init;
+    FILE *pFile;
+    int K;
+
+    if( ! NumInit || asprintf( &Init, "%s/init.cmd", Dir ) < 0 )
+	return( NULL );
+
+    if( ! (pFile = fopen( Init, "w" )) )
+    {
+	free( Init );
+	return( NULL );
+    }
+    for( K = 0; K < NumInit; K++ )
+	fprintf( pFile, "%s\n", ppInit[K] );
+    if( fclose( pFile ) )
+    {
+	unlink( Init );
+	free( Init );
+	return( NULL );
+    }
+
+    return( Init );
+}
+
+
+
+
+static void SweepFree( Sweep *pSweep )
+{
+    int K;
+
+    for( K = 0; K < pSweep->NumWorkers; K++ )
+    {
+	free( pSweep->Workers[K].WorkDir );
+	free( pSweep->Workers[K].Log );
+    }
+    if( pSweep->pShared )
+	munmap( pSweep->pShared, sizeof(double) * pSweep->Capacity *
+	        pSweep->Width * pSweep->NumVars * pSweep->NumPoints );
+    if( pSweep->Shared )
+	unlink( pSweep->Shared );
+    free( pSweep->Shared );
+    if( pSweep->Init )
+	unlink( pSweep->Init );
+    free( pSweep->Init );
+}
+
+
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    if( nrhs < 8 || nrhs > 11 )
+    {
+	mexErrMsgTxt( "Error: wrong number of arguments. " PANSWEEP_USAGE );
+	return;
+    }
+    if( ! mxIsChar( prhs[0] ) || ! mxIsChar( prhs[1] ) )
+    {
+	mexErrMsgTxt( "Error: NETLIST and DIR must be strings. "
+	              PANSWEEP_USAGE );
+	return;
+    }
+    if( ! mxIsDouble( prhs[4] ) || mxIsComplex( prhs[4] ) )
+    {
+	mexErrMsgTxt( "Error: VALUES must be a real matrix. " PANSWEEP_USAGE );
+	return;
+    }
+    if( ! mxIsChar( prhs[5] ) || ! mxIsChar( prhs[6] ) )
+    {
+	mexErrMsgTxt( "Error: name and analysis must be strings. "
+	              PANSWEEP_USAGE );
+	return;
+    }
+    if( nlhs > 3 )
+    {
+	mexErrMsgTxt( "Error: at most three output variables are allowed. "
+	              PANSWEEP_USAGE );
+	return;
+    }
+
+    PanCounterBegin( PAN_COUNTER_PANSWEEP );
+
+    static Sweep Sw;
+    long Cores = sysconf( _SC_NPROCESSORS_ONLN );
+    int NumWorkers = Cores > 0 ? (int) Cores : 1, NumInit, K;
+    char **ppInit;
+
+    memset( &Sw, 0, sizeof( Sweep ) );
+    Sw.Netlist = mxArrayToString( prhs[0] );
+    Sw.Dir = mxArrayToString( prhs[1] );
+    ppInit = GetStrings( prhs[2], &NumInit, "INIT" );
+    Sw.ppAlter = GetStrings( prhs[3], &(Sw.NumParams), "ALTER" );
+    Sw.ppMem = GetStrings( prhs[7], &(Sw.NumVars), "MEM" );
+    Sw.Name = mxArrayToString( prhs[5] );
+    Sw.Analysis = mxArrayToString( prhs[6] );
+    Sw.pValues = mxGetDoubles( prhs[4] );
+
+    if( ! Sw.Netlist || ! Sw.Dir || ! Sw.Name || ! Sw.Analysis )
+    {
+	mexErrMsgTxt( "No more memory.\n" );
+	return;
+    }
+
+    if( (size_t) Sw.NumParams != mxGetM( prhs[4] ) )
+    {
+	mexErrMsgTxt( "Error: VALUES must have one row per ALTER command. "
+	              PANSWEEP_USAGE );
+	return;
+    }
+    Sw.NumPoints = (long) mxGetN( prhs[4] );
+
+    /* WORKERS may be [] for the default, when TIMEOUT is given. */
+    if( nrhs > 8 && ! mxIsEmpty( prhs[8] ) )
+    {
+	double Workers = mxGetScalar( prhs[8] );
+
+	if( ! mxIsNumeric( prhs[8] ) || Workers < 1 ||
+	    Workers != (int) Workers )
+	{
+	    mexErrMsgTxt( "Error: WORKERS must be a positive integer. "
+	                  PANSWEEP_USAGE );
+	    return;
+	}
+	NumWorkers = (int) Workers;
+    }
+    if( nrhs > 9 && ! mxIsEmpty( prhs[9] ) )
+    {
+	double Timeout = mxGetScalar( prhs[9] );
+
+	if( ! mxIsNumeric( prhs[9] ) || ! (Timeout > 0) )
+	{
+	    mexErrMsgTxt( "Error: TIMEOUT must be a positive number of "
+	                  "seconds. " PANSWEEP_USAGE );
+	    return;
+	}
+	if( ! mxIsInf( Timeout ) )
+	    Sw.Timeout = (uint64_t) (1e9 * Timeout);
+    }
+    if( nrhs > 10 && ! mxIsEmpty( prhs[10] ) )
+    {
+	double Samples = mxGetScalar( prhs[10] );
+
+	if( ! mxIsNumeric( prhs[10] ) || Samples < 0 ||
+	    Samples != (double) (size_t) Samples )
+	{
+	    mexErrMsgTxt( "Error: SAMPLES must be a non-negative integer. "
+	                  PANSWEEP_USAGE );
+	    return;
+	}
+	Sw.MinCapacity = (size_t) Samples;
+    }
+    if( NumWorkers > SWEEP_MAX_WORKERS )
+	NumWorkers = SWEEP_MAX_WORKERS;
+    if( NumWorkers > Sw.NumPoints )
+	NumWorkers = Sw.NumPoints > 0 ? (int) Sw.NumPoints : 1;
+    Sw.NumWorkers = NumWorkers;
+
+    char *Runner = PanWorkerRunner();
+
+    if( ! Runner )
+    {
+	mexErrMsgTxt( "Error: the panrun runner, which runs the sweep "
+	              "workers, can not be found next to pansweep. Run "
+	              "MPanSuiteInstall to build it." );
+	return;
+    }
+    mkdir( Sw.Dir, 0777 );
+
+    Sw.Init = SweepInit( Sw.Dir, ppInit, NumInit );
+    if( NumInit && ! Sw.Init )
+    {
+	free( Runner );
+	mexErrMsgTxt( "Error: the INIT commands can not be written to DIR. "
+	              PANSWEEP_USAGE );
+	return;
+    }
+
+    Sw.pRows = mxMalloc( (Sw.NumPoints + 1) * sizeof( int ) );
+    Sw.pStatus = mxMalloc( (Sw.NumPoints + 1) * sizeof( int ) );
+
+    for( K = 0; K < Sw.NumPoints; K++ )
+    {
+	Sw.pRows[K] = 0;
+	Sw.pStatus[K] = SWEEP_NOT_RUN;
+    }
+    for( K = 0; K < NumWorkers; K++ )
+    {
+	Sw.Range[K].Next = K * Sw.NumPoints / NumWorkers;
+	Sw.Range[K].End = (K + 1) * Sw.NumPoints / NumWorkers;
+    }
+
+    /* The time spent waiting for the workers is reported as PAN time. */
+    PanCounterPanEnter();
+    int Started = Sw.NumPoints > 0 ? SweepRun( &Sw, Runner ) : 1;
+    PanCounterPanLeave();
+
+    free( Runner );
+
+    if( Sw.NeedsMatlab )
+    {
+	char Buffer[ 400 ];
+
+	SweepFree( &Sw );
+	snprintf( Buffer, sizeof( Buffer ), "Error: the netlist evaluates its "
+	          "macro devices through %s%s%s, which the sweep workers can "
+	          "not call: they run PAN without MATLAB. Such netlists can "
+	          "be swept with MPanBatch.", Sw.Matlab[0] ? "the <" :
+	          "MATLAB functions", Sw.Matlab, Sw.Matlab[0] ?
+	          "> MATLAB function" : "" );
+	mexErrMsgTxt( Buffer );
+	return;
+    }
+    if( ! Started || (Started == Sw.LoadFailures) )
+    {
+	char Buffer[ 200 ];
+
+	SweepFree( &Sw );
+	snprintf( Buffer, sizeof( Buffer ), "Error: no sweep worker could %s. "
+	          "See the logs of the workers in <%s>.", Started ?
+	          "load the netlist and run the INIT commands" : "be started",
+	          Sw.Dir );
+	mexErrMsgTxt( Buffer );
+	return;
+    }
+
+    mxArray *pRows, *pStatus;
+
+    plhs[0] = SweepCollect( &Sw, &pRows, &pStatus );
+    SweepFree( &Sw );
+
+    PanCounterBytes( PAN_COUNTER_MX_BYTES( plhs[0] ) );
+    PanCounterEnd( Sw.Analysis );
+
+    if( nlhs > 1 )
+	plhs[1] = pRows;
+    else
+	mxDestroyArray( pRows );
+    if( nlhs > 2 )
+	plhs[2] = pStatus;
+    else
+	mxDestroyArray( pStatus );
+}
@@ -0,0 +1,479 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "pantranspose.h"
+
+/* Exactly one of pDst, pDstS and pDstQ is set. */
+typedef struct
+{
+    double              *pDst;
+    float               *pDstS;
+    int16_t             *pDstQ;
+    const double * const *ppSrc;
+    const double * const *ppSrcI;
+    const double        *pInvScale, *pOffset;
+    int                  Rows, Cols;
+    int                  RowBegin, RowEnd;
+    int                  ColBegin, ColEnd;
+    int                  Wide;
+} TransposeTask;
+
+
+
+
+static void TransposeTile( double *pDst, const double * const *ppSrc,
+                           size_t Rows, int I0, int I1, int J0, int J1 )
+{
+    register int I = I0, J;
+
+#ifdef __SSE2__
+    /*
+     * Two source rows at a time: the 2 x 2 sub-blocks are transposed in
+     * registers and stored as pairs of consecutive rows of two columns.
+     */
+    for( ; I + 1 < I1; I += 2 )
+    {
+	const double *pRow0 = ppSrc[I];
+	const double *pRow1 = ppSrc[I + 1];
+
+	for( J = J0; J + 1 < J1; J += 2 )
+	{
+	    __m128d A = _mm_loadu_pd( pRow0 + J );
+	    __m128d B = _mm_loadu_pd( pRow1 + J );
+
+	    _mm_storeu_pd( pDst + J * Rows + I, _mm_unpacklo_pd( A, B ) );
+	    _mm_storeu_pd( pDst + (J + 1) * Rows + I, _mm_unpackhi_pd( A, B ) );
+	}
+	for( ; J < J1; J++ )
+	{
+	    pDst[J * Rows + I]     = pRow0[J];
+	    pDst[J * Rows + I + 1] = pRow1[J];
+	}
+    }
+#endif
+
+    for( ; I < I1; I++ )
+    {
+	const double *pRow = ppSrc[I];
+
+	for( J = J0; J < J1; J++ )
+	    pDst[J * Rows + I] = pRow[J];
+    }
+}
+
+
+
+
+/*
+ * Complex tile: pDst holds (real, imaginary) pairs, so one 16 byte store
+ * writes a whole element and two columns are handled per iteration.
+ */
+static void TransposeTileComplex( double *pDst, const double * const *ppSrcR,
+                                  const double * const *ppSrcI, size_t Rows,
+                                  int I0, int I1, int J0, int J1 )
+{
+    register int I, J;
+
+    for( I = I0; I < I1; I++ )
+    {
+	const double *pRowR = ppSrcR[I];
+	const double *pRowI = ppSrcI[I];
+
+	J = J0;
+#ifdef __SSE2__
+	for( ; J + 1 < J1; J += 2 )
+	{
+	    __m128d A = _mm_loadu_pd( pRowR + J );
+	    __m128d B = _mm_loadu_pd( pRowI + J );
+
+	    _mm_storeu_pd( pDst + 2 * (J * Rows + I), _mm_unpacklo_pd( A, B ) );
+	    _mm_storeu_pd( pDst + 2 * ((J + 1) * Rows + I),
+	                   _mm_unpackhi_pd( A, B ) );
+	}
+#endif
+	for( ; J < J1; J++ )
+	{
+	    pDst[2 * (J * Rows + I)]     = pRowR[J];
+	    pDst[2 * (J * Rows + I) + 1] = pRowI[J];
+	}
+    }
+}
+
+
+
+
+/* Single precision tile: the conversion is fused with the transposition. */
+static void TransposeTileSingle( float *pDst, const double * const *ppSrcR,
+                                 const double * const *ppSrcI, size_t Rows,
+                                 int I0, int I1, int J0, int J1 )
+{
+    register int I, J;
+
+    for( I = I0; I < I1; I++ )
+    {
+	const double *pRowR = ppSrcR[I];
+
+	if( ppSrcI )
+	{
+	    const double *pRowI = ppSrcI[I];
+
+	    for( J = J0; J < J1; J++ )
+	    {
+		pDst[2 * (J * Rows + I)]     = (float) pRowR[J];
+		pDst[2 * (J * Rows + I) + 1] = (float) pRowI[J];
+	    }
+	}
+	else
+	{
+	    for( J = J0; J < J1; J++ )
+		pDst[J * Rows + I] = (float) pRowR[J];
+	}
+    }
+}
+
+
+
+
+static void TransposeTileInt16( int16_t *pDst, const double * const *ppSrc,
+                                const double *pInvScale, const double *pOffset,
+                                size_t Rows, int I0, int I1, int J0, int J1 )
+{
+    register int I, J;
+
+    for( I = I0; I < I1; I++ )
+    {
+	const double *pRow = ppSrc[I];
+
+	for( J = J0; J < J1; J++ )
+	    pDst[J * Rows + I] = PanQuantize( pRow[J], pInvScale[J],
+	                                      pOffset[J] );
+    }
+}
+
+
+
+
+/* Real matrices of a few rows, on one thread: one column at a time. */
+static void TransposeGather( double *pDst, const double * const *ppSrc,
+                             int Rows, int Cols )
+{
+    register int I, J;
+
+    for( J = 0; J < Cols; J++ )
+    {
+	for( I = 0; I < Rows; I++ )
+	    *pDst++ = ppSrc[I][J];
+    }
+}
+
+
+
+
+static void TransposeBlock( const TransposeTask *pTask,
+                            int I0, int I1, int J0, int J1 )
+{
+    if( pTask->pDstS )
+	TransposeTileSingle( pTask->pDstS, pTask->ppSrc, pTask->ppSrcI,
+	                     (size_t) pTask->Rows, I0, I1, J0, J1 );
+    else if( pTask->pDstQ )
+	TransposeTileInt16( pTask->pDstQ, pTask->ppSrc, pTask->pInvScale,
+	                    pTask->pOffset, (size_t) pTask->Rows,
+	                    I0, I1, J0, J1 );
+    else if( pTask->ppSrcI )
+	TransposeTileComplex( pTask->pDst, pTask->ppSrc, pTask->ppSrcI,
+	                      (size_t) pTask->Rows, I0, I1, J0, J1 );
+    else
+	TransposeTile( pTask->pDst, pTask->ppSrc, (size_t) pTask->Rows,
+	               I0, I1, J0, J1 );
+}
+
+
+
+
+static void *TransposeRows( void *pArg )
+{
+    TransposeTask *pTask = (TransposeTask *) pArg;
+    int I0, J0, I1, J1;
+
+    /*
+     * A wide matrix is gathered in strips of PAN_TRANSPOSE_BLOCK columns
+     * that span all the rows: each strip is a contiguous run of pDst.
+     */
+    if( pTask->Wide )
+    {
+	for( J0 = pTask->ColBegin; J0 < pTask->ColEnd;
+	     J0 += PAN_TRANSPOSE_BLOCK )
+	{
+	    J1 = J0 + PAN_TRANSPOSE_BLOCK;
+	    if( J1 > pTask->ColEnd )
+		J1 = pTask->ColEnd;
+
+	    TransposeBlock( pTask, pTask->RowBegin, pTask->RowEnd, J0, J1 );
+	}
+
+	return( NULL );
+    }
+
+    for( I0 = pTask->RowBegin; I0 < pTask->RowEnd; I0 += PAN_TRANSPOSE_BLOCK )
+    {
+	I1 = I0 + PAN_TRANSPOSE_BLOCK;
+	if( I1 > pTask->RowEnd )
+	    I1 = pTask->RowEnd;
+
+	for( J0 = pTask->ColBegin; J0 < pTask->ColEnd;
+	     J0 += PAN_TRANSPOSE_BLOCK )
+	{
+	    J1 = J0 + PAN_TRANSPOSE_BLOCK;
+	    if( J1 > pTask->ColEnd )
+		J1 = pTask->ColEnd;
+
+	    TransposeBlock( pTask, I0, I1, J0, J1 );
+	}
+    }
+
+    return( NULL );
+}
+
+
+
+
+static int TransposeThreads( int Rows, int Cols )
+{
+    size_t Elements = (size_t) Rows * (size_t) Cols;
+    long Cores = sysconf( _SC_NPROCESSORS_ONLN );
+    int NumThreads = (int) (Elements / PAN_TRANSPOSE_THREAD_MIN);
+
+    if( Cores > 0 && NumThreads > Cores )
+	NumThreads = (int) Cores;
+    if( NumThreads > PAN_TRANSPOSE_MAX_THREADS )
+	NumThreads = PAN_TRANSPOSE_MAX_THREADS;
+
+    return( NumThreads < 1 ? 1 : NumThreads );
+}
+
+
+
+
+static void TransposeSplit( const TransposeTask *pTemplate, int NumThreads )
+{
+    TransposeTask Tasks[ PAN_TRANSPOSE_MAX_THREADS ];
+    pthread_t     Threads[ PAN_TRANSPOSE_MAX_THREADS ];
+    int Rows = pTemplate->Rows, Cols = pTemplate->Cols;
+    int Wide = Rows <= PAN_TRANSPOSE_WIDE_ROWS && Cols > Rows;
+    int Span = Wide ? Cols : Rows;
+    int Chunk, K, Started;
+
+    if( Rows <= 0 || Cols <= 0 )
+	return;
+
+    if( NumThreads <= 0 )
+	NumThreads = TransposeThreads( Rows, Cols );
+    if( NumThreads > PAN_TRANSPOSE_MAX_THREADS )
+	NumThreads = PAN_TRANSPOSE_MAX_THREADS;
+
+    if( 1 == NumThreads && Rows <= PAN_TRANSPOSE_GATHER_ROWS &&
+        pTemplate->pDst && ! pTemplate->ppSrcI )
+    {
+	TransposeGather( pTemplate->pDst, pTemplate->ppSrc, Rows, Cols );
+	return;
+    }
+
+    /*
+     * Threads work on disjoint row ranges, aligned to the tile size so that
+     * no two threads write the same cache line of a destination column. A
+     * wide matrix is split by columns instead: its row ranges would be
+     * short runs scattered over all of pDst.
+     */
+    Chunk = (Span + NumThreads - 1) / NumThreads;
+    Chunk = (Chunk + PAN_TRANSPOSE_BLOCK - 1) / PAN_TRANSPOSE_BLOCK *
+	    PAN_TRANSPOSE_BLOCK;
+
+    for( K = 0; K < NumThreads; K++ )
+    {
+	int Begin = K * Chunk < Span ? K * Chunk : Span;
+	int End = (K + 1) * Chunk < Span ? (K + 1) * Chunk : Span;
+
+	Tasks[K]          = *pTemplate;
+	Tasks[K].Wide     = Wide;
+	Tasks[K].RowBegin = Wide ? 0 : Begin;
+	Tasks[K].RowEnd   = Wide ? Rows : End;
+	Tasks[K].ColBegin = Wide ? Begin : 0;
+	Tasks[K].ColEnd   = Wide ? End : Cols;
+    }
+
+    /*
+     * The calling thread takes the first range. If a thread can not be
+     * created its range is done serially.
+     */
+    Started = 0;
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( pthread_create( Threads + K, NULL, TransposeRows, Tasks + K ) )
+	    TransposeRows( Tasks + K );
+	else
+	    Started |= 1 << K;
+    }
+
+    TransposeRows( Tasks );
+
+    for( K = 1; K < NumThreads; K++ )
+    {
+	if( Started & (1 << K) )
+	    pthread_join( Threads[K], NULL );
+    }
+}
+
+
+
+
+static void TransposeInit( TransposeTask *pTask,
+                           const double * const *ppSrc,
+                           const double * const *ppSrcI, int Rows, int Cols )
+{
+    memset( pTask, 0, sizeof( TransposeTask ) );
+    pTask->ppSrc  = ppSrc;
+    pTask->ppSrcI = ppSrcI;
+    pTask->Rows   = Rows;
+    pTask->Cols   = Cols;
+}
+
+
+
+
+void PanTranspose( double *pDst, const double * const *ppSrc,
+                   int Rows, int Cols, int NumThreads )
+{
+    TransposeTask Task;
+
+    TransposeInit( &Task, ppSrc, NULL, Rows, Cols );
+    Task.pDst = pDst;
+    TransposeSplit( &Task, NumThreads );
+}
+
+
+
+
+void PanTransposeComplex( double *pDst, const double * const *ppSrcR,
+                          const double * const *ppSrcI,
+                          int Rows, int Cols, int NumThreads )
+{
+    TransposeTask Task;
+
+    /* Each element moves twice the bytes of a real one. */
+    if( NumThreads <= 0 )
+	NumThreads = TransposeThreads( Rows, 2 * Cols );
+
+    TransposeInit( &Task, ppSrcR, ppSrcI, Rows, Cols );
+    Task.pDst = pDst;
+    TransposeSplit( &Task, NumThreads );
+}
+
+
+
+
+void PanTransposeSingle( float *pDst, const double * const *ppSrcR,
+                         const double * const *ppSrcI,
+                         int Rows, int Cols, int NumThreads )
+{
+    TransposeTask Task;
+
+    if( NumThreads <= 0 )
+	NumThreads = TransposeThreads( Rows, ppSrcI ? 2 * Cols : Cols );
+
+    TransposeInit( &Task, ppSrcR, ppSrcI, Rows, Cols );
+    Task.pDstS = pDst;
+    TransposeSplit( &Task, NumThreads );
+}
+
+
+
+
+void PanColumnRanges( PanQuantRange *pRanges, const double * const *ppSrc,
+                      int Rows, int Cols )
+{
+    register int I, J;
+
+    for( J = 0; J < Cols; J++ )
+	PanQuantRangeInit( pRanges + J );
+
+    for( I = 0; I < Rows; I++ )
+    {
+	const double *pRow = ppSrc[I];
+
+	for( J = 0; J < Cols; J++ )
+	    PanQuantRangeAdd( pRanges + J, pRow[J] );
+    }
+}
+
+
+
+
+int PanTransposeInt16( int16_t *pDst, const double * const *ppSrc,
+                       const double *pScale, const double *pOffset,
+                       int Rows, int Cols, int NumThreads )
+{
+    TransposeTask Task;
+    double *pInvScale;
+    int J;
+
+    pInvScale = malloc( (Cols > 0 ? Cols : 1) * sizeof(double) );
+    if( NULL == pInvScale )
+	return( -1 );
+    for( J = 0; J < Cols; J++ )
+	pInvScale[J] = 1.0 / pScale[J];
+
+    TransposeInit( &Task, ppSrc, NULL, Rows, Cols );
+    Task.pDstQ     = pDst;
+    Task.pInvScale = pInvScale;
+    Task.pOffset   = pOffset;
+    TransposeSplit( &Task, NumThreads );
+
+    free( pInvScale );
+
+    return( 0 );
+}
+
+
+
+
+void PanInterleaveSingle( float *pDst, const double *pSrcR,
+                          const double *pSrcI, size_t N )
+{
+    register size_t I;
+
+    for( I = 0; I < N; I++ )
+    {
+	pDst[2 * I]     = (float) pSrcR[I];
+	pDst[2 * I + 1] = (float) pSrcI[I];
+    }
+}
+
+
+
+
+void PanInterleave( double *pDst, const double *pSrcR, const double *pSrcI,
+                    size_t N )
+{
+    register size_t I = 0;
+
+#ifdef __SSE2__
+    for( ; I + 1 < N; I += 2 )
+    {
+	__m128d A = _mm_loadu_pd( pSrcR + I );
+	__m128d B = _mm_loadu_pd( pSrcI + I );
+
+	_mm_storeu_pd( pDst + 2 * I, _mm_unpacklo_pd( A, B ) );
+	_mm_storeu_pd( pDst + 2 * I + 2, _mm_unpackhi_pd( A, B ) );
+    }
+#endif
+    for( ; I < N; I++ )
+    {
+	pDst[2 * I]     = pSrcR[I];
+	pDst[2 * I + 1] = pSrcI[I];
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef PAN_TRANSPOSE_H
+#define PAN_TRANSPOSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "panquant.h"
+
+/*
+ * Side of the square tiles used to gather multi-column waveforms. A tile
+ * of PAN_TRANSPOSE_BLOCK x PAN_TRANSPOSE_BLOCK doubles (8 kB) keeps both
+ * the source rows and the destination columns in L1.
+ */
+#define PAN_TRANSPOSE_BLOCK        32
+
+/*
+ * Matrices with more columns than rows, and at most PAN_TRANSPOSE_WIDE_ROWS
+ * rows, are gathered in strips of PAN_TRANSPOSE_BLOCK whole columns: a
+ * strip of the source (one tile width of every row) still fits in L2 and
+ * the strip of pDst is written sequentially.
+ */
+#define PAN_TRANSPOSE_WIDE_ROWS    2048
+
+/*
+ * On a single thread, matrices with at most PAN_TRANSPOSE_GATHER_ROWS rows
+ * are gathered column by column: the rows read for a column stay in L1 for
+ * the next ones and the tiles only add overhead. With more rows, or more
+ * threads, the tiled kernels are faster (see bench/pantranspose_bench.c).
+ */
+#define PAN_TRANSPOSE_GATHER_ROWS  PAN_TRANSPOSE_BLOCK
+
+/*
+ * Matrices with less than PAN_TRANSPOSE_THREAD_MIN elements per thread are
+ * not worth the cost of spawning threads.
+ */
+#define PAN_TRANSPOSE_THREAD_MIN   (1 << 18)
+#define PAN_TRANSPOSE_MAX_THREADS  8
+
+/*
+ * Copy the Rows x Cols matrix stored by PAN as an array of row pointers
+ * (ppSrc[I][J]) into the column-major buffer pDst. NumThreads = 0 selects
+ * the number of threads from the matrix size and the available cores.
+ */
+void PanTranspose( double *pDst, const double * const *ppSrc,
+                   int Rows, int Cols, int NumThreads );
+
+/*
+ * Same as PanTranspose for complex matrices: the real and imaginary row
+ * pointers are gathered in one pass into pDst, which holds Rows x Cols
+ * interleaved (real, imaginary) pairs as mxComplexDouble does.
+ */
+void PanTransposeComplex( double *pDst, const double * const *ppSrcR,
+                          const double * const *ppSrcI,
+                          int Rows, int Cols, int NumThreads );
+
+/* Interleave two vectors of N doubles into N (real, imaginary) pairs. */
+void PanInterleave( double *pDst, const double *pSrcR, const double *pSrcI,
+                    size_t N );
+
+/*
+ * Single precision forms, for panget(..., 'single'): the conversion is done
+ * while gathering. ppSrcI is NULL for real matrices.
+ */
+void PanTransposeSingle( float *pDst, const double * const *ppSrcR,
+                         const double * const *ppSrcI,
+                         int Rows, int Cols, int NumThreads );
+void PanInterleaveSingle( float *pDst, const double *pSrcR,
+                          const double *pSrcI, size_t N );
+
+/*
+ * Quantised form, for panget(..., 'int16'). The ranges of the columns are
+ * gathered by PanColumnRanges in one pass over the rows; PanTransposeInt16
+ * quantises every column with its SCALE and OFFSET (see panquant.h) and
+ * returns -1 if it runs out of memory.
+ */
+void PanColumnRanges( PanQuantRange *pRanges, const double * const *ppSrc,
+                      int Rows, int Cols );
+int  PanTransposeInt16( int16_t *pDst, const double * const *ppSrc,
+                        const double *pScale, const double *pOffset,
+                        int Rows, int Cols, int NumThreads );
+
+#endif
@@ -0,0 +1,191 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <dlfcn.h>
+#include <libgen.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "panworker.h"
+#include "pancounter.h"
+
+#define WORKER_MAX_ARGS  16
+
+extern char **environ;
+
+
+
+
+char *PanWorkerRunner( void )
+{
+    Dl_info Info;
+    char *Copy, *Path;
+
+    if( ! dladdr( (void *) PanWorkerRunner, &Info ) || ! Info.dli_fname )
+	return( NULL );
+    if( ! (Copy = strdup( Info.dli_fname )) )
+	return( NULL );
+    if( asprintf( &Path, "%s/%s", dirname( Copy ), PAN_WORKER_RUNNER ) < 0 )
+	Path = NULL;
+    free( Copy );
+
+    if( Path && access( Path, X_OK ) )
+    {
+	free( Path );
+	Path = NULL;
+    }
+
+    return( Path );
+}
+
+
+
+
+int PanWorkerStart( PanWorker *pWorker, const char *Runner,
+                    char * const *ppArgs, const char *Log )
+{
+    posix_spawn_file_actions_t Actions;
+    char *ppArgv[ WORKER_MAX_ARGS + 3 ];
+    int In[2] = { -1, -1 }, Out[2] = { -1, -1 }, Status = -1, K;
+
+    memset( pWorker, 0, sizeof( PanWorker ) );
+    pWorker->Pid = -1;
+    pWorker->In = pWorker->Out = -1;
+
+    ppArgv[0] = (char *) Runner;
+    ppArgv[1] = "-s";
+    for( K = 0; K < WORKER_MAX_ARGS && ppArgs[K]; K++ )
+	ppArgv[ K + 2 ] = ppArgs[K];
+    ppArgv[ K + 2 ] = NULL;
+
+    if( pipe2( In, O_CLOEXEC ) || pipe2( Out, O_CLOEXEC ) )
+	goto Done;
+
+    posix_spawn_file_actions_init( &Actions );
+    posix_spawn_file_actions_adddup2( &Actions, In[0], STDIN_FILENO );
+    posix_spawn_file_actions_adddup2( &Actions, Out[1], STDOUT_FILENO );
+    posix_spawn_file_actions_addopen( &Actions, STDERR_FILENO, Log,
+                                      O_WRONLY | O_CREAT | O_APPEND, 0666 );
+    Status = posix_spawn( &(pWorker->Pid), Runner, &Actions, NULL, ppArgv,
+                          environ );
+    posix_spawn_file_actions_destroy( &Actions );
+
+Done:
+    if( In[0] >= 0 )
+	close( In[0] );
+    if( Out[1] >= 0 )
+	close( Out[1] );
+
+    if( Status )
+    {
+	if( In[1] >= 0 )
+	    close( In[1] );
+	if( Out[0] >= 0 )
+	    close( Out[0] );
+	pWorker->Pid = -1;
+	return( -1 );
+    }
+
+    pWorker->In = In[1];
+    pWorker->Out = Out[0];
+
+    return( 0 );
+}
+
+
+
+
+int PanWorkerSend( PanWorker *pWorker, const char *pText, size_t Length )
+{
+    ssize_t Written;
+
+    while( Length > 0 )
+    {
+	Written = write( pWorker->In, pText, Length );
+	if( Written < 0 && EINTR == errno )
+	    continue;
+	if( Written <= 0 )
+	    return( -1 );
+	pText += Written;
+	Length -= Written;
+    }
+
+    return( 0 );
+}
+
+
+
+
+int PanWorkerRead( PanWorker *pWorker )
+{
+    char *pEnd;
+    ssize_t Read;
+
+    Read = read( pWorker->Out, pWorker->Answer + pWorker->Length,
+                 sizeof( pWorker->Answer ) - 1 - pWorker->Length );
+    if( Read < 0 && EINTR == errno )
+	return( 0 );
+    if( Read <= 0 )
+	return( -1 );
+
+    pWorker->Length += Read;
+    pWorker->Answer[ pWorker->Length ] = 0;
+    if( ! (pEnd = strchr( pWorker->Answer, '\n' )) )
+	return( pWorker->Length + 1 < sizeof( pWorker->Answer ) ? 0 : -1 );
+
+    /* One request is pending at a time: nothing follows the answer. */
+    *pEnd = 0;
+    pWorker->Length = 0;
+
+    return( 1 );
+}
+
+
+
+
+int PanWorkerStop( PanWorker *pWorker, int Kill )
+{
+    uint64_t Limit = PanCounterNow() +
+                     PAN_WORKER_EXIT_GRACE * 1000000000ull;
+    struct timespec Pause = { 0, 1000000 };
+    pid_t Reaped;
+    int Status = 0;
+
+    if( pWorker->In >= 0 )
+	close( pWorker->In );
+    if( pWorker->Out >= 0 )
+	close( pWorker->Out );
+    pWorker->In = pWorker->Out = -1;
+
+    if( pWorker->Pid <= 0 )
+	return( -1 );
+
+    if( Kill )
+	kill( pWorker->Pid, SIGKILL );
+
+    while( 0 == (Reaped = waitpid( pWorker->Pid, &Status, WNOHANG )) ||
+           (Reaped < 0 && EINTR == errno) )
+    {
+	if( PanCounterNow() > Limit )
+	{
+	    kill( pWorker->Pid, SIGKILL );
+	    while( (Reaped = waitpid( pWorker->Pid, &Status, 0 )) < 0 &&
+	           EINTR == errno )
+		;
+	    break;
+	}
+	nanosleep( &Pause, NULL );
+    }
+
+    pWorker->Pid = -1;
+
+    if( Reaped < 0 || ! WIFEXITED( Status ) )
+	return( -1 );
+
+    return( WEXITSTATUS( Status ) );
+}
@@ -0,0 +1,70 @@
+#ifndef PAN_WORKER_H
+#define PAN_WORKER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * A worker is a "panrun -s" process (see panrun.c) that loads a netlist on
+ * its own and runs the commands written to In, answering "ERROR STATUS"
+ * on Out to every "> OUTPUT NAME ..." (or bare ">") line, and as panrun.c
+ * describes to the "?" and "=" lines. The gateways use
+ * workers to run PAN outside of the MATLAB process: PAN calls the MATLAB
+ * API, which may only be used on the MATLAB main thread and never in a
+ * fork of MATLAB.
+ */
+#define PAN_WORKER_RUNNER       "panrun"
+
+/*
+ * The exit status of panrun when the netlist can not be loaded, when a
+ * command of its INIT script fails and when either called a MATLAB
+ * function. PAN_WORKER_EMATLAB is also the STATUS of an answer, as is
+ * PAN_WORKER_ESPACE when the memwaveforms do not fit in the result array.
+ */
+#define PAN_WORKER_ELOAD        2
+#define PAN_WORKER_ECOMMAND     3
+#define PAN_WORKER_EMATLAB      5
+#define PAN_WORKER_ESPACE       6
+
+/* Seconds a worker is given to exit once its input is closed. */
+#define PAN_WORKER_EXIT_GRACE   2
+
+typedef struct
+{
+    pid_t   Pid;                /* -1 if the worker is not running */
+    int     In, Out;
+    size_t  Length;
+    char    Answer[ 64 ];
+} PanWorker;
+
+/*
+ * panrun in the folder of the MEX file, where MPanSuiteInstall builds it,
+ * in a malloc'd string; NULL if it is not there.
+ */
+char *PanWorkerRunner( void );
+
+/*
+ * Start Runner -s with the options ppArgs (NULL terminated, the netlist
+ * last): the console output of PAN is appended to Log. Return 0 on
+ * success. The pipes are not inherited by the other workers.
+ */
+int  PanWorkerStart( PanWorker *pWorker, const char *Runner,
+                     char * const *ppArgs, const char *Log );
+
+/* Write Length bytes to the worker: -1 if it can not be reached. */
+int  PanWorkerSend( PanWorker *pWorker, const char *pText, size_t Length );
+
+/*
+ * Read what the worker sent: 1 once Answer holds a whole answer (without
+ * the newline), 0 if it is not complete yet, -1 if the worker died.
+ */
+int  PanWorkerRead( PanWorker *pWorker );
+
+/*
+ * Close the pipes and reap the worker, which is killed if Kill is set or
+ * if it does not exit within PAN_WORKER_EXIT_GRACE seconds. Return its
+ * exit status, -1 if it was killed or was not running.
+ */
+int  PanWorkerStop( PanWorker *pWorker, int Kill );
+
+#endif
@@ -37,6 +37,8 @@ if nargin > 4
     str_command = MPanStrCommandComplete(str_command,varargin{:});
 end
 
-clear NAME PARAM VALUE varargin;
+clear NAME varargin;
 
 pansimc(str_command);
+
+MPanSolutionCache('alter', PARAM, VALUE);
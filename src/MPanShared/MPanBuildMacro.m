@@ -0,0 +1,146 @@
+function MPanBuildMacro(NAME, varargin)
+% MPanBuildMacro compiles the evaluate function of an nport macro device
+% (model NAME nport macro=yes evaluate="MACRO") into a MEX file, which
+% MATLAB calls instead of the interpreted MACRO.m.
+%
+% Usage: MPanBuildMacro(MACRO)
+%        MPanBuildMacro(MACRO, SOURCE)
+%        MPanBuildMacro(MACRO, 'coder', ARGS)
+%        MPanBuildMacro(MACRO, 'bypass')
+%        MPanBuildMacro(MACRO, 'remove')
+%
+% MPanBuildMacro(MACRO) links the C kernel MACRO.c, found in the folder of
+% MACRO.m (or in the current folder), with the panmacro gateway of
+% MPanSuite and writes the MACRO MEX file next to MACRO.m. The kernel
+% defines the PanMacro model of mex_so/panmacro.h: the number of ports and
+% states and a function evaluating a batch of instances over
+% struct-of-arrays of V, I, X and dX into preallocated f, C and R (see
+% examples/IEEE14_feeder/PvMod.c, the kernel of PvMod.m). PAN calls the
+% MEX file as it called MACRO.m; the same kernel also evaluates N
+% instances in one call:
+%    [F, C, R] = MACRO('batch', PARS, V, I, X, DX, TIME)
+% with V and I N x ports, X and DX N x states, F N x ports and C and R
+% N x ports x ports.
+%
+% MPanBuildMacro(MACRO, SOURCE) uses the C kernel SOURCE.
+%
+% MPanBuildMacro(MACRO, 'coder', ARGS) compiles MACRO.m itself with MATLAB
+% Coder, when no C kernel has been written. ARGS is the cell array of the
+% arguments of a typical call, {Pars, PN, V, I, StN, X, dX, Time}, from
+% which the types of the arguments are derived. MACRO.m must preallocate
+% its outputs, e.g. f = zeros(1,3) in PvMod.m.
+%
+% Near convergence most instances are called back with the same inputs
+% at every Newton iteration. The compiled macro can return the cached
+% outputs of such calls instead of evaluating them again:
+%    MACRO('bypass', RELTOL, ABSTOL)
+% bypasses the evaluation when Pars, StN and Time are the same as those
+% of a cached call and every element of V, I, X and dX is within
+% ABSTOL + RELTOL*max(|new|,|cached|) of it; f is then corrected with the
+% cached linearisation, f + C*(V - V0) + R*(I - I0). The last 256 calls
+% are cached (MACRO('bypass', RELTOL, ABSTOL, SIZE) sets their number).
+% MACRO('bypass', 'off') evaluates every call again, S = MACRO('stats')
+% returns the number of calls, the hits and the hit rate, MACRO('reset')
+% zeroes them and empties the cache.
+%
+% MPanBuildMacro(MACRO, 'bypass') builds MACRO_bypass, which adds only
+% the bypass in front of MACRO (e.g. an interpreted MACRO.m): name it in
+% the netlist, evaluate="MACRO_bypass", and set its tolerances with
+% MACRO_bypass('bypass', RELTOL, ABSTOL).
+%
+% The calls of both MEX files are profiled by MPanProfile: MACRO_bypass
+% also profiles an interpreted MACRO.m, with bypass off.
+%
+% MPanBuildMacro(MACRO, 'remove') deletes the MEX files: MACRO.m is used
+% again.
+%
+% See also
+%    MPanLoadNet, MPanProfile, mex, codegen
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+if nargin < 1
+    error('MPanSuiteError: the name of the macro is missing.');
+end
+NAME = char(NAME);
+
+MFILE = which([NAME '.m']);
+if isempty(MFILE)
+    OUTDIR = pwd;
+else
+    OUTDIR = fileparts(MFILE);
+end
+MEXFILE = fullfile(OUTDIR, [NAME '.' mexext]);
+
+MEXDIR = fileparts(which('panget'));
+if isempty(MEXDIR) || ~exist(fullfile(MEXDIR,'panmacro.c'),'file')
+    MEXDIR = '';
+end
+
+if nargin > 1 && strcmp(varargin{1},'remove')
+    clear(NAME, [NAME '_bypass']);
+    BYPASSFILE = fullfile(OUTDIR, [NAME '_bypass.' mexext]);
+    if exist(MEXFILE,'file')
+        delete(MEXFILE);
+    end
+    if exist(BYPASSFILE,'file')
+        delete(BYPASSFILE);
+    end
+    rehash;
+    return
+end
+
+if nargin > 1 && strcmp(varargin{1},'bypass')
+    if isempty(MEXDIR)
+        error('MPanSuiteError: the panmacro gateway of MPanSuite can not be found.');
+    end
+    clear([NAME '_bypass']);
+    mex('-R2018a', '-O', ['-I' MEXDIR], ['-DPAN_MACRO_FORWARD=' NAME], ...
+        '-outdir', OUTDIR, '-output', [NAME '_bypass'], ...
+        fullfile(MEXDIR,'panmacro.c'), fullfile(MEXDIR,'panmacrofwd.c'), ...
+        fullfile(MEXDIR,'pancounter.c'), fullfile(MEXDIR,'panprof.c'));
+    rehash;
+    return
+end
+
+if nargin > 1 && strcmp(varargin{1},'coder')
+    if nargin < 3 || ~iscell(varargin{2})
+        error('MPanSuiteError: the cell array of the example arguments is missing.');
+    end
+    if isempty(MFILE)
+        error('MPanSuiteError: %s.m can not be found.', NAME);
+    end
+    if ~license('test','MATLAB_Coder')
+        error('MPanSuiteError: MATLAB Coder is not available: write a C kernel of %s.', NAME);
+    end
+    clear(NAME);
+    codegen('-config:mex', MFILE, '-args', varargin{2}, ...
+        '-o', fullfile(OUTDIR, NAME), '-d', fullfile(tempdir, ['codegen_' NAME]));
+    rehash;
+    return
+end
+
+if nargin > 1
+    SOURCE = char(varargin{1});
+else
+    SOURCE = fullfile(OUTDIR, [NAME '.c']);
+    if ~exist(SOURCE,'file')
+        SOURCE = fullfile(pwd, [NAME '.c']);
+    end
+end
+if ~exist(SOURCE,'file')
+    error('MPanSuiteError: the C kernel %s can not be found.', SOURCE);
+end
+
+if isempty(MEXDIR)
+    error('MPanSuiteError: the panmacro gateway of MPanSuite can not be found.');
+end
+
+clear(NAME);
+mex('-R2018a', '-O', ['-I' MEXDIR], '-outdir', OUTDIR, '-output', NAME, ...
+    fullfile(MEXDIR,'panmacro.c'), fullfile(MEXDIR,'pancounter.c'), ...
+    fullfile(MEXDIR,'panprof.c'), SOURCE);
+rehash;
+end
@@ -0,0 +1,207 @@
+classdef MPanFuture < handle
+% MPanFuture is the handle to a PAN command run in background by
+% pansimc_async. MATLAB is free while the command runs: raw files can be
+% read, the next commands prepared and the simulator used as usual.
+%
+% Every background command runs in a panrun worker process of its own
+% (see panrun.c), which loads the netlist of MPanLoadNet from its file,
+% writes its log in RADIX.async.log and the console output of PAN in
+% RADIX.async.console.log. The worker first replays the parameters
+% altered in the MATLAB session with MPanAlter or MPanBatch (see
+% MPanSolutionCache) when the command was queued; the other commands
+% given to pansimc are not seen. The raw files of the worker go to a
+% temporary folder private to F, removed as soon as F is found completed
+% (by isdone, wait or fetch), is cancelled or is deleted: the memwaveforms
+% of a background analysis are read through fetch(F) only, not by panget
+% nor by the raw files functions. Deleting F cancels its command.
+% Netlists whose macro devices are evaluated by MATLAB functions
+% (evaluate=) can not be run in background, since the worker has no
+% MATLAB.
+%
+% Usage: F = MPanFuture(COMMAND)
+%        F = MPanFuture(COMMAND, NAME, MEMVARS)
+%        F = MPanTran(..., 'async', true) (as well as MPanDc, MPanShooting
+%        and MPanEnvelope)
+%
+% F = MPanFuture(COMMAND) queues the PAN command COMMAND. Commands are run
+% one at a time in the order they were queued.
+%
+% F = MPanFuture(COMMAND, NAME, MEMVARS) also records the identifier NAME
+% and the memwaveforms MEMVARS of the analysis, so that fetch(F) returns
+% them.
+%
+% isdone(F) is true once the command is completed or cancelled.
+%
+% ERROR = wait(F) waits for the command and returns its error code, in
+% place of the MPanerror global variable; NaN if it was cancelled, -2 if
+% the worker could not be started or died, -4 if the memwaveforms could
+% not be written, -6 if the worker could not load the netlist or replay
+% the altered parameters and -7 if the netlist called a MATLAB function.
+% ERROR = wait(F, TIMEOUT) waits at most TIMEOUT seconds and returns [] if
+% the command is not completed yet. Waiting can be interrupted with Ctrl-C.
+%
+% OK = cancel(F) cancels the command, killing the worker if the command is
+% running; OK is false once it is completed.
+%
+% S = fetch(F) waits for the command and returns the memwaveforms as S =
+% MPanTran(...) does. An error is raised if the command failed.
+%
+% See also
+%    pansimc_async, pansimc
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+    properties (SetAccess = private)
+        Id
+        Command
+        Error = []
+    end
+
+    properties (Access = private)
+        Name = ''
+        MemVars = {}
+        Dir = ''
+        Output = ''
+        Result = []
+    end
+
+    methods
+        function obj = MPanFuture(COMMAND, NAME, MEMVARS)
+            global MPanSuite_NETLIST_INFO
+            if isempty(MPanSuite_NETLIST_INFO) || isempty(MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_FILE)
+                error('MPanSuiteError: no netlist has been loaded. Use MPanLoadNet first.');
+            end
+            INFO = MPanSuite_NETLIST_INFO;
+            [LOG_PATH,LOG_NAME] = fileparts(INFO.MPanSuite_NETLIST_LOG);
+            LOG = fullfile(LOG_PATH,[LOG_NAME '.async.log']);
+            INIT = MPanSolutionCache('replay', 'async');
+
+            obj.Command = char(COMMAND);
+            if nargin > 2
+                obj.Name = NAME;
+                obj.MemVars = cell(1,numel(MEMVARS));
+                for k = 1:numel(MEMVARS)
+                    obj.MemVars{k} = char(MEMVARS{k});
+                end
+            end
+            obj.Dir = tempname;
+            mkdir(obj.Dir);
+            if isempty(obj.MemVars)
+                obj.Id = pansimc_async(obj.Command, INFO.MPanSuite_NETLIST_FILE, ...
+                    LOG, obj.Dir, INIT);
+            else
+                % The memwaveforms come back in a raw file of the worker.
+                obj.Output = fullfile(obj.Dir,'memwaveforms.raw');
+                obj.Id = pansimc_async(obj.Command, INFO.MPanSuite_NETLIST_FILE, ...
+                    LOG, obj.Dir, INIT, obj.Output, strcat([obj.Name '.'], obj.MemVars));
+            end
+        end
+
+        function DONE = isdone(obj)
+            if isempty(obj.Error) && pansimc_async('isdone', obj.Id)
+                obj.wait(0);
+            end
+            DONE = ~isempty(obj.Error);
+        end
+
+        function ERROR = wait(obj, TIMEOUT)
+            if nargin < 2
+                TIMEOUT = Inf;
+            end
+            t0 = tic;
+            while isempty(obj.Error)
+                % Short waits in the gateway, so that Ctrl-C is served.
+                STEP = max(0, min(0.2, TIMEOUT - toc(t0)));
+                ERROR = pansimc_async('wait', obj.Id, STEP);
+                if ~isempty(ERROR)
+                    obj.Error = ERROR;
+                    obj.collect();
+                elseif toc(t0) >= TIMEOUT
+                    return
+                else
+                    drawnow;
+                end
+            end
+            ERROR = obj.Error;
+        end
+
+        function OK = cancel(obj)
+            OK = isempty(obj.Error) && pansimc_async('cancel', obj.Id);
+            if OK
+                obj.Error = NaN;
+                obj.remove();
+            end
+        end
+
+        function S = fetch(obj)
+            ERROR = obj.wait();
+            if isnan(ERROR)
+                error('MPanSuiteError: the command "%s" was cancelled.', obj.Command);
+            elseif ERROR
+                error('MPanSuiteError: an error blocked the command execution (error %d).', ERROR);
+            end
+            if isa(obj.Result,'MException')
+                throw(obj.Result);
+            end
+            S = obj.Result;
+        end
+
+        function delete(obj)
+            if isempty(obj.Error)
+                obj.cancel();
+            end
+            obj.remove();
+        end
+    end
+
+    methods (Access = private)
+        function collect(obj)
+            % The memwaveforms are read before the folder of F is removed.
+            if obj.Error == 0 && ~isempty(obj.MemVars)
+                try
+                    obj.Result = obj.read();
+                catch ME
+                    obj.Result = ME;
+                end
+            end
+            obj.remove();
+        end
+
+        function remove(obj)
+            if ~isempty(obj.Dir) && exist(obj.Dir,'dir')
+                rmdir(obj.Dir,'s');
+            end
+            obj.Dir = '';
+        end
+
+        function S = read(obj)
+            % A multi-column memwaveform is written as NAME(1), NAME(2), ...
+            INDEX = MPanRawIndex(obj.Output);
+            if isempty(INDEX)
+                error('MPanSuiteError: the memwaveforms of "%s" can not be read.', obj.Command);
+            end
+            nmem = numel(obj.MemVars);
+            S = cell(nmem,1);
+            tmp = struct('label',[],'signal',[]);
+            for k = 1:nmem
+                LABEL = [obj.Name '.' obj.MemVars{k}];
+                if isKey(INDEX.MAP, LABEL)
+                    LIST = {LABEL};
+                else
+                    LIST = {};
+                    while isKey(INDEX.MAP, sprintf('%s(%d)', LABEL, numel(LIST)+1))
+                        LIST{end+1} = sprintf('%s(%d)', LABEL, numel(LIST)+1); %#ok<AGROW>
+                    end
+                end
+                if isempty(LIST)
+                    error('MPanSuiteError: the <%s> variable can not be found in the simulator data-bases.', LABEL);
+                end
+                tmp.label = obj.MemVars{k};
+                tmp.signal = MPanVarGetRawFile(obj.Output, LIST);
+                S{k} = tmp;
+            end
+        end
+    end
+end
@@ -0,0 +1,72 @@
+function [S, TIME, Y] = MPanGetMemVars(NAME, MEMVARS)
+% MPanGetMemVars returns the memwaveforms saved by the analysis NAME
+% through its "mem" option.
+%
+% Usage: S = MPanGetMemVars(NAME, MEMVARS)
+%        [LABELS, TIME, Y] = MPanGetMemVars(NAME, MEMVARS)
+%
+% S = MPanGetMemVars(NAME, MEMVARS) fetches all the MEMVARS waveforms of
+% the analysis NAME with a single panget call. S is a cell array and each
+% cell contains a label and a waveform, as returned by MPanTran, MPanDc,
+% MPanShooting and MPanEnvelope. MEMVARS must be an array of strings or a
+% cell array of chars or a cell array of strings.
+%
+% [LABELS, TIME, Y] = MPanGetMemVars(NAME, MEMVARS) returns the "time"
+% waveform once, in TIME ([] if it is not one of the MEMVARS), and the
+% other MEMVARS, whose labels are in the cell array LABELS, in Y. When
+% all the waveforms are numeric vectors of the same length, Y is a
+% SAMPLES x numel(LABELS) matrix filled by a single panget call, without
+% a copy of TIME for every signal; otherwise Y is a cell array with one
+% waveform per label.
+%
+% The fetched memwaveforms are recorded in the registry of the gateways,
+% so that they can be listed, cleared by pattern and evicted when a
+% memory budget is set (see MPanMemWaveforms).
+%
+% See also
+%    MPanMemWaveforms, panget
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+nmem = numel(MEMVARS);
+labels = cell(1,nmem);
+for k = 1:nmem
+    labels{k} = char(MEMVARS{k});
+end
+
+if nargout > 1
+    t = strcmp(labels, 'time');
+    S = labels(~t);
+    names = strcat([NAME '.'], S);
+    try
+        [Y, missing] = panget(names);
+    catch
+        % The row counts differ or a waveform is not a numeric vector.
+        [Y, missing] = panget(names, 'cell');
+    end
+    if any(missing)
+        error('MPanSuiteError: the <%s> variable can not be found in the simulator data-bases.', ...
+            names{find(missing,1)});
+    end
+    TIME = [];
+    if any(t)
+        TIME = panget([NAME '.time']);
+    end
+    return
+end
+
+[W, missing] = panget(strcat([NAME '.'], labels), 'cell');
+if any(missing)
+    error('MPanSuiteError: the <%s> variable can not be found in the simulator data-bases.', ...
+        [NAME '.' labels{find(missing,1)}]);
+end
+
+S = cell(nmem,1);
+tmp = struct('label',[],'signal',[]);
+for k = 1:nmem
+    tmp.label = labels{k};
+    tmp.signal = W{k};
+    S{k} = tmp;
+end
@@ -1,8 +1,9 @@
-function [ varargout ] = MPanLoadNet(FILE)
+function [ varargout ] = MPanLoadNet(FILE, varargin)
 %MPanLoadNet loads a PAN netlist.
 %
 % Usage: STATUS = MPanLoadNet(FILE)
 %                 MPanLoadNet(FILE)
+%        STATUS = MPanLoadNet(FILE, 'reuse', true)
 %
 % STATUS = MpanLoadNet(FILE) check il FILE exist in the Matlab path.
 % If it exists (STATUS = 1) then a FILE.raw folder is created in the
@@ -15,12 +16,30 @@ function [ varargout ] = MPanLoadNet(FILE)
 %
 % MPanLoadNet(FILE) works as above but no output is provided.
 %
+% The netlist is always parsed and loaded again. With MPanLoadNet(FILE,
+% 'reuse', true) a netlist that is loaded again is not parsed again if
+% neither FILE, nor its include files, nor the Verilog-A sources it
+% references have changed since it was loaded without errors, and if no
+% parameter has been changed with MPanAlter or MPanBatch in the meantime:
+% the circuit already loaded is kept, with the state left by the previous
+% analyses, and only the MATLAB side of the session (e.g. the solutions
+% cached by MPanSolutionCache) is reset. The analyses in FILE are not run
+% again. Only the changes made through MPanAlter and MPanBatch are
+% tracked, and only until the MATLAB functions are cleared: parameters
+% changed by commands given directly to pansimc are kept by a reused
+% circuit. 'reload', true, accepted for compatibility, always loads the
+% netlist.
+%
+% When the console output is captured (see panlog('on')), it is also
+% appended to FILE.console.log, next to the FILE.log file written by PAN.
+%
 % Angelo Brambilla - Federico Bizzarri 
 % Copyright (c) 2015.
 % Revision: 1.0.0 $Date: 2015/02/10$
 
 global MPanSuite_NETLIST_INFO
 MPanSuite_NETLIST_INFO = struct('MPanSuite_NETLIST_NAME',[],...
+                                'MPanSuite_NETLIST_FILE',[],...
                                 'MPanSuite_NETLIST_LOG',[],...
                                 'MPanSuite_NETLIST_DIR',[],...
                                 'MPanSuite_NETLIST_RAW_DIR',[]);
@@ -29,6 +48,18 @@ if nargout > 2
     error('MPanSuiteError: no more than two output variables can be specified.');
 end
 
+REUSE = false;
+RELOAD = false;
+for k = 1:2:numel(varargin)
+    if strcmp(varargin{k},'reuse') && k < numel(varargin)
+        REUSE = logical(varargin{k+1});
+    elseif strcmp(varargin{k},'reload') && k < numel(varargin)
+        RELOAD = logical(varargin{k+1});
+    else
+        error('MPanSuiteError: the only allowed options are ''reuse'' and ''reload''.');
+    end
+end
+
 if exist(FILE,'file') == 2
     netlist_path = which(FILE,'-all');
     if numel(netlist_path) > 1
@@ -43,6 +74,7 @@ if exist(FILE,'file') == 2
         [SIM_PATH,FILENAME,FILEXT] = fileparts(FILE);
         
         MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_DIR = SIM_PATH;
+        MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_FILE = netlist_path{1};
         
         if strcmp(FILEXT,'.pan')
             FILE_RADIX = FILENAME;
@@ -57,8 +89,20 @@ if exist(FILE,'file') == 2
         
         LOG_FILE = [fullfile(SIM_PATH,FILE_RADIX) '.log'];
         MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_LOG = LOG_FILE;
+
+        % The console output captured by panlog is mirrored next to the
+        % PAN log, which is written by PAN itself.
+        panlog('mirror', [fullfile(SIM_PATH,FILE_RADIX) '.console.log']);
         
-        pannet([FILE ' -l ' LOG_FILE ' -r ' RAW_FILES_DIR]);
+        if REUSE && ~RELOAD && ~MPanSolutionCache('altered')
+            pannet([FILE ' -l ' LOG_FILE ' -r ' RAW_FILES_DIR], 'reuse');
+        else
+            pannet([FILE ' -l ' LOG_FILE ' -r ' RAW_FILES_DIR]);
+        end
+
+        % Cached solutions are valid only for this version of the netlist.
+        D = dir(netlist_path{1});
+        MPanSolutionCache('netlist', sprintf('%s@%.10f', netlist_path{1}, D.datenum));
                 
         % include in the MPanSuite PATH the folders created after netlist
         % loading
@@ -0,0 +1,91 @@
+function varargout = MPanMemWaveforms(ACTION, varargin)
+% MPanMemWaveforms lists, clears and bounds the memwaveforms that PAN
+% keeps in memory after the analyses run with the "mem" option.
+%
+% Usage: L = MPanMemWaveforms()
+%        L = MPanMemWaveforms('list')
+%        [TOTAL, BUDGET] = MPanMemWaveforms('usage')
+%        NAMES = MPanMemWaveforms('clear', PATTERN)
+%        NAMES = MPanMemWaveforms('clear', PATTERN, 'regex')
+%        N = MPanMemWaveforms('budget', BYTES)
+%        MISSING = MPanMemWaveforms('register', NAMES)
+%
+% PAN can not enumerate its memwaveforms: the gateways keep a registry of
+% those fetched by panget, panslice and pandownsample (and hence by
+% MPanGetMemVars and MPanWaveform) or registered explicitly. The registry
+% is emptied when a netlist is loaded again by MPanLoadNet.
+%
+% L = MPanMemWaveforms('list') returns a struct array, least recently
+% fetched first, with fields name, rows, cols, type ('real', 'complex' or
+% 'string'), bytes (an estimate of the memory used by PAN) and age (the
+% seconds since the last fetch).
+%
+% [TOTAL, BUDGET] = MPanMemWaveforms('usage') returns the bytes used by the
+% registered memwaveforms and the budget (Inf when there is no limit).
+%
+% NAMES = MPanMemWaveforms('clear', PATTERN) deletes from PAN the
+% registered memwaveforms whose name matches the glob PATTERN, e.g.
+% 'Tr*.*', and returns their names. With 'regex' PATTERN is an extended
+% regular expression, e.g. '^Tr[0-9]+\.'.
+%
+% N = MPanMemWaveforms('budget', BYTES) bounds the memory used by the
+% registered memwaveforms: whenever a fetch exceeds BYTES, the least
+% recently fetched memwaveforms are deleted from PAN, never those of the
+% fetch itself. N memwaveforms are deleted at once when BYTES is already
+% exceeded. BYTES equal to Inf removes the limit.
+%
+% MISSING = MPanMemWaveforms('register', NAMES) registers memwaveforms
+% that were not fetched, e.g. those just saved by an analysis, so that
+% they can be cleared or evicted. MISSING flags the names PAN does not
+% know.
+%
+% See also
+%    panmemwav, panclearwav, MPanGetMemVars, MPanStats
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+if nargin == 0
+    ACTION = 'list';
+end
+
+switch ACTION
+    case 'list'
+        varargout{1} = panmemwav('list');
+    case 'usage'
+        U = panmemwav('usage');
+        varargout{1} = U(1);
+        varargout{2} = U(2);
+    case 'clear'
+        if nargin < 2
+            error('MPanSuiteError: the PATTERN of the memwaveforms to clear is missing.');
+        end
+        if nargin > 2
+            NAMES = panclearwav(char(varargin{1}), varargin{2});
+        else
+            NAMES = panclearwav(char(varargin{1}), 'glob');
+        end
+        if nargout > 0
+            varargout{1} = NAMES;
+        end
+    case 'budget'
+        if nargin < 2
+            error('MPanSuiteError: the BYTES of the budget are missing.');
+        end
+        N = panmemwav('budget', varargin{1});
+        if nargout > 0
+            varargout{1} = N;
+        end
+    case 'register'
+        if nargin < 2
+            error('MPanSuiteError: the NAMES to register are missing.');
+        end
+        MISSING = panmemwav('register', varargin{1});
+        if nargout > 0
+            varargout{1} = MISSING;
+        end
+    otherwise
+        error('MPanSuiteError: unknown MPanMemWaveforms action %s.', ACTION);
+end
+end
@@ -0,0 +1,68 @@
+function varargout = MPanProfile(ACTION, varargin)
+% MPanProfile profiles the callbacks from PAN to the MATLAB functions that
+% evaluate the nport macro devices (evaluate="MACRO").
+%
+% Usage: MPanProfile('on')
+%        MPanProfile('on', PERIOD)
+%        MPanProfile('off')
+%        MPanProfile('reset')
+%        T = MPanProfile()
+%        T = MPanProfile('last')
+%
+% Only the macros served by a MEX file built by MPanBuildMacro are
+% profiled: the compiled ones and, through MACRO_bypass, the interpreted
+% ones. The calls that PAN dispatches straight to MACRO.m are not seen.
+%
+% MPanProfile('on') times every callback; MPanProfile('on', PERIOD) times
+% one callback every PERIOD, which then stands for PERIOD callbacks.
+% MPanProfile('off') stops profiling and MPanProfile('reset') zeroes the
+% profile.
+%
+% T = MPanProfile() returns a table with a row per instance of every
+% macro model (instances are named after the StN argument of the
+% callbacks) and the variables
+%    model, instance    the macro and its instance
+%    samples            the number of timed callbacks
+%    calls, hits        the (estimated) callbacks and the bypassed ones
+%    time               the seconds spent in the callbacks
+%    eval_time          the part spent evaluating the macro
+%    marshal_time       the part spent marshalling the arguments
+%    p50, p90, p99      the percentiles of the latency of a callback
+% The callbacks take place inside pansimc and are part of its pan_time
+% in MPanStats.
+%
+% T = MPanProfile('last') returns the profile gathered since the previous
+% MPanProfile('last') or MPanProfile('reset') and then resets it: called
+% after an analysis, it returns the profile of that analysis.
+%
+% See also
+%    panprofile, MPanBuildMacro, MPanStats
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+if nargin == 0
+    ACTION = 'table';
+end
+
+switch ACTION
+    case 'on'
+        if nargin > 1
+            panprofile('on', varargin{1});
+        else
+            panprofile('on');
+        end
+    case 'off'
+        panprofile('off');
+    case 'reset'
+        panprofile('reset');
+    case 'table'
+        varargout{1} = struct2table(panprofile());
+    case 'last'
+        varargout{1} = struct2table(panprofile());
+        panprofile('reset');
+    otherwise
+        error('MPanSuiteError: unknown action %s.', ACTION);
+end
+end
@@ -0,0 +1,110 @@
+function varargout = MPanRawConvert(FILE, varargin)
+% MPanRawConvert writes the columnar companion of a RAW file, so that
+% reading one variable with MPanVarGetRawFile reads from disk only the
+% data of that variable.
+%
+% Usage: BYTES = MPanRawConvert(FILE)
+%        BYTES = MPanRawConvert(FILE, LEVEL)
+%        MPanRawConvert('all')
+%        MPanRawConvert('all', LEVEL)
+%        MPanRawConvert('auto', FLAG)
+%        MPanRawConvert('auto', FLAG, LEVEL)
+%        [FLAG, LEVEL] = MPanRawConvert('auto')
+%
+% BYTES = MPanRawConvert(FILE) converts the RAW file named FILE (looked up
+% as in MPanVarInRawFile) into the columnar file FILE followed by c (e.g.
+% tran.raw into tran.rawc) and returns its size. The companion has the
+% same text header as FILE; its data are stored variable by variable, in
+% chunks listed in an offset table, the time axis being stored once like
+% any other variable. From then on MPanVarInRawFile and MPanVarGetRawFile
+% use the companion of FILE, until FILE is written again by PAN. The RAW
+% file is left untouched.
+%
+% BYTES = MPanRawConvert(FILE, LEVEL) compresses every chunk with zlib at
+% the given LEVEL (1 fastest, 9 smallest) after shuffling its bytes, which
+% is lossless. LEVEL 0, the default, stores the chunks as they are.
+% Compressed companions can only be read through panrawread.
+%
+% MPanRawConvert('all') converts the RAW files of the RAW FILES DIRECTORY
+% of the currently loaded netlist whose companion is missing or was not
+% converted from the RAW file as it is now, i.e. with the same size and
+% modification time.
+%
+% MPanRawConvert('auto', true) makes MPanRawIndex, i.e. MPanVarInRawFile
+% and MPanVarGetRawFile, convert a RAW file with the given LEVEL (0 by
+% default) when it is read and its companion is missing or stale, so that
+% the analyses themselves do not pay for the conversion. [FLAG, LEVEL] =
+% MPanRawConvert('auto') returns the current setting.
+%
+% See also
+%    MPanVarGetRawFile, MPanRawIndex, panrawconv
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+global MPanSuite_NETLIST_INFO
+persistent AUTO AUTO_LEVEL
+if isempty(AUTO)
+    AUTO = false;
+    AUTO_LEVEL = 0;
+end
+
+if ~strcmp(FILE,'auto') && exist('panrawconv','file') ~= 3
+    error('MPanSuiteError: the panrawconv MEX file is not available.');
+end
+
+switch FILE
+    case 'auto'
+        if nargin == 1
+            varargout{1} = AUTO;
+            varargout{2} = AUTO_LEVEL;
+            return
+        end
+        AUTO = logical(varargin{1});
+        if nargin > 2
+            AUTO_LEVEL = MPanRawConvertLevel(varargin{2});
+        end
+    case 'all'
+        LEVEL = 0;
+        if nargin > 1
+            LEVEL = MPanRawConvertLevel(varargin{1});
+        elseif AUTO
+            LEVEL = AUTO_LEVEL;
+        end
+        if isempty(MPanSuite_NETLIST_INFO) || ...
+                isempty(MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_RAW_DIR)
+            error(['MPanSuiteError: no RAW FILES DIRECTORY is known: ' ...
+                'load a netlist with MPanLoadNet first.']);
+        end
+        RAW_DIR = MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_RAW_DIR;
+        D = dir(fullfile(RAW_DIR, '*.raw'));
+        for k = 1:numel(D)
+            SOURCE = fullfile(RAW_DIR, D(k).name);
+            if ~panrawconv('-fresh', SOURCE, [SOURCE 'c'])
+                panrawconv(SOURCE, [SOURCE 'c'], LEVEL);
+            end
+        end
+    otherwise
+        LEVEL = 0;
+        if nargin > 1
+            LEVEL = MPanRawConvertLevel(varargin{1});
+        end
+        [LIST, FULL_FILE_NAME] = MPanVarInRawFile(FILE);
+        if isempty(LIST)
+            varargout(1:nargout) = {[]};
+            return
+        end
+        BYTES = panrawconv(FULL_FILE_NAME, [FULL_FILE_NAME 'c'], LEVEL);
+        if nargout > 0
+            varargout{1} = BYTES;
+        end
+end
+end
+
+function LEVEL = MPanRawConvertLevel(LEVEL)
+if ~isscalar(LEVEL) || ~isnumeric(LEVEL) || LEVEL < 0 || LEVEL > 9 || ...
+        LEVEL ~= fix(LEVEL)
+    error('MPanSuiteError: LEVEL must be an integer between 0 and 9.');
+end
+end
@@ -0,0 +1,274 @@
+function INDEX = MPanRawIndex(FULL_FILE_NAME, varargin)
+% MPanRawIndex returns the header index of a RAW file. The index is built
+% once per file and then reused until the size or the modification time
+% of the file change.
+%
+% Usage: INDEX = MPanRawIndex(FULL_FILE_NAME)
+%        MPanRawIndex('save', FLAG)
+%        MPanRawIndex('clear')
+%
+% INDEX = MPanRawIndex(FULL_FILE_NAME) returns a struct with the fields
+%    FILE         the full name of the RAW file
+%    BYTES        the size of the file when the index was built
+%    DATENUM      the modification time of the file when the index was built
+%    FLAGS        the Flags field of the header (real or complex)
+%    NUM_VAR      the number of variables
+%    NUM_SAMPLES  the number of points
+%    DATA_OFFSET  the offset in bytes of the binary data
+%    LIST         the variable list, as returned by MPanVarInRawFile
+%    MAP          a containers.Map from variable name to VAR_INDEX
+%    LAYOUT       'row' for the files written by PAN, 'columnar' for the
+%                 ones written by MPanRawConvert
+%    CODEC        0 if the columns are stored as they are, 1 if they are
+%                 compressed (columnar files only)
+%    CHUNK_ROWS   the samples of every chunk of a column (columnar only)
+%    NUM_CHUNKS   the number of chunks of every column (columnar only)
+%    TABLE_OFFSET the offset in bytes of the chunk table (columnar only)
+%    SOURCE_BYTES the size of the RAW file converted (columnar only)
+%    SOURCE_MTIME its modification time in ns, as a uint64 (columnar only,
+%                 0 for the files written before it was recorded)
+% When FULL_FILE_NAME ends with .raw and MPanRawConvert has written its
+% columnar companion (FULL_FILE_NAME followed by c), the index of the
+% companion is returned, unless the size or the modification time of the
+% RAW file differ from the ones recorded when it was converted. The index
+% is kept in memory. If saving is enabled it is also stored in the
+% rawindex.mpan.mat file of the RAW files directory, so that it survives
+% MATLAB sessions.
+%
+% MPanRawIndex('save', FLAG) enables (FLAG = true) or disables (FLAG =
+% false, the default) saving the indices in the RAW files directory.
+%
+% MPanRawIndex('clear') empties the in-memory index cache.
+%
+% See also
+%    MPanVarInRawFile, MPanVarGetRawFile, MPanRawConvert
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+persistent CACHE SAVE
+if isempty(CACHE)
+    CACHE = containers.Map('KeyType','char','ValueType','any');
+    SAVE = false;
+end
+
+INDEX = [];
+
+if strcmp(FULL_FILE_NAME,'save')
+    if nargin < 2
+        error('MPanSuiteError: MPanRawIndex(''save'', FLAG) requires FLAG.');
+    end
+    SAVE = logical(varargin{1});
+    return
+elseif strcmp(FULL_FILE_NAME,'clear')
+    CACHE = containers.Map('KeyType','char','ValueType','any');
+    return
+end
+
+D = dir(FULL_FILE_NAME);
+if numel(D) ~= 1
+    warning('MPanSuiteWarning: The RAW file %s cannot be found.', FULL_FILE_NAME);
+    return
+end
+
+if numel(FULL_FILE_NAME) > 4 && strcmpi(FULL_FILE_NAME(end-3:end),'.raw')
+    COMPANION = [FULL_FILE_NAME 'c'];
+    [AUTO, LEVEL] = MPanRawConvert('auto');
+    if AUTO && exist('panrawconv','file') == 3 && ...
+            ~panrawconv('-fresh', FULL_FILE_NAME, COMPANION)
+        % Converted when it is read, see MPanRawConvert('auto').
+        panrawconv(FULL_FILE_NAME, COMPANION, LEVEL);
+    end
+    C = dir(COMPANION);
+    if numel(C) == 1 && exist('panrawconv','file') == 3
+        [FRESH, MTIME] = panrawconv('-fresh', FULL_FILE_NAME, COMPANION);
+        if FRESH
+            INDEX = MPanRawIndex(COMPANION);
+            if ~isempty(INDEX) && INDEX.SOURCE_MTIME ~= MTIME
+                % Converted again within the same second: the index kept
+                % for the companion is stale.
+                INDEX = MPanRawIndexBuild(COMPANION);
+                if ~isempty(INDEX)
+                    INDEX.BYTES = C.bytes;
+                    INDEX.DATENUM = C.datenum;
+                    CACHE(COMPANION) = INDEX;
+                    if SAVE
+                        [RAW_DIR, FILENAME, FILEXT] = fileparts(COMPANION);
+                        MPanRawIndexSave(fullfile(RAW_DIR, 'rawindex.mpan.mat'), ...
+                            [FILENAME FILEXT], INDEX);
+                    end
+                end
+            end
+            if ~isempty(INDEX)
+                return
+            end
+        end
+        INDEX = [];
+    end
+end
+
+if isKey(CACHE, FULL_FILE_NAME)
+    INDEX = CACHE(FULL_FILE_NAME);
+    if INDEX.BYTES == D.bytes && INDEX.DATENUM == D.datenum
+        return
+    end
+end
+
+[RAW_DIR, FILENAME, FILEXT] = fileparts(FULL_FILE_NAME);
+STORE = fullfile(RAW_DIR, 'rawindex.mpan.mat');
+KEY = [FILENAME FILEXT];
+
+INDEX = [];
+if SAVE && exist(STORE,'file') == 2
+    S = load(STORE, 'RAW_INDEX');
+    if isfield(S,'RAW_INDEX') && isKey(S.RAW_INDEX, KEY)
+        INDEX = S.RAW_INDEX(KEY);
+        if ~isfield(INDEX,'LAYOUT') || INDEX.BYTES ~= D.bytes || ...
+                INDEX.DATENUM ~= D.datenum
+            INDEX = [];
+        else
+            INDEX.FILE = FULL_FILE_NAME;
+        end
+    end
+end
+
+if isempty(INDEX)
+    INDEX = MPanRawIndexBuild(FULL_FILE_NAME);
+    if isempty(INDEX)
+        return
+    end
+    INDEX.BYTES = D.bytes;
+    INDEX.DATENUM = D.datenum;
+    if SAVE
+        MPanRawIndexSave(STORE, KEY, INDEX);
+    end
+end
+
+CACHE(FULL_FILE_NAME) = INDEX;
+end
+
+function INDEX = MPanRawIndexBuild(FULL_FILE_NAME)
+% Read the whole text header in large blocks and parse it once.
+INDEX = [];
+
+fileID = fopen(FULL_FILE_NAME);
+if fileID < 0
+    warning('MPanSuiteWarning: The RAW file %s cannot be opened.', FULL_FILE_NAME);
+    return
+end
+header = '';
+pos = [];
+while isempty(pos)
+    chunk = fread(fileID, 65536, 'uint8=>char')';
+    if isempty(chunk)
+        break
+    end
+    from = max(1, numel(header) - 6);
+    header = [header chunk]; %#ok<AGROW>
+    pos = strfind(header(from:end), 'Binary:');
+    if ~isempty(pos)
+        pos = pos(1) + from - 1;
+    end
+end
+
+if isempty(pos)
+    fclose(fileID);
+    warning('MPanSuiteWarning: %s is not a valid RAW file.', FULL_FILE_NAME);
+    return
+end
+
+% A columnar file written by panrawconv starts its binary section with
+% the PANCOLv2 header, or the PANCOLv1 one which lacks SOURCE_MTIME (see
+% mex_so/panrawcol.h).
+LAYOUT = struct('LAYOUT','row','CODEC',0,'CHUNK_ROWS',NaN,'NUM_CHUNKS',NaN, ...
+    'TABLE_OFFSET',NaN,'SOURCE_BYTES',NaN,'SOURCE_MTIME',uint64(0));
+fseek(fileID, pos + 7, 'bof');
+MAGIC = fread(fileID, [1 8], 'uint8=>char');
+if any(strcmp(MAGIC, {'PANCOLv1','PANCOLv2'}))
+    H = fread(fileID, 2, 'uint32');
+    V = fread(fileID, 4, 'uint64');
+    MTIME = uint64(0);
+    if strcmp(MAGIC, 'PANCOLv2')
+        MTIME = fread(fileID, 1, 'uint64=>uint64');
+    end
+    if numel(V) == 4 && numel(MTIME) == 1
+        LAYOUT = struct('LAYOUT','columnar','CODEC',H(1),'CHUNK_ROWS',V(1), ...
+            'NUM_CHUNKS',V(2),'TABLE_OFFSET',V(3),'SOURCE_BYTES',V(4), ...
+            'SOURCE_MTIME',MTIME);
+    end
+end
+fclose(fileID);
+
+lines = regexp(header(1:pos-1), '\r?\n', 'split');
+
+var_type = [];
+num_var = 0;
+num_samples = 0;
+k = 1;
+while k <= numel(lines)
+    tline = lines{k};
+    k = k + 1;
+    if strncmp(tline,'Flags',5)
+        tf  = find(isspace(tline));
+        var_type = tline(tf(1)+1: end);
+    elseif strncmp(tline,'No. Variables:',14)
+        num_var = sscanf(tline(15:end), '%d', 1);
+    elseif strncmp(tline,'No. Points:',11)
+        num_samples = sscanf(tline(12:end), '%d', 1);
+    elseif strncmp(tline,'Variables:',10)
+        break
+    end
+end
+
+if k + num_var - 1 > numel(lines)
+    warning('MPanSuiteWarning: the header of %s is truncated.', FULL_FILE_NAME);
+    return
+end
+
+LIST(1:num_var,1)=struct('VAR_INDEX',NaN,'VAR_NAME',[],'VAR_TYPE',[],'NUM_SAMPLES',NaN,'FLAGS',[]);
+names = cell(num_var,1);
+for h = 1:num_var
+    tline = lines{k+h-1};
+    tf  = find(isspace(tline));
+    LIST(h).VAR_INDEX = h-1;
+    names{h} = char(tline(tf(2)+1:tf(3)-1));
+    LIST(h).VAR_NAME  = names{h};
+    LIST(h).VAR_TYPE  = char(tline(tf(4)+1:end));
+    LIST(h).NUM_SAMPLES = num_samples;
+    LIST(h).FLAGS = var_type;
+end
+
+% The first variable wins when a name is repeated, as in a linear search.
+MAP = containers.Map('KeyType','char','ValueType','double');
+for h = num_var:-1:1
+    MAP(names{h}) = h-1;
+end
+
+INDEX = struct('FILE', FULL_FILE_NAME, 'BYTES', NaN, 'DATENUM', NaN, ...
+    'FLAGS', var_type, 'NUM_VAR', num_var, 'NUM_SAMPLES', num_samples, ...
+    'DATA_OFFSET', pos + 7, 'LIST', [], 'MAP', MAP);
+INDEX.LIST = LIST;
+for NAME = fieldnames(LAYOUT).'
+    INDEX.(NAME{1}) = LAYOUT.(NAME{1});
+end
+end
+
+function MPanRawIndexSave(STORE, KEY, INDEX)
+RAW_INDEX = [];
+if exist(STORE,'file') == 2
+    S = load(STORE, 'RAW_INDEX');
+    if isfield(S,'RAW_INDEX')
+        RAW_INDEX = S.RAW_INDEX;
+    end
+end
+if isempty(RAW_INDEX)
+    RAW_INDEX = containers.Map('KeyType','char','ValueType','any');
+end
+RAW_INDEX(KEY) = INDEX;
+try
+    save(STORE, 'RAW_INDEX');
+catch
+    warning('MPanSuiteWarning: the RAW index cannot be saved in %s.', STORE);
+end
+end
@@ -0,0 +1,100 @@
+function varargout = MPanSession(ACTION, varargin)
+% MPanSession manages named PAN sessions, i.e. netlists loaded side by side
+% with the one loaded by MPanLoadNet, each in its own copy of PAN.
+%
+% Usage: MPanSession('load', NAME, FILE)
+%        MPanSession('load', NAME, FILE, 'reuse', true)
+%        NAMES = MPanSession('list')
+%        MPanSession('close', NAME)
+%
+% MPanSession('load', NAME, FILE) loads the netlist in FILE in the session
+% NAME, a new copy of PAN which shares no state with the default session of
+% MPanLoadNet nor with the other named sessions. The raw files are written
+% in FILE.NAME.raw and the log in FILE.NAME.log, next to FILE. The netlist
+% is always loaded again unless 'reuse' is true: then, as done by
+% MPanLoadNet, a netlist that has not changed since it was loaded in NAME
+% is not parsed again and keeps the state of its previous analyses.
+%
+% The session is then addressed by appending 'session', NAME to the
+% arguments of pansimc, panget and panclearwav, e.g.
+%
+%    MPanSession('load', 'hot', 'amp.pan');
+%    pansimc('tr tran stop=1m', 'session', 'hot');
+%    V = panget('out', 'session', 'hot');
+%
+% The memwaveforms of a named session are accounted and evicted on their
+% own; the budget set by MPanMemWaveforms applies to the default session.
+% The MPan* functions work on the default session only, and pansimc_async
+% runs its analyses in a worker process of its own (see MPanFuture).
+%
+% NAMES = MPanSession('list') returns the names of the loaded sessions and
+% MPanSession('close', NAME) unloads NAME and releases its memory. A
+% session still in use by another thread (e.g. of a thread-based pool) is
+% unloaded when that thread is done with it; a session in use cannot be
+% loaded again meanwhile.
+%
+% Up to 15 named sessions are allowed. Each one loads a private copy of
+% panMat.so, made in TMPDIR (/tmp by default) and removed right away: only
+% the state kept in panMat.so itself is private, while the libraries it
+% depends on are shared by all the sessions, MATLAB ones included.
+%
+% See also
+%    MPanLoadNet, pannet, pansimc, panget, panclearwav
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+if nargin == 0
+    ACTION = 'list';
+end
+
+switch ACTION
+    case 'load'
+        if nargin < 3
+            error('MPanSuiteError: MPanSession(''load'', NAME, FILE) requires a session name and a netlist.');
+        end
+        NAME = varargin{1};
+        FILE = varargin{2};
+        REUSE = false;
+        RELOAD = false;
+        for k = 3:2:numel(varargin)
+            if strcmp(varargin{k},'reuse') && k < numel(varargin)
+                REUSE = logical(varargin{k+1});
+            elseif strcmp(varargin{k},'reload') && k < numel(varargin)
+                RELOAD = logical(varargin{k+1});
+            else
+                error('MPanSuiteError: the only allowed options are ''reuse'' and ''reload''.');
+            end
+        end
+        if exist(FILE,'file') ~= 2
+            error('MPanSuiteError: the netlist %s cannot be found in the Matlab PATH.', FILE);
+        end
+
+        [SIM_PATH,FILENAME,FILEXT] = fileparts(FILE);
+        if strcmp(FILEXT,'.pan')
+            FILE_RADIX = FILENAME;
+        else
+            FILE_RADIX = [FILENAME FILEXT];
+        end
+        RADIX = [fullfile(SIM_PATH,FILE_RADIX) '.' NAME];
+        ARGS = [FILE ' -l ' RADIX '.log -r ' RADIX '.raw'];
+
+        if REUSE && ~RELOAD
+            ERR = pannet(ARGS, 'reuse', 'session', NAME);
+        else
+            ERR = pannet(ARGS, 'session', NAME);
+        end
+        if nargout > 0
+            varargout{1} = ERR;
+        end
+    case 'list'
+        varargout{1} = pannet('-sessions');
+    case 'close'
+        if nargin < 2
+            error('MPanSuiteError: MPanSession(''close'', NAME) requires a session name.');
+        end
+        pannet('-close', 'session', varargin{1});
+    otherwise
+        error('MPanSuiteError: unknown action ''%s''.', ACTION);
+end
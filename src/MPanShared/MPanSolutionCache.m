@@ -0,0 +1,258 @@
+function varargout = MPanSolutionCache(ACTION, varargin)
+% MPanSolutionCache keeps the converged solutions of the shooting and DC
+% analyses and uses them as initial guesses of the following ones.
+%
+% Usage: MPanSolutionCache('enable', FLAG)
+%        MPanSolutionCache('capacity', N)
+%        MPanSolutionCache('radius', R)
+%        MPanSolutionCache('clear')
+%        STATS = MPanSolutionCache('stats')
+%
+% MPanSolutionCache('enable', true) enables the cache (it is disabled by
+% default). From then on MPanShooting and MPanDc save their solution
+% (through the 'save' option) in a temporary directory, keyed by the
+% netlist and by the values of the parameters changed with MPanAlter.
+% When a new analysis of the same kind is run, the cached solution whose
+% parameters are the nearest to the current ones is given to PAN through
+% the 'load' option. In a parameter sweep each point thus starts from the
+% steady state of the previous points. The cache is not used when the
+% 'load' or 'save' option is given explicitly or with 'async', true.
+%
+% MPanSolutionCache('capacity', N) keeps at most N solutions (32 by
+% default): the least recently used ones are discarded first.
+%
+% MPanSolutionCache('radius', R) uses a cached solution only if its
+% relative distance from the current parameters is not larger than R (Inf
+% by default). The distance is the norm of the parameter differences,
+% each one divided by the largest magnitude of the two values.
+%
+% MPanSolutionCache('clear') discards all the solutions and the statistics.
+%
+% STATS = MPanSolutionCache('stats') returns a struct with the number of
+% exact hits, of nearest-neighbour hits, of misses, of stored and of
+% evicted solutions, and the mean time of the analyses with and without a
+% cached initial guess. PAN does not report the number of iterations to
+% MATLAB: the time saved is estimated from these means.
+%
+% MPanAlter, MPanBatch, MPanLoadNet, MPanShooting and MPanDc call the
+% 'alter', 'altered', 'netlist', 'inject' and 'commit' actions themselves:
+% 'commit' is given the error code returned by pansimc, which it reports
+% as pansimc does when the code is not returned (see pansimc).
+% ALTERED = MPanSolutionCache('altered') is true if a parameter has been
+% altered since the netlist was loaded. COMMANDS =
+% MPanSolutionCache('replay', NAME) returns the alter commands, named
+% NAME_session1, NAME_session2, ..., that give these parameters their
+% current values: MPanSweep and MPanFuture run them in their worker
+% processes.
+%
+% See also
+%    MPanShooting, MPanDc, MPanAlter
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+persistent C
+if isempty(C)
+    C = MPanSolutionCacheInit();
+end
+
+switch ACTION
+    case 'enable'
+        C.ENABLED = logical(varargin{1});
+    case 'capacity'
+        C.CAPACITY = max(1, round(varargin{1}));
+        C = MPanSolutionCacheEvict(C);
+    case 'radius'
+        C.RADIUS = varargin{1};
+    case 'clear'
+        for k = 1:numel(C.ENTRIES)
+            MPanSolutionCacheDelete(C.ENTRIES(k).FILE);
+        end
+        ENABLED = C.ENABLED;
+        CAPACITY = C.CAPACITY;
+        RADIUS = C.RADIUS;
+        NETLIST = C.NETLIST;
+        PARAMS = C.PARAMS;
+        C = MPanSolutionCacheInit();
+        C.ENABLED = ENABLED;
+        C.CAPACITY = CAPACITY;
+        C.RADIUS = RADIUS;
+        % The parameters altered in the session are not part of the cache.
+        C.NETLIST = NETLIST;
+        C.PARAMS = PARAMS;
+    case 'stats'
+        S = C.STATS;
+        S.entries = numel(C.ENTRIES);
+        S.mean_time_cold = S.time_cold / max(1, S.runs_cold);
+        S.mean_time_warm = S.time_warm / max(1, S.runs_warm);
+        if S.runs_cold > 0 && S.runs_warm > 0
+            S.time_saved = S.runs_warm * S.mean_time_cold - S.time_warm;
+        else
+            S.time_saved = NaN;
+        end
+        varargout{1} = S;
+    case 'netlist'
+        % A (re)loaded netlist starts from its own parameter values.
+        C.PARAMS = containers.Map('KeyType','char','ValueType','double');
+        C.NETLIST = varargin{1};
+    case 'alter'
+        C.PARAMS(char(varargin{1})) = varargin{2};
+    case 'altered'
+        varargout{1} = C.PARAMS.Count > 0;
+    case 'replay'
+        NAMES = keys(C.PARAMS);
+        COMMANDS = cell(1,numel(NAMES));
+        for k = 1:numel(NAMES)
+            COMMANDS{k} = [varargin{1} '_session' num2str(k) ' alter param = "' ...
+                NAMES{k} '" value = ' num2str(C.PARAMS(NAMES{k}),'%23.16e')];
+        end
+        varargout{1} = COMMANDS;
+    case 'inject'
+        [varargout{1}, varargout{2}, C] = MPanSolutionCacheInject(C, varargin{:});
+    case 'commit'
+        C = MPanSolutionCacheCommit(C, varargin{1}, varargin{2});
+        MPanSolutionCacheReport(varargin{2});
+    otherwise
+        error('MPanSuiteError: unknown MPanSolutionCache action %s.', ACTION);
+end
+end
+
+function C = MPanSolutionCacheInit()
+C.ENABLED = false;
+C.CAPACITY = 32;
+C.RADIUS = Inf;
+C.DIR = [];
+C.NETLIST = '';
+C.PARAMS = containers.Map('KeyType','char','ValueType','double');
+C.ENTRIES = struct('KIND',{},'NETLIST',{},'NAMES',{},'VALUES',{},'FILE',{},'USED',{});
+C.CLOCK = 0;
+C.COUNT = 0;
+C.STATS = struct('hits',0,'near_hits',0,'misses',0,'stores',0,'evictions',0, ...
+    'runs_cold',0,'runs_warm',0,'time_cold',0,'time_warm',0);
+end
+
+function [ARGS, ENTRY, C] = MPanSolutionCacheInject(C, KIND, ARGS)
+ENTRY = [];
+if ~C.ENABLED || isempty(C.NETLIST)
+    return
+end
+KEYS = ARGS(1:2:end);
+if any(strcmp(KEYS,'load')) || any(strcmp(KEYS,'save')) || any(strcmp(KEYS,'async'))
+    return
+end
+
+NAMES = sort(keys(C.PARAMS));
+VALUES = zeros(1,numel(NAMES));
+for k = 1:numel(NAMES)
+    VALUES(k) = C.PARAMS(NAMES{k});
+end
+
+% Nearest cached solution of the same analysis, netlist and parameters.
+BEST = 0;
+DIST = Inf;
+for k = 1:numel(C.ENTRIES)
+    E = C.ENTRIES(k);
+    if strcmp(E.KIND,KIND) && strcmp(E.NETLIST,C.NETLIST) && isequal(E.NAMES,NAMES)
+        SCALE = max(max(abs(E.VALUES), abs(VALUES)), realmin);
+        d = norm((E.VALUES - VALUES) ./ SCALE);
+        if d < DIST
+            DIST = d;
+            BEST = k;
+        end
+    end
+end
+
+WARM = BEST > 0 && DIST <= C.RADIUS;
+if WARM
+    C.CLOCK = C.CLOCK + 1;
+    C.ENTRIES(BEST).USED = C.CLOCK;
+    ARGS = [ARGS {'load', C.ENTRIES(BEST).FILE}];
+    if DIST == 0
+        C.STATS.hits = C.STATS.hits + 1;
+    else
+        C.STATS.near_hits = C.STATS.near_hits + 1;
+    end
+else
+    C.STATS.misses = C.STATS.misses + 1;
+end
+
+if isempty(C.DIR)
+    C.DIR = tempname;
+    mkdir(C.DIR);
+end
+C.COUNT = C.COUNT + 1;
+FILE = fullfile(C.DIR, sprintf('%s_%d.sol', KIND, C.COUNT));
+ARGS = [ARGS {'save', FILE}];
+
+ENTRY = struct('KIND',KIND,'NETLIST',C.NETLIST,'NAMES',{NAMES},'VALUES',VALUES, ...
+    'FILE',FILE,'WARM',WARM,'START',tic);
+end
+
+function C = MPanSolutionCacheCommit(C, ENTRY, ERR)
+if isempty(ENTRY)
+    return
+end
+ELAPSED = toc(ENTRY.START);
+
+% ERR is the error code returned by pansimc for the analysis.
+if ERR ~= 0 || exist(ENTRY.FILE,'file') ~= 2
+    MPanSolutionCacheDelete(ENTRY.FILE);
+    return
+end
+
+if ENTRY.WARM
+    C.STATS.runs_warm = C.STATS.runs_warm + 1;
+    C.STATS.time_warm = C.STATS.time_warm + ELAPSED;
+else
+    C.STATS.runs_cold = C.STATS.runs_cold + 1;
+    C.STATS.time_cold = C.STATS.time_cold + ELAPSED;
+end
+
+% A solution for the very same parameters replaces the previous one.
+for k = numel(C.ENTRIES):-1:1
+    E = C.ENTRIES(k);
+    if strcmp(E.KIND,ENTRY.KIND) && strcmp(E.NETLIST,ENTRY.NETLIST) && ...
+            isequal(E.NAMES,ENTRY.NAMES) && isequal(E.VALUES,ENTRY.VALUES)
+        MPanSolutionCacheDelete(E.FILE);
+        C.ENTRIES(k) = [];
+    end
+end
+
+C.CLOCK = C.CLOCK + 1;
+C.ENTRIES(end+1) = struct('KIND',ENTRY.KIND,'NETLIST',ENTRY.NETLIST, ...
+    'NAMES',{ENTRY.NAMES},'VALUES',ENTRY.VALUES,'FILE',ENTRY.FILE,'USED',C.CLOCK);
+C.STATS.stores = C.STATS.stores + 1;
+C = MPanSolutionCacheEvict(C);
+end
+
+function MPanSolutionCacheReport(ERR)
+% The error code is reported as pansimc does when it is not returned: the
+% MPanerror global variable, if declared, keeps the largest one, otherwise
+% an error is raised.
+if ERR == 0
+    return
+end
+if isempty(whos('global','MPanerror'))
+    error('MPanSuiteError: an error blocked the command execution (error %d).', ERR);
+end
+global MPanerror
+if isscalar(MPanerror) && MPanerror < ERR
+    MPanerror = ERR;
+end
+end
+
+function C = MPanSolutionCacheEvict(C)
+while numel(C.ENTRIES) > C.CAPACITY
+    [~, k] = min([C.ENTRIES.USED]);
+    MPanSolutionCacheDelete(C.ENTRIES(k).FILE);
+    C.ENTRIES(k) = [];
+    C.STATS.evictions = C.STATS.evictions + 1;
+end
+end
+
+function MPanSolutionCacheDelete(FILE)
+if exist(FILE,'file') == 2
+    delete(FILE);
+end
+end
@@ -0,0 +1,101 @@
+function varargout = MPanStats(ACTION, varargin)
+% MPanStats reports where the time goes between MATLAB and PAN: every
+% gateway in mex_so counts its calls, the time spent inside panMat.so and
+% the bytes copied into MATLAB arrays.
+%
+% Usage: S = MPanStats()
+%        MPanStats('reset')
+%        MPanStats('trace', FLAG)
+%        T = MPanStats('trace')
+%        MPanStats('dump', FILE)
+%
+% S = MPanStats() returns a struct with one field per gateway (pannet,
+% pansimc, panget, ...), plus the dlopen of panMat.so done by pannet and
+% the directory scans of MPanUpdateRawFilesList. Each field is a struct
+% with
+%    calls         the number of completed calls
+%    time          the total time of the calls [s]
+%    pan_time      the time spent inside the panMat.so entry points [s]
+%    marshal_time  time - pan_time, i.e. the time spent converting
+%                  arguments and results [s]
+%    bytes         the bytes copied into MATLAB arrays
+% Calls ended by an error are not counted. pansimc_async counts the
+% analyses run by its worker process; for pansimc_async and pansweep
+% pan_time is the time spent waiting for the worker processes. Times are
+% measured with the monotonic clock.
+%
+% MPanStats('reset') zeroes the counters and empties the trace.
+%
+% MPanStats('trace', true) also records every call (the last 4096 ones)
+% with its command, e.g. the PAN command of pansimc or the memwaveform of
+% panget; MPanStats('trace', false) stops recording.
+%
+% T = MPanStats('trace') returns the recorded calls, oldest first, as a
+% struct array with fields name, start (seconds since the last reset),
+% time, pan_time, bytes and label.
+%
+% MPanStats('dump', FILE) writes the recorded calls to FILE, in JSON format
+% if FILE ends with .json and in CSV format otherwise.
+%
+% See also
+%    panstats, MPanUpdateRawFilesList
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+if nargin == 0
+    ACTION = 'report';
+end
+
+switch ACTION
+    case 'report'
+        C = panstats();
+        S = struct();
+        for k = 1:numel(C.name)
+            S.(C.name{k}) = struct('calls',C.calls(k),'time',C.time(k), ...
+                'pan_time',C.pan_time(k),'marshal_time',C.time(k) - C.pan_time(k), ...
+                'bytes',C.bytes(k));
+        end
+        varargout{1} = S;
+    case 'reset'
+        panstats('reset');
+    case 'trace'
+        if nargin > 1
+            panstats('trace', logical(varargin{1}));
+        else
+            varargout{1} = MPanStatsTrace();
+        end
+    case 'dump'
+        if nargin < 2
+            error('MPanSuiteError: the FILE to dump the trace to is missing.');
+        end
+        MPanStatsDump(varargin{1}, MPanStatsTrace());
+    otherwise
+        error('MPanSuiteError: unknown MPanStats action %s.', ACTION);
+end
+end
+
+function T = MPanStatsTrace()
+R = panstats('trace');
+T = struct('name',R.name,'start',num2cell(R.start),'time',num2cell(R.time), ...
+    'pan_time',num2cell(R.pan_time),'bytes',num2cell(R.bytes),'label',R.label);
+end
+
+function MPanStatsDump(FILE, T)
+[~,~,EXT] = fileparts(FILE);
+fileID = fopen(FILE,'w');
+if fileID < 0
+    error('MPanSuiteError: the file %s cannot be opened.', FILE);
+end
+if strcmpi(EXT,'.json')
+    fprintf(fileID,'%s\n',jsonencode(T));
+else
+    fprintf(fileID,'name,start,time,pan_time,bytes,label\n');
+    for k = 1:numel(T)
+        fprintf(fileID,'%s,%.9f,%.9f,%.9f,%d,"%s"\n',T(k).name,T(k).start, ...
+            T(k).time,T(k).pan_time,T(k).bytes,strrep(T(k).label,'"','""'));
+    end
+end
+fclose(fileID);
+end
@@ -10,6 +10,10 @@ KeyNames = fieldnames(OPTIONS);
 m = numel(KeyNames);
 for k = 1:m
     key = KeyNames{k};
+    if strcmp(key,'async')
+        % Not a PAN option: the wrappers use it to run in background.
+        continue
+    end
     if ~isempty(OPTIONS.(key))
         if strcmp(key,'savelist') || strcmp(key,'mem') || strcmp(key,'statevars')
             str_command = MPanListOfWords(str_command, OPTIONS, key);
@@ -4,6 +4,11 @@ function MPanUpdateRawFilesList()
 %
 % Usage: MPanUpdateRawFilesList()
 %
+% It is called at the end of every analysis. Only the RAW files written by
+% PAN are listed: the columnar companions of MPanRawConvert (.rawc), the
+% index store of MPanRawIndex, the folders of MPanSweep (NAME.sweep) and
+% the files of the asynchronous analyses (async.*) are left out.
+%
 % Angelo Brambilla - Federico Bizzarri - Daniele Linaro
 % Copyright (c) 2015.
 % Revision: 2.0 $Date: 2022/03/10$
@@ -18,28 +23,19 @@ if isempty(MPanSuite_NETLIST_INFO) || ...
         'MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_RAW_DIR is empty.']);
 end
 
+t0 = tic;
 D = dir(MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_RAW_DIR);
 
-for k = 1:numel(D)
-    if strcmp(D(k).name ,'.')
-        D = [D(1:k-1); D(k+1:end)];
-        break
-    end
-end
-for k = 1:numel(D)
-    if strcmp(D(k).name ,'..')
-        D = [D(1:k-1); D(k+1:end)];
-        break
-    end
-end
-for k = 1:numel(D)
-    if strcmp(D(k).name ,'rawindex')
-        D = [D(1:k-1); D(k+1:end)];
-        break
-    end
-end
+names = {D.name};
+skip = ismember(names, {'.','..','rawindex','rawindex.mpan.mat'}) | ...
+    endsWith(names, '.rawc') | ([D.isdir] & endsWith(names, '.sweep')) | ...
+    ~cellfun(@isempty, regexp(names, '(^|\.)async\.', 'once'));
+D = D(~skip);
 
 for k = numel(D):-1:1
     tmp = rmfield(D(k),{'isdir','datenum'});
     MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_RAW_FILES(k,1) = tmp;
 end
+
+% The directory scan is reported by MPanStats.
+panstats('record', 'MPanUpdateRawFilesList', toc(t0));
@@ -0,0 +1,73 @@
+function [Y, T] = MPanVarDecimateRawFile(FILE, LIST, WIDTH, varargin)
+% MPanVarDecimateRawFile reduces a set of variables stored in a RAW file
+% to the few points needed to plot them.
+%
+% Usage: [Y, T] = MPanVarDecimateRawFile(FILE, LIST, WIDTH)
+%        [Y, T] = MPanVarDecimateRawFile(FILE, LIST, WIDTH, 'mode', MODE)
+%        [Y, T] = MPanVarDecimateRawFile(FILE, LIST, WIDTH, 'window', [T0 T1])
+%
+% [Y, T] = MPanVarDecimateRawFile(FILE, LIST, WIDTH) returns, for every
+% variable of the RAW file named FILE specified in LIST (as in
+% MPanVarGetRawFile), at most 2*WIDTH samples, Y, and the corresponding
+% time samples, T, such that plot(T, Y) drawn WIDTH pixels wide looks like
+% the plot of the whole variables: the smallest and the largest sample of
+% every pixel are kept. Columns with fewer points are padded with NaN.
+% The variables are never copied into MATLAB: FILE (or its columnar
+% companion written by MPanRawConvert) is scanned by the pandownsample
+% MEX file, one variable per thread.
+%
+% MODE can be 'minmax' (the default) or 'lttb': the latter keeps 2*WIDTH
+% samples chosen by the Largest-Triangle-Three-Buckets algorithm, which
+% looks smoother but may miss isolated spikes. 'window', [T0 T1] only
+% considers the samples with T0 <= time <= T1. Only real RAW files (e.g.
+% tran or dc analyses) can be decimated: the time axis is variable 0.
+%
+% See also
+%    MPanVarGetRawFile, MPanVarInRawFile, MPanWaveform, pandownsample
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+if nargin < 3
+    error('MPanSuiteError: at least 3 inputs are needed.');
+end
+if exist('pandownsample','file') ~= 3
+    error('MPanSuiteError: the pandownsample MEX file is not available.');
+end
+
+Y = [];
+T = [];
+
+[GETLIST, ~, INDEX] = MPanVarInRawFile(FILE);
+if isempty(GETLIST)
+    return
+end
+if strncmp(GETLIST(1).FLAGS,'complex',7)
+    error('MPanSuiteError: %s is a complex RAW file: it can not be decimated.', ...
+        FILE);
+end
+
+num_var = numel(GETLIST);
+if ~iscell(LIST)
+    LIST = num2cell(LIST);
+end
+
+VAR_INDEX = zeros(1,numel(LIST));
+for j = 1:numel(LIST)
+    if isnumeric(LIST{j}) && isscalar(LIST{j}) && LIST{j} >= 0 && ...
+            LIST{j} < num_var && LIST{j} == fix(LIST{j})
+        VAR_INDEX(j) = LIST{j};
+    elseif (ischar(LIST{j}) || isstring(LIST{j})) && ...
+            isKey(INDEX.MAP, char(LIST{j}))
+        VAR_INDEX(j) = INDEX.MAP(char(LIST{j}));
+    else
+        warning(['MPanSuiteWarning: at least one of the variables ' ...
+            'in the input LIST are not found in %s. ' ...
+            'The first one is:'],FILE);
+        display(LIST{j});
+        return
+    end
+end
+
+[Y, T] = pandownsample(INDEX.FILE, WIDTH, 'raw', VAR_INDEX, varargin{:});
@@ -1,8 +1,11 @@
-function DATA = MPanVarGetRawFile(FILE, LIST, varargin)
+function [DATA, SCALE, OFFSET] = MPanVarGetRawFile(FILE, LIST, varargin)
 % DATA = MPanVarInRawFile(FILE, LIST, STRATEGY) returns a set of variables,
 % stored in the RAW file named FILE, specified in LIST.
 %
 % Usage: DATA = MPanVarGetRawFile(FILE, LIST, STRATEGY)
+%        DATA = MPanVarGetRawFile(FILE, LIST, STRATEGY, CLASS)
+%        DATA = MPanVarGetRawFile(FILE, LIST, CLASS)
+%        [Q, SCALE, OFFSET] = MPanVarGetRawFile(FILE, LIST, 'int16')
 %
 % DATA = MPanVarInRawFile(FILE, LIST, STRATEGY) returns a set of variables,
 % stored in the RAW file named FILE, specified in LIST.
@@ -10,33 +13,69 @@ function DATA = MPanVarGetRawFile(FILE, LIST, varargin)
 % array if text labes or both text labels and integer indices are used to
 % indentify the requested variables, or a vector of integer if only indices
 % are used. Whatever the indexing choice, a variable must be present only
-% once in LIST. If STRATEGY is not specified it assumed to be SLOW. The
-% user can choose between FAST and SLOW. The FAST mode laod in memory the
-% whole FILE and then discards the columns not required trought LIST. If
-% SLOW mode is selected then the FILE is read one row at a time. If FILE
-% is large with respect to the RAM size the SLOW mode is recommended.
+% once in LIST. If STRATEGY is not specified it assumed to be NATIVE. The
+% user can choose between NATIVE, FAST and SLOW. The NATIVE mode uses the
+% panrawread MEX file, which maps FILE in memory and copies only the
+% columns required through LIST: its memory footprint is bounded by the
+% size of DATA. If panrawread is not available SLOW is assumed. The FAST
+% mode laod in memory the whole FILE and then discards the columns not
+% required trought LIST. If SLOW mode is selected then the FILE is read one
+% row at a time. If FILE is large with respect to the RAM size the SLOW
+% mode is recommended among the two. The header of FILE is parsed once
+% and indexed by MPanRawIndex, so that labels are looked up in constant
+% time and repeated reads of the same FILE skip the header.
+% If FILE has been converted by MPanRawConvert, its columnar companion is
+% read instead, whatever STRATEGY: only the chunks of the variables in
+% LIST are read from disk. A compressed companion requires panrawread.
+%
+% CLASS can be 'double' (the default), 'single' or 'int16'. With 'single'
+% DATA is returned in single precision, halving its memory; in NATIVE mode
+% the samples are converted by panrawread while they are copied. With
+% 'int16' every real column is quantised: Q has the class int16 and
+% double(Q(:,k))*SCALE(k) + OFFSET(k) approximates the k-th variable within
+% SCALE(k)/2, OFFSET being the centre and 32767*SCALE the half width of the
+% range of its finite samples. NaN samples are stored as intmin('int16').
+% Complex variables can not be quantised.
 %
 % See also
-%    MPanVarInRawFile
+%    MPanVarInRawFile, MPanRawIndex, MPanRawConvert
 %
 % Angelo Brambilla - Federico Bizzarri - Daniele Linaro
 % Copyright (c) 2015.
 % Revision: 2.0 $Date: 2022/03/10$
-if nargin < 2 || nargin > 3
-    error('MPanSuiteError: 2 or 3 inputs are needed.');
+SCALE = [];
+OFFSET = [];
+CLASS = 'double';
+CLASSES = {'double','single','int16'};
+if nargin < 2 || nargin > 4
+    error('MPanSuiteError: 2, 3 or 4 inputs are needed.');
 elseif nargin == 2
-    STRATEGY = 'SLOW';
-elseif nargin == 3
-    if (strcmp(varargin{1},'SLOW') || strcmp(varargin{1},'FAST'))
+    STRATEGY = 'NATIVE';
+elseif nargin == 3 && any(strcmp(varargin{1},CLASSES))
+    STRATEGY = 'NATIVE';
+    CLASS = varargin{1};
+else
+    if (strcmp(varargin{1},'SLOW') || strcmp(varargin{1},'FAST') || ...
+            strcmp(varargin{1},'NATIVE'))
         STRATEGY = varargin{1};
     else
-        warning(['MPanSuiteWarning: STRATEGY must be set to SLOW or ' ...
-            'FAST. %s has been wrongly chose and SLOW is assumed'],...
+        warning(['MPanSuiteWarning: STRATEGY must be set to NATIVE, SLOW or ' ...
+            'FAST. %s has been wrongly chose and NATIVE is assumed'],...
             varargin{1});
-        STRATEGY = 'SLOW';
+        STRATEGY = 'NATIVE';
+    end
+    if nargin == 4
+        if ~any(strcmp(varargin{2},CLASSES))
+            error('MPanSuiteError: CLASS must be double, single or int16.');
+        end
+        CLASS = varargin{2};
     end
 end
 
+if strcmp(STRATEGY,'NATIVE') && exist('panrawread','file') ~= 3
+    STRATEGY = 'SLOW';
+end
+
 switch STRATEGY
     case 'SLOW'
         slow = true;
@@ -46,7 +85,7 @@ end
         
 DATA = [];
 
-[GETLIST, FULL_FILE_NAME] = MPanVarInRawFile(FILE);
+[GETLIST, ~, INDEX] = MPanVarInRawFile(FILE);
 if isempty(GETLIST)
     DATA = [];
     return
@@ -74,17 +113,17 @@ else
     ib = 1:numel(LIST);
     ia = numel(LIST);
     for j = 1:numel(LIST)
-        k = 1;
         GO = true;
-        while k < num_var + 1 && GO
-            if isnumeric(LIST{j}) && GETLIST(k).VAR_INDEX == LIST{j}
-                ia(j) = GETLIST(k).VAR_INDEX + 1;
-                GO = false;
-            elseif strcmp(GETLIST(k).VAR_NAME,LIST{j})
-                ia(j) = GETLIST(k).VAR_INDEX + 1;
+        if isnumeric(LIST{j})
+            if isscalar(LIST{j}) && LIST{j} >= 0 && LIST{j} < num_var && ...
+                    LIST{j} == fix(LIST{j})
+                ia(j) = LIST{j} + 1;
                 GO = false;
             end
-            k = k +1;
+        elseif (ischar(LIST{j}) || isstring(LIST{j})) && ...
+                isKey(INDEX.MAP, char(LIST{j}))
+            ia(j) = INDEX.MAP(char(LIST{j})) + 1;
+            GO = false;
         end
         if GO
             warning(['MPanSuiteWarning: at least one of the variables ' ...
@@ -103,34 +142,64 @@ else
     end
 end
 
-fileID = fopen(FULL_FILE_NAME);
-ch1='';
-ch2='';
-ch3='';
-ch4='';
-ch5='';
-ch6='';
-ch7='';
-while ~strncmp([ch1 ch2 ch3 ch4 ch5 ch6 ch7],'Binary:',7)
-    ch1 = ch2;
-    ch2 = ch3;
-    ch3 = ch4;
-    ch4 = ch5;
-    ch5 = ch6;
-    ch6 = ch7;
-    ch7 = fread(fileID, 1, 'uint8=>char');
-    if( feof( fileID ) )
-        fclose(fileID);
-        DATA = [];
-        return;
+if strcmp(CLASS,'int16') && strncmp(GETLIST(1).FLAGS,'complex',7)
+    error(['MPanSuiteError: %s is a complex RAW file: its variables ' ...
+        'can not be quantised to int16.'], FILE);
+end
+
+COLUMNAR = strcmp(INDEX.LAYOUT,'columnar');
+if COLUMNAR && exist('panrawread','file') == 3
+    STRATEGY = 'NATIVE';
+elseif COLUMNAR && INDEX.CODEC ~= 0
+    error(['MPanSuiteError: %s is a compressed columnar RAW file: ' ...
+        'panrawread is needed to read it.'], INDEX.FILE);
+end
+
+if strcmp(STRATEGY,'NATIVE')
+    VAR_INDEX = zeros(1,numel(LIST));
+    VAR_INDEX(ib) = ia - 1;
+    if strcmp(CLASS,'int16')
+        [DATA, SCALE, OFFSET] = panrawread(INDEX.FILE, VAR_INDEX, CLASS);
+    else
+        DATA = panrawread(INDEX.FILE, VAR_INDEX, CLASS);
     end
+    return
+end
+
+fileID = fopen(INDEX.FILE);
+if fseek(fileID, INDEX.DATA_OFFSET, 'bof') ~= 0
+    fclose(fileID);
+    DATA = [];
+    return;
 end
-fread(fileID, 1, 'uint8=>char');
 
 num_samples = GETLIST(1).NUM_SAMPLES;
-DATA = zeros(num_samples,numel(LIST));
+if strcmp(CLASS,'single')
+    DATA = zeros(num_samples,numel(LIST),'single');
+else
+    DATA = zeros(num_samples,numel(LIST));
+end
 
-if slow
+if COLUMNAR
+    % Every column is read chunk by chunk, through the chunk table.
+    IS_COMPLEX = strncmp(GETLIST(1).FLAGS,'complex',7);
+    for h = 1:numel(ib)
+        fseek(fileID, INDEX.TABLE_OFFSET + 16*INDEX.NUM_CHUNKS*(ia(h)-1), 'bof');
+        TABLE = fread(fileID, [2 INDEX.NUM_CHUNKS], 'uint64');
+        A = zeros(num_samples*(1+IS_COMPLEX), 1);
+        p = 0;
+        for c = 1:INDEX.NUM_CHUNKS
+            fseek(fileID, TABLE(1,c), 'bof');
+            A(p+1:p+TABLE(2,c)/8) = fread(fileID, TABLE(2,c)/8, 'real*8');
+            p = p + TABLE(2,c)/8;
+        end
+        if IS_COMPLEX
+            DATA(:,ib(h)) = complex(A(1:2:end), A(2:2:end));
+        else
+            DATA(:,ib(h)) = A;
+        end
+    end
+elseif slow
     if ~strncmp(GETLIST(1).FLAGS,'complex',7)
         for k = 1:num_samples
             A = fread(fileID,[num_var 1],'real*8');
@@ -157,3 +226,33 @@ else
     end
 end
 fclose(fileID);
+
+if strcmp(CLASS,'int16')
+    [DATA, SCALE, OFFSET] = MPanVarQuantize(DATA);
+end
+end
+
+function [Q, SCALE, OFFSET] = MPanVarQuantize(DATA)
+% Same quantisation as panrawread(FILE, VAR_INDEX, 'int16').
+if ~isreal(DATA)
+    error('MPanSuiteError: complex variables can not be quantised to int16.');
+end
+N = size(DATA,2);
+SCALE = ones(1,N);
+OFFSET = zeros(1,N);
+if isempty(DATA)
+    Q = zeros(size(DATA),'int16');
+    return
+end
+F = DATA;
+F(~isfinite(F)) = NaN;
+MN = min(F,[],1);
+MX = max(F,[],1);
+K = ~isnan(MN);
+OFFSET(K) = MN(K)/2 + MX(K)/2;
+SCALE(K) = (MX(K)/2 - MN(K)/2)/32767;
+SCALE(SCALE == 0) = 1;
+Q = bsxfun(@times, bsxfun(@minus, DATA, OFFSET), 1./SCALE);
+Q = int16(max(min(Q, 32767), -32767));
+Q(isnan(DATA)) = intmin('int16');
+end
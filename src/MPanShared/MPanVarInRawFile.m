@@ -4,6 +4,7 @@ function [varargout] = MPanVarInRawFile(FILE)
 %
 % Usage: LIST = MPanVarInRawFile(FILE)
 %        [LIST, FULL_FILE_PATH] = MPanVarInRawFile(FILE)
+%        [LIST, FULL_FILE_PATH, INDEX] = MPanVarInRawFile(FILE)
 %
 % LIST = MPanVarInRawFile(FILE) checks if the global variable
 % MPan_NETLIST_INFO exist. In this case it looks for FILE in such a
@@ -15,23 +16,26 @@ function [varargout] = MPanVarInRawFile(FILE)
 % [LIST, FULL_FILE_PATH] = MPanVarInRawFile(FILE) works as above and
 % moreover the full name of the requested file is given.
 %
+% [LIST, FULL_FILE_PATH, INDEX] = MPanVarInRawFile(FILE) also returns the
+% header index of the file (see MPanRawIndex). The header is parsed only
+% the first time a file is accessed, or after it has been rewritten.
+%
 % See also
-%    MPanVarGetRawFile
+%    MPanVarGetRawFile, MPanRawIndex
 %
 % Angelo Brambilla - Federico Bizzarri 
 % Copyright (c) 2015.
 % Revision: 1.0.1 $Date: 2015/08/04$
-if nargout > 2
-    error('MPanSuiteError: no more than two output variables can be specified.');
+if nargout > 3
+    error('MPanSuiteError: no more than three output variables can be specified.');
 end
 
 if nargout == 0
     error('MPanSuiteError: at least one output is provided.');
 elseif nargout == 1
     varargout{1} = [];
-elseif nargout == 2
-    varargout{1} = [];
-    varargout{2} = [];
+else
+    varargout(1:nargout) = {[]};
 end
 
 global MPanSuite_NETLIST_INFO
@@ -60,40 +64,16 @@ else
     end
 end
 
-fileID = fopen(FULL_FILE_NAME);
-tline  = 'INITIAL DUMMY VALUE FOR TLINE';
-while ~strncmp(tline,'Binary:',7)
-    tline = fgetl(fileID);
-    if strncmp(tline,'Flags',5)
-        tf  = find(isspace(tline));
-        var_type = tline(tf(1)+1: end);
-    end
-    if strncmp(tline,'No. Variables: ',15)
-        tf  = find(isspace(tline));
-        num_var = str2double(tline(tf(2)+1: tf(3)-1));
-    end
-    if strncmp(tline,'No. Points: ',12)
-        tf  = find(isspace(tline));
-        num_samples = str2double(tline(tf(2)+1: tf(3)-1));
-    end
-    if strncmp(tline,'Variables: ',12)
-        break
-    end
-end
-
-LIST(1:num_var,1)=struct('VAR_INDEX',NaN,'VAR_NAME',[],'VAR_TYPE',[],'NUM_SAMPLES',NaN,'FLAGS',[]);
-for k = 1:num_var
-    tline = fgetl(fileID);
-    tf  = find(isspace(tline));
-    LIST(k).VAR_INDEX = k-1;
-    name = char(tline(tf(2)+1:tf(3)-1));
-    LIST(k).VAR_NAME  = name;
-    LIST(k).VAR_TYPE  = char(tline(tf(4)+1:end));
-    LIST(k).NUM_SAMPLES = num_samples;
-    LIST(k).FLAGS = var_type;
+INDEX = MPanRawIndex(FULL_FILE_NAME);
+if isempty(INDEX)
+    return
 end
+LIST = INDEX.LIST;
 
 varargout{1} = LIST;
-if nargout == 2
+if nargout >= 2
     varargout{2} = FULL_FILE_NAME;
 end
+if nargout == 3
+    varargout{3} = INDEX;
+end
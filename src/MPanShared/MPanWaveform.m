@@ -0,0 +1,178 @@
+classdef MPanWaveform < handle
+% MPanWaveform is a lightweight handle to a memwaveform kept in the PAN
+% memory. Samples are copied into MATLAB only when they are indexed.
+%
+% Usage: H = MPanWaveform(NAME)
+%        H = MPanWaveform(NAME, TIMENAME)
+%        H = panget(NAME, 'handle')
+%
+% H = MPanWaveform(NAME) returns a handle to the memwaveform NAME (e.g.
+% 'Tr1.v'). size(H), numel(H) and length(H) do not copy any sample.
+% H(1e6:2e6), H(end-N:end) or H(1:10:end) copy only the requested rows
+% (for multi-column waveforms H(ROWS, COLS) can be used as well). A
+% constant stride is used to decimate the waveform while reading it.
+%
+% Y = H.window(T0, T1) returns the samples with T0 <= time <= T1 and
+% Y = H.window(T0, T1, STRIDE) decimates them. [Y, T] = H.window(...) also
+% returns the corresponding time samples. The time axis is the "time"
+% memwaveform of the same analysis (e.g. 'Tr1.time'), unless TIMENAME is
+% given.
+%
+% Y = H.get() returns the whole waveform, as panget(NAME) does.
+%
+% [Y, T] = H.decimate(WIDTH) reduces the waveform to at most 2*WIDTH
+% points per column for a plot WIDTH pixels wide, without copying it into
+% MATLAB: the smallest and the largest sample of every pixel are kept, so
+% that plot(T, Y) draws the same envelope as the whole waveform. The
+% options of pandownsample can be given, e.g.
+% H.decimate(WIDTH, 'mode', 'lttb', 'window', [T0 T1]).
+%
+% See also
+%    panget, panslice, pandownsample
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+    properties (SetAccess = private)
+        Name
+        TimeName
+        Rows
+        Cols
+    end
+
+    methods
+        function obj = MPanWaveform(NAME, TIMENAME)
+            if isstring(NAME)
+                NAME = char(NAME);
+            end
+            obj.Name = NAME;
+            if nargin > 1
+                obj.TimeName = char(TIMENAME);
+            else
+                k = find(NAME == '.', 1);
+                if isempty(k)
+                    obj.TimeName = 'time';
+                else
+                    obj.TimeName = [NAME(1:k) 'time'];
+                end
+            end
+            SZ = panslice(NAME);
+            obj.Rows = SZ(1);
+            obj.Cols = SZ(2);
+        end
+
+        function varargout = size(obj, DIM)
+            SZ = [obj.Rows obj.Cols];
+            if nargin > 1
+                varargout{1} = SZ(DIM);
+            elseif nargout <= 1
+                varargout{1} = SZ;
+            else
+                varargout = num2cell(SZ);
+            end
+        end
+
+        function N = numel(obj, varargin)
+            if nargin > 1
+                N = 1;
+            else
+                N = obj.Rows*obj.Cols;
+            end
+        end
+
+        function N = length(obj)
+            N = max(obj.Rows, obj.Cols);
+        end
+
+        function E = end(obj, K, N)
+            if N == 1
+                E = obj.Rows*obj.Cols;
+            elseif K == 1
+                E = obj.Rows;
+            else
+                E = obj.Cols;
+            end
+        end
+
+        function Y = get(obj)
+            Y = panslice(obj.Name, 1, obj.Rows);
+        end
+
+        function [Y, T] = decimate(obj, WIDTH, varargin)
+            [Y, T] = pandownsample(obj.Name, WIDTH, 'time', obj.TimeName, ...
+                varargin{:});
+        end
+
+        function [Y, T] = window(obj, T0, T1, STRIDE)
+            if nargin < 4
+                STRIDE = 1;
+            end
+            IDX = panslice(obj.TimeName, 'window', T0, T1);
+            if IDX(1) > IDX(2)
+                Y = panslice(obj.Name, 1, 0);
+                T = zeros(0,1);
+                return
+            end
+            Y = panslice(obj.Name, IDX(1), IDX(2), STRIDE);
+            if nargout > 1
+                T = panslice(obj.TimeName, IDX(1), IDX(2), STRIDE);
+            end
+        end
+
+        function varargout = subsref(obj, S)
+            if ~strcmp(S(1).type, '()')
+                [varargout{1:nargout}] = builtin('subsref', obj, S);
+                return
+            end
+            if numel(S(1).subs) > 2
+                error('MPanSuiteError: a memwaveform has two dimensions.');
+            end
+            ROWS = S(1).subs{1};
+            if numel(S(1).subs) == 1 && obj.Cols > 1 && ~ischar(ROWS)
+                error('MPanSuiteError: use H(ROWS, COLS) for multi-column memwaveforms.');
+            end
+            Y = obj.getRows(ROWS);
+            if numel(S(1).subs) == 2
+                Y = Y(:, S(1).subs{2});
+            end
+            if numel(S) > 1
+                Y = subsref(Y, S(2:end));
+            end
+            varargout{1} = Y;
+        end
+    end
+
+    methods (Access = private)
+        function Y = getRows(obj, ROWS)
+            if ischar(ROWS) && strcmp(ROWS, ':')
+                Y = panslice(obj.Name, 1, obj.Rows);
+                return
+            end
+            if islogical(ROWS)
+                ROWS = find(ROWS);
+            end
+            ROWS = ROWS(:).';
+            if isempty(ROWS)
+                Y = panslice(obj.Name, 1, 0);
+                return
+            end
+            if numel(ROWS) == 1
+                Y = panslice(obj.Name, ROWS, ROWS);
+                return
+            end
+            STEP = diff(ROWS);
+            if all(STEP == STEP(1)) && STEP(1) > 0
+                Y = panslice(obj.Name, ROWS(1), ROWS(end), STEP(1));
+            elseif all(STEP == STEP(1)) && STEP(1) < 0
+                Y = flipud(panslice(obj.Name, ROWS(end), ROWS(1), -STEP(1)));
+            else
+                % Arbitrary indices: only the rows between the smallest and
+                % the largest one are copied out of PAN.
+                FIRST = min(ROWS);
+                Y = panslice(obj.Name, FIRST, max(ROWS));
+                Y = Y(ROWS - FIRST + 1, :);
+            end
+        end
+    end
+end
@@ -26,6 +26,16 @@ function varargout = MPanShooting(NAME, MEMVARS, varargin)
 % input. If MEMVARS is empty S is empty. MEMVARS must be an array of
 % strings or a cell array of chars or a cell array of strings.
 %
+% F = MPanShooting(..., 'async', true) queues the analysis and returns at once
+% an MPanFuture F, while the analysis runs in background. S = fetch(F)
+% returns the MEMVARS waveforms once the analysis is completed and
+% wait(F) its error code. The analysis runs in a worker process on the
+% netlist file, with the parameters altered by MPanAlter (see MPanFuture).
+%
+% When MPanSolutionCache is enabled, the solution of the nearest previous
+% shooting analysis is loaded as initial guess, and 'period' or 'fund' are
+% needed only by the first analysis.
+%
 % Angelo Brambilla - Federico Bizzarri - Daniele Linaro
 % Copyright (c) 2015.
 % Revision: 2.0 $Date: 2022/03/10$
@@ -52,6 +62,8 @@ if nargin > 3
     end
 end
 
+[varargin, CACHE_ENTRY] = MPanSolutionCache('inject', 'shooting', varargin);
+
 OPTIONS = MPanOptions(varargin{:});
 if not(isfield(OPTIONS,'period')) && not(isfield(OPTIONS,'fund')) && not(isfield(OPTIONS,'load'))
     error('The shooting analysis requires an estimate of the working period or of the fundamental frequency.');
@@ -65,30 +77,37 @@ if nargout > 0 && ~isempty(MEMVARS)
     varargin{1,m+1} = 'mem';
     varargin{1,m+2} = MEMVARS;
     NAME_ = NAME;
-elseif  nargout > 0 && isempty(MEMVARS)
+elseif  nargout > 0 && isempty(MEMVARS) && ~any(strcmp(varargin(1:2:end),'async'))
     warning('The MEMVARS input is empty but an output has been required')
 end
 
 if nargin > 2
-    str_command = MPanStrCommandComplete(str_command,varargin{:});
+    [str_command, OPTIONS] = MPanStrCommandComplete(str_command,varargin{:});
 end
 
 clear NAME MEMVARS varargin
-pansimc(str_command);
+
+if exist('OPTIONS','var') && isfield(OPTIONS,'async') && isequal(OPTIONS.async,true)
+    if exist('NAME_','var') && isfield(OPTIONS,'mem') && ~isempty(OPTIONS.mem)
+        F = MPanFuture(str_command, NAME_, OPTIONS.mem);
+    else
+        F = MPanFuture(str_command);
+    end
+    if nargout == 1
+        varargout{1} = F;
+    end
+    return
+end
+
+ERR = pansimc(str_command);
+
+MPanSolutionCache('commit', CACHE_ENTRY, ERR);
 
 MPanUpdateRawFilesList();
 
 if nargout == 1
-    if ~isempty(OPTIONS.mem)
-        nmem = numel(OPTIONS.mem);
-        S = cell(nmem,1);
-        tmp = struct('label',[],'signal',[]);
-        for k = 1:nmem
-            tmp.label = OPTIONS.mem{k};
-            c_lab = [NAME_ '.' OPTIONS.mem{k}];
-            tmp.signal = panget(c_lab);
-            S{k} = tmp;
-        end
+    if isfield(OPTIONS,'mem') && ~isempty(OPTIONS.mem)
+        S = MPanGetMemVars(NAME_, OPTIONS.mem);
         varargout{1} = S;
     else
         warning('MPAnSuiteWarning: an output is expected but it is empty since the list mem in the OPTIONS struct is empty');
@@ -0,0 +1,70 @@
+function S = MPanBatch(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin)
+% MPanBatch runs the same PAN analysis for every point of a parameter
+% sweep without returning to MATLAB between the points. A netlist must be
+% already loaded with MPanNetLoad.
+%
+% Usage: S = MPanBatch(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS)
+%        S = MPanBatch(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin)
+%
+% S = MPanBatch(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS) alters the netlist
+% parameters PARAMS (a char or a cell array of chars) to each column of
+% VALUES (one row per parameter, one column per sweep point) and runs the
+% analysis ANALYSIS (e.g. 'dc' or 'shooting fund = 50') whose identifier
+% is NAME. The alter commands, the analysis and the collection of the
+% MEMVARS waveforms are all performed by the panbatch MEX file, so that
+% short analyses do not pay the MATLAB overhead of MPanAlter and of the
+% analysis wrappers at every point. S is a struct with fields
+%    label    the MEMVARS labels
+%    signal   a SAMPLES x numel(MEMVARS) x POINTS array, as in MPanSweep.
+%             Waveforms shorter than the longest one are padded with NaN
+%    samples  a numel(MEMVARS) x POINTS matrix with the number of samples
+%             of every waveform (0 if it was not collected)
+%    status   a 1 x POINTS vector with the error code of every point: 0 if
+%             the point succeeded, the PAN error code if the alter or the
+%             analysis failed, -4 if its waveforms could not be collected
+%             and NaN if it was not run
+% The sweep stops at the first point whose alter or analysis fails.
+% MEMVARS must be an array of strings or a cell array of chars or a cell
+% array of strings and must name single-column numeric waveforms: a point
+% whose MEMVARS are missing, strings or multi-column gets the status -4.
+%
+% S = MPanBatch(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin) works as
+% above. varargin must be a sequence of pairs as 'NAME1',VALUE1,... where
+% the name of the options and the allowed values are specified by the PAN
+% simulator documentation. The option "mem" cannot be used since it is
+% emulated by the MEMVARS input.
+%
+% See also
+%    MPanSweep, MPanAlter, MPanSweepArgs, panbatch
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+if nargin < 5
+    error('MPanSuiteError: at least 5 input arguments are required.')
+end
+[ALTER, VALUES, labels, str_command, ~, PARAMS] = ...
+    MPanSweepArgs(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin, struct());
+
+[Y, ROWS, STATUS] = panbatch(ALTER, VALUES, NAME, str_command, labels);
+
+% The circuit of the session keeps the values of the last point run.
+k = find(~isnan(STATUS), 1, 'last');
+if ~isempty(k)
+    for h = 1:numel(PARAMS)
+        MPanSolutionCache('alter', char(PARAMS{h}), VALUES(h,k));
+    end
+end
+
+MPanUpdateRawFilesList();
+
+S = struct('label',[],'signal',Y,'samples',ROWS,'status',STATUS);
+S.label = labels;
+
+if any(isnan(STATUS))
+    warning('MPanSuiteWarning: the sweep stopped at point %d (error %d).', k, STATUS(k));
+elseif any(STATUS)
+    warning('MPanSuiteWarning: %d of the %d sweep points failed. See the status field.', ...
+        nnz(STATUS), numel(STATUS));
+end
@@ -0,0 +1,89 @@
+function S = MPanSweep(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin)
+% MPanSweep runs the same PAN analysis for every point of a parameter
+% sweep, spreading the sweep points across several worker processes. A
+% netlist must be already loaded with MPanNetLoad.
+%
+% Usage: S = MPanSweep(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS)
+%        S = MPanSweep(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin)
+%
+% S = MPanSweep(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS) alters the netlist
+% parameters PARAMS (a char or a cell array of chars) to each column of
+% VALUES (one row per parameter, one column per sweep point) and runs the
+% analysis ANALYSIS (e.g. 'tran tstop = 1e-3' or 'shooting fund = 50')
+% whose identifier is NAME. The waveforms MEMVARS of every point are
+% collected in the struct S with fields
+%    label    the MEMVARS labels
+%    signal   a SAMPLES x numel(MEMVARS) x POINTS array. Waveforms shorter
+%             than the longest one are padded with NaN
+%    samples  a numel(MEMVARS) x POINTS matrix with the number of samples
+%             of every waveform (0 if it was not found)
+%    status   a 1 x POINTS vector with the error code of every point: 0 if
+%             the point succeeded, the PAN error code if the alter or the
+%             analysis failed, -1 if the point was not run, -2 if its
+%             worker died while running it, -3 if its waveforms did not
+%             fit in the result array, -4 if its waveforms could not be
+%             collected, -5 if it did not complete within the time limit
+%             and -6 if its worker could not load the netlist
+% MEMVARS must be an array of strings or a cell array of chars or a cell
+% array of strings and must name single-column numeric waveforms with the
+% same number of samples: a point whose MEMVARS are missing, multi-column
+% or of different lengths gets the status -4.
+%
+% S = MPanSweep(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin) works as
+% above. varargin must be a sequence of pairs as 'NAME1',VALUE1,... where
+% 'workers' sets the number of worker processes (by default the number of
+% cores), 'timeout' the seconds a point may take (by default 3600, Inf for
+% no limit), 'samples' the number of samples reserved for every waveform
+% (see below) and the other names are options of the analysis, as
+% specified by the PAN simulator documentation. The option "mem" cannot be
+% used since it is emulated by the MEMVARS input.
+%
+% Every worker is a panrun process (see mex_so/panrun.c) that loads the
+% netlist file on its own, without MATLAB, and then replays the parameters
+% altered in the MATLAB session with MPanAlter or MPanBatch since the
+% netlist was loaded (see MPanSolutionCache). The other commands given to
+% pansimc are not replayed, and the alter commands of the sweep do not
+% change the circuit of the MATLAB session. Netlists whose macro devices
+% are evaluated by MATLAB functions (evaluate=) can not be swept, since the
+% workers have no MATLAB: an error is raised as soon as a worker calls
+% one, and such netlists can be swept with MPanBatch. Consecutive sweep
+% points are run by the same worker, and a worker that is done steals half
+% of the points left to the busiest one. A worker that exceeds the time
+% limit is killed and started again for the points left.
+%
+% The workers write the waveforms straight into one result array in shared
+% memory, preallocated when the first point completes: every waveform gets
+% as many samples as that point has, or 'samples' if they are more. A
+% point whose waveforms are longer (e.g. a tran with adaptive time step)
+% gets the status -3: set 'samples' to the longest expected waveform. The
+% workers run in NAME.sweep/k, in the raw files folder of the netlist, and
+% write the console output of PAN in NAME.sweep/k.log.
+%
+% See also
+%    MPanBatch, MPanAlter, MPanSweepArgs, MPanSolutionCache, pansweep
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+global MPanSuite_NETLIST_INFO
+if nargin < 5
+    error('MPanSuiteError: at least 5 input arguments are required.')
+end
+[ALTER, VALUES, labels, str_command, OPTS] = ...
+    MPanSweepArgs(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, varargin, ...
+    struct('workers',[],'timeout',3600,'samples',[]));
+
+DIR = fullfile(MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_RAW_DIR, [NAME '.sweep']);
+INIT = MPanSolutionCache('replay', NAME);
+[Y, ROWS, STATUS] = pansweep(MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_FILE, DIR, ...
+    INIT, ALTER, VALUES, NAME, str_command, labels, OPTS.workers, OPTS.timeout, ...
+    OPTS.samples);
+
+S = struct('label',[],'signal',Y,'samples',ROWS,'status',STATUS);
+S.label = labels;
+
+if any(STATUS)
+    warning('MPanSuiteWarning: %d of the %d sweep points failed. See the status field.', ...
+        nnz(STATUS), numel(STATUS));
+end
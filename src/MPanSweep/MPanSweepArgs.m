@@ -0,0 +1,68 @@
+function [ALTER, VALUES, LABELS, COMMAND, OPTS, PARAMS] = MPanSweepArgs(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, OPTIONS, DEFAULTS)
+% MPanSweepArgs checks and prepares the arguments shared by MPanSweep and
+% MPanBatch.
+%
+% Usage: [ALTER, VALUES, LABELS, COMMAND, OPTS, PARAMS] = ...
+%            MPanSweepArgs(NAME, PARAMS, VALUES, ANALYSIS, MEMVARS, OPTIONS, DEFAULTS)
+%
+% NAME, PARAMS, VALUES, ANALYSIS and MEMVARS are the inputs of MPanSweep
+% and MPanBatch, OPTIONS their varargin. ALTER holds one alter command
+% per parameter, to be completed with its value, VALUES has one row per
+% parameter, LABELS holds the MEMVARS names as chars and COMMAND is the
+% analysis completed with the options left in OPTIONS. The options named
+% by the fields of the struct DEFAULTS are removed from OPTIONS and
+% returned in the struct OPTS, with the value of DEFAULTS when they are
+% not given. PARAMS is returned as a cell array.
+%
+% See also
+%    MPanSweep, MPanBatch, MPanStrCommandComplete
+%
+% Angelo Brambilla - Federico Bizzarri - Daniele Linaro
+% Copyright (c) 2022.
+% Revision: 2.0 $Date: 2022/03/10$
+
+global MPanSuite_NETLIST_INFO
+if isempty(MPanSuite_NETLIST_INFO) || isempty(MPanSuite_NETLIST_INFO.MPanSuite_NETLIST_NAME)
+    error('MPanSuiteError: a MPanSuiteNetlist is not loaded yet.')
+end
+
+if rem(numel(OPTIONS),2) ~= 0
+    error('Beside NAME, PARAMS, VALUES, ANALYSIS and MEMVARS an even number of inputs is expected')
+end
+if isempty(MEMVARS)
+    error('MPanSuiteError: MEMVARS cannot be empty.')
+end
+
+if ischar(PARAMS) || isstring(PARAMS)
+    PARAMS = cellstr(PARAMS);
+end
+if size(VALUES,1) ~= numel(PARAMS)
+    if isvector(VALUES) && numel(PARAMS) == 1
+        VALUES = VALUES(:).';
+    else
+        error('MPanSuiteError: VALUES must have one row per parameter in PARAMS.')
+    end
+end
+
+OPTS = DEFAULTS;
+k = 1;
+while k < numel(OPTIONS)
+    if ischar(OPTIONS{k}) && isfield(DEFAULTS, OPTIONS{k})
+        OPTS.(OPTIONS{k}) = OPTIONS{k+1};
+        OPTIONS(k:k+1) = [];
+    else
+        k = k + 2;
+    end
+end
+
+ALTER = cell(1,numel(PARAMS));
+for k = 1:numel(PARAMS)
+    ALTER{k} = [NAME '_alter' num2str(k) ' alter param = "' char(PARAMS{k}) '" value = '];
+end
+
+LABELS = cell(1,numel(MEMVARS));
+for k = 1:numel(MEMVARS)
+    LABELS{k} = char(MEMVARS{k});
+end
+
+COMMAND = MPanStrCommandComplete(ANALYSIS, OPTIONS{:}, 'mem', MEMVARS);
@@ -27,6 +27,12 @@ function varargout = MPanTran(NAME, TSTOP, MEMVARS, varargin)
 % input. If MEMVARS is empty S is empty. MEMVARS must be an array of
 % strings or a cell array of chars or a cell array of strings.
 %
+% F = MPanTran(..., 'async', true) queues the analysis and returns at once
+% an MPanFuture F, while the analysis runs in background. S = fetch(F)
+% returns the MEMVARS waveforms once the analysis is completed and
+% wait(F) its error code. The analysis runs in a worker process on the
+% netlist file, with the parameters altered by MPanAlter (see MPanFuture).
+%
 % Angelo Brambilla - Federico Bizzarri - Daniele Linaro
 % Copyright (c) 2015.
 % Revision: 2.0 $Date: 2022/03/10$
@@ -61,7 +67,7 @@ if nargout > 0 && ~isempty(MEMVARS)
     varargin{1,m+1} = 'mem';
     varargin{1,m+2} = MEMVARS;
     NAME_ = NAME;
-elseif  nargout > 0 && isempty(MEMVARS)
+elseif  nargout > 0 && isempty(MEMVARS) && ~any(strcmp(varargin(1:2:end),'async'))
     warning('The MEMVARS input is empty but an output has been required')
 end
 
@@ -70,6 +76,19 @@ if nargin > 2
 end
 
 clear NAME TSTOP MEMVARS varargin
+
+if exist('OPTIONS','var') && isfield(OPTIONS,'async') && isequal(OPTIONS.async,true)
+    if exist('NAME_','var') && isfield(OPTIONS,'mem') && ~isempty(OPTIONS.mem)
+        F = MPanFuture(str_command, NAME_, OPTIONS.mem);
+    else
+        F = MPanFuture(str_command);
+    end
+    if nargout == 1
+        varargout{1} = F;
+    end
+    return
+end
+
 pansimc(str_command);
 
 MPanUpdateRawFilesList();
@@ -78,15 +97,7 @@ if nargout == 1
     S = [];
     if exist('OPTIONS','var') && isfield(OPTIONS,'mem')
         if ~isempty(OPTIONS.mem)
-            nmem = numel(OPTIONS.mem);
-            S = cell(nmem,1);
-            tmp = struct('label',[],'signal',[]);
-            for k = 1:nmem
-                tmp.label = OPTIONS.mem{k};
-                c_lab = [NAME_ '.' OPTIONS.mem{k}];
-                tmp.signal = panget(c_lab);
-                S{k} = tmp;
-            end
+            S = MPanGetMemVars(NAME_, OPTIONS.mem);
             varargout{1} = S;
         end
     end